@@ -16,29 +16,14 @@
 using namespace dg;
 using namespace std;
 
-#define MAX_DATA_LEN 1024
-
-struct LogFrameData
-{
-    std::vector<std::string> vps;
-    std::vector<std::string> ocr;
-    std::vector<std::string> logo;
-    std::vector<std::string> intersection;
-};
-
 class LogViewer
 {
 public:
     void run(std::string fname_log, std::string fname_cam, int sel)
     {
         // open log file
-        ifstream stream;
-        stream.open(fname_log, ios::in);
-        if (!stream.is_open())
-        {
-            printf("Error: can't open %s\n", fname_log.c_str());
-            return;
-        }
+        ReplayLog log;
+        if (!log.open(fname_log)) return;
 
         // open cam data
         cv::VideoCapture vc(fname_cam);
@@ -48,8 +33,8 @@ public:
             return;
         }
 
-        // build data
-        build(stream, vc);
+        // in case of broken video, total_frames is zero.
+        m_total_frames = std::max((int)(vc.get(cv::CAP_PROP_FRAME_COUNT)), log.size());
 
         // modules
         VPS vps;
@@ -87,9 +72,8 @@ public:
             // drawing
             int disp_delay = 1;
             double fps = -1;
-            if (sel == 0 && !m_data[fn].vps.empty())
+            if (sel == 0 && log.read(vps, fn))
             {
-                vps.read(m_data[fn].vps);
                 std::vector<VPSResult> svs;
                 vps.get(svs);
                 cv::Mat sv_image;
@@ -117,28 +101,25 @@ public:
             {
                 cv::hconcat(image, sv_black, image_disp);
             }
-            else if (sel == 1 && !m_data[fn].ocr.empty())
+            else if (sel == 1 && log.read(ocr, fn))
             {
                 image_disp = image;
-                ocr.read(m_data[fn].ocr);
                 ocr.draw(image_disp);
-                if (!m_data[fn].ocr.empty()) fps = 1.0 / ocr.procTime();
+                fps = 1.0 / ocr.procTime();
                 disp_delay = 2000;
             }
-            else if (sel == 2 && !m_data[fn].logo.empty())
+            else if (sel == 2 && log.read(logo, fn))
             {
                 image_disp = image;
-                logo.read(m_data[fn].logo);
                 logo.draw(image_disp);
-                if (!m_data[fn].logo.empty()) fps = 1.0 / logo.procTime();
+                fps = 1.0 / logo.procTime();
                 disp_delay = 2000;
             }
-            else if (sel == 3 && !m_data[fn].intersection.empty())
+            else if (sel == 3 && log.read(intersection, fn))
             {
                 image_disp = image;
-                intersection.read(m_data[fn].intersection);
                 intersection.draw(image_disp);
-                if (!m_data[fn].intersection.empty()) fps = 1.0 / intersection.procTime();
+                fps = 1.0 / intersection.procTime();
                 IntersectionResult intersect;
                 intersection.get(intersect);
                 if(intersect.cls>0) disp_delay = 300;
@@ -171,53 +152,6 @@ public:
 
 protected:
     int m_total_frames = 0;
-    std::vector<LogFrameData> m_data;
-
-    bool build(ifstream& stream, cv::VideoCapture& vc)
-    {
-        // in case of broken video, total_frames is zero.
-        m_data.clear();
-        m_total_frames = (int)(vc.get(cv::CAP_PROP_FRAME_COUNT));
-        if(m_total_frames>0) m_data.resize(m_total_frames);
-
-        // parse log data
-        char buf[MAX_DATA_LEN];
-        char buf_tmp[MAX_DATA_LEN];
-        int buf_len = MAX_DATA_LEN;
-        while (!stream.eof())
-        {
-            // read one line (skip blank lines)
-            buf[0] = '\0';
-            stream.getline(buf, buf_len);
-            while (!stream.eof() && buf[0] == '\0') stream.getline(buf, buf_len);
-            if (buf[0] == '\0' && stream.eof()) break;
-
-            // parse data
-            dg::Timestamp ts;
-            int fn = -1;
-            sscanf(buf, "%lf,%d,%s", &ts, &fn, buf_tmp);
-            int idx = (int)string(buf_tmp).find_first_of(',');
-            std::string name = string(buf_tmp).substr(0, idx);
-            while (fn >= 0 && m_total_frames <= fn)
-            {
-                m_data.push_back(LogFrameData());
-                m_total_frames++;
-            }
-            if (fn >= 0 && fn < m_total_frames)
-            {
-                if (name == "vps")
-                    m_data[fn].vps.push_back(std::string(buf));
-                else if (name == "ocr")
-                    m_data[fn].ocr.push_back(std::string(buf));
-                else if (name == "logo")
-                    m_data[fn].logo.push_back(std::string(buf));
-                else if (name == "intersection")
-                    m_data[fn].intersection.push_back(std::string(buf));
-            }
-        }
-
-        return true;
-    }
 };
 
 
@@ -237,6 +171,7 @@ int main(int argc, char* argv[])
     }
 
     std::string fname_log = dataname + ".txt";
+    if (BinaryLogReader::isBinaryLog(dataname + ".dglog")) fname_log = dataname + ".dglog";
     std::string fname_cam = dataname + "_cam.avi";
 
     LogViewer viewer;
@@ -14,6 +14,7 @@
 #include "dg_exploration.hpp"
 #include "dg_utils.hpp"
 #include <chrono>
+#include <sstream>
 #ifdef VPSSERVER
     #include <jsoncpp/json/json.h>
     #include <curl/curl.h>
@@ -36,7 +37,6 @@ public:
     int run();
 
     void procMouseEvent(int evt, int x, int y, int flags);
-    void procTTS();
 
 protected:
     bool loadConfig(std::string config_file);
@@ -55,6 +55,8 @@ protected:
     std::string m_srcdir = "./../src";              // path of deepguider/src (required for python embedding)
 
     std::string m_map_image_path = "data/NaverMap_ETRI(Satellite)_191127.png";
+    std::string m_map_tile_dir;                     // tiled pyramid of the map image (used instead of map_image_path if given)
+    cv::Size m_map_view_size = cv::Size(1920, 1080);  // gui window size for the tiled map image
     dg::LatLon m_map_ref_point = dg::LatLon(36.383837659737, 127.367880828442);
     double m_map_pixel_per_meter = 1.045;
     dg::Point2 m_map_canvas_offset = dg::Point2(344, 293);
@@ -62,22 +64,60 @@ protected:
     std::string m_video_input = "data/191115_ETRI.avi";
 
     bool m_use_high_gps = false;                    // use high-precision gps (novatel)
+    bool m_use_pipeline = false;                    // run modules as event-driven pipeline stages
+    bool m_local_routing = false;                   // find paths on the loaded map first (the routing server is used if failed)
+    std::string m_route_hierarchy;                  // precomputed contraction hierarchy for local routing (empty: not used)
+    std::string m_streetview_cache_dir;             // disk cache of streetview images (empty: not used)
+    int m_streetview_prefetch_nodes = 0;            // prefetch streetview images near this number of path nodes (0: not used)
+    std::vector<std::string> m_camera_names = { "front" };          // cameras (the first one is the main camera for gui and data logging)
+    std::map<std::string, std::vector<double>> m_camera_priorities; // share of each camera per recognizer (default: the main camera only)
+    std::map<std::string, int> m_input_reductions;                  // input image reduction (1, 2, 4, or 8) per recognizer (default: 1)
+    bool m_adaptive_rates = false;                  // set the rate of each recognizer by the guidance context
+    std::map<std::string, std::vector<double>> m_recognizer_rates = // [idle, active] rates of recognizers [Hz] (0: not run, negative: unlimited)
+        { { "intersection", { 0.5, 5 } }, { "vps", { 0.2, 2 } }, { "ocr", { 0.2, 3 } }, { "logo", { 0.2, 3 } }, { "roadtheta", { 2, 2 } } };
+    double m_vps_active_confidence = 0.5;           // vps is active if the pose confidence is lower than this
+    double m_poi_active_radius = 50;                // ocr and logo are active within this distance from POIs along the path [m]
+    bool m_result_cache = false;                    // reuse recent results of vps, ocr, and logo at the same place and heading if the scene is unchanged
+    double m_result_cache_cell = 2;                 // size of position cells of the result cache [m]
+    double m_result_cache_heading = 22.5;           // size of heading bins of the result cache [deg]
+    double m_result_cache_age = 3;                  // maximum age of reusable results [sec]
+    int m_result_cache_hash_distance = 6;           // maximum difference of image hashes of the same scene (0 ~ 64)
 
     bool m_data_logging = false;
+    bool m_data_log_binary = false;                 // write the data log in the binary chunked format (including gps, pose, and guidance)
     bool m_enable_tts = false;
     bool m_recording = false;
     int m_recording_fps = 30;
     std::string m_recording_header_name = "dg_simple_";
+    std::string m_metrics_file;                     // periodic dump of latency and counters (CSV, empty: disabled)
+    double m_metrics_period = 1;                    // period of the metrics dump [sec]
+    std::string m_trace_file;                       // trace events of the whole run (Chrome trace JSON, empty: disabled)
+    bool m_headless = false;                        // replay sensor data without GUI as fast as possible
+    std::string m_replay_log;                       // data log whose recognizer outputs are replayed instead of running the recognizers (empty: run the recognizers)
+    std::string m_replay_output = "dg_replay";      // header name of replay outputs (trajectory, guidance events, and timings)
+    dg::LatLon m_replay_dest = dg::LatLon(0, 0);    // destination of headless replay (0: the last gps position)
 
     // local variables
     cx::VideoWriter m_video_gui;
     cx::VideoWriter m_video_cam;
     std::ofstream m_log;
     cv::Mutex m_log_mutex;
-    cv::Mat m_map_image;
-    cv::Mat m_map_image_original;
+    dg::BinaryLogWriter m_binary_log;
+    dg::LayerCompositor m_gui;                      // gui map layers (base map, map graph, path, and trajectory) with dirty-region updates
+    cv::Mutex m_gui_mutex;
+    int m_gui_layer_graph = -1;
+    int m_gui_layer_path = -1;
+    int m_gui_layer_trajectory = -1;
+    dg::Path m_gui_path;
+    dg::MapSnapshot m_gui_map;
+    dg::MapSnapshot m_map_snapshot;
     dg::MapPainter m_painter;
     dg::MapCanvasInfo m_map_info;    
+    dg::MapTilePyramid m_map_tiles;
+    dg::MapCanvasInfo m_map_info_whole;             // canvas info of the whole tiled map image
+    dg::Point2 m_view_tl;                           // top-left corner of the gui view on the whole tiled map image
+    double m_view_zoom = 1;
+    cv::Point m_view_drag = cv::Point(-1, -1);
     dg::GuidanceManager::Motion m_guidance_cmd = dg::GuidanceManager::Motion::STOP;
     dg::GuidanceManager::GuideStatus m_guidance_status = dg::GuidanceManager::GuideStatus::GUIDE_INITIAL;
     std::list<dg::LatLon> m_gps_history_asen;
@@ -86,15 +126,19 @@ protected:
     // global variables
     dg::LatLon m_gps_start;
     dg::LatLon m_gps_dest;
-    bool m_dest_defined = false;
-    bool m_pose_initialized = false;
-    bool m_path_initialized = false;
+    std::atomic<bool> m_dest_defined{ false };
+    std::atomic<bool> m_pose_initialized{ false };
+    std::atomic<bool> m_path_initialized{ false };
+    cv::Mutex m_dest_mutex;                         // guards the destination and path updates, which are requested by the gui, localizer, and guidance threads (locked before the other mutexes)
     std::string m_winname = "DeepGuider";           // title of gui window
 
     // internal api's
     bool initializeDefaultMap();
     bool setDeepGuiderDestination(dg::LatLon gps_dest);
     bool updateDeepGuiderPath(dg::TopometricPose pose_topo, dg::LatLon gps_start, dg::LatLon gps_dest);
+    bool initializeGuiLayers(const cv::Mat& map_image);
+    bool updateGuiView();
+    void addGuiTrajectory(const dg::LatLon& gps);
     void drawGuiDisplay(cv::Mat& gui_image);
     void drawGuidance(cv::Mat image, dg::GuidanceManager::Guidance guide, cv::Rect rect);
     void drawLogo(cv::Mat target_image, std::vector<LogoResult> pois, cv::Size original_image_size);
@@ -107,14 +151,44 @@ protected:
     bool procOcr();
     bool procVps();
     bool procRoadTheta();
+    bool applyLocClue(const std::vector<dg::ID>& ids, const std::vector<dg::Polar2>& obs, const dg::CameraFrame& frame, const std::vector<double>& confs);
+
+    // pipelined run
+    struct GPSData
+    {
+        dg::LatLon gps;
+        dg::Timestamp ts = -1;
+    };
+    struct LocClueData
+    {
+        std::vector<dg::ID> ids;
+        std::vector<dg::Polar2> obs;
+        dg::Timestamp ts = -1;
+        std::vector<double> confs;
+    };
+    dg::Pipeline m_pipeline;
+    std::shared_ptr<dg::StageSignal> m_cam_signal;
+    std::shared_ptr<dg::StageSignal> m_localizer_signal;
+    std::shared_ptr<dg::StageSignal> m_guidance_signal;
+    std::shared_ptr<dg::BoundedQueue<GPSData>> m_gps_queue;
+    std::shared_ptr<dg::BoundedQueue<LocClueData>> m_clue_queue;
+    std::atomic<double> m_guidance_time;
+    int runPipeline();
+
+    // headless replay
+    dg::ReplayLog m_replay;
+    std::ofstream m_guidance_log;
+    int m_guidance_log_cmd = -1;
+    dg::ID m_guidance_log_node = 0;
+    int runReplay();
+    void writeGuidanceEvent(dg::Timestamp ts, dg::GuidanceManager::GuideStatus status, const dg::GuidanceManager::Guidance& guide);
+    template <typename T> bool applyRecognizer(T& recognizer, const dg::CameraFrame& frame, const cv::Mat& image);
+    template <typename T, typename R, typename F> bool applyCachedRecognizer(T& recognizer, dg::ResultCache<R>& cache, const dg::CameraFrame& frame, F apply, bool& reused);
+    template <typename T> void writeRecognizerLog(const T& recognizer, const dg::CameraFrame& frame);
 
     // tts
-    cv::Mutex m_tts_mutex;
-    std::vector<std::string> m_tts_msg;
-    std::thread* tts_thread = nullptr;
-    static void threadfunc_tts(DeepGuider* guider);
-    bool is_tts_running = false;
-    void putTTS(const char* msg);
+    dg::TTSService m_tts;
+    void putTTS(const char* msg, int priority = dg::TTSService::PRIORITY_NORMAL);
 
     // Thread routines
     std::thread* vps_thread = nullptr;
@@ -141,11 +215,20 @@ protected:
 #endif
 
     // shared variables for multi-threading
-    cv::Mutex m_cam_mutex;
-    cv::Mat m_cam_image;
-    dg::Timestamp m_cam_capture_time;
-    dg::LatLon m_cam_gps;
-    int m_cam_fnumber;              // frame number
+    dg::CameraHub m_cameras;                        // the latest frames of cameras (shared without copy) and the scheduler of recognizers across them
+    dg::Mailbox<GPSData> m_gps_mailbox;             // the latest gps datum
+    int m_cam_fnumber;              // frame number of the latest frame of the main camera
+    void publishCameraFrame(const cv::Mat& image, dg::Timestamp capture_time, dg::LatLon gps, int camera = 0);
+    void publishCameraFrame(std::shared_ptr<const dg::FrameImage> image, dg::Timestamp capture_time, dg::LatLon gps, int camera = 0);
+    cv::Mat getInputImage(const dg::CameraFrame& frame, const std::string& module_name);
+    dg::Mailbox<dg::CameraFrame>::Handle getCameraFrame(const std::string& module_name);
+    void countStaleResult(const dg::CameraFrame& frame, int metric_id);
+    dg::RatePolicy m_rate_policy;                   // rates of recognizers which are set by the guidance context
+    std::vector<dg::Point2> m_path_pois;            // metric positions of POIs along the current path
+    dg::ResultCache<std::vector<VPSResult>> m_vps_cache;
+    dg::ResultCache<std::vector<OCRResult>> m_ocr_cache;
+    dg::ResultCache<std::vector<LogoResult>> m_logo_cache;
+    void updateRecognizerRates(const dg::Pose2& pose_metric, double pose_confidence, dg::GuidanceManager::MoveStatus move_status);
 
     cv::Mutex m_vps_mutex;
     cv::Mat m_vps_image;            // top-1 matched streetview image
@@ -205,14 +288,29 @@ void onMouseEvent(int event, int x, int y, int flags, void* param)
 
 DeepGuider::~DeepGuider()
 {
-    if (m_enable_vps) m_vps.clear();
-    if(m_enable_logo) m_logo.clear();
-    if (m_enable_ocr) m_ocr.clear();
-    if(m_enable_intersection) m_intersection_classifier.clear();
-    if (m_enable_roadtheta) m_roadtheta.clear();
-
-    bool enable_python = m_enable_roadtheta || m_enable_vps || m_enable_logo || m_enable_ocr || m_enable_intersection || m_enable_exploration;
-    if(enable_python) close_python_environment();
+    dg::Metrics& metrics = dg::Metrics::instance();
+    metrics.stopDump();
+    if (!m_metrics_file.empty()) metrics.writeCSV(m_metrics_file, true);
+    if (!m_trace_file.empty()) metrics.writeChromeTrace(m_trace_file);
+    metrics.print();
+    m_cameras.print();
+    if (m_adaptive_rates) m_rate_policy.print();
+    if (m_result_cache)
+    {
+        m_vps_cache.print("vps");
+        m_ocr_cache.print("ocr");
+        m_logo_cache.print("logo");
+    }
+
+    bool run_recognizers = !m_replay.isOpened();
+    if (run_recognizers && m_enable_vps) m_vps.clear();
+    if (run_recognizers && m_enable_logo) m_logo.clear();
+    if (run_recognizers && m_enable_ocr) m_ocr.clear();
+    if (run_recognizers && m_enable_intersection) m_intersection_classifier.clear();
+    if (run_recognizers && m_enable_roadtheta) m_roadtheta.clear();
+
+    bool enable_python = run_recognizers && (m_enable_roadtheta || m_enable_vps || m_enable_logo || m_enable_ocr || m_enable_intersection);
+    if(enable_python || m_enable_exploration) close_python_environment();
 }
 
 
@@ -242,12 +340,36 @@ bool DeepGuider::loadConfig(std::string config_file)
     LOAD_PARAM_VALUE(fn, "dg_srcdir", m_srcdir);
 
     LOAD_PARAM_VALUE(fn, "use_high_gps", m_use_high_gps);
+    LOAD_PARAM_VALUE(fn, "enable_pipeline", m_use_pipeline);
+    LOAD_PARAM_VALUE(fn, "local_routing", m_local_routing);
+    LOAD_PARAM_VALUE(fn, "route_hierarchy", m_route_hierarchy);
+    LOAD_PARAM_VALUE(fn, "streetview_cache_dir", m_streetview_cache_dir);
+    LOAD_PARAM_VALUE(fn, "streetview_prefetch_nodes", m_streetview_prefetch_nodes);
+    LOAD_PARAM_VALUE(fn, "camera_names", m_camera_names);
+    const char* recognizers[] = { "vps", "logo", "ocr", "intersection", "roadtheta" };
+    for (const char* name : recognizers)
+    {
+        LOAD_PARAM_VALUE(fn, std::string("camera_priority_") + name, m_camera_priorities[name]);
+        LOAD_PARAM_VALUE(fn, std::string("input_reduction_") + name, m_input_reductions[name]);
+        LOAD_PARAM_VALUE(fn, std::string("recognizer_rates_") + name, m_recognizer_rates[name]);
+    }
+    LOAD_PARAM_VALUE(fn, "enable_adaptive_rates", m_adaptive_rates);
+    LOAD_PARAM_VALUE(fn, "vps_active_confidence", m_vps_active_confidence);
+    LOAD_PARAM_VALUE(fn, "poi_active_radius", m_poi_active_radius);
+    LOAD_PARAM_VALUE(fn, "enable_result_cache", m_result_cache);
+    LOAD_PARAM_VALUE(fn, "result_cache_cell", m_result_cache_cell);
+    LOAD_PARAM_VALUE(fn, "result_cache_heading", m_result_cache_heading);
+    LOAD_PARAM_VALUE(fn, "result_cache_age", m_result_cache_age);
+    LOAD_PARAM_VALUE(fn, "result_cache_hash_distance", m_result_cache_hash_distance);
 
     LOAD_PARAM_VALUE(fn, "enable_data_logging", m_data_logging);
+    LOAD_PARAM_VALUE(fn, "data_log_binary", m_data_log_binary);
     LOAD_PARAM_VALUE(fn, "enable_tts", m_enable_tts);
     LOAD_PARAM_VALUE(fn, "video_recording", m_recording);
     LOAD_PARAM_VALUE(fn, "video_recording_fps", m_recording_fps);
     LOAD_PARAM_VALUE(fn, "map_image_path", m_map_image_path);
+    LOAD_PARAM_VALUE(fn, "map_tile_dir", m_map_tile_dir);
+    LOAD_PARAM_VALUE(fn, "map_view_size", m_map_view_size);
     LOAD_PARAM_VALUE(fn, "map_ref_point_lat", m_map_ref_point.lat);
     LOAD_PARAM_VALUE(fn, "map_ref_point_lon", m_map_ref_point.lon);
     LOAD_PARAM_VALUE(fn, "map_pixel_per_meter", m_map_pixel_per_meter);
@@ -255,6 +377,14 @@ bool DeepGuider::loadConfig(std::string config_file)
     LOAD_PARAM_VALUE(fn, "gps_input", m_gps_input);
     LOAD_PARAM_VALUE(fn, "video_input", m_video_input);
     LOAD_PARAM_VALUE(fn, "recording_header_name", m_recording_header_name);
+    LOAD_PARAM_VALUE(fn, "metrics_file", m_metrics_file);
+    LOAD_PARAM_VALUE(fn, "metrics_period", m_metrics_period);
+    LOAD_PARAM_VALUE(fn, "trace_file", m_trace_file);
+    LOAD_PARAM_VALUE(fn, "headless", m_headless);
+    LOAD_PARAM_VALUE(fn, "replay_log", m_replay_log);
+    LOAD_PARAM_VALUE(fn, "replay_output", m_replay_output);
+    LOAD_PARAM_VALUE(fn, "replay_dest_lat", m_replay_dest.lat);
+    LOAD_PARAM_VALUE(fn, "replay_dest_lon", m_replay_dest.lon);
 
     return true;
 }
@@ -268,35 +398,49 @@ bool DeepGuider::initialize(std::string config_file)
     bool ok = loadConfig(config_file);
     if(ok) printf("\tConfiguration %s loaded!\n", config_file.c_str());
 
+    // load recorded recognizer outputs (the recognizers are not run)
+    if (!m_replay_log.empty())
+    {
+        VVS_CHECK_TRUE(m_replay.open(m_replay_log));
+        printf("\tReplay log %s loaded! (frames=%d, lines=%d)\n", m_replay_log.c_str(), m_replay.size(), m_replay.countLines());
+    }
+    bool run_recognizers = !m_replay.isOpened();
+
     // initialize python
-    bool enable_python = m_enable_roadtheta || m_enable_vps || m_enable_ocr || m_enable_logo || m_enable_intersection || m_enable_exploration;
+    bool enable_python = (run_recognizers && (m_enable_roadtheta || m_enable_vps || m_enable_ocr || m_enable_logo || m_enable_intersection)) || m_enable_exploration;
     if (enable_python && !init_python_environment("python3", "", m_threaded_run_python)) return false;
     if(enable_python) printf("\tPython environment initialized!\n");
 
     // initialize map manager
     m_map_manager.setIP(m_server_ip);
     if (!m_map_manager.initialize()) return false;
+    if (!m_streetview_cache_dir.empty()) m_map_manager.getStreetViewCache().setDiskDir(m_streetview_cache_dir);
     printf("\tMapManager initialized!\n");
+    if (m_local_routing && !m_route_hierarchy.empty())
+    {
+        if (m_map_manager.loadHierarchy(m_route_hierarchy)) printf("\tRoute hierarchy loaded from %s!\n", m_route_hierarchy.c_str());
+        else printf("\tFailed to load route hierarchy %s (local routing runs without it)\n", m_route_hierarchy.c_str());
+    }
 
     // initialize VPS
     std::string module_path = m_srcdir + "/vps";
-    if (m_enable_vps && !m_vps.initialize("vps", module_path.c_str())) return false;
-    if (m_enable_vps) printf("\tVPS initialized in %.3lf seconds!\n", m_vps.procTime());
+    if (run_recognizers && m_enable_vps && !m_vps.initialize("vps", module_path.c_str())) return false;
+    if (run_recognizers && m_enable_vps) printf("\tVPS initialized in %.3lf seconds!\n", m_vps.procTime());
 
     // initialize OCR
     module_path = m_srcdir + "/ocr_recog";
-    if (m_enable_ocr && !m_ocr.initialize("ocr_recognizer", module_path.c_str())) return false;
-    if (m_enable_ocr) printf("\tOCR initialized in %.3lf seconds!\n", m_ocr.procTime());
+    if (run_recognizers && m_enable_ocr && !m_ocr.initialize("ocr_recognizer", module_path.c_str())) return false;
+    if (run_recognizers && m_enable_ocr) printf("\tOCR initialized in %.3lf seconds!\n", m_ocr.procTime());
 
     // initialize Intersection
     module_path = m_srcdir + "/intersection_cls";
-    if (m_enable_intersection && !m_intersection_classifier.initialize("intersection_cls", module_path.c_str())) return false;
-    if (m_enable_intersection) printf("\tIntersection initialized in %.3lf seconds!\n", m_intersection_classifier.procTime());
+    if (run_recognizers && m_enable_intersection && !m_intersection_classifier.initialize("intersection_cls", module_path.c_str())) return false;
+    if (run_recognizers && m_enable_intersection) printf("\tIntersection initialized in %.3lf seconds!\n", m_intersection_classifier.procTime());
 
     // initialize Logo
     module_path = m_srcdir + "/logo_recog";
-    if (m_enable_logo && !m_logo.initialize("logo_recognizer", module_path.c_str())) return false;
-    if (m_enable_logo) printf("\tLogo initialized in %.3lf seconds!\n", m_logo.procTime());
+    if (run_recognizers && m_enable_logo && !m_logo.initialize("logo_recognizer", module_path.c_str())) return false;
+    if (run_recognizers && m_enable_logo) printf("\tLogo initialized in %.3lf seconds!\n", m_logo.procTime());
 
     //initialize exploation 
     if (m_enable_exploration && !m_active_nav.initialize()) return false;
@@ -305,10 +449,25 @@ bool DeepGuider::initialize(std::string config_file)
     // initialize default map
     VVS_CHECK_TRUE(initializeDefaultMap());
 
-    // load background GUI image
-    m_map_image = cv::imread(m_map_image_path);
-    VVS_CHECK_TRUE(!m_map_image.empty());
-    m_map_image_original = m_map_image.clone();
+    // load background GUI image (only visible tiles are decoded if its tiled pyramid is given)
+    cv::Mat map_image;
+    if (m_map_tile_dir.empty())
+    {
+        map_image = cv::imread(m_map_image_path);
+        VVS_CHECK_TRUE(!map_image.empty());
+    }
+    else
+    {
+        if (!m_map_tiles.open(m_map_tile_dir))
+        {
+            // build the pyramid once from the map image
+            VVS_CHECK_TRUE(dg::MapTilePyramid::build(cv::imread(m_map_image_path), m_map_tile_dir));
+            VVS_CHECK_TRUE(m_map_tiles.open(m_map_tile_dir));
+        }
+        m_map_view_size.width = std::min(m_map_view_size.width, m_map_tiles.getImageSize().width);
+        m_map_view_size.height = std::min(m_map_view_size.height, m_map_tiles.getImageSize().height);
+        VVS_CHECK_TRUE(m_map_tiles.render(map_image, m_map_view_size, m_view_tl, m_view_zoom));
+    }
 
     // prepare GUI map
     m_painter.setReference(m_map_ref_point);
@@ -322,11 +481,21 @@ bool DeepGuider::initialize(std::string config_file)
     m_painter.setParamValue("node_color", { 255, 50, 255 });
     m_painter.setParamValue("edge_color", { 200, 100, 100 });
     //m_painter.setParamValue("edge_thickness", 2);
-    m_map_info = m_painter.getCanvasInfo(m_map_image);
+    m_map_info = m_painter.getCanvasInfo(map_image);
+    if (m_map_tiles.isOpened())
+    {
+        // the zoomable view skips nodes and short edges when zoomed out
+        m_painter.setParamValue("lod_node_ppm", 0.5);
+        m_painter.setParamValue("lod_edge_length", 2);
+        m_map_info_whole = m_painter.getCanvasInfo(m_map_tiles.getImageSize());
+        m_map_info = m_painter.getViewInfo(m_map_info_whole, m_view_tl, m_view_zoom, m_map_view_size);
+    }
 
-    // draw topology of default map
-    dg::Map& map = m_map_manager.getMap();
-    VVS_CHECK_TRUE(m_painter.drawMap(m_map_image, m_map_info, map));
+    // prepare GUI layers with topology of default map
+    m_map_mutex.lock();
+    m_gui_map = m_map_manager.getMapSnapshot();
+    m_map_mutex.unlock();
+    VVS_CHECK_TRUE(initializeGuiLayers(map_image));
 
     // load icon images
     m_icon_forward = cv::imread("data/forward.png");
@@ -339,11 +508,16 @@ bool DeepGuider::initialize(std::string config_file)
     cv::threshold(m_icon_turn_back, m_mask_turn_back, 250, 1, cv::THRESH_BINARY_INV);
 
     // show GUI window
-    cv::namedWindow(m_winname, cv::WINDOW_NORMAL);
-    cv::setMouseCallback(m_winname, onMouseEvent, this);
-    cv::resizeWindow(m_winname, m_map_image.cols, m_map_image.rows);
-    cv::imshow(m_winname, m_map_image);
-    cv::waitKey(1);
+    if (!m_headless)
+    {
+        cv::namedWindow(m_winname, cv::WINDOW_NORMAL);
+        cv::setMouseCallback(m_winname, onMouseEvent, this);
+        cv::resizeWindow(m_winname, map_image.cols, map_image.rows);
+        m_gui_mutex.lock();
+        cv::imshow(m_winname, m_gui.compose());
+        m_gui_mutex.unlock();
+        cv::waitKey(1);
+    }
 
     // init video recording
     time_t start_t;
@@ -351,7 +525,7 @@ bool DeepGuider::initialize(std::string config_file)
     tm _tm = *localtime(&start_t);
     char sztime[255];
     strftime(sztime, 255, "%y%m%d_%H%M%S", &_tm);
-    if (m_recording)
+    if (m_recording && !m_headless)
     {
         std::string filename = m_recording_header_name + sztime + "_gui.avi";
         m_video_gui.open(filename, m_recording_fps);
@@ -360,8 +534,16 @@ bool DeepGuider::initialize(std::string config_file)
     // init data logging
     if (m_data_logging)
     {
-        std::string filename = m_recording_header_name + sztime + ".txt";
-        m_log.open(filename, ios::out);
+        if (m_data_log_binary)
+        {
+            std::string filename = m_recording_header_name + sztime + ".dglog";
+            m_binary_log.open(filename);
+        }
+        else
+        {
+            std::string filename = m_recording_header_name + sztime + ".txt";
+            m_log.open(filename, ios::out);
+        }
 
         std::string filename_cam = m_recording_header_name + sztime + "_cam.avi";
         m_video_cam.open(filename_cam, m_recording_fps);
@@ -372,8 +554,31 @@ bool DeepGuider::initialize(std::string config_file)
     m_pose_initialized = false;
     m_path_initialized = false;
     m_gps_update_cnt = 0;
-    m_cam_image.release();
-    m_cam_capture_time = -1;
+    m_cameras.clear();
+    for (auto name = m_camera_names.begin(); name != m_camera_names.end(); name++)
+    {
+        VVS_CHECK_TRUE(m_cameras.addCamera(*name) >= 0);
+    }
+    for (auto module = m_camera_priorities.begin(); module != m_camera_priorities.end(); module++)
+    {
+        for (int i = 0; i < (int)module->second.size(); i++)
+        {
+            VVS_CHECK_TRUE(m_cameras.setPriority(module->first, i, module->second[i]));
+        }
+    }
+    m_rate_policy.clear();
+    if (m_adaptive_rates)
+    {
+        for (auto module = m_recognizer_rates.begin(); module != m_recognizer_rates.end(); module++)
+        {
+            if (module->second.size() >= 2) m_rate_policy.setRates(module->first, module->second[0], module->second[1]);
+        }
+    }
+    double heading_bin = cx::cvtDeg2Rad(m_result_cache_heading);
+    m_vps_cache.setParams(m_result_cache_cell, heading_bin, m_result_cache_age, m_result_cache_hash_distance);
+    m_ocr_cache.setParams(m_result_cache_cell, heading_bin, m_result_cache_age, m_result_cache_hash_distance);
+    m_logo_cache.setParams(m_result_cache_cell, heading_bin, m_result_cache_age, m_result_cache_hash_distance);
+    m_gps_mailbox.clear();
     m_cam_fnumber = -1;
     m_vps_image.release();
     m_vps_id = 0;
@@ -383,17 +588,26 @@ bool DeepGuider::initialize(std::string config_file)
     m_ocr_image.release();
     m_ocrs.clear();
     m_intersection_image.release();
+    m_gui_mutex.lock();
     m_gps_history_asen.clear();
     m_gps_history_novatel.clear();
+    m_gui_mutex.unlock();
     m_guidance_cmd = dg::GuidanceManager::Motion::STOP;
     m_guidance_status = dg::GuidanceManager::GuideStatus::GUIDE_INITIAL;
+    m_guidance_log_cmd = -1;
+    m_guidance_log_node = 0;
+
+    // metrics
+    if (!m_metrics_file.empty()) dg::Metrics::instance().startDump(m_metrics_file, m_metrics_period);
+    if (!m_trace_file.empty()) dg::Metrics::instance().enableTrace(true);
 
     // tts
     if (m_enable_tts)
     {
-        tts_thread = new std::thread(threadfunc_tts, this);
-        putTTS("System is initialized!");
-    } 
+        if (!m_tts.initialize(dg::TTSService::getStandardPhrases())) printf("\tSome TTS phrases are not prepared!\n");
+        m_tts.start();
+        putTTS("System is initialized!", dg::TTSService::PRIORITY_LOW);
+    }
 
     printf("\tInitialization is done!\n\n");
 
@@ -434,13 +648,13 @@ bool DeepGuider::initializeDefaultMap()
 std::vector<std::pair<double, dg::LatLon>> loadExampleGPSData(std::string csv_file)
 {
     const string ANDRO_POSTFIX = "AndroSensor.csv";
-    cx::CSVReader csv;
+    cx::CSVStreamReader csv;
     std::vector<std::pair<double, dg::LatLon>> data;
     const string postfix = csv_file.substr(csv_file.length() - ANDRO_POSTFIX.length(), ANDRO_POSTFIX.length());
     if (postfix.compare(ANDRO_POSTFIX) == 0)
     {
         VVS_CHECK_TRUE(csv.open(csv_file, ';'));
-        cx::CSVReader::Double2D csv_ext = csv.extDouble2D(2, { 31, 22, 23, 28 }); // Skip the header
+        cx::CSVStreamReader::Double2D csv_ext = csv.extDouble2D(2, { 31, 22, 23, 28 }); // Skip the header
 
         for (auto row = csv_ext.begin(); row != csv_ext.end(); row++)
         {
@@ -452,7 +666,7 @@ std::vector<std::pair<double, dg::LatLon>> loadExampleGPSData(std::string csv_fi
     else
     {
         VVS_CHECK_TRUE(csv.open(csv_file));
-        cx::CSVReader::Double2D csv_ext = csv.extDouble2D(1, { 2, 3, 7, 8 }); // Skip the header
+        cx::CSVStreamReader::Double2D csv_ext = csv.extDouble2D(1, { 2, 3, 7, 8 }); // Skip the header
 
         for (auto row = csv_ext.begin(); row != csv_ext.end(); row++)
         {
@@ -468,6 +682,8 @@ std::vector<std::pair<double, dg::LatLon>> loadExampleGPSData(std::string csv_fi
 int DeepGuider::run()
 {
     printf("Run deepguider system...\n");
+    if (m_headless) return runReplay();
+    if (m_use_pipeline) return runPipeline();
 
     // load gps sensor data (ETRI dataset)
     auto gps_data = loadExampleGPSData(m_gps_input);
@@ -492,14 +708,14 @@ int DeepGuider::run()
     int itr = 300;
     while (itr < maxItr)
     {
-        dg::Timestamp t1 = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count() / 1000.0;
+        static const int iteration_id = dg::Metrics::instance().registerName("DeepGuider::iteration");
+        dg::ScopedTimer iteration_timer(iteration_id);
 
         // gps update
         const dg::LatLon gps_datum = gps_data[itr].second;
         const dg::Timestamp gps_time = gps_data[itr].first;
         procGpsData(gps_datum, gps_time);
-        m_painter.drawNode(m_map_image, m_map_info, gps_datum, 2, 0, cv::Vec3b(0, 255, 0));
-        m_gps_history_asen.push_back(gps_datum);
+        addGuiTrajectory(gps_datum);
         printf("[GPS] lat=%lf, lon=%lf, ts=%lf\n", gps_datum.lat, gps_datum.lon, gps_time);
 
         // video capture
@@ -510,12 +726,7 @@ int DeepGuider::run()
             if (video_image.empty()) break;
             video_time = video_time_scale * video_data.get(cv::VideoCaptureProperties::CAP_PROP_POS_MSEC) / 1000 + video_time_offset;
         }
-        m_cam_mutex.lock();
-        m_cam_image = video_image;
-        m_cam_capture_time = video_time;
-        m_cam_gps = gps_datum;
-        m_cam_fnumber++;
-        m_cam_mutex.unlock();
+        publishCameraFrame(video_image, video_time, gps_datum);
 
         // process vision modules
         if(m_enable_roadtheta) procRoadTheta();
@@ -528,12 +739,14 @@ int DeepGuider::run()
         procGuidance(gps_time);
 
         // draw GUI display
-        cv::Mat gui_image = m_map_image.clone();
+        m_gui_mutex.lock();
+        cv::Mat& gui_image = m_gui.compose();
         drawGuiDisplay(gui_image);
+        m_gui_mutex.unlock();
 
         // recording
         if (m_recording) m_video_gui << gui_image;
-        if (m_data_logging) m_video_cam << m_cam_image;
+        if (m_data_logging) m_video_cam << video_image;
 
         cv::imshow(m_winname, gui_image);
         int key = cv::waitKey(1);
@@ -541,8 +754,7 @@ int DeepGuider::run()
         if (key == cx::KEY_ESC) break;
         if (key == 83) itr += 30;   // Right Key
 
-        dg::Timestamp t2 = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count() / 1000.0;
-        printf("Iteration: %d (it took %lf seconds)\n", itr, t2 - t1);
+        printf("Iteration: %d (it took %lf seconds)\n", itr, iteration_timer.elapsed());
 
         // update iteration
         itr++;
@@ -557,6 +769,7 @@ int DeepGuider::run()
     printf("\tthread terminated\n");
     if(m_recording) m_video_gui.release();
     if(m_data_logging) m_video_cam.release();
+    m_binary_log.close();
     printf("\tclose recording\n");
     cv::destroyWindow(m_winname);
     printf("\tgui window destroyed\n");
@@ -566,18 +779,436 @@ int DeepGuider::run()
 }
 
 
+int DeepGuider::runPipeline()
+{
+    // load gps sensor data (ETRI dataset)
+    auto gps_data = loadExampleGPSData(m_gps_input);
+    VVS_CHECK_TRUE(!gps_data.empty());
+    printf("\tSample gps data loaded!\n");
+
+    // load image sensor data (ETRI dataset)
+    cv::VideoCapture video_data;
+    VVS_CHECK_TRUE(video_data.open(m_video_input));
+    double video_time_offset = gps_data.front().first - 0.5, video_time_scale = 1.75; // Calculated from 'bag' files
+    double video_time = video_time_scale * video_data.get(cv::VideoCaptureProperties::CAP_PROP_POS_MSEC) / 1000 + video_time_offset;
+    printf("\tSample video data loaded!\n");
+
+    // connect stages: sensor -> recognizers -> localizer -> guidance (GUI runs on the main thread)
+    m_cam_signal = std::make_shared<dg::StageSignal>();
+    m_cameras.setSignal(m_cam_signal);
+    m_localizer_signal = std::make_shared<dg::StageSignal>();
+    m_guidance_signal = std::make_shared<dg::StageSignal>();
+    m_gps_queue = std::make_shared<dg::BoundedQueue<GPSData>>(64, dg::DropPolicy::DROP_OLDEST, m_localizer_signal);
+    m_clue_queue = std::make_shared<dg::BoundedQueue<LocClueData>>(16, dg::DropPolicy::DROP_OLDEST, m_localizer_signal);
+    m_guidance_time = -1;
+
+    // sensor stage: replay gps and video data at their recorded pace
+    std::atomic<int> itr(300);
+    std::atomic<bool> paused(false);
+    const int maxItr = (int)gps_data.size();
+    dg::Timestamp last_wall_time = -1, last_gps_time = -1;
+    auto sensor_stage = [&]() -> bool
+    {
+        int k = itr;
+        if (k >= maxItr) return false;
+        const dg::Timestamp gps_time = gps_data[k].first;
+        dg::Timestamp now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count() / 1000.0;
+        if (paused)
+        {
+            last_wall_time = -1;
+            return false;
+        }
+        if (last_wall_time >= 0 && now - last_wall_time < std::min(gps_time - last_gps_time, 1.0)) return false;
+        last_wall_time = now;
+        last_gps_time = gps_time;
+
+        const dg::LatLon gps_datum = gps_data[k].second;
+        GPSData gps;
+        gps.gps = gps_datum;
+        gps.ts = gps_time;
+        m_gps_queue->push(gps);
+        printf("[GPS] lat=%lf, lon=%lf, ts=%lf\n", gps_datum.lat, gps_datum.lon, gps_time);
+
+        cv::Mat video_image;
+        while (video_time <= gps_time)
+        {
+            video_data >> video_image;
+            if (video_image.empty()) break;
+            video_time = video_time_scale * video_data.get(cv::VideoCaptureProperties::CAP_PROP_POS_MSEC) / 1000 + video_time_offset;
+        }
+        publishCameraFrame(video_image, video_time, gps_datum);
+
+        itr.compare_exchange_strong(k, k + 1);
+        return true;
+    };
+
+    // localizer stage: apply all gps data and localization clues in arrival order
+    auto localizer_stage = [&]() -> bool
+    {
+        bool updated = false;
+        GPSData gps;
+        while (m_gps_queue->pop(gps))
+        {
+            procGpsData(gps.gps, gps.ts);
+            addGuiTrajectory(gps.gps);
+            m_guidance_time = gps.ts;
+            updated = true;
+        }
+        LocClueData clue;
+        while (m_clue_queue->pop(clue))
+        {
+            m_localizer_mutex.lock();
+            m_localizer.applyLocClue(clue.ids, clue.obs, clue.ts, clue.confs);
+            m_localizer_mutex.unlock();
+            updated = true;
+        }
+        if (updated) m_guidance_signal->notify();
+        return false;
+    };
+
+    // guidance stage: update guidance whenever the pose is updated
+    auto guidance_stage = [&]() -> bool
+    {
+        double ts = m_guidance_time;
+        if (ts >= 0) procGuidance(ts);
+        return false;
+    };
+
+    m_pipeline.addStage("sensor", sensor_stage, nullptr, 0.005);
+    m_pipeline.addStage("localizer", localizer_stage, m_localizer_signal);
+    m_pipeline.addStage("guidance", guidance_stage, m_guidance_signal);
+    if (m_enable_roadtheta) m_pipeline.addStage("roadtheta", [&]() { procRoadTheta(); return false; }, m_cam_signal);
+    if (m_enable_vps) m_pipeline.addStage("vps", [&]() { procVps(); return false; }, m_cam_signal);
+    if (m_enable_logo) m_pipeline.addStage("logo", [&]() { procLogo(); return false; }, m_cam_signal);
+    if (m_enable_ocr) m_pipeline.addStage("ocr", [&]() { procOcr(); return false; }, m_cam_signal);
+    if (m_enable_intersection) m_pipeline.addStage("intersection", [&]() { procIntersectionClassifier(); return false; }, m_cam_signal);
+    VVS_CHECK_TRUE(m_pipeline.start());
+
+    // GUI stage: draw the latest results on the main thread
+    while (itr < maxItr)
+    {
+        DG_TRACE_SCOPE("DeepGuider::gui");
+        DG_GAUGE("DeepGuider::gps_dropped", (int64_t)m_gps_queue->dropped());
+        DG_GAUGE("DeepGuider::clues_dropped", (int64_t)m_clue_queue->dropped());
+        m_gui_mutex.lock();
+        cv::Mat& gui_image = m_gui.compose();
+        drawGuiDisplay(gui_image);
+        m_gui_mutex.unlock();
+
+        // recording
+        if (m_recording) m_video_gui << gui_image;
+        if (m_data_logging)
+        {
+            dg::Mailbox<dg::CameraFrame>::Handle frame = m_cameras.latest();
+            if (frame) m_video_cam << frame->getImage();
+            m_log.flush();
+        }
+
+        cv::imshow(m_winname, gui_image);
+        int key = cv::waitKey(30);
+        if (key == cx::KEY_SPACE) paused = !paused;
+        if (key == cx::KEY_ESC) break;
+        if (key == 83) itr += 30;   // Right Key
+    }
+    printf("Iteration: %d (dropped gps=%d, clues=%d)\n", (int)itr, (int)m_gps_queue->dropped(), (int)m_clue_queue->dropped());
+
+    // end system
+    printf("End deepguider system...\n");
+    m_pipeline.stop();
+    m_clue_queue.reset();
+    printf("\tpipeline terminated\n");
+    terminateThreadFunctions();
+    if (m_recording) m_video_gui.release();
+    if (m_data_logging) m_video_cam.release();
+    m_binary_log.close();
+    printf("\tclose recording\n");
+    cv::destroyWindow(m_winname);
+    printf("\tgui window destroyed\n");
+    printf("all done!\n");
+
+    return 0;
+}
+
+
+int DeepGuider::runReplay()
+{
+    // load gps sensor data (ETRI dataset)
+    auto gps_data = loadExampleGPSData(m_gps_input);
+    VVS_CHECK_TRUE(!gps_data.empty());
+    printf("\tSample gps data loaded!\n");
+
+    // load image sensor data (ETRI dataset)
+    cv::VideoCapture video_data;
+    VVS_CHECK_TRUE(video_data.open(m_video_input));
+    double video_time_offset = gps_data.front().first - 0.5, video_time_scale = 1.75; // Calculated from 'bag' files
+    double video_time = video_time_scale * video_data.get(cv::VideoCaptureProperties::CAP_PROP_POS_MSEC) / 1000 + video_time_offset;
+    printf("\tSample video data loaded!\n");
+
+    // decode video frames only if they are used (recorded recognizer outputs don't need them)
+    bool decode_video = !m_replay.isOpened() || m_enable_exploration || m_data_logging;
+
+    // set destination (default: the last gps position)
+    dg::LatLon gps_dest = m_replay_dest;
+    if (gps_dest.lat == 0 && gps_dest.lon == 0) gps_dest = gps_data.back().second;
+    VVS_CHECK_TRUE(setDeepGuiderDestination(gps_dest));
+
+    // open replay outputs
+    std::ofstream trajectory(m_replay_output + "_trajectory.csv", ios::out);
+    m_guidance_log.open(m_replay_output + "_guidance.csv", ios::out);
+    VVS_CHECK_TRUE(trajectory.is_open() && m_guidance_log.is_open());
+    trajectory << "itr,gps_time,gps_lat,gps_lon,x,y,theta,lat,lon,node_id,edge_idx,dist,confidence" << std::endl;
+    m_guidance_log << "ts,status,cmd,heading_node_id,distance_to_remain,msg" << std::endl;
+
+    // run iteration as fast as possible on a single thread (start at the same iteration with run() so that frame numbers match the data log)
+    static const int iteration_id = dg::Metrics::instance().registerName("DeepGuider::iteration");
+    double replay_start = dg::Metrics::now();
+    int maxItr = (int)gps_data.size();
+    int itr = 300;
+    for (; itr < maxItr; itr++)
+    {
+        dg::ScopedTimer iteration_timer(iteration_id);
+
+        // gps update
+        const dg::LatLon gps_datum = gps_data[itr].second;
+        const dg::Timestamp gps_time = gps_data[itr].first;
+        procGpsData(gps_datum, gps_time);
+        addGuiTrajectory(gps_datum);
+
+        // video capture
+        cv::Mat video_image;
+        while (video_time <= gps_time)
+        {
+            bool ok = decode_video ? video_data.read(video_image) : video_data.grab();
+            if (!ok) break;
+            video_time = video_time_scale * video_data.get(cv::VideoCaptureProperties::CAP_PROP_POS_MSEC) / 1000 + video_time_offset;
+        }
+        publishCameraFrame(video_image, video_time, gps_datum);
+
+        // process vision modules
+        if (m_enable_roadtheta) procRoadTheta();
+        if (m_enable_vps) procVps();
+        if (m_enable_logo) procLogo();
+        if (m_enable_ocr) procOcr();
+        if (m_enable_intersection) procIntersectionClassifier();
+
+        // process Guidance
+        procGuidance(gps_time);
+
+        // write trajectory
+        m_localizer_mutex.lock();
+        dg::Pose2 pose_metric = m_localizer.getPose();
+        dg::TopometricPose pose_topo = m_localizer.getPoseTopometric();
+        dg::LatLon pose_gps = m_localizer.getPoseGPS();
+        double pose_confidence = m_localizer.getPoseConfidence();
+        m_localizer_mutex.unlock();
+        trajectory << cv::format("%d,%.3lf,%.8lf,%.8lf,%.3lf,%.3lf,%.4lf,%.8lf,%.8lf,%zu,%d,%.3lf,%.3lf", itr, gps_time, gps_datum.lat, gps_datum.lon,
+            pose_metric.x, pose_metric.y, pose_metric.theta, pose_gps.lat, pose_gps.lon, pose_topo.node_id, pose_topo.edge_idx, pose_topo.dist, pose_confidence) << std::endl;
+
+        // recording
+        if (m_data_logging) m_video_cam << video_image;
+        if (m_data_logging) m_log.flush();
+    }
+    double replay_time = (dg::Metrics::now() - replay_start) / 1e6;
+
+    // write timings
+    int n_itr = std::max(itr - 300, 0);
+    double data_time = (n_itr > 0) ? gps_data[itr - 1].first - gps_data[300].first : 0;
+    printf("Replay: %d iterations in %.3lf seconds (%.1lf Hz, x%.1lf of real time)\n", n_itr, replay_time, n_itr / std::max(replay_time, 1e-6), data_time / std::max(replay_time, 1e-6));
+    dg::Metrics::instance().writeCSV(m_replay_output + "_timing.csv");
+    printf("\ttrajectory, guidance events, and timings are written to %s_*.csv\n", m_replay_output.c_str());
+
+    // end system
+    printf("End deepguider system...\n");
+    m_guidance_log.close();
+    terminateThreadFunctions();
+    if (m_data_logging) m_video_cam.release();
+    m_binary_log.close();
+    printf("all done!\n");
+
+    return 0;
+}
+
+
+void DeepGuider::writeGuidanceEvent(dg::Timestamp ts, dg::GuidanceManager::GuideStatus status, const dg::GuidanceManager::Guidance& guide)
+{
+    // write only when the status, the action, or the heading node changes
+    int cmd = guide.actions.empty() ? -1 : (int)guide.actions[0].cmd;
+    if (status == m_guidance_status && cmd == m_guidance_log_cmd && guide.heading_node_id == m_guidance_log_node) return;
+    m_guidance_log_cmd = cmd;
+    m_guidance_log_node = guide.heading_node_id;
+
+    std::string msg = guide.msg;
+    std::replace(msg.begin(), msg.end(), '"', '\'');
+    m_guidance_log << cv::format("%.3lf,%d,%d,%zu,%.3lf,\"%s\"", ts, (int)status, cmd, guide.heading_node_id, guide.distance_to_remain, msg.c_str()) << std::endl;
+}
+
+
+template <typename T>
+void DeepGuider::writeRecognizerLog(const T& recognizer, const dg::CameraFrame& frame)
+{
+    // record only the main camera (frame numbers are counted per camera, and the replay looks up the main camera)
+    if (frame.camera != 0) return;
+    if (m_binary_log.isOpened())
+    {
+        std::ostringstream stream;
+        recognizer.write(stream, frame.fnumber);
+        m_binary_log.writeText(dg::LogType::RECOGNIZER, frame.capture_time, frame.fnumber, stream.str());
+        return;
+    }
+    cv::AutoLock lock(m_log_mutex);
+    recognizer.write(m_log, frame.fnumber);
+}
+
+
+template <typename T>
+bool DeepGuider::applyRecognizer(T& recognizer, const dg::CameraFrame& frame, const cv::Mat& image)
+{
+    // take the recorded outputs if replaying a data log (recorded only for the main camera)
+    if (m_replay.isOpened()) return frame.camera == 0 && m_replay.read(recognizer, frame.fnumber);
+    return !image.empty() && recognizer.apply(image, frame.capture_time);
+}
+
+
+template <typename T, typename R, typename F>
+bool DeepGuider::applyCachedRecognizer(T& recognizer, dg::ResultCache<R>& cache, const dg::CameraFrame& frame, F apply, bool& reused)
+{
+    reused = false;
+    if (!m_result_cache) return apply();
+
+    // key the frame by the current pose and the hash of its smallest level (shared with other modules)
+    m_localizer_mutex.lock();
+    dg::Pose2 pose = m_localizer.getPose();
+    m_localizer_mutex.unlock();
+    uint64_t hash = dg::ResultCache<R>::calcImageHash(frame.getImage(8));
+
+    // reuse the recent result if the scene is unchanged (its processing time becomes zero)
+    R result;
+    if (cache.find(pose, frame.camera, hash, frame.capture_time, result))
+    {
+        recognizer.set(result, frame.capture_time, 0);
+        reused = true;
+        return true;
+    }
+    if (!apply()) return false;
+    recognizer.get(result);
+    cache.insert(pose, frame.camera, hash, frame.capture_time, result, recognizer.procTime());
+    return true;
+}
+
+
+void DeepGuider::publishCameraFrame(const cv::Mat& image, dg::Timestamp capture_time, dg::LatLon gps, int camera)
+{
+    publishCameraFrame(std::make_shared<const dg::FrameImage>(image), capture_time, gps, camera);
+}
+
+
+void DeepGuider::publishCameraFrame(std::shared_ptr<const dg::FrameImage> image, dg::Timestamp capture_time, dg::LatLon gps, int camera)
+{
+    int fnumber = m_cameras.publish(camera, std::move(image), capture_time, gps);
+    if (camera == 0) m_cam_fnumber = fnumber;
+}
+
+
+cv::Mat DeepGuider::getInputImage(const dg::CameraFrame& frame, const std::string& module_name)
+{
+    // decode the frame on the calling thread at the reduction of the module (levels are shared with other modules)
+    auto reduction = m_input_reductions.find(module_name);
+    return frame.getImage((reduction != m_input_reductions.end() && reduction->second > 1) ? reduction->second : 1);
+}
+
+
+dg::Mailbox<dg::CameraFrame>::Handle DeepGuider::getCameraFrame(const std::string& module_name)
+{
+    // take a new frame of the camera scheduled for the module if the module is due at its current rate
+    // (frames which are not due are counted as skipped by the hub, and they do not take the share of their camera)
+    return m_cameras.next(module_name, [&](const dg::CameraFrame& frame) { return m_rate_policy.accept(module_name, frame.capture_time); });
+}
+
+
+void DeepGuider::countStaleResult(const dg::CameraFrame& frame, int metric_id)
+{
+    // count results which are older than the latest frame of their camera when they come out
+    if (m_cameras.isStale(frame)) dg::Metrics::instance().count(metric_id);
+}
+
+
+void DeepGuider::updateRecognizerRates(const dg::Pose2& pose_metric, double pose_confidence, dg::GuidanceManager::MoveStatus move_status)
+{
+    // intersection: approaching a junction, vps: low pose confidence, ocr and logo: near POIs along the path
+    bool near_poi = false;
+    m_guider_mutex.lock();
+    for (auto poi = m_path_pois.begin(); poi != m_path_pois.end() && !near_poi; poi++)
+    {
+        near_poi = cv::norm(*poi - dg::Point2(pose_metric)) <= m_poi_active_radius;
+    }
+    m_guider_mutex.unlock();
+    m_rate_policy.setActive("intersection", move_status == dg::GuidanceManager::MoveStatus::APPROACHING_NODE);
+    m_rate_policy.setActive("vps", pose_confidence < m_vps_active_confidence);
+    m_rate_policy.setActive("ocr", near_poi);
+    m_rate_policy.setActive("logo", near_poi);
+}
+
+
+bool DeepGuider::applyLocClue(const std::vector<dg::ID>& ids, const std::vector<dg::Polar2>& obs, const dg::CameraFrame& frame, const std::vector<double>& confs)
+{
+    // apply clues only from the main camera (relative poses of clues are for the main camera)
+    if (frame.camera != 0) return true;
+    dg::Timestamp ts = frame.capture_time;
+
+    // pass the clues to the localizer stage if pipelined
+    std::shared_ptr<dg::BoundedQueue<LocClueData>> queue = m_clue_queue;
+    if (queue)
+    {
+        LocClueData clue;
+        clue.ids = ids;
+        clue.obs = obs;
+        clue.ts = ts;
+        clue.confs = confs;
+        queue->push(clue);
+        return true;
+    }
+
+    cv::AutoLock lock(m_localizer_mutex);
+    return m_localizer.applyLocClue(ids, obs, ts, confs);
+}
+
+
 void DeepGuider::procGpsData(dg::LatLon gps_datum, dg::Timestamp ts)
-{    
+{
+    GPSData gps;
+    gps.gps = gps_datum;
+    gps.ts = ts;
+    m_gps_mailbox.publish(gps);
+    if (m_binary_log.isOpened()) m_binary_log.writeGPS(gps_datum, ts);
+
     // apply gps to localizer
     m_localizer_mutex.lock();
     VVS_CHECK_TRUE(m_localizer.applyGPS(gps_datum, ts));
     double pose_confidence = m_localizer.getPoseConfidence();
+    if (m_binary_log.isOpened())
+    {
+        dg::Pose2 pose_metric = m_localizer.getPose();
+        dg::TopometricPose pose_topo = m_localizer.getPoseTopometric();
+        dg::LatLon pose_gps = m_localizer.getPoseGPS();
+        dg::LogPose pose;
+        pose.x = pose_metric.x;
+        pose.y = pose_metric.y;
+        pose.theta = pose_metric.theta;
+        pose.lat = pose_gps.lat;
+        pose.lon = pose_gps.lon;
+        pose.node_id = pose_topo.node_id;
+        pose.edge_idx = pose_topo.edge_idx;
+        pose.dist = pose_topo.dist;
+        pose.confidence = pose_confidence;
+        m_binary_log.writePose(pose, ts);
+    }
     m_localizer_mutex.unlock();    
 
     // check pose initialization
     m_gps_update_cnt++;
     if (!m_pose_initialized && pose_confidence > 0.2 && m_gps_update_cnt > 10)
     {
+        cv::AutoLock lock(m_dest_mutex);
         m_pose_initialized = true;
         if(m_dest_defined)
         {
@@ -592,6 +1223,14 @@ void DeepGuider::procMouseEvent(int evt, int x, int y, int flags)
 {
     if (evt == cv::EVENT_MOUSEMOVE)
     {
+        // pan the tiled map image
+        if (m_map_tiles.isOpened() && m_view_drag.x >= 0)
+        {
+            m_view_tl.x -= (x - m_view_drag.x) / m_view_zoom;
+            m_view_tl.y -= (y - m_view_drag.y) / m_view_zoom;
+            m_view_drag = cv::Point(x, y);
+            updateGuiView();
+        }
     }
     else if (evt == cv::EVENT_LBUTTONDOWN)
     {
@@ -606,18 +1245,32 @@ void DeepGuider::procMouseEvent(int evt, int x, int y, int flags)
     }
     else if (evt == cv::EVENT_RBUTTONDOWN)
     {
+        m_view_drag = cv::Point(x, y);
     }
     else if (evt == cv::EVENT_RBUTTONUP)
     {
+        m_view_drag = cv::Point(-1, -1);
     }
     else if (evt == cv::EVENT_MOUSEWHEEL)
     {
+        // zoom the tiled map image at the mouse position
+        if (m_map_tiles.isOpened())
+        {
+            double zoom = (cv::getMouseWheelDelta(flags) > 0) ? m_view_zoom * 1.25 : m_view_zoom / 1.25;
+            zoom = std::max(std::min(zoom, 8.0), 1.0 / (1 << m_map_tiles.getLevels()));
+            m_view_tl.x += x / m_view_zoom - x / zoom;
+            m_view_tl.y += y / m_view_zoom - y / zoom;
+            m_view_zoom = zoom;
+            updateGuiView();
+        }
     }
 }
 
 
 bool DeepGuider::setDeepGuiderDestination(dg::LatLon gps_dest)
 {
+    cv::AutoLock lock(m_dest_mutex);
+
     // check self-localized
     if(!m_pose_initialized)
     {
@@ -646,6 +1299,8 @@ bool DeepGuider::setDeepGuiderDestination(dg::LatLon gps_dest)
 
 bool DeepGuider::updateDeepGuiderPath(dg::TopometricPose pose_topo, dg::LatLon gps_start, dg::LatLon gps_dest)
 {
+    cv::AutoLock lock(m_dest_mutex);
+
     // set start position to nearest node position
     m_map_mutex.lock();
     dg::Map& tmpmap = m_map_manager.getMap();    
@@ -661,7 +1316,8 @@ bool DeepGuider::updateDeepGuiderPath(dg::TopometricPose pose_topo, dg::LatLon g
     // generate path to destination
     dg::Path path;
     m_map_mutex.lock();
-    bool ok = m_map_manager.getPath_expansion(pose_gps.lat, pose_gps.lon, gps_dest.lat, gps_dest.lon, path);
+    bool ok = m_local_routing && m_map_manager.getPath_local(pose_gps.lat, pose_gps.lon, gps_dest.lat, gps_dest.lon, path, dg::PathCostProfile::pedestrian());
+    if (!ok) ok = m_map_manager.getPath_expansion(pose_gps.lat, pose_gps.lon, gps_dest.lat, gps_dest.lon, path);
     m_map_mutex.unlock();
     path.start_pos = gps_start;
     path.dest_pos = gps_dest;
@@ -676,37 +1332,80 @@ bool DeepGuider::updateDeepGuiderPath(dg::TopometricPose pose_topo, dg::LatLon g
 
     // check if the generated path is valid on the map
     m_map_mutex.lock();
-    dg::Map& map = m_map_manager.getMap();    
-    dg::Node* node_start = map.findNode(nid_start);
-    dg::Node* node_dest = map.findNode(nid_dest);
+    dg::MapSnapshot map = m_map_manager.getMapSnapshot();
     m_map_mutex.unlock();
-    VVS_CHECK_TRUE(node_start != nullptr);
-    VVS_CHECK_TRUE(node_dest != nullptr);
+    VVS_CHECK_TRUE(map != nullptr);
+    VVS_CHECK_TRUE(map->findNode(nid_start) != nullptr);
+    VVS_CHECK_TRUE(map->findNode(nid_dest) != nullptr);
+    bool map_changed = (map != m_map_snapshot);
+    m_map_snapshot = map;
+
+    // localizer: set map to localizer (only if the map is changed)
+    if (map_changed)
+    {
+        m_localizer_mutex.lock();
+        VVS_CHECK_TRUE(m_localizer.loadMap(*map));
+        m_localizer_mutex.unlock();
+        printf("\tLocalizer is updated with new map!\n");
+
+        // cached results are keyed by metric positions of the previous map
+        m_vps_cache.clear();
+        m_ocr_cache.clear();
+        m_logo_cache.clear();
+    }
 
-    // localizer: set map to localizer
-    m_localizer_mutex.lock();
-    VVS_CHECK_TRUE(m_localizer.loadMap(map));
-    m_localizer_mutex.unlock();
-    printf("\tLocalizer is updated with new map!\n");
+    // collect POIs along the path (ocr and logo are active near them)
+    if (m_adaptive_rates)
+    {
+        std::vector<dg::Point2> path_nodes, path_pois;
+        m_localizer_mutex.lock();
+        for (auto pt = path.pts.begin(); pt != path.pts.end(); pt++)
+        {
+            const dg::Node* path_node = map->findNode(pt->node_id);
+            if (path_node) path_nodes.push_back(m_localizer.toMetric(*path_node));
+        }
+        for (auto poi = map->pois.begin(); poi != map->pois.end(); poi++)
+        {
+            dg::Point2 p = m_localizer.toMetric(*poi);
+            for (auto n = path_nodes.begin(); n != path_nodes.end(); n++)
+            {
+                if (cv::norm(p - *n) > m_poi_active_radius) continue;
+                path_pois.push_back(p);
+                break;
+            }
+        }
+        m_localizer_mutex.unlock();
+        printf("\t%d POIs along the path are collected!\n", (int)path_pois.size());
+        m_guider_mutex.lock();
+        m_path_pois.swap(path_pois);
+        m_guider_mutex.unlock();
+    }
 
-    // guidance: init map and path for guidance
+    // guidance: init map and path for guidance (the map is shared, not copied)
+    // (on rerouting, only the remaining route is replaced and the walked guides are kept)
     m_guider_mutex.lock();
-    VVS_CHECK_TRUE(m_guider.initiateNewGuidance(path, map));
+    ok = (m_path_initialized && !map_changed) ? m_guider.updateGuidancePath(path, map) : m_guider.initiateNewGuidance(path, map);
+    VVS_CHECK_TRUE(ok);
     m_guider_mutex.unlock();
     printf("\tGuidance is updated with new map and path!\n");
 
-    // draw map
-    m_map_image_original.copyTo(m_map_image);
-    m_painter.drawMap(m_map_image, m_map_info, map);
-    m_painter.drawPath(m_map_image, m_map_info, map, path);
-    for(auto itr = m_gps_history_novatel.begin(); itr != m_gps_history_novatel.end(); itr++)
+    // prefetch streetview images along the path (downloaded in the background)
+    if (m_enable_vps && m_streetview_prefetch_nodes > 0)
     {
-        m_painter.drawNode(m_map_image, m_map_info, *itr, 2, 0, cv::Vec3b(0, 0, 255));
+        int n_prefetch = m_map_manager.prefetchStreetViewImages(path, *map, 10, m_streetview_prefetch_nodes, "f");
+        printf("\t%d streetview images are being prefetched!\n", n_prefetch);
     }
-    for(auto itr = m_gps_history_asen.begin(); itr != m_gps_history_asen.end(); itr++)
+
+    // draw map (the map topology is redrawn only if the map is changed, and layers are redrawn when the next frame is composed)
+    m_gui_mutex.lock();
+    if (m_gui_map != map)
     {
-        m_painter.drawNode(m_map_image, m_map_info, *itr, 2, 0, cv::Vec3b(0, 255, 0));
+        m_gui_map = map;
+        m_gui.invalidate(m_gui_layer_graph);
     }
+    m_gui_path = path;
+    m_gui.invalidate(m_gui_layer_path);
+    m_gui_mutex.unlock();
 
     printf("\tGUI map is updated with new map and path!\n");
 
@@ -714,25 +1413,79 @@ bool DeepGuider::updateDeepGuiderPath(dg::TopometricPose pose_topo, dg::LatLon g
 }
 
 
+bool DeepGuider::initializeGuiLayers(const cv::Mat& map_image)
+{
+    m_gui_mutex.lock();
+    m_gui.clear();
+    bool ok = m_gui.setBase(map_image);
+    m_gui_layer_graph = m_gui.addLayer("graph", [this](cv::Mat& canvas)
+    {
+        if (m_gui_map) m_painter.drawMap(canvas, m_map_info, *m_gui_map);
+    });
+    m_gui_layer_path = m_gui.addLayer("path", [this](cv::Mat& canvas)
+    {
+        if (m_gui_map && !m_gui_path.pts.empty()) m_painter.drawPath(canvas, m_map_info, *m_gui_map, m_gui_path);
+    });
+    m_gui_layer_trajectory = m_gui.addLayer("trajectory", [this](cv::Mat& canvas)
+    {
+        for (auto itr = m_gps_history_novatel.begin(); itr != m_gps_history_novatel.end(); itr++)
+            m_painter.drawNode(canvas, m_map_info, *itr, 2, 0, cv::Vec3b(0, 0, 255));
+        for (auto itr = m_gps_history_asen.begin(); itr != m_gps_history_asen.end(); itr++)
+            m_painter.drawNode(canvas, m_map_info, *itr, 2, 0, cv::Vec3b(0, 255, 0));
+    });
+    m_gui_mutex.unlock();
+    return ok && m_gui_layer_graph > 0 && m_gui_layer_path > 0 && m_gui_layer_trajectory > 0;
+}
+
+
+bool DeepGuider::updateGuiView()
+{
+    // redraw the background with visible tiles (all layers are redrawn in the view at the next frame)
+    cv::Mat view_image;
+    if (!m_map_tiles.render(view_image, m_map_view_size, m_view_tl, m_view_zoom)) return false;
+    m_gui_mutex.lock();
+    m_map_info = m_painter.getViewInfo(m_map_info_whole, m_view_tl, m_view_zoom, m_map_view_size);
+    bool ok = m_gui.setBase(view_image);
+    m_gui_mutex.unlock();
+    return ok;
+}
+
+
+void DeepGuider::addGuiTrajectory(const dg::LatLon& gps)
+{
+    // draw only the new point on the cached trajectory layer
+    m_gui_mutex.lock();
+    m_gps_history_asen.push_back(gps);
+    cv::Point pt = m_painter.cvtLatLon2Pixel(gps, m_map_info);
+    int r = std::max(static_cast<int>(2 * m_map_info.ppm + 0.5), 1);
+    m_gui.drawOnLayer(m_gui_layer_trajectory, [&](cv::Mat& canvas)
+    {
+        m_painter.drawNode(canvas, m_map_info, gps, 2, 0, cv::Vec3b(0, 255, 0));
+    }, cv::Rect(pt.x - r - 1, pt.y - r - 1, 2 * r + 3, 2 * r + 3));
+    m_gui_mutex.unlock();
+}
+
+
 void DeepGuider::drawGuiDisplay(cv::Mat& image)
 {
     double video_resize_scale = 0.4;
     int win_delta = 10;
 
     // cam image
-    m_cam_mutex.lock();
-    cv::Mat cam_image = m_cam_image.clone();
-    m_cam_mutex.unlock();
+    dg::Mailbox<dg::CameraFrame>::Handle frame = m_cameras.latest();
+    cv::Size cam_size;
+    if (frame && frame->image) cam_size = frame->image->getSize();
 
-    // draw cam image as subwindow on the GUI map image
+    // draw cam image as subwindow on the GUI map image (resized from the reduced level shared with recognizers)
     cv::Rect win_rect;
     cv::Mat video_image;
     cv::Point video_offset(20, image.rows - 322);
-    if (!cam_image.empty())
+    if (cam_size.area() > 0) video_image = frame->image->getResized(cv::Size(cvRound(cam_size.width * video_resize_scale * 0.8), cvRound(cam_size.height * video_resize_scale)));
+    if (!video_image.empty())
     {
-        cv::resize(cam_image, video_image, cv::Size(), video_resize_scale*0.8, video_resize_scale);
         win_rect = cv::Rect(video_offset, video_offset + cv::Point(video_image.cols, video_image.rows));
         if (win_rect.br().x < image.cols && win_rect.br().y < image.rows) image(win_rect) = video_image * 1;
+        m_gui.markDirty(win_rect);
     }
     else
     {
@@ -766,6 +1519,7 @@ void DeepGuider::drawGuiDisplay(cv::Mat& image)
             intersection_offset.x = win_rect.x + win_rect.width + win_delta;
             cv::Rect rect(intersection_offset, intersection_offset + cv::Point(intersection_image.cols, intersection_image.rows));
             if (rect.x >= 0 && rect.y >= 0 && rect.br().x < image.cols && rect.br().y < image.rows) image(rect) = intersection_image * 1;
+            m_gui.markDirty(rect);
             win_rect = rect;
         }
     }
@@ -796,29 +1550,30 @@ void DeepGuider::drawGuiDisplay(cv::Mat& image)
             if (rect.x >= 0 && rect.y >= 0 && rect.br().x < image.cols && rect.br().y < image.rows)
             {
                 image(rect) = sv_image * 1;
+                m_gui.markDirty(rect);
 
                 cv::Point msg_offset = sv_offset + cv::Point(10, 30);
                 double font_scale = 0.8;
                 std::string str_confidence = cv::format("Confidence: %.2lf", sv_confidence);
                 cv::putText(image, str_confidence.c_str(), msg_offset, cv::FONT_HERSHEY_SIMPLEX, font_scale, cv::Scalar(0, 255, 255), 5);
                 cv::putText(image, str_confidence.c_str(), msg_offset, cv::FONT_HERSHEY_SIMPLEX, font_scale, cv::Scalar(255, 0, 0), 2);
+                m_gui.markText(str_confidence, msg_offset, cv::FONT_HERSHEY_SIMPLEX, font_scale, 5);
                 std::string str_id = cv::format("ID: %zu", sv_id);
                 msg_offset.y += 30;
                 cv::putText(image, str_id.c_str(), msg_offset, cv::FONT_HERSHEY_SIMPLEX, font_scale, cv::Scalar(0, 255, 255), 5);
                 cv::putText(image, str_id.c_str(), msg_offset, cv::FONT_HERSHEY_SIMPLEX, font_scale, cv::Scalar(255, 0, 0), 2);
+                m_gui.markText(str_id, msg_offset, cv::FONT_HERSHEY_SIMPLEX, font_scale, 5);
 
                 win_rect = rect;
             }
         }
 
-        // show gps position of top-1 matched image on the map
-        if (sv_id > 0)
+        // show gps position of top-1 matched image on the map (looked up in the GUI map without querying the server)
+        const dg::StreetView* sv = (sv_id > 0 && m_gui_map) ? m_gui_map->findView(sv_id) : nullptr;
+        if (sv)
         {
-            vector<dg::StreetView> sv = m_map_manager.getStreetView(sv_id);
-            if(!sv.empty() && sv.front().id == sv_id)
-            {
-                m_painter.drawNode(image, m_map_info, dg::LatLon(sv.front().lat, sv.front().lon), 6, 0, cv::Vec3b(255, 255, 0));
-            }
+            m_painter.drawNode(image, m_map_info, dg::LatLon(sv->lat, sv->lon), 6, 0, cv::Vec3b(255, 255, 0));
+            m_gui.markCircle(m_painter.cvtLatLon2Pixel(dg::LatLon(sv->lat, sv->lon), m_map_info), static_cast<int>(6 * m_map_info.ppm + 0.5));
         }
     }
 
@@ -846,6 +1601,7 @@ void DeepGuider::drawGuiDisplay(cv::Mat& image)
             logo_offset.x = win_rect.x + win_rect.width + win_delta;
             cv::Rect rect(logo_offset, logo_offset + cv::Point(logo_image.cols, logo_image.rows));
             if (rect.x >= 0 && rect.y >= 0 && rect.br().x < image.cols && rect.br().y < image.rows) image(rect) = logo_image * 1;
+            m_gui.markDirty(rect);
             win_rect = rect;
         }
     }
@@ -880,6 +1636,7 @@ void DeepGuider::drawGuiDisplay(cv::Mat& image)
             ocr_offset.x = win_rect.x + win_rect.width + win_delta;
             cv::Rect rect(ocr_offset, ocr_offset + cv::Point(ocr_image.cols, ocr_image.rows));
             if (rect.x >= 0 && rect.y >= 0 && rect.br().x < image.cols && rect.br().y < image.rows) image(rect) = ocr_image * 1;
+            m_gui.markDirty(rect);
             win_rect = rect;
         }
     }
@@ -897,14 +1654,18 @@ void DeepGuider::drawGuiDisplay(cv::Mat& image)
     m_painter.drawNode(image, m_map_info, pose_gps, 8, 0, cx::COLOR_BLUE);
     dg::Point2 pose_pixel = m_painter.cvtMeter2Pixel(pose_metric, m_map_info);
     cv::line(image, pose_pixel, pose_pixel + 10 * dg::Point2(cos(pose_metric.theta), -sin(pose_metric.theta)), cx::COLOR_YELLOW, 2);
+    m_gui.markCircle(m_painter.cvtLatLon2Pixel(pose_gps, m_map_info), static_cast<int>(10 * m_map_info.ppm + 0.5));
+    m_gui.markCircle(pose_pixel, 12);
 
     // draw status message (localization)
     cv::String info_topo = cv::format("Node: %zu, Edge: %d, D: %.3fm", pose_topo.node_id, pose_topo.edge_idx, pose_topo.dist);
     cv::putText(image, info_topo, cv::Point(10, 30), cv::FONT_HERSHEY_SIMPLEX, 0.8, cv::Scalar(0, 255, 255), 5);
     cv::putText(image, info_topo, cv::Point(10, 30), cv::FONT_HERSHEY_SIMPLEX, 0.8, cv::Scalar(255, 0, 0), 2);
+    m_gui.markText(info_topo, cv::Point(10, 30), cv::FONT_HERSHEY_SIMPLEX, 0.8, 5);
     std::string info_confidence = cv::format("Confidence: %.2lf", pose_confidence);
     cv::putText(image, info_confidence, cv::Point(10, 60), cv::FONT_HERSHEY_SIMPLEX, 0.8, cv::Scalar(0, 255, 255), 5);
     cv::putText(image, info_confidence, cv::Point(10, 60), cv::FONT_HERSHEY_SIMPLEX, 0.8, cv::Scalar(255, 0, 0), 2);
+    m_gui.markText(info_confidence, cv::Point(10, 60), cv::FONT_HERSHEY_SIMPLEX, 0.8, 5);
 
     // print status message (localization)
     printf("[Localizer]\n");
@@ -932,6 +1693,7 @@ void DeepGuider::drawGuiDisplay(cv::Mat& image)
         cv::Point pt(600, 500);
         cv::putText(image, msg, pt, cv::FONT_HERSHEY_PLAIN, 5, cv::Scalar(0, 255, 0), 8);
         cv::putText(image, msg, pt, cv::FONT_HERSHEY_PLAIN, 5, cv::Scalar(0, 0, 0), 4);
+        m_gui.markText(msg, pt, cv::FONT_HERSHEY_PLAIN, 5, 8);
     }
 }
 
@@ -955,6 +1717,7 @@ void DeepGuider::drawGuidance(cv::Mat image, dg::GuidanceManager::Guidance guide
         int y1 = center_pos.y - icon.rows / 2;
         cv::Rect rect(x1, y1, icon.cols, icon.rows);
         if (rect.x >= 0 && rect.y >= 0 && rect.br().x < image.cols && rect.br().y < image.rows) icon.copyTo(image(rect), mask);
+        m_gui.markDirty(rect);
         if (cmd == dg::GuidanceManager::Motion::GO_FORWARD) dir_msg = "[Guide] GO_FORWARD";
         if (cmd == dg::GuidanceManager::Motion::CROSS_FORWARD) dir_msg = "[Guide] CROSS_FORWARD";
         if (cmd == dg::GuidanceManager::Motion::ENTER_FORWARD) dir_msg = "[Guide] ENTER_FORWARD";
@@ -968,6 +1731,7 @@ void DeepGuider::drawGuidance(cv::Mat image, dg::GuidanceManager::Guidance guide
         int y1 = center_pos.y - icon.rows / 2;
         cv::Rect rect(x1, y1, icon.cols, icon.rows);
         if (rect.x >= 0 && rect.y >= 0 && rect.br().x < image.cols && rect.br().y < image.rows) icon.copyTo(image(rect), mask);
+        m_gui.markDirty(rect);
         if (cmd == dg::GuidanceManager::Motion::TURN_LEFT) dir_msg = "[Guide] TURN_LEFT";
         if (cmd == dg::GuidanceManager::Motion::CROSS_LEFT) dir_msg = "[Guide] CROSS_LEFT";
         if (cmd == dg::GuidanceManager::Motion::ENTER_LEFT) dir_msg = "[Guide] ENTER_LEFT";
@@ -981,6 +1745,7 @@ void DeepGuider::drawGuidance(cv::Mat image, dg::GuidanceManager::Guidance guide
         int y1 = center_pos.y - icon.rows / 2;
         cv::Rect rect(x1, y1, icon.cols, icon.rows);
         if (rect.x >= 0 && rect.y >= 0 && rect.br().x < image.cols && rect.br().y < image.rows) icon.copyTo(image(rect), mask);
+        m_gui.markDirty(rect);
         if (cmd == dg::GuidanceManager::Motion::TURN_RIGHT) dir_msg = "[Guide] TURN_RIGHT";
         if (cmd == dg::GuidanceManager::Motion::CROSS_RIGHT) dir_msg = "[Guide] CROSS_RIGHT";
         if (cmd == dg::GuidanceManager::Motion::ENTER_RIGHT) dir_msg = "[Guide] ENTER_RIGHT";
@@ -994,6 +1759,7 @@ void DeepGuider::drawGuidance(cv::Mat image, dg::GuidanceManager::Guidance guide
         int y1 = center_pos.y - icon.rows / 2;
         cv::Rect rect(x1, y1, icon.cols, icon.rows);
         if (rect.x >= 0 && rect.y >= 0 && rect.br().x < image.cols && rect.br().y < image.rows) icon.copyTo(image(rect), mask);
+        m_gui.markDirty(rect);
         dir_msg = "[Guide] TURN_BACK";
     }
     else
@@ -1005,17 +1771,20 @@ void DeepGuider::drawGuidance(cv::Mat image, dg::GuidanceManager::Guidance guide
     cv::Point msg_offset = rect.tl() + cv::Point(10, 30);
     cv::putText(image, dir_msg.c_str(), msg_offset, cv::FONT_HERSHEY_SIMPLEX, 0.8, cv::Scalar(0, 255, 255), 5);
     cv::putText(image, dir_msg.c_str(), msg_offset, cv::FONT_HERSHEY_SIMPLEX, 0.8, cv::Scalar(255, 0, 0), 2);
+    m_gui.markText(dir_msg, msg_offset, cv::FONT_HERSHEY_SIMPLEX, 0.8, 5);
 
     // show distance message
     msg_offset = center_pos + cv::Point(50, 10);
     std::string distance = cv::format("D=%.2lfm", guide.distance_to_remain);
     cv::putText(image, distance.c_str(), msg_offset, cv::FONT_HERSHEY_SIMPLEX, 0.8, cv::Scalar(0, 255, 255), 5);
     cv::putText(image, distance.c_str(), msg_offset, cv::FONT_HERSHEY_SIMPLEX, 0.8, cv::Scalar(255, 0, 0), 2);
+    m_gui.markText(distance, msg_offset, cv::FONT_HERSHEY_SIMPLEX, 0.8, 5);
 
     // show guidance message
     msg_offset = rect.tl() + cv::Point(0, rect.height + 25);
     cv::putText(image, guide.msg.c_str(), msg_offset, cv::FONT_HERSHEY_SIMPLEX, 0.7, cv::Scalar(0, 255, 255), 4);
     cv::putText(image, guide.msg.c_str(), msg_offset, cv::FONT_HERSHEY_SIMPLEX, 0.7, cv::Scalar(255, 0, 0), 2);
+    m_gui.markText(guide.msg, msg_offset, cv::FONT_HERSHEY_SIMPLEX, 0.7, 4);
 }
 
 
@@ -1099,15 +1868,29 @@ void DeepGuider::procGuidance(dg::Timestamp ts)
     m_guider.update(pose_topo, pose_confidence);
     cur_status = m_guider.getGuidanceStatus();
     cur_guide = m_guider.getGuidance();
+    dg::GuidanceManager::MoveStatus move_status = m_guider.getMoveStatus();
     if (node != nullptr)
     {
         m_guider.applyPoseGPS(dg::LatLon(node->lat, node->lon));
     }
     m_guider_mutex.unlock();
 
+    // set the rates of recognizers by the guidance context
+    if (m_adaptive_rates) updateRecognizerRates(pose_metric, pose_confidence, move_status);
+
     // print guidance message
     printf("%s\n", cur_guide.msg.c_str());
-    
+    if (m_guidance_log.is_open()) writeGuidanceEvent(ts, cur_status, cur_guide);
+    if (m_binary_log.isOpened())
+    {
+        dg::LogGuidance guidance;
+        guidance.status = (int32_t)cur_status;
+        guidance.cmd = cur_guide.actions.empty() ? -1 : (int32_t)cur_guide.actions[0].cmd;
+        guidance.heading_node_id = cur_guide.heading_node_id;
+        guidance.distance_to_remain = cur_guide.distance_to_remain;
+        m_binary_log.writeGuidance(guidance, cur_guide.msg, ts);
+    }
+
     // tts guidance message
     if (m_enable_tts && cur_guide.announce && !cur_guide.actions.empty())
     {
@@ -1129,7 +1912,9 @@ void DeepGuider::procGuidance(dg::Timestamp ts)
             else if (cmd == dg::GuidanceManager::Motion::EXIT_RIGHT) tts_msg = "Exit right";
             else if (cmd == dg::GuidanceManager::Motion::TURN_BACK) tts_msg = "Turn back";
 
-            if(!tts_msg.empty()) putTTS(tts_msg.c_str());
+            // Turns pre-empt stale messages, but going forward does not
+            bool urgent = (cmd != dg::GuidanceManager::Motion::GO_FORWARD && cmd != dg::GuidanceManager::Motion::CROSS_FORWARD && cmd != dg::GuidanceManager::Motion::ENTER_FORWARD && cmd != dg::GuidanceManager::Motion::EXIT_FORWARD);
+            if (!tts_msg.empty()) putTTS(tts_msg.c_str(), urgent ? dg::TTSService::PRIORITY_URGENT : dg::TTSService::PRIORITY_NORMAL);
             m_guidance_cmd = cmd;
         }
     }
@@ -1147,7 +1932,8 @@ void DeepGuider::procGuidance(dg::Timestamp ts)
         if (cur_status == GuidanceManager::GuideStatus::GUIDE_OOP || cur_status == GuidanceManager::GuideStatus::GUIDE_LOST)
         {
             printf("GUIDANCE: out of path detected!\n");
-            if (m_enable_tts) putTTS("Regenerate path!");
+            if (m_enable_tts) putTTS("Regenerate path!", dg::TTSService::PRIORITY_URGENT);
+            cv::AutoLock lock(m_dest_mutex);
             VVS_CHECK_TRUE(updateDeepGuiderPath(pose_topo, pose_gps, m_gps_dest));
         }
 
@@ -1155,7 +1941,8 @@ void DeepGuider::procGuidance(dg::Timestamp ts)
         if (m_enable_exploration)
         {
             m_guider.makeLostValue(m_guider.m_prevconf, pose_confidence);
-            m_active_nav.apply(m_cam_image, cur_guide, ts);
+            dg::Mailbox<dg::CameraFrame>::Handle frame = m_cameras.latest();
+            if (frame) m_active_nav.apply(frame->getImage(), cur_guide, ts);
             if (cur_status == dg::GuidanceManager::GuideStatus::GUIDE_LOST)
             {
                 std::vector<ExplorationGuidance> actions;
@@ -1174,26 +1961,18 @@ void DeepGuider::procGuidance(dg::Timestamp ts)
 
 bool DeepGuider::procIntersectionClassifier()
 {
-    dg::Timestamp ts_old = m_intersection_classifier.timestamp();
-    m_cam_mutex.lock(); 
-    dg::Timestamp capture_time = m_cam_capture_time;
-    if(capture_time <= ts_old)
-    {
-        m_cam_mutex.unlock();
-        return true;
-    }
-    cv::Mat cam_image = m_cam_image.clone();
-    dg::LatLon capture_pos = m_cam_gps;
-    int cam_fnumber = m_cam_fnumber;
-    m_cam_mutex.unlock();
+    dg::Mailbox<dg::CameraFrame>::Handle frame = getCameraFrame("intersection");
+    if (!frame) return true;
+    cv::Mat cam_image = getInputImage(*frame, "intersection");
 
-    if (!cam_image.empty() && m_intersection_classifier.apply(cam_image, capture_time))
+    if (applyRecognizer(m_intersection_classifier, *frame, cam_image))
     {
+        static const int stale_id = dg::Metrics::instance().registerName("intersection.stale_results");
+        countStaleResult(*frame, stale_id);
+        m_rate_policy.addBusyTime("intersection", m_intersection_classifier.procTime());
         if (m_data_logging)
         {
-            m_log_mutex.lock();
-            m_intersection_classifier.write(m_log, cam_fnumber);
-            m_log_mutex.unlock();
+            writeRecognizerLog(m_intersection_classifier, *frame);
         } 
         m_intersection_classifier.print();
 
@@ -1218,26 +1997,19 @@ bool DeepGuider::procIntersectionClassifier()
 
 bool DeepGuider::procLogo()
 {
-    dg::Timestamp ts_old = m_logo.timestamp();
-    m_cam_mutex.lock(); 
-    dg::Timestamp capture_time = m_cam_capture_time;
-    if(capture_time <= ts_old)
-    {
-        m_cam_mutex.unlock();
-        return true;
-    }
-    cv::Mat cam_image = m_cam_image.clone();
-    dg::LatLon capture_pos = m_cam_gps;
-    int cam_fnumber = m_cam_fnumber;
-    m_cam_mutex.unlock();
+    dg::Mailbox<dg::CameraFrame>::Handle frame = getCameraFrame("logo");
+    if (!frame) return true;
+    cv::Mat cam_image = getInputImage(*frame, "logo");
 
-    if (!cam_image.empty() && m_logo.apply(cam_image, capture_time))
+    bool reused = false;
+    if (applyCachedRecognizer(m_logo, m_logo_cache, *frame, [&]() { return applyRecognizer(m_logo, *frame, cam_image); }, reused))
     {
+        static const int stale_id = dg::Metrics::instance().registerName("logo.stale_results");
+        countStaleResult(*frame, stale_id);
+        if (!reused) m_rate_policy.addBusyTime("logo", m_logo.procTime());
         if (m_data_logging)
         {
-            m_log_mutex.lock();
-            m_logo.write(m_log, cam_fnumber);
-            m_log_mutex.unlock();
+            writeRecognizerLog(m_logo, *frame);
         }
         m_logo.print();
 
@@ -1253,7 +2025,7 @@ bool DeepGuider::procLogo()
             obs.push_back(rel_pose_defualt);
             confs.push_back(logos[k].confidence);
         }
-        VVS_CHECK_TRUE(m_localizer.applyLocClue(ids, obs, capture_time, confs));
+        VVS_CHECK_TRUE(applyLocClue(ids, obs, *frame, confs));
 
         if(!logos.empty())
         {
@@ -1277,26 +2049,19 @@ bool DeepGuider::procLogo()
 
 bool DeepGuider::procOcr()
 {
-    dg::Timestamp ts_old = m_ocr.timestamp();
-    m_cam_mutex.lock(); 
-    dg::Timestamp capture_time = m_cam_capture_time;
-    if(capture_time <= ts_old)
-    {
-        m_cam_mutex.unlock();
-        return true;
-    }
-    cv::Mat cam_image = m_cam_image.clone();
-    dg::LatLon capture_pos = m_cam_gps;
-    int cam_fnumber = m_cam_fnumber;
-    m_cam_mutex.unlock();
+    dg::Mailbox<dg::CameraFrame>::Handle frame = getCameraFrame("ocr");
+    if (!frame) return true;
+    cv::Mat cam_image = getInputImage(*frame, "ocr");
 
-    if (!cam_image.empty() && m_ocr.apply(cam_image, capture_time))
+    bool reused = false;
+    if (applyCachedRecognizer(m_ocr, m_ocr_cache, *frame, [&]() { return applyRecognizer(m_ocr, *frame, cam_image); }, reused))
     {
+        static const int stale_id = dg::Metrics::instance().registerName("ocr.stale_results");
+        countStaleResult(*frame, stale_id);
+        if (!reused) m_rate_policy.addBusyTime("ocr", m_ocr.procTime());
         if (m_data_logging)
         {
-            m_log_mutex.lock();
-            m_ocr.write(m_log, cam_fnumber);
-            m_log_mutex.unlock();
+            writeRecognizerLog(m_ocr, *frame);
         }
         m_ocr.print();
 
@@ -1313,7 +2078,7 @@ bool DeepGuider::procOcr()
             obs.push_back(rel_pose_defualt);
             confs.push_back(ocrs[k].confidence);
         }
-        VVS_CHECK_TRUE(m_localizer.applyLocClue(ids, obs, capture_time, confs));
+        VVS_CHECK_TRUE(applyLocClue(ids, obs, *frame, confs));
 
         if (!ocrs.empty())
         {
@@ -1338,24 +2103,26 @@ bool DeepGuider::procOcr()
 
 bool DeepGuider::procRoadTheta()
 {
-    dg::Timestamp ts_old = m_roadtheta.timestamp();
-    m_cam_mutex.lock(); 
-    dg::Timestamp capture_time = m_cam_capture_time;
-    if(capture_time <= ts_old)
-    {
-        m_cam_mutex.unlock();
-        return true;
-    }
-    cv::Mat cam_image = m_cam_image.clone();
-    dg::LatLon capture_pos = m_cam_gps;
-    int cam_fnumber = m_cam_fnumber;
-    m_cam_mutex.unlock();
+    dg::Mailbox<dg::CameraFrame>::Handle frame = getCameraFrame("roadtheta");
+    if (!frame) return true;
+    cv::Mat cam_image = getInputImage(*frame, "roadtheta");
     
-    if (!cam_image.empty() && m_roadtheta.apply(cam_image, capture_time))
+    if (applyRecognizer(m_roadtheta, *frame, cam_image))
     {
+        static const int stale_id = dg::Metrics::instance().registerName("roadtheta.stale_results");
+        countStaleResult(*frame, stale_id);
+        m_rate_policy.addBusyTime("roadtheta", m_roadtheta.procTime());
+        if (m_data_logging)
+        {
+            writeRecognizerLog(m_roadtheta, *frame);
+        }
+
         double angle, confidence;
         m_roadtheta.get(angle, confidence);
-        VVS_CHECK_TRUE(m_localizer.applyLocClue(id_invalid, Polar2(-1, angle), capture_time, confidence));
+        std::vector<dg::ID> ids(1, id_invalid);
+        std::vector<Polar2> obs(1, Polar2(-1, angle));
+        std::vector<double> confs(1, confidence);
+        VVS_CHECK_TRUE(applyLocClue(ids, obs, *frame, confs));
     }
 
     return true;
@@ -1445,18 +2212,11 @@ bool DeepGuider::curl_request(const std::string url, const char* CMD, const Json
 
 bool DeepGuider::procVps() // This sends query image and parameters to server using curl_request() and it receives its results (Id,conf.)
 {
-    dg::Timestamp ts_old = m_vps.timestamp();
-    m_cam_mutex.lock(); 
-    dg::Timestamp capture_time = m_cam_capture_time;
-    if(capture_time <= ts_old)
-    {
-        m_cam_mutex.unlock();
-        return true;
-    }
-    cv::Mat cam_image = m_cam_image.clone();
-    dg::LatLon capture_pos = m_cam_gps;
-    int cam_fnumber = m_cam_fnumber;
-    m_cam_mutex.unlock();
+    dg::Mailbox<dg::CameraFrame>::Handle frame = getCameraFrame("vps");
+    if (!frame) return true;
+    cv::Mat cam_image = getInputImage(*frame, "vps");
+    dg::Timestamp capture_time = frame->capture_time;
+    dg::LatLon capture_pos = frame->gps;
 
     int N = 3;  // top-3
     double gps_accuracy = 1;   // 0: search radius = 230m ~ 1: search radius = 30m
@@ -1474,6 +2234,8 @@ bool DeepGuider::procVps() // This sends query image and parameters to server us
     if (!cam_image.empty())
 	//	&& m_vps.apply(cam_image, N, capture_pos.lat, capture_pos.lon, gps_accuracy, capture_time, m_server_ip.c_str()))
     {
+        DG_TRACE_SCOPE("VPS::apply(server)");
+        double start_time = dg::Metrics::now();
         std::vector<dg::ID> ids;
         std::vector<dg::Polar2> obs;
         std::vector<double> confs;
@@ -1510,6 +2272,7 @@ bool DeepGuider::procVps() // This sends query image and parameters to server us
 			IDandConf.confidence = ret_json["vps_IDandConf"][1][idx].asDouble(); 
 			streetviews.push_back(IDandConf);
 		}
+        m_rate_policy.addBusyTime("vps", (dg::Metrics::now() - start_time) / 1e6);
 	
         //m_vps.get(streetviews);
 
@@ -1525,9 +2288,7 @@ bool DeepGuider::procVps() // This sends query image and parameters to server us
 
         if(ids.size() > 0)
         {
-            m_localizer_mutex.lock();
-            VVS_CHECK_TRUE(m_localizer.applyLocClue(ids, obs, capture_time, confs));
-            m_localizer_mutex.unlock();
+            VVS_CHECK_TRUE(applyLocClue(ids, obs, *frame, confs));
 
             cv::Mat sv_image;
             if(m_map_manager.getStreetViewImage(ids[0], sv_image, "f") && !sv_image.empty())
@@ -1563,28 +2324,28 @@ bool DeepGuider::procVps() // This sends query image and parameters to server us
 #else // VPSSERVER
 bool DeepGuider::procVps() // This will call apply() in vps.py embedded by C++ 
 {
-    dg::Timestamp ts_old = m_vps.timestamp();
-    m_cam_mutex.lock(); 
-    dg::Timestamp capture_time = m_cam_capture_time;
-    if(capture_time <= ts_old)
-    {
-        m_cam_mutex.unlock();
-        return true;
-    }
-    cv::Mat cam_image = m_cam_image.clone();
-    dg::LatLon capture_pos = m_cam_gps;
-    int cam_fnumber = m_cam_fnumber;
-    m_cam_mutex.unlock();
+    dg::Mailbox<dg::CameraFrame>::Handle frame = getCameraFrame("vps");
+    if (!frame) return true;
+    cv::Mat cam_image = getInputImage(*frame, "vps");
+    dg::Timestamp capture_time = frame->capture_time;
+    dg::LatLon capture_pos = frame->gps;
+    int cam_fnumber = frame->fnumber;
 
     int N = 3;  // top-3
     double gps_accuracy = 1;   // 0: search radius = 230m ~ 1: search radius = 30m
-    if (!cam_image.empty() && m_vps.apply(cam_image, N, capture_pos.lat, capture_pos.lon, gps_accuracy, capture_time, m_server_ip.c_str()))
+    bool reused = false;
+    bool ok = applyCachedRecognizer(m_vps, m_vps_cache, *frame, [&]()
     {
+        return m_replay.isOpened() ? (frame->camera == 0 && m_replay.read(m_vps, cam_fnumber)) : (!cam_image.empty() && m_vps.apply(cam_image, N, capture_pos.lat, capture_pos.lon, gps_accuracy, capture_time, m_server_ip.c_str()));
+    }, reused);
+    if (ok)
+    {
+        static const int stale_id = dg::Metrics::instance().registerName("vps.stale_results");
+        countStaleResult(*frame, stale_id);
+        if (!reused) m_rate_policy.addBusyTime("vps", m_vps.procTime());
         if (m_data_logging)
         {
-            m_log_mutex.lock();
-            m_vps.write(m_log, cam_fnumber);
-            m_log_mutex.unlock();
+            writeRecognizerLog(m_vps, *frame);
         } 
         m_vps.print();
 
@@ -1603,9 +2364,7 @@ bool DeepGuider::procVps() // This will call apply() in vps.py embedded by C++
 
         if(ids.size() > 0)
         {
-            m_localizer_mutex.lock();
-            VVS_CHECK_TRUE(m_localizer.applyLocClue(ids, obs, capture_time, confs));
-            m_localizer_mutex.unlock();
+            VVS_CHECK_TRUE(applyLocClue(ids, obs, *frame, confs));
 
             cv::Mat sv_image;
             if(m_map_manager.getStreetViewImage(ids[0], sv_image, "f") && !sv_image.empty())
@@ -1705,42 +2464,14 @@ void DeepGuider::threadfunc_roadtheta(DeepGuider* guider)
     printf("\troadtheta thread ends\n");
 }
 
-// Thread fnuction for tts
-void DeepGuider::threadfunc_tts(DeepGuider* guider)
+void DeepGuider::putTTS(const char* msg, int priority)
 {
-    guider->is_tts_running = true;
-    printf("\ttts thread starts\n");
-    while (guider->m_enable_tts)
-    {
-        guider->procTTS();
-    }
-    guider->is_tts_running = false;
-    printf("\ttts thread ends\n");
-}
-
-void DeepGuider::putTTS(const char* msg)
-{
-    m_tts_mutex.lock();
-    m_tts_msg.push_back(msg);
-    m_tts_mutex.unlock();
-}
-
-void DeepGuider::procTTS()
-{
-    m_tts_mutex.lock();
-    std::vector<std::string> tts_msg = m_tts_msg;
-    m_tts_msg.clear();
-    m_tts_mutex.unlock();
-
-    for(int i=0; i<(int)tts_msg.size(); i++)
-    {
-        tts(tts_msg[i]);
-    }
+    m_tts.put(msg, priority);
 }
 
 void DeepGuider::terminateThreadFunctions()
 {
-    if (vps_thread == nullptr && ocr_thread == nullptr && logo_thread == nullptr && intersection_thread == nullptr && roadtheta_thread == nullptr && tts_thread == nullptr) return;
+    if (vps_thread == nullptr && ocr_thread == nullptr && logo_thread == nullptr && intersection_thread == nullptr && roadtheta_thread == nullptr && !m_tts.isRunning()) return;
 
     // disable all thread running
     m_enable_vps = false;
@@ -1756,7 +2487,7 @@ void DeepGuider::terminateThreadFunctions()
     if (logo_thread && is_logo_running) logo_thread->join();
     if (intersection_thread && is_intersection_running) intersection_thread->join();
     if (roadtheta_thread && is_roadtheta_running) roadtheta_thread->join();
-    if (tts_thread && is_tts_running) tts_thread->join();
+    m_tts.stop();
 
     // clear threads
     vps_thread = nullptr;
@@ -1764,7 +2495,6 @@ void DeepGuider::terminateThreadFunctions()
     logo_thread = nullptr;
     intersection_thread = nullptr;
     roadtheta_thread = nullptr;
-    tts_thread = nullptr;
 }
 
 #endif      // #ifndef __DEEPGUIDER_SIMPLE__
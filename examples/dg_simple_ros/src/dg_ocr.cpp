@@ -35,9 +35,8 @@ protected:
     std::ofstream m_log;
     int m_recording_fps = 30;
 
-    cv::Mutex m_cam_mutex;
-    cv::Mat m_cam_image;
-    dg::Timestamp m_cam_capture_time;
+    dg::Mailbox<dg::CameraFrame> m_cam_mailbox;     // the latest camera frame (shared without copy)
+    uint64_t m_cam_seq = 0;         // sequence number of the last processed frame
     int m_cam_fnumber;              // frame number
     cv::Mat m_gui_image;
     std::string m_winname;
@@ -122,8 +121,8 @@ bool DGRosRecognizer::initialize()
     printf("\t%s initialized in %.3lf seconds!\n", m_recognizer.name(), m_recognizer.procTime());
 
     // reset interval variables
-    m_cam_image.release();
-    m_cam_capture_time = -1;
+    m_cam_mailbox.clear();
+    m_cam_seq = 0;
     m_winname = cv::format("dg_%s", m_recognizer.name());
     m_cam_fnumber = -1;
 
@@ -178,14 +177,13 @@ bool DGRosRecognizer::runOnce(double timestamp)
     dg::Timestamp ts_old = m_recognizer.timestamp();
     cv::Mat cam_image;
     dg::Timestamp capture_time;
-    m_cam_mutex.lock();
-    if(!m_cam_image.empty() && m_cam_capture_time > ts_old)
+    dg::Mailbox<dg::CameraFrame>::Handle frame;
+    if (m_cam_mailbox.fetch(m_cam_seq, frame) && frame->image && frame->capture_time > ts_old)
     {
-        cam_image = m_cam_image.clone();
-        capture_time = m_cam_capture_time;
+        cam_image = frame->getImage();      // only the latest frame is decoded
+        capture_time = frame->capture_time;
         m_cam_fnumber++;
-    }    
-    m_cam_mutex.unlock();
+    }
 
     bool detected = false;
     if (!cam_image.empty() && m_recognizer.apply(cam_image, capture_time))
@@ -230,6 +228,7 @@ bool DGRosRecognizer::runOnce(double timestamp)
     // show results & fps
     if(!cam_image.empty() && detected)
     {
+        cam_image = cam_image.clone();      // the frame is shared, so draw on its copy
         std::string fn = cv::format("FPS: %.1lf", 1.0 / m_recognizer.procTime());
         cv::putText(cam_image, fn.c_str(), cv::Point(20, 50), cv::FONT_HERSHEY_PLAIN, 2.0, cv::Scalar(0, 0, 0), 4);
         cv::putText(cam_image, fn.c_str(), cv::Point(20, 50), cv::FONT_HERSHEY_PLAIN, 2.0, cv::Scalar(0, 255, 255), 2);
@@ -254,10 +253,10 @@ void DGRosRecognizer::callbackImageCompressed(const sensor_msgs::CompressedImage
     cv_bridge::CvImagePtr image_ptr;
     try
     {
-        m_cam_mutex.lock();
-        m_cam_image = cv::imdecode(cv::Mat(msg->data), 1);//convert compressed image data to cv::Mat
-        m_cam_capture_time = msg->header.stamp.toSec();
-        m_cam_mutex.unlock();
+        dg::CameraFrame frame;
+        frame.image = std::make_shared<const dg::FrameImage>(msg->data);    // decoded later by runOnce() if not skipped
+        frame.capture_time = msg->header.stamp.toSec();
+        m_cam_mailbox.publish(frame);
     }
     catch (cv_bridge::Exception& e)
     {
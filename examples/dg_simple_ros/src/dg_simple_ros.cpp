@@ -144,6 +144,7 @@ int DeepGuiderROS::run()
     printf("\tthread terminated\n");
     if(m_recording) m_video_gui.release();
     if(m_data_logging) m_video_cam.release();
+    m_binary_log.close();
     printf("\tclose recording\n");
     cv::destroyWindow(m_winname);
     printf("\tgui window destroyed\n");
@@ -199,20 +200,16 @@ void DeepGuiderROS::callbackImageCompressed(const sensor_msgs::CompressedImageCo
     cv_bridge::CvImagePtr image_ptr;
     try
     {
-        cv::Mat logging_image;
-        m_cam_mutex.lock();
-        m_cam_image = cv::imdecode(cv::Mat(msg->data), 1);//convert compressed image data to cv::Mat
-        m_cam_capture_time = msg->header.stamp.toSec();
-        m_cam_gps = m_localizer.getPoseGPS();
-        m_cam_fnumber++;
-        if (m_data_logging) logging_image = m_cam_image.clone();
-        m_cam_mutex.unlock();
+        // the compressed image is decoded later by its consumers (not on this callback)
+        std::shared_ptr<const dg::FrameImage> image = std::make_shared<const dg::FrameImage>(msg->data);
+        dg::Timestamp capture_time = msg->header.stamp.toSec();
+        publishCameraFrame(image, capture_time, m_localizer.getPoseGPS());
 
-        updateTimestamp2Framenumber(m_cam_capture_time, m_cam_fnumber);
+        updateTimestamp2Framenumber(capture_time, m_cam_fnumber);
 
         if (m_data_logging)
         {
-            m_video_cam << logging_image;
+            m_video_cam << image->get();    // decoded once and shared with recognizers
         }
     }
     catch (cv_bridge::Exception& e)
@@ -226,10 +223,10 @@ void DeepGuiderROS::callbackImageCompressed(const sensor_msgs::CompressedImageCo
 void DeepGuiderROS::callbackRealsenseImage(const sensor_msgs::CompressedImageConstPtr& msg)
 {
     ROS_INFO_THROTTLE(1.0, "Realsense: RGB (timestamp=%f)", msg->header.stamp.toSec());
-    cv::Mat image;
+    if (m_cameras.size() < 2) return;   // used only if the second camera is configured
     try
     {
-        cv::Mat image = cv::imdecode(cv::Mat(msg->data), 1);//convert compressed image data to cv::Mat
+        publishCameraFrame(std::make_shared<const dg::FrameImage>(msg->data), msg->header.stamp.toSec(), m_localizer.getPoseGPS(), 1);
     }
     catch (cv_bridge::Exception& e)
     {
@@ -321,6 +318,25 @@ void DeepGuiderROS::callbackIMU(const sensor_msgs::Imu::ConstPtr& msg)
     double linacc_z = msg->linear_acceleration.z;
 
     ROS_INFO_THROTTLE(1.0, "IMU: seq=%d, orientation=(%f,%f,%f), angular_veloctiy=(%f,%f,%f), linear_acceleration=(%f,%f,%f)", seq, ori_x, ori_y, ori_z, angvel_x, angvel_y, angvel_z, linacc_x, linacc_y, linacc_z);
+
+    if (m_binary_log.isOpened())
+    {
+        dg::LogIMU imu;
+        imu.ori_w = msg->orientation.w;
+        imu.ori_x = ori_x;
+        imu.ori_y = ori_y;
+        imu.ori_z = ori_z;
+        imu.angvel_x = angvel_x;
+        imu.angvel_y = angvel_y;
+        imu.angvel_z = angvel_z;
+        imu.linacc_x = linacc_x;
+        imu.linacc_y = linacc_y;
+        imu.linacc_z = linacc_z;
+        m_binary_log.writeIMU(imu, msg->header.stamp.toSec());
+    }
+
+    // accumulate gyro data for the next localizer update (linear_acceleration includes gravity, so it is not used)
+    m_localizer.applyIMU(angvel_z, 0, msg->header.stamp.toSec());
 }
 
 // A callback function for subscribing OCR output
@@ -349,9 +365,7 @@ void DeepGuiderROS::callbackOCR(const dg_simple_ros::ocr_info::ConstPtr& msg)
 
         if (m_data_logging)
         {
-            m_log_mutex.lock();
-            m_ocr.write(m_log, cam_fnumber);
-            m_log_mutex.unlock();
+            writeRecognizerLog(m_ocr, ts, cam_fnumber);
         }
         m_ocr.print();
 
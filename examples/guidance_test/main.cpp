@@ -4,6 +4,8 @@
 #include "dg_map_manager.hpp"
 #include "dg_exploration.hpp"
 #include "dg_guidance.hpp"
+#include "test_guidance.hpp"
+#include "test_tts.hpp"
 #include <chrono>
 
 using namespace dg;
@@ -166,6 +168,14 @@ void test_image_run(ActiveNavigation& active_nav, GuidanceManager::Guidance guid
 
 int main()
 {	   	 
+	// Test guidance on a synthetic route
+	VVS_RUN_TEST(testGuidanceSimple());
+	VVS_RUN_TEST(testGuidanceUpdateBenchmark());
+	VVS_RUN_TEST(testGuidanceReroute());
+
+	// Test the TTS service with a fake decoder
+	VVS_RUN_TEST(testTTSService());
+
 	//initialize map
 	MapManager map_manager;
 	map_manager.setIP("localhost");
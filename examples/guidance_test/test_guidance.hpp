@@ -0,0 +1,242 @@
+#ifndef __TEST_GUIDANCE__
+#define __TEST_GUIDANCE__
+
+#include "utils/vvs.h"
+#include "dg_guidance.hpp"
+#include <chrono>
+
+/**
+ * Build a staircase-shaped route with n_nodes nodes (10 m edges, a junction with a 90 degree turn every 5 nodes)
+ * Node IDs are 1 ~ n_nodes along the route, and edge IDs are 1001 ~ 1000 + n_nodes - 1.
+ */
+void buildGuidanceTestRoute(int n_nodes, dg::Map& map, dg::Path& path)
+{
+	const double step_lat = 9e-5, step_lon = 1.1e-4;
+	double lat = 36.38, lon = 127.36;
+	map = dg::Map();
+	path.pts.clear();
+	for (int k = 0; k < n_nodes; k++)
+	{
+		int type = (k > 0 && k % 5 == 0) ? dg::Node::NODE_JUNCTION : dg::Node::NODE_BASIC;
+		map.addNode(dg::Node(1 + k, lat, lon, type));
+		if ((k / 5) % 2 == 0) lon += step_lon;
+		else lat += step_lat;
+	}
+	for (int k = 0; k + 1 < n_nodes; k++)
+	{
+		map.addEdge(1 + k, 2 + k, dg::Edge(1001 + k, 10));
+		path.pts.push_back(dg::PathElement(1 + k, 1001 + k));
+	}
+	path.pts.push_back(dg::PathElement(n_nodes, 0));
+}
+
+/** Walk along the route built by buildGuidanceTestRoute (4 poses per edge) and return the average time of update() */
+double walkGuidanceTestRoute(dg::GuidanceManager& guider, int n_nodes, int& n_normal)
+{
+	n_normal = 0;
+	double t_update = 0;
+	int n_updates = 0;
+	for (int k = 0; k + 1 < n_nodes; k++)
+	{
+		for (int d = 0; d < 10; d += 3)
+		{
+			dg::TopometricPose pose(1 + k, (k == 0) ? 0 : 1, d);
+			auto t0 = std::chrono::steady_clock::now();
+			guider.update(pose, 1.0);
+			t_update += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+			n_updates++;
+			if (guider.getGuidanceStatus() == dg::GuidanceManager::GuideStatus::GUIDE_NORMAL) n_normal++;
+		}
+	}
+	guider.update(dg::TopometricPose(n_nodes, 0, 0), 1.0);
+	return t_update / n_updates;
+}
+
+int testGuidanceSimple()
+{
+	dg::Map map;
+	dg::Path path;
+	buildGuidanceTestRoute(12, map, path);
+
+	dg::GuidanceManager guider;
+	VVS_CHECK_TRUE(guider.initiateNewGuidance(path, std::move(map)));
+
+	// Guides follow the route from the start to the destination
+	VVS_CHECK_TRUE(guider.update(dg::TopometricPose(1, 0, 0), 1.0));
+	VVS_CHECK_TRUE(guider.getGuidanceStatus() == dg::GuidanceManager::GuideStatus::GUIDE_INITIAL);
+	VVS_CHECK_TRUE(guider.update(dg::TopometricPose(2, 1, 3), 1.0));
+	VVS_CHECK_TRUE(guider.update(dg::TopometricPose(2, 1, 4), 1.0));
+	VVS_CHECK_TRUE(guider.getGuidanceStatus() == dg::GuidanceManager::GuideStatus::GUIDE_NORMAL);
+	VVS_CHECK_EQUL(guider.getGuidance().heading_node_id, 3);
+	VVS_CHECK_NEAR(guider.getGuidance().distance_to_remain, 36);
+
+	// The turn at the junction is announced while approaching it
+	VVS_CHECK_TRUE(guider.update(dg::TopometricPose(5, 1, 5), 1.0));
+	VVS_CHECK_TRUE(guider.getGuidance().moving_status == dg::GuidanceManager::MoveStatus::APPROACHING_NODE);
+	VVS_CHECK_EQUL(guider.getGuidance().actions.size(), 2);
+	VVS_CHECK_TRUE(guider.getGuidance().actions[0].cmd == dg::GuidanceManager::Motion::TURN_LEFT);
+
+	// Skipping a few nodes and arriving at the destination
+	VVS_CHECK_TRUE(guider.update(dg::TopometricPose(9, 1, 2), 1.0));
+	VVS_CHECK_EQUL(guider.getGuidance().heading_node_id, 10);
+	VVS_CHECK_TRUE(guider.update(dg::TopometricPose(12, 0, 0), 1.0));
+	VVS_CHECK_TRUE(guider.getGuidanceStatus() == dg::GuidanceManager::GuideStatus::GUIDE_ARRIVED);
+
+	return 0;
+}
+
+int testGuidanceUpdateBenchmark()
+{
+	const int lengths[] = { 100, 1000, 10000, 50000 };
+	for (int n_nodes : lengths)
+	{
+		dg::Map map;
+		dg::Path path;
+		buildGuidanceTestRoute(n_nodes, map, path);
+		dg::MapSnapshot snapshot = std::make_shared<const dg::Map>(std::move(map));
+
+		dg::GuidanceManager guider;
+		auto t0 = std::chrono::steady_clock::now();
+		VVS_CHECK_TRUE(guider.initiateNewGuidance(path, snapshot));
+		double t_init = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+		int n_normal = 0;
+		double t_update = walkGuidanceTestRoute(guider, n_nodes, n_normal);
+		VVS_CHECK_EQUL(n_normal, 4 * (n_nodes - 2) - 1);
+		VVS_CHECK_TRUE(guider.getGuidanceStatus() == dg::GuidanceManager::GuideStatus::GUIDE_ARRIVED);
+		printf(" * Path length: %d nodes (initiateNewGuidance: %.3f ms, update: %.2f us/call)\n", n_nodes, t_init * 1000, t_update * 1e6);
+	}
+	return 0;
+}
+
+/** Check that two guiders give the same guidances on the given poses */
+int compareGuidances(dg::GuidanceManager& guider1, dg::GuidanceManager& guider2, const std::vector<dg::TopometricPose>& poses)
+{
+	for (auto pose = poses.begin(); pose != poses.end(); pose++)
+	{
+		bool ok1 = guider1.update(*pose, 1.0);
+		bool ok2 = guider2.update(*pose, 1.0);
+		VVS_CHECK_EQUL(ok1, ok2);
+		VVS_CHECK_TRUE(guider1.getGuidanceStatus() == guider2.getGuidanceStatus());
+		VVS_CHECK_EQUL(guider1.getGuidance().heading_node_id, guider2.getGuidance().heading_node_id);
+		VVS_CHECK_NEAR(guider1.getGuidance().distance_to_remain, guider2.getGuidance().distance_to_remain);
+		VVS_CHECK_TRUE(guider1.getGuidance().msg == guider2.getGuidance().msg);
+	}
+	return 0;
+}
+
+int testGuidanceReroute()
+{
+	// A detour 4 - 201 - 202 - 8 next to the route 1 - 2 - ... - 12
+	dg::Map map;
+	dg::Path path;
+	buildGuidanceTestRoute(12, map, path);
+	map.addNode(dg::Node(201, 36.3799, 127.36033, dg::Node::NODE_JUNCTION));
+	map.addNode(dg::Node(202, 36.3799, 127.36077, dg::Node::NODE_JUNCTION));
+	map.addEdge(4, 201, dg::Edge(2001, 12));
+	map.addEdge(201, 202, dg::Edge(2002, 40));
+	map.addEdge(202, 8, dg::Edge(2003, 12));
+	dg::MapSnapshot snapshot = std::make_shared<const dg::Map>(std::move(map));
+
+	dg::Path detour;
+	detour.pts.push_back(dg::PathElement(4, 2001));
+	detour.pts.push_back(dg::PathElement(201, 2002));
+	detour.pts.push_back(dg::PathElement(202, 2003));
+	detour.pts.insert(detour.pts.end(), path.pts.begin() + 7, path.pts.end());
+
+	// The incremental reroute gives the same guidances with the guidance on the whole route
+	dg::GuidanceManager guider;
+	VVS_CHECK_TRUE(guider.initiateNewGuidance(path, snapshot));
+	VVS_CHECK_TRUE(guider.update(dg::TopometricPose(1, 0, 5), 1.0));
+	VVS_CHECK_TRUE(guider.update(dg::TopometricPose(2, 1, 5), 1.0));
+	VVS_CHECK_TRUE(guider.update(dg::TopometricPose(3, 1, 5), 1.0));
+	VVS_CHECK_TRUE(guider.updateGuidancePath(detour));
+
+	dg::Path whole;
+	whole.pts.assign(path.pts.begin(), path.pts.begin() + 3);
+	whole.pts.insert(whole.pts.end(), detour.pts.begin(), detour.pts.end());
+	dg::GuidanceManager reference;
+	VVS_CHECK_TRUE(reference.initiateNewGuidance(whole, snapshot));
+	VVS_CHECK_TRUE(reference.update(dg::TopometricPose(1, 0, 5), 1.0));
+	VVS_CHECK_TRUE(reference.update(dg::TopometricPose(2, 1, 5), 1.0));
+	VVS_CHECK_TRUE(reference.update(dg::TopometricPose(3, 1, 5), 1.0));
+
+	std::vector<dg::TopometricPose> poses;
+	poses.push_back(dg::TopometricPose(4, 1, 0));
+	poses.push_back(dg::TopometricPose(4, 2, 6));
+	poses.push_back(dg::TopometricPose(201, 1, 2));
+	poses.push_back(dg::TopometricPose(201, 1, 35));
+	poses.push_back(dg::TopometricPose(202, 1, 3));
+	poses.push_back(dg::TopometricPose(8, 2, 1));
+	poses.push_back(dg::TopometricPose(9, 1, 5));
+	poses.push_back(dg::TopometricPose(12, 0, 0));
+	VVS_CHECK_EQUL(compareGuidances(guider, reference, poses), 0);
+	VVS_CHECK_TRUE(guider.getGuidanceStatus() == dg::GuidanceManager::GuideStatus::GUIDE_ARRIVED);
+
+	// The reroute which starts off the route (after the robot went out of the path at 4) is joined from the current guide
+	dg::Path offroute;
+	offroute.pts.assign(detour.pts.begin() + 1, detour.pts.end());
+	std::vector<dg::TopometricPose> walked;
+	walked.push_back(dg::TopometricPose(1, 0, 5));
+	walked.push_back(dg::TopometricPose(2, 1, 5));
+	walked.push_back(dg::TopometricPose(3, 1, 5));
+	walked.push_back(dg::TopometricPose(4, 1, 0));
+	walked.push_back(dg::TopometricPose(4, 2, 6));
+	VVS_CHECK_TRUE(guider.initiateNewGuidance(path, snapshot));
+	VVS_CHECK_TRUE(reference.initiateNewGuidance(whole, snapshot));
+	for (auto pose = walked.begin(); pose != walked.end(); pose++)
+	{
+		guider.update(*pose, 1.0);
+		reference.update(*pose, 1.0);
+	}
+	VVS_CHECK_TRUE(guider.updateGuidancePath(offroute));
+	poses.clear();
+	poses.push_back(dg::TopometricPose(201, 1, 2));
+	poses.push_back(dg::TopometricPose(201, 1, 35));
+	poses.push_back(dg::TopometricPose(202, 1, 3));
+	poses.push_back(dg::TopometricPose(8, 2, 1));
+	poses.push_back(dg::TopometricPose(9, 1, 5));
+	poses.push_back(dg::TopometricPose(12, 0, 0));
+	VVS_CHECK_EQUL(compareGuidances(guider, reference, poses), 0);
+	VVS_CHECK_TRUE(guider.getGuidanceStatus() == dg::GuidanceManager::GuideStatus::GUIDE_ARRIVED);
+
+	// The reroute which starts off the remaining route (behind the robot) gives the same guidances with a new guidance
+	VVS_CHECK_TRUE(guider.initiateNewGuidance(path, snapshot));
+	for (dg::ID nid = 1; nid <= 6; nid++)
+		VVS_CHECK_TRUE(guider.update(dg::TopometricPose(nid, (nid > 1) ? 1 : 0, 5), 1.0));
+	VVS_CHECK_TRUE(guider.updateGuidancePath(detour));
+	VVS_CHECK_TRUE(reference.initiateNewGuidance(detour, snapshot));
+	poses.clear();
+	poses.push_back(dg::TopometricPose(4, 2, 5));
+	poses.push_back(dg::TopometricPose(201, 1, 2));
+	poses.push_back(dg::TopometricPose(202, 1, 3));
+	poses.push_back(dg::TopometricPose(8, 2, 1));
+	poses.push_back(dg::TopometricPose(12, 0, 0));
+	VVS_CHECK_EQUL(compareGuidances(guider, reference, poses), 0);
+	VVS_CHECK_TRUE(guider.getGuidanceStatus() == dg::GuidanceManager::GuideStatus::GUIDE_ARRIVED);
+
+	// Rerouting latency does not depend on the walked route
+	const int n_nodes = 50000, n_remain = 100;
+	buildGuidanceTestRoute(n_nodes, map, path);
+	snapshot = std::make_shared<const dg::Map>(std::move(map));
+	dg::Path remain;
+	remain.pts.assign(path.pts.end() - n_remain, path.pts.end());
+	dg::ID nid = remain.pts.front().node_id;
+	VVS_CHECK_TRUE(guider.initiateNewGuidance(path, snapshot));
+	VVS_CHECK_TRUE(guider.update(dg::TopometricPose(nid - 1, 1, 5), 1.0));
+
+	auto t0 = std::chrono::steady_clock::now();
+	VVS_CHECK_TRUE(reference.initiateNewGuidance(path, snapshot));
+	double t_full = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+	t0 = std::chrono::steady_clock::now();
+	VVS_CHECK_TRUE(guider.updateGuidancePath(remain));
+	double t_splice = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+	VVS_CHECK_TRUE(guider.update(dg::TopometricPose(nid, 1, 5), 1.0));
+	VVS_CHECK_TRUE(guider.getGuidanceStatus() == dg::GuidanceManager::GuideStatus::GUIDE_NORMAL);
+	VVS_CHECK_EQUL(guider.getGuidance().heading_node_id, nid + 1);
+	printf(" * Reroute on a %d node route (remain: %d nodes): rebuild %.3f ms, splice %.3f ms\n", n_nodes, n_remain, t_full * 1000, t_splice * 1000);
+
+	return 0;
+}
+
+#endif // End of '__TEST_GUIDANCE__'
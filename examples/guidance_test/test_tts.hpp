@@ -0,0 +1,121 @@
+#ifndef __TEST_TTS__
+#define __TEST_TTS__
+
+#include "utils/vvs.h"
+#include "utils/tts.hpp"
+#include <chrono>
+#include <thread>
+
+/**
+ * A TTS service which decodes every phrase to silence of the given duration (no speech synthesis)
+ */
+class FakeTTSService : public dg::TTSService
+{
+public:
+	FakeTTSService(double duration, const std::string& sink_cmd = "cat > /dev/null") : dg::TTSService(8000), m_duration(duration), m_n_decoded(0)
+	{
+		setSinkCommand(sink_cmd);
+	}
+
+	int countDecoded() const { return m_n_decoded; }
+
+protected:
+	virtual bool decode(const std::string& phrase, std::vector<int16_t>& pcm)
+	{
+		pcm.assign((size_t)(m_sample_rate * m_duration), 0);
+		m_n_decoded++;
+		return true;
+	}
+
+	double m_duration;
+
+	std::atomic<int> m_n_decoded;
+};
+
+/**
+ * Wait until the given number of messages are finished (played, dropped, or pre-empted)
+ * @return True if finished before the timeout (false if not)
+ */
+bool waitTTSFinished(const dg::TTSService& tts, size_t n_finished, double timeout = 5)
+{
+	auto start = std::chrono::steady_clock::now();
+	while (tts.countPlayed() + tts.countDropped() + tts.countPreempted() < n_finished)
+	{
+		if (std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() > timeout) return false;
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	return true;
+}
+
+/** Wait until the speaking thread takes the queued messages */
+bool waitTTSDequeued(dg::TTSService& tts, double timeout = 5)
+{
+	auto start = std::chrono::steady_clock::now();
+	while (tts.countQueued() > 0)
+	{
+		if (std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() > timeout) return false;
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	return true;
+}
+
+int testTTSService()
+{
+#ifndef _WIN32
+	// Pre-decode phrases
+	FakeTTSService tts(1.0);
+	VVS_CHECK_TRUE(!tts.put("Go forward"));
+	VVS_CHECK_TRUE(tts.initialize({ "Go forward", "Turn left" }));
+	VVS_CHECK_EQUL(tts.countCached(), 2);
+	VVS_CHECK_EQUL(tts.countDecoded(), 2);
+	VVS_CHECK_TRUE(tts.start());
+	VVS_CHECK_TRUE(tts.isRunning());
+
+	// Merge the same messages (while queued or spoken)
+	VVS_CHECK_TRUE(tts.put("Go forward"));
+	VVS_CHECK_TRUE(tts.put("Go forward"));
+	VVS_CHECK_TRUE(tts.put("Go forward"));
+	VVS_CHECK_TRUE(waitTTSFinished(tts, 1));
+	VVS_CHECK_EQUL(tts.countPlayed(), 1);
+	VVS_CHECK_EQUL(tts.countDropped(), 0);
+	VVS_CHECK_EQUL(tts.countDecoded(), 2);
+
+	// Drop a message which expires while another one is spoken
+	VVS_CHECK_TRUE(tts.put("Turn left"));
+	VVS_CHECK_TRUE(waitTTSDequeued(tts));
+	VVS_CHECK_TRUE(tts.put("Turn right", dg::TTSService::PRIORITY_LOW, 0.01));
+	VVS_CHECK_EQUL(tts.countQueued(), 1);
+	VVS_CHECK_TRUE(waitTTSFinished(tts, 3));
+	VVS_CHECK_EQUL(tts.countPlayed(), 2);
+	VVS_CHECK_EQUL(tts.countDropped(), 1);
+	VVS_CHECK_EQUL(tts.countDecoded(), 2);
+
+	// Pre-empt the spoken message and drop less urgent queued messages
+	VVS_CHECK_TRUE(tts.put("Go forward"));
+	VVS_CHECK_TRUE(waitTTSDequeued(tts));
+	VVS_CHECK_TRUE(tts.put("Cross the crosswalk", dg::TTSService::PRIORITY_LOW));
+	VVS_CHECK_TRUE(tts.put("Regenerate path!", dg::TTSService::PRIORITY_URGENT));
+	VVS_CHECK_TRUE(waitTTSFinished(tts, 6));
+	VVS_CHECK_EQUL(tts.countPlayed(), 3);
+	VVS_CHECK_EQUL(tts.countDropped(), 2);
+	VVS_CHECK_EQUL(tts.countPreempted(), 1);
+	VVS_CHECK_EQUL(tts.countDecoded(), 3);
+
+	tts.stop();
+	VVS_CHECK_TRUE(!tts.isRunning());
+	VVS_CHECK_TRUE(!tts.put("Go forward"));
+
+	// Survive the exited audio sink (the broken pipe only fails the message)
+	FakeTTSService broken(1.0, "true");
+	VVS_CHECK_TRUE(broken.start());
+	VVS_CHECK_TRUE(broken.put("Go forward"));
+	std::this_thread::sleep_for(std::chrono::milliseconds(1500));
+	VVS_CHECK_EQUL(broken.countQueued(), 0);
+	VVS_CHECK_EQUL(broken.countPlayed(), 0);
+	VVS_CHECK_EQUL(broken.countPreempted(), 0);
+	broken.stop();
+#endif
+	return 0;
+}
+
+#endif // End of '__TEST_TTS__'
@@ -7,9 +7,9 @@ vector<cv::Vec3d> getGPSData(const string& dataset, double gps_noise = 0.5, cons
     vector<cv::Vec3d> gps_data;
 
     // Load the true trajectory
-    cx::CSVReader gps_reader;
+    cx::CSVStreamReader gps_reader;
     if (!gps_reader.open(dataset)) return gps_data;
-    cx::CSVReader::Double2D gps_truth = gps_reader.extDouble2D(1, { 0, 1, 2, 3 });
+    cx::CSVStreamReader::Double2D gps_truth = gps_reader.extDouble2D(1, { 0, 1, 2, 3 });
     if (gps_truth.empty()) return gps_data;
 
     // Generate noisy GPS data
@@ -256,9 +256,9 @@ int expLocalizersSynthetic(int trial_num = 100)
 
 int cvtGPSData2UTM(const string& gps_file = "data/191115_ETRI_asen_fix.csv", const string& utm_file = "ETRI_191115.pose.csv", const dg::LatLon& ref_pts = dg::LatLon(36.383837659737, 127.367880828442))
 {
-    cx::CSVReader csv;
+    cx::CSVStreamReader csv;
     if (!csv.open(gps_file)) return -1;
-    cx::CSVReader::Double2D csv_ext = csv.extDouble2D(1, { 2, 3, 7, 8 }); // Skip the header
+    cx::CSVStreamReader::Double2D csv_ext = csv.extDouble2D(1, { 2, 3, 7, 8 }); // Skip the header
     if (csv_ext.empty()) return -1;
 
     dg::UTMConverter converter;
@@ -294,9 +294,9 @@ int runLocalizerETRI(const string& localizer_name, const string& gps_file, const
     if (!localizer->loadMap(map)) return -1;
 
     // Read GPS data
-    cx::CSVReader csv;
+    cx::CSVStreamReader csv;
     if (!csv.open(gps_file)) return -2;
-    cx::CSVReader::Double2D csv_ext = csv.extDouble2D(1, { 0, 1, 2 }); // Skip the header
+    cx::CSVStreamReader::Double2D csv_ext = csv.extDouble2D(1, { 0, 1, 2 }); // Skip the header
     if (csv_ext.empty()) return -2;
     vector<cv::Vec3d> gps_data;
     for (auto row = csv_ext.begin(); row != csv_ext.end(); row++)
@@ -326,8 +326,55 @@ int runLocalizerETRI(const string& localizer_name, const string& gps_file, const
     return runLocalizer(localizer, gps_data, traj_file, wait_msec, &painter, background, 10, cv::Vec3b(0, 0, 255), 300);
 }
 
+int runMapMatcherETRI(const string& gps_file, const string& map_file, const string& result_file = "", double gps_noise = 5)
+{
+    // Prepare a map matcher
+    dg::RoadMap map;
+    if (!map.load(map_file.c_str())) return -1;
+    dg::MapMatcher matcher;
+    matcher.setParam(gps_noise);
+    if (!matcher.build(map)) return -1;
+
+    // Read GPS data
+    cx::CSVStreamReader csv;
+    if (!csv.open(gps_file)) return -2;
+    cx::CSVStreamReader::Double2D csv_ext = csv.extDouble2D(1, { 0, 1, 2 }); // Skip the header
+    if (csv_ext.empty()) return -2;
+    vector<dg::Point2> track;
+    for (auto row = csv_ext.begin(); row != csv_ext.end(); row++)
+    {
+        if (row->size() < 3) return -2;
+        track.push_back(dg::Point2(row->at(1), row->at(2)));
+    }
+
+    // Align the whole trajectory to the map
+    int64 tick = cv::getTickCount();
+    vector<dg::TopometricPose> result;
+    if (!matcher.match(track, result)) return -3;
+    double elapsed = double(cv::getTickCount() - tick) / cv::getTickFrequency();
+    printf("Matched %zd points in %.3f sec (breaks: %d)\n", track.size(), elapsed, matcher.countBreaks());
+
+    // Record the matched poses
+    if (!result_file.empty())
+    {
+        dg::SimpleLocalizer localizer;
+        if (!localizer.loadMap(map)) return -4;
+        FILE* fd = fopen(result_file.c_str(), "wt");
+        if (fd == nullptr) return -4;
+        fprintf(fd, "# Time[sec], NodeID, EdgeIdx, Dist[m], X[m], Y[m]\n");
+        for (size_t i = 0; i < result.size(); i++)
+        {
+            dg::Pose2 pose = localizer.cvtTopmetric2Metric(result[i]);
+            fprintf(fd, "%f, %zd, %d, %f, %f, %f\n", csv_ext[i][0], result[i].node_id, result[i].edge_idx, result[i].dist, pose.x, pose.y);
+        }
+        fclose(fd);
+    }
+    return 0;
+}
+
 int main()
 {
+    //return runMapMatcherETRI("data_localizer/real_data/ETRI_191115.gps.csv", "data/NaverLabs_ETRI.csv", "ETRI_191115.matched.csv");
     //return runLocalizerETRI("EKFLocalizer", "data_localizer/real_data/ETRI_191115.gps.csv", "", 0.5, dg::Polar2(1, 0), 0.1, dg::Pose2(), 1, "data/NaverLabs_ETRI.csv", "data/NaverMap_ETRI(Satellite)_191127.png");
     //return runLocalizerETRI("EKFLocalizerZeroGyro", "data_localizer/real_data/ETRI_191115.gps.csv", "", 0.5, dg::Polar2(1, 0), 0.5, dg::Pose2(), 1, "data/NaverLabs_ETRI.csv", "data/NaverMap_ETRI(Satellite)_191127.png");
     //return runLocalizerETRI("EKFLocalizerHyperTan", "data_localizer/real_data/ETRI_191115.gps.csv", "", 0.5, dg::Polar2(1, 0), 0.5, dg::Pose2(), 1, "data/NaverLabs_ETRI.csv", "data/NaverMap_ETRI(Satellite)_191127.png");
@@ -3,8 +3,22 @@
 #include "test_localizer_gps2utm.hpp"
 #include "test_localizer_road.hpp"
 #include "test_localizer_simple.hpp"
+#include "test_localizer_beam.hpp"
+#include "test_localizer_matcher.hpp"
+#include "test_localizer_zone.hpp"
 #include "test_localizer_ekf.hpp"
 #include "test_localizer_etri.hpp"
+#include "test_localizer_csv.hpp"
+#include "test_utils_metrics.hpp"
+#include "test_utils_binary_log.hpp"
+#include "test_utils_pipeline.hpp"
+#include "test_utils_mailbox.hpp"
+#include "test_utils_camera_hub.hpp"
+#include "test_utils_frame_image.hpp"
+#include "test_utils_rate_policy.hpp"
+#include "test_utils_result_cache.hpp"
+#include "test_utils_layer_compositor.hpp"
+#include "test_utils_map_tiles.hpp"
 
 int main()
 {
@@ -42,12 +56,40 @@ int main()
     VVS_RUN_TEST(testLocBaseDist2());
     VVS_RUN_TEST(testLocBaseNearest());
     VVS_RUN_TEST(testLocBaseTrack());
+    VVS_RUN_TEST(testLocBaseTrackBeam());
+    VVS_RUN_TEST(testLocMapMatcher());
     VVS_RUN_TEST(testLocSimple());
 
     VVS_RUN_TEST(testLocEKFGPS());
     VVS_RUN_TEST(testLocEKFGyroGPS());
     VVS_RUN_TEST(testLocEKFLocClue());
+    VVS_RUN_TEST(testLocEKFIMUGPS());
+    VVS_RUN_TEST(testLocEKFSmoother());
+    VVS_RUN_TEST(testLocGPSDeadZone());
 
+    VVS_RUN_TEST(testLocCSVStreamReader());
+    VVS_RUN_TEST(testMetricsHistogram());
+    VVS_RUN_TEST(testMetricsAggregation());
+    VVS_RUN_TEST(testMetricsTraceScope());
+    VVS_RUN_TEST(testBinaryLogRoundTrip());
+    VVS_RUN_TEST(testBinaryLogSeek());
+    VVS_RUN_TEST(testBinaryLogTruncated());
+    VVS_RUN_TEST(testBoundedQueue());
+    VVS_RUN_TEST(testStageSignal());
+    VVS_RUN_TEST(testPipeline());
+    VVS_RUN_TEST(testMailbox());
+    VVS_RUN_TEST(testMailboxCameraFrame());
+    VVS_RUN_TEST(testCameraHub());
+    VVS_RUN_TEST(testFrameImageJPEGSize());
+    VVS_RUN_TEST(testFrameImageLevels());
+    VVS_RUN_TEST(testRatePolicy());
+    VVS_RUN_TEST(testRatePolicySimulation());
+    VVS_RUN_TEST(testResultCacheHash());
+    VVS_RUN_TEST(testResultCacheReuse());
+    VVS_RUN_TEST(testResultCacheSimulation());
+    VVS_RUN_TEST(testLayerCompositor());
+    VVS_RUN_TEST(testMapTilePyramid());
+    VVS_RUN_TEST(testMapPainterCulling());
     VVS_RUN_TEST(testLocETRIMap2RoadMap());
     VVS_RUN_TEST(testLocETRISyntheticMap());
     VVS_RUN_TEST(testLocETRIRealMap());
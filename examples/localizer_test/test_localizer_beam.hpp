@@ -0,0 +1,91 @@
+#ifndef __TEST_LOCALIZER_BEAM__
+#define __TEST_LOCALIZER_BEAM__
+
+#include "vvs.h"
+#include "dg_core.hpp"
+#include "dg_localizer.hpp"
+#include <chrono>
+#include <random>
+
+/**
+ * Build a grid road map (rows x cols junctions with the given spacing and bi-directional roads)
+ * Node IDs are 1 + r * cols + c at (c * spacing, r * spacing).
+ */
+dg::RoadMap getGridRoadMap(int rows, int cols, double spacing)
+{
+    dg::RoadMap map;
+    for (int r = 0; r < rows; r++)
+        for (int c = 0; c < cols; c++)
+            map.addNode(dg::Point2ID(1 + r * cols + c, c * spacing, r * spacing));
+    for (int r = 0; r < rows; r++)
+    {
+        for (int c = 0; c < cols; c++)
+        {
+            dg::ID id = 1 + r * cols + c;
+            if (c + 1 < cols) map.addRoad(id, id + 1, spacing);
+            if (r + 1 < rows) map.addRoad(id, id + cols, spacing);
+        }
+    }
+    return map;
+}
+
+int testLocBaseTrackBeam(double gps_noise = 3, int n_repeat = 10)
+{
+    const int rows = 5, cols = 5;
+    const double spacing = 20;
+    dg::SimpleLocalizer localizer;
+    VVS_CHECK_TRUE(localizer.loadMap(getGridRoadMap(rows, cols, spacing)));
+
+    // A route turning at two junctions: (0, 0) -> (40, 0) -> (40, 60) -> (80, 60)
+    std::vector<dg::Pose2> route;
+    for (double x = 0; x < 40; x += 1) route.push_back(dg::Pose2(x, 0, 0));
+    for (double y = 0; y < 60; y += 1) route.push_back(dg::Pose2(40, y, CV_PI / 2));
+    for (double x = 40; x <= 80; x += 1) route.push_back(dg::Pose2(x, 60, 0));
+
+    std::mt19937 rng(0);
+    std::normal_distribution<double> noise(0, gps_noise);
+    int n_correct = 0, n_total = 0;
+    double t_track = 0;
+    for (int i = 0; i < n_repeat; i++)
+    {
+        dg::Pose2 prev;
+        for (size_t k = 0; k < route.size(); k++)
+        {
+            dg::Pose2 pose_m = route[k];
+            pose_m.x += noise(rng);
+            pose_m.y += noise(rng);
+            double travel = (k > 0) ? 1 : 0;
+            auto t0 = std::chrono::steady_clock::now();
+            dg::TopometricPose pose_t = localizer.trackTopoPoseBeam(pose_m, travel, 1);
+            t_track += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+            if (pose_t.node_id == 0) return -1;
+
+            // The best hypothesis is on the true road
+            dg::Pose2 pose_b = localizer.cvtTopmetric2Metric(pose_t);
+            double dx = pose_b.x - route[k].x, dy = pose_b.y - route[k].y;
+            if (dx * dx + dy * dy < gps_noise * gps_noise * 4) n_correct++;
+            n_total++;
+
+            // Hypotheses are sorted and their confidences are normalized
+            std::vector<dg::TopometricPose> poses;
+            std::vector<double> confidences;
+            if (!localizer.getTopoHypotheses(poses, confidences)) return -1;
+            if (poses.size() != confidences.size() || poses.size() > 8) return -1;
+            if (poses.front().node_id != pose_t.node_id) return -1;
+            double sum = 0;
+            for (size_t j = 0; j < confidences.size(); j++)
+            {
+                if (j > 0 && confidences[j] > confidences[j - 1]) return -1;
+                sum += confidences[j];
+            }
+            if (fabs(sum - 1) > 1e-6) return -1;
+        }
+        VVS_CHECK_TRUE(localizer.loadMap(getGridRoadMap(rows, cols, spacing))); // Restart tracking
+    }
+    VVS_CHECK_TRUE(n_correct > 0.9 * n_total);
+    printf(" * Beam tracking: %.1f %% on the true road (GPS noise: %.1f m, %.2f us/update)\n", 100.0 * n_correct / n_total, gps_noise, t_track * 1e6 / n_total);
+
+    return 0;
+}
+
+#endif // End of '__TEST_LOCALIZER_BEAM__'
@@ -0,0 +1,78 @@
+#ifndef __TEST_LOCALIZER_CSV__
+#define __TEST_LOCALIZER_CSV__
+
+#include "vvs.h"
+#include "dg_core.hpp"
+#include "dg_localizer.hpp"
+#include <chrono>
+#include <cmath>
+
+int testLocCSVStreamReader(int n_rows = 500000, const char* filename = "test_csv_stream.csv")
+{
+    // Test degenerate cases
+    cx::CSVStreamReader reader;
+    VVS_CHECK_TRUE(reader.open("nothing.csv") == false);
+    VVS_CHECK_TRUE(reader.extDouble2D().empty());
+
+    // Test a small file with a header, spaces, CRLF, an empty row, a non-numeric field, and a missing column
+    FILE* fd = fopen(filename, "wb");
+    if (fd == nullptr) return -1;
+    fprintf(fd, "time; x ; y\r\n1.5; +2 ;-3e2\r\n\r\n 4 ;abc\r\n7;8;9");
+    fclose(fd);
+    VVS_CHECK_TRUE(reader.open(filename, ';'));
+    cx::CSVStreamReader::Double2D data = reader.extDouble2D(1);
+    VVS_CHECK_EQUL(data.size(), 3);
+    VVS_CHECK_EQUL(data[0][0], 1.5);
+    VVS_CHECK_EQUL(data[0][1], 2);
+    VVS_CHECK_EQUL(data[0][2], -300);
+    VVS_CHECK_EQUL(data[1][0], 4);
+    VVS_CHECK_TRUE(std::isnan(data[1][1]) && std::isnan(data[1][2]));
+    VVS_CHECK_EQUL(data[2][2], 9);
+    cx::CSVStreamReader::Int2D ints = reader.extInt2D(1, { 2, 0 }, -9);
+    VVS_CHECK_EQUL(ints[1][0], -9);
+    VVS_CHECK_EQUL(ints[2][1], 7);
+    std::vector<std::string> names;
+    size_t n_read = reader.forEachRow([&names](size_t row, const std::vector<cx::CSVStreamReader::Field>& fields)
+    {
+        names.push_back(fields[1].toString());
+        return row < 3;
+    });
+    VVS_CHECK_EQUL(n_read, 3);
+    VVS_CHECK_TRUE(names[0] == "x" && names[2] == "abc");
+    cx::CSVReader legacy;
+    VVS_CHECK_TRUE(legacy.open(filename, ';'));
+    VVS_CHECK_EQUL(legacy.size(), 5);
+    VVS_CHECK_TRUE(legacy[1][1] == "+2");
+    VVS_CHECK_EQUL(legacy.extDouble2D(1)[0][2], -300);
+
+    // Generate a large GPS log (in the format of ROS 'NavSatFix' messages)
+    fd = fopen(filename, "wt");
+    if (fd == nullptr) return -1;
+    fprintf(fd, "time,.header.seq,.header.stamp.secs,.header.stamp.nsecs,.header.frame_id,.status.status,.status.service,.latitude,.longitude,.altitude\n");
+    for (int i = 0; i < n_rows; i++)
+        fprintf(fd, "%d,%d,%d,%d,gps,0,1,%.10f,%.10f,%.3f\n", 1573776000 + i, i, 1573776000 + i / 10, (i % 10) * 100000000, 36.38 + 1e-6 * (i % 1000), 127.36 + 1e-6 * (i % 777), 60 + 0.01 * (i % 100));
+    fclose(fd);
+
+    // Compare with 'CSVReader'
+    auto t0 = std::chrono::steady_clock::now();
+    VVS_CHECK_TRUE(legacy.open(filename));
+    cx::CSVReader::Double2D legacy_data = legacy.extDouble2D(1, { 2, 3, 7, 8 });
+    double t_legacy = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    legacy.clear();
+
+    t0 = std::chrono::steady_clock::now();
+    VVS_CHECK_TRUE(reader.open(filename));
+    data = reader.extDouble2D(1, { 2, 3, 7, 8 });
+    double t_stream = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    VVS_CHECK_EQUL(data.size(), (size_t)n_rows);
+    VVS_CHECK_TRUE(data == legacy_data);
+
+    double mbytes = reader.getFileSize() / 1024.0 / 1024.0;
+    reader.close();
+    remove(filename);
+    printf(" * CSV reader: %.1f MB/s (CSVReader), %.1f MB/s (CSVStreamReader) for %.1f MB\n", mbytes / t_legacy, mbytes / t_stream, mbytes);
+
+    return 0;
+}
+
+#endif // End of '__TEST_LOCALIZER_CSV__'
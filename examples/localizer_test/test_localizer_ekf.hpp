@@ -98,4 +98,91 @@ int testLocEKFLocClue(const dg::Polar2 obs_noise = dg::Polar2(0.3, 0.1), const d
     return 0;
 }
 
+int testLocEKFIMUGPS(double gyro_noise = 0.01, double gps_noise = 1, double imu_interval = 0.01, double gps_interval = 1, double velocity = 1, double angvel = 0.2)
+{
+    // Two localizers with and without IMU data on the same circular motion
+    dg::EKFLocalizer localizer_imu, localizer_gps;
+    dg::EKFLocalizer* localizers[] = { &localizer_imu, &localizer_gps };
+    for (int i = 0; i < 2; i++)
+    {
+        VVS_CHECK_TRUE(localizers[i]->setParamMotionNoise(0.1, 0.1));
+        VVS_CHECK_TRUE(localizers[i]->setParamGPSNoise(gps_noise));
+        VVS_CHECK_TRUE(localizers[i]->setState(cv::Vec<double, 5>(0, 0, 0, velocity, 0)));
+    }
+    VVS_CHECK_TRUE(localizer_imu.setParamIMUNoise(gyro_noise, 0.1));
+
+    const double radius = velocity / angvel;
+    double err_imu = 0, err_gps = 0;
+    int n_imu = 0, n_gps = 0, n_err = 0;
+    double t_gps = gps_interval;
+    for (double t = imu_interval; t < 60; t += imu_interval)
+    {
+        // Apply noisy gyroscope data (they are accumulated without filter updates)
+        VVS_CHECK_TRUE(localizer_imu.applyIMU(angvel + cv::theRNG().gaussian(gyro_noise), 0, t));
+        n_imu++;
+        if (t + imu_interval / 2 < t_gps) continue;
+
+        // Apply noisy GPS position
+        dg::Pose2 truth(radius * sin(angvel * t), radius * (1 - cos(angvel * t)), cx::trimRad(angvel * t));
+        dg::Point2 gps(truth.x + cv::theRNG().gaussian(gps_noise), truth.y + cv::theRNG().gaussian(gps_noise));
+        VVS_CHECK_TRUE(localizer_imu.applyPosition(gps, t));
+        VVS_CHECK_TRUE(localizer_gps.applyPosition(gps, t));
+        n_gps++;
+        t_gps += gps_interval;
+
+        // Accumulate heading errors after convergence
+        if (t < 10) continue;
+        err_imu += fabs(cx::trimRad(localizer_imu.getPose().theta - truth.theta));
+        err_gps += fabs(cx::trimRad(localizer_gps.getPose().theta - truth.theta));
+        n_err++;
+    }
+    err_imu /= n_err;
+    err_gps /= n_err;
+    printf(" * IMU: %d samples, GPS: %d samples, heading error: %.2f [deg] (IMU+GPS), %.2f [deg] (GPS only)\n", n_imu, n_gps, cx::cvtRad2Deg(err_imu), cx::cvtRad2Deg(err_gps));
+    VVS_CHECK_TRUE(err_imu < err_gps);
+    return 0;
+}
+
+int testLocEKFSmoother(int lag = 10, double gps_noise = 1, double interval = 0.1, double velocity = 1, double angvel = 0.2)
+{
+    dg::EKFLocalizer localizer;
+    VVS_CHECK_TRUE(localizer.setParamMotionNoise(0.1, 0.1));
+    VVS_CHECK_TRUE(localizer.setParamGPSNoise(gps_noise));
+    VVS_CHECK_TRUE(localizer.setParamSmootherLag(lag));
+    VVS_CHECK_TRUE(localizer.setState(cv::Vec<double, 5>(0, 0, 0, velocity, 0)));
+
+    // Compare filtered poses and smoothed poses (at the oldest time in the window) on a circular motion
+    const double radius = velocity / angvel;
+    double err_filter = 0, err_smooth = 0, time_smooth = 0;
+    int n_err = 0;
+    std::vector<dg::Pose2> poses;
+    std::vector<dg::Timestamp> times;
+    for (double t = interval; t < 60; t += interval)
+    {
+        dg::Point2 truth(radius * sin(angvel * t), radius * (1 - cos(angvel * t)));
+        dg::Point2 gps(truth.x + cv::theRNG().gaussian(gps_noise), truth.y + cv::theRNG().gaussian(gps_noise));
+        if (!localizer.applyPosition(gps, t)) return -1;
+        if (!localizer.getPoseSmoothed(poses, times)) continue; // No window before the first prediction
+        if (poses.size() != times.size() || (int)poses.size() > lag + 1 || fabs(times.back() - t) > 1e-6) return -1;
+        time_smooth += localizer.getSmootherTime();
+        if (t < 10) continue;
+
+        dg::Pose2 pose = localizer.getPose();
+        dg::Point2 truth_old(radius * sin(angvel * times.front()), radius * (1 - cos(angvel * times.front())));
+        err_filter += sqrt((pose.x - truth.x) * (pose.x - truth.x) + (pose.y - truth.y) * (pose.y - truth.y));
+        err_smooth += sqrt((poses.front().x - truth_old.x) * (poses.front().x - truth_old.x) + (poses.front().y - truth_old.y) * (poses.front().y - truth_old.y));
+        n_err++;
+    }
+    printf(" * Position error: %.3f [m] (filtered), %.3f [m] (smoothed with %d steps of lag, %.1f usec/query)\n", err_filter / n_err, err_smooth / n_err, lag, time_smooth / (60 / interval) * 1e6);
+    VVS_CHECK_TRUE(err_smooth < err_filter);
+
+    // The window starts again from a new state
+    VVS_CHECK_TRUE(localizer.setState(cv::Vec<double, 5>(0, 0, 0, velocity, 0)));
+    VVS_CHECK_TRUE(!localizer.getPoseSmoothed(poses, times));
+    VVS_CHECK_TRUE(localizer.applyPosition(dg::Point2(velocity * interval, 0), 60 + interval));
+    VVS_CHECK_TRUE(localizer.getPoseSmoothed(poses, times));
+    VVS_CHECK_EQUL(poses.size(), 2);
+    return 0;
+}
+
 #endif // End of '__TEST_LOCALIZER_EKF__'
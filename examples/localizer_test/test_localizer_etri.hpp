@@ -7,9 +7,9 @@
 
 std::vector<std::pair<double, dg::LatLon>> getGPSDataROSFix(const char* csv_file)
 {
-    cx::CSVReader csv;
+    cx::CSVStreamReader csv;
     VVS_CHECK_TRUE(csv.open(csv_file));
-    cx::CSVReader::Double2D csv_ext = csv.extDouble2D(1, { 2, 3, 7, 8 }); // Skip the header
+    cx::CSVStreamReader::Double2D csv_ext = csv.extDouble2D(1, { 2, 3, 7, 8 }); // Skip the header
 
     std::vector<std::pair<double, dg::LatLon>> data;
     for (auto row = csv_ext.begin(); row != csv_ext.end(); row++)
@@ -23,9 +23,9 @@ std::vector<std::pair<double, dg::LatLon>> getGPSDataROSFix(const char* csv_file
 
 std::vector<std::pair<double, dg::LatLon>> getGPSDataAndroSen(const char* csv_file)
 {
-    cx::CSVReader csv;
+    cx::CSVStreamReader csv;
     VVS_CHECK_TRUE(csv.open(csv_file, ';'));
-    cx::CSVReader::Double2D csv_ext = csv.extDouble2D(2, { 31, 22, 23, 28 }); // Skip the header
+    cx::CSVStreamReader::Double2D csv_ext = csv.extDouble2D(2, { 31, 22, 23, 28 }); // Skip the header
 
     std::vector<std::pair<double, dg::LatLon>> data;
     for (auto row = csv_ext.begin(); row != csv_ext.end(); row++)
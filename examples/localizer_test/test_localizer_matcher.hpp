@@ -0,0 +1,78 @@
+#ifndef __TEST_LOCALIZER_MATCHER__
+#define __TEST_LOCALIZER_MATCHER__
+
+#include "vvs.h"
+#include "dg_core.hpp"
+#include "dg_localizer.hpp"
+#include "test_localizer_beam.hpp"
+#include <chrono>
+#include <random>
+
+int testLocMapMatcher(int n_points = 100000, double gps_noise = 2)
+{
+    const int rows = 30, cols = 30;
+    const double spacing = 20, step = 2;
+    dg::RoadMap map = getGridRoadMap(rows, cols, spacing);
+    dg::MapMatcher matcher;
+    VVS_CHECK_TRUE(matcher.build(map));
+
+    // Generate a random walk on the grid and its noisy positions
+    std::mt19937 rng(0);
+    std::normal_distribution<double> noise(0, gps_noise);
+    std::vector<dg::Point2> truth, track;
+    int r = 0, c = 0;
+    while ((int)track.size() < n_points)
+    {
+        int dir = rng() % 4;
+        int nr = r + (dir == 0) - (dir == 1), nc = c + (dir == 2) - (dir == 3);
+        if (nr < 0 || nr >= rows || nc < 0 || nc >= cols) continue;
+        for (double d = 0; d < spacing; d += step)
+        {
+            dg::Point2 p((c + (nc - c) * d / spacing) * spacing, (r + (nr - r) * d / spacing) * spacing);
+            truth.push_back(p);
+            track.push_back(dg::Point2(p.x + noise(rng), p.y + noise(rng)));
+        }
+        r = nr;
+        c = nc;
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    std::vector<dg::TopometricPose> result;
+    VVS_CHECK_TRUE(matcher.match(track, result));
+    double t_match = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    VVS_CHECK_EQUL(result.size(), track.size());
+    VVS_CHECK_EQUL(matcher.countBreaks(), 0);
+
+    // Most of matched poses are on the true roads
+    dg::SimpleLocalizer localizer;
+    VVS_CHECK_TRUE(localizer.loadMap(map));
+    int n_correct = 0;
+    for (size_t i = 0; i < result.size(); i++)
+    {
+        if (result[i].node_id == 0) return -1;
+        dg::Pose2 pose_m = localizer.cvtTopmetric2Metric(result[i]);
+        auto dist2 = dg::BaseLocalizer::calcDist2FromLineSeg(pose_m, localizer.cvtTopmetric2Metric(dg::TopometricPose(result[i].node_id, result[i].edge_idx, 1e6)), truth[i]);
+        if (dist2.first < 1) n_correct++;
+    }
+    VVS_CHECK_TRUE(n_correct > 0.85 * result.size());
+    printf(" * Map matching: %zu points in %.3f sec, %.1f %% on the true roads (GPS noise: %.1f m, %zu cached routes)\n", track.size(), t_match, 100.0 * n_correct / result.size(), gps_noise, matcher.countCachedRoutes());
+
+    // A trajectory is split at a disconnected jump, and a far position has no matched pose
+    map.addNode(dg::Point2ID(10000, 2000, 0));
+    map.addNode(dg::Point2ID(10001, 2020, 0));
+    map.addRoad(10000, 10001, 20);
+    VVS_CHECK_TRUE(matcher.build(map));
+    std::vector<dg::Point2> jump = { dg::Point2(1, 0), dg::Point2(5, 0), dg::Point2(1000, 1000), dg::Point2(2005, 1), dg::Point2(2010, 1) };
+    VVS_CHECK_TRUE(matcher.match(jump, result));
+    VVS_CHECK_EQUL(result.size(), jump.size());
+    VVS_CHECK_EQUL(matcher.countBreaks(), 1);
+    dg::Pose2 pose_m = localizer.cvtTopmetric2Metric(result[1]);
+    VVS_CHECK_NEAR(pose_m.x, 5);
+    VVS_CHECK_NEAR(pose_m.y, 0);
+    VVS_CHECK_EQUL(result[2].node_id, 0);
+    VVS_CHECK_TRUE(result[4].node_id == 10000 || result[4].node_id == 10001);
+
+    return 0;
+}
+
+#endif // End of '__TEST_LOCALIZER_MATCHER__'
@@ -0,0 +1,109 @@
+#ifndef __TEST_LOCALIZER_ZONE__
+#define __TEST_LOCALIZER_ZONE__
+
+#include "vvs.h"
+#include "dg_core.hpp"
+#include "dg_localizer.hpp"
+#include <chrono>
+#include <random>
+
+int testLocGPSDeadZone(int n_zones = 5000, int n_queries = 20000, const char* filename = "test_gps_dead_zone.csv")
+{
+    // Test degenerate cases
+    dg::GPSDeadZoneMap zones;
+    VVS_CHECK_TRUE(zones.load("nothing") == false);
+    VVS_CHECK_TRUE(zones.empty());
+    VVS_CHECK_EQUL(zones.find(dg::Point2(0, 0)), -1);
+    VVS_CHECK_TRUE(zones.add({ dg::Point2(0, 0), dg::Point2(1, 1) }) == false);
+
+    // A concave polygon (U-shape) and overlapped zones with different noise
+    VVS_CHECK_TRUE(zones.add({ dg::Point2(0, 0), dg::Point2(30, 0), dg::Point2(30, 30), dg::Point2(20, 30), dg::Point2(20, 10), dg::Point2(10, 10), dg::Point2(10, 30), dg::Point2(0, 30) }, 5));
+    VVS_CHECK_TRUE(zones.addRect(dg::Point2(25, 5), dg::Point2(100, 15), 20));
+    VVS_CHECK_EQUL(zones.size(), 2);
+    double noise = 0;
+    VVS_CHECK_EQUL(zones.find(dg::Point2(5, 20), &noise), 0);
+    VVS_CHECK_EQUL(noise, 5);
+    VVS_CHECK_EQUL(zones.find(dg::Point2(15, 20)), -1);
+    VVS_CHECK_EQUL(zones.find(dg::Point2(28, 12), &noise), 1);
+    VVS_CHECK_EQUL(noise, 20);
+    VVS_CHECK_EQUL(zones.find(dg::Point2(90, 10)), 1);
+    VVS_CHECK_EQUL(zones.find(dg::Point2(-1, 10)), -1);
+
+    // Generate random polygons (irregular hexagons) in a 5 km x 5 km area
+    std::mt19937 rng(0);
+    std::uniform_real_distribution<double> uniform(0, 1);
+    const double area = 5000;
+    zones.clear();
+    std::vector<std::vector<dg::Point2>> polygons;
+    std::vector<double> noises;
+    for (int i = 0; i < n_zones; i++)
+    {
+        dg::Point2 center(area * uniform(rng), area * uniform(rng));
+        std::vector<dg::Point2> polygon;
+        for (int k = 0; k < 6; k++)
+        {
+            double r = 10 + 30 * uniform(rng), theta = CV_PI / 3 * (k + uniform(rng));
+            polygon.push_back(dg::Point2(center.x + r * cos(theta), center.y + r * sin(theta)));
+        }
+        polygons.push_back(polygon);
+        noises.push_back(1 + 20 * uniform(rng));
+        if (!zones.add(polygon, noises.back())) return -1;
+    }
+    std::vector<dg::Point2> queries;
+    for (int i = 0; i < n_queries; i++) queries.push_back(dg::Point2(area * uniform(rng), area * uniform(rng)));
+
+    // Compare the grid index with the linear scan
+    std::vector<double> found_scan(queries.size(), -1), found_grid(queries.size(), -1);
+    auto t0 = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < queries.size(); i++)
+    {
+        for (size_t z = 0; z < polygons.size(); z++)
+            if (noises[z] > found_scan[i] && dg::GPSDeadZoneMap::isInside(polygons[z], queries[i])) found_scan[i] = noises[z];
+    }
+    double t_scan = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    t0 = std::chrono::steady_clock::now();
+    int n_inside = 0;
+    for (size_t i = 0; i < queries.size(); i++)
+    {
+        if (zones.find(queries[i], &found_grid[i]) >= 0) n_inside++;
+    }
+    double t_grid = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    for (size_t i = 0; i < queries.size(); i++)
+    {
+        if (found_grid[i] != found_scan[i]) return -1;
+    }
+    VVS_CHECK_TRUE(n_inside > 0);
+    printf(" * GPS dead zones: %d zones, %d queries (%d inside), %.3f us/query with the grid, %.3f us/query with the linear scan\n",
+        n_zones, n_queries, n_inside, t_grid * 1e6 / n_queries, t_scan * 1e6 / n_queries);
+
+    // Save and load the zones
+    VVS_CHECK_TRUE(zones.save(filename));
+    dg::GPSDeadZoneMap loaded;
+    VVS_CHECK_TRUE(loaded.load(filename));
+    VVS_CHECK_EQUL(loaded.size(), zones.size());
+    for (size_t i = 0; i < queries.size(); i += 10)
+    {
+        int z1 = zones.find(queries[i]), z2 = loaded.find(queries[i]);
+        if (z1 != z2) return -1;
+    }
+
+    // The EKF localizer follows GPS less in a noisier zone
+    std::vector<double> errors;
+    for (int i = 0; i < 3; i++)
+    {
+        dg::EKFLocalizer localizer;
+        if (!localizer.setParamGPSNoise(1, 10)) return -1;
+        if (i == 1) VVS_CHECK_TRUE(localizer.addParamGPSDeadZone(dg::Point2(-50, -50), dg::Point2(50, 50)));
+        if (i == 2) VVS_CHECK_TRUE(localizer.addParamGPSDeadZone({ dg::Point2(-50, -50), dg::Point2(50, -50), dg::Point2(0, 50) }, 100));
+        if (!localizer.applyPosition(dg::Point2(0, 0), 1)) return -1;
+        if (!localizer.applyPosition(dg::Point2(10, 0), 1.1)) return -1;
+        dg::Pose2 pose = localizer.getPose();
+        errors.push_back(fabs(10 - pose.x));
+    }
+    VVS_CHECK_TRUE(errors[0] < errors[1]);
+    VVS_CHECK_TRUE(errors[1] < errors[2]);
+
+    return 0;
+}
+
+#endif // End of '__TEST_LOCALIZER_ZONE__'
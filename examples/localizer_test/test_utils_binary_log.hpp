@@ -0,0 +1,220 @@
+#ifndef __TEST_UTILS_BINARY_LOG__
+#define __TEST_UTILS_BINARY_LOG__
+
+#include "vvs.h"
+#include "utils/binary_log.hpp"
+
+/** Write a log with all record types at 10 Hz (a GPS, an IMU, a pose, and a guidance per frame, and a recognizer line every 5 frames) */
+bool writeTestBinaryLog(const std::string& filename, int n_frames, size_t chunk_size)
+{
+    dg::BinaryLogWriter writer;
+    if (!writer.open(filename, chunk_size)) return false;
+    for (int i = 0; i < n_frames; i++)
+    {
+        double t = 100 + i * 0.1;
+        writer.writeGPS(dg::LatLon(36 + i * 1e-5, 127), t);
+
+        dg::LogIMU imu = { 1, 0, 0, 0, 0.1, 0.2, 0.3 * i, 0, 0, 9.8 };
+        writer.writeIMU(imu, t + 0.01);
+
+        dg::LogPose pose = { (double)i, -i * 0.5, 0.1, 36, 127, (uint64_t)(1000 + i), i % 3, 0.5 * i, 0.9 };
+        writer.writePose(pose, t + 0.02);
+
+        dg::LogGuidance guidance = { 1, (i % 2) ? 3 : -1, (uint64_t)(2000 + i), 50.0 - i };
+        writer.writeGuidance(guidance, (i % 2) ? "Turn left" : "", t + 0.03);
+
+        if (i % 5 == 0) writer.writeText(dg::LogType::RECOGNIZER, t + 0.04, i, cv::format("%.2f,%d,ocr,cafe,%d\n%.2f,%d,logo,bank\n", t, i, i, t, i));
+    }
+    writer.writeText(dg::LogType::RECOGNIZER, 200, 999, "");
+    bool ok = (writer.countRecords() == (uint64_t)(n_frames * 4 + (n_frames + 4) / 5));
+    writer.close();
+    return ok && !writer.isOpened();
+}
+
+/** Copy the first given bytes of a file */
+bool truncateTestBinaryLog(const std::string& src, const std::string& dst, size_t size)
+{
+    FILE* in = fopen(src.c_str(), "rb");
+    if (in == nullptr) return false;
+    std::vector<char> data(size);
+    size_t n_read = fread(data.data(), 1, size, in);
+    fclose(in);
+    FILE* out = fopen(dst.c_str(), "wb");
+    if (out == nullptr) return false;
+    fwrite(data.data(), 1, n_read, out);
+    fclose(out);
+    return n_read == size;
+}
+
+int testBinaryLogRoundTrip(const std::string& filename = "test_binary_log.dglog")
+{
+    // Write and read back all record types (small chunks to have several ones)
+    const int n_frames = 100;
+    VVS_CHECK_TRUE(writeTestBinaryLog(filename, n_frames, 1024));
+    VVS_CHECK_TRUE(dg::BinaryLogReader::isBinaryLog(filename));
+    dg::BinaryLogReader reader;
+    VVS_CHECK_TRUE(reader.open(filename));
+    VVS_CHECK_EQUL(reader.countRecords(), n_frames * 4 + n_frames / 5);
+    VVS_CHECK_TRUE(reader.countChunks() > 10);
+    VVS_CHECK_EQUL(reader.size(), 96);
+
+    std::vector<dg::BinaryLogReader::Record> records;
+    VVS_CHECK_TRUE(reader.getRecords(dg::LogType::GPS, records));
+    VVS_CHECK_EQUL(records.size(), n_frames);
+    dg::LogGPS gps;
+    VVS_CHECK_TRUE(records[10].get(gps));
+    VVS_CHECK_NEAR(gps.lat, 36 + 10 * 1e-5);
+    VVS_CHECK_NEAR(gps.lon, 127);
+    VVS_CHECK_NEAR(records[10].timestamp, 101);
+    VVS_CHECK_EQUL(records[10].fnumber, -1);
+
+    VVS_CHECK_TRUE(reader.getRecords(dg::LogType::IMU, records));
+    VVS_CHECK_EQUL(records.size(), n_frames);
+    dg::LogIMU imu;
+    VVS_CHECK_TRUE(records[20].get(imu));
+    VVS_CHECK_NEAR(imu.ori_w, 1);
+    VVS_CHECK_NEAR(imu.angvel_z, 0.3 * 20);
+    VVS_CHECK_NEAR(imu.linacc_z, 9.8);
+    VVS_CHECK_NEAR(records[20].timestamp, 102.01);
+
+    VVS_CHECK_TRUE(reader.getRecords(dg::LogType::POSE, records));
+    VVS_CHECK_EQUL(records.size(), n_frames);
+    dg::LogPose pose;
+    VVS_CHECK_TRUE(records[30].get(pose));
+    VVS_CHECK_NEAR(pose.x, 30);
+    VVS_CHECK_NEAR(pose.y, -15);
+    VVS_CHECK_EQUL(pose.node_id, 1030);
+    VVS_CHECK_EQUL(pose.edge_idx, 0);
+    VVS_CHECK_NEAR(pose.confidence, 0.9);
+
+    VVS_CHECK_TRUE(reader.getRecords(dg::LogType::GUIDANCE, records));
+    VVS_CHECK_EQUL(records.size(), n_frames);
+    dg::LogGuidance guidance;
+    VVS_CHECK_TRUE(records[41].get(guidance));
+    VVS_CHECK_EQUL(guidance.cmd, 3);
+    VVS_CHECK_EQUL(guidance.heading_node_id, 2041);
+    VVS_CHECK_NEAR(guidance.distance_to_remain, 9);
+    VVS_CHECK_TRUE(records[41].text() == "Turn left");
+    VVS_CHECK_TRUE(records[40].text().empty());
+
+    // Read recognizer lines by their frame numbers (an empty text is not recorded)
+    VVS_CHECK_TRUE(reader.getRecords(dg::LogType::RECOGNIZER, records));
+    VVS_CHECK_EQUL(records.size(), n_frames / 5);
+    std::vector<std::string> lines;
+    VVS_CHECK_TRUE(reader.getLines(45, "ocr", lines));
+    VVS_CHECK_EQUL(lines.size(), 1);
+    VVS_CHECK_TRUE(lines[0] == "104.50,45,ocr,cafe,45");
+    VVS_CHECK_TRUE(reader.getLines(45, "logo", lines));
+    VVS_CHECK_TRUE(reader.getLines(45, "vps", lines) == false);
+    VVS_CHECK_TRUE(reader.getLines(46, "ocr", lines) == false);
+    VVS_CHECK_TRUE(reader.getRecords(999, records) == false);
+    VVS_CHECK_TRUE(reader.getRecords(-1, records) == false);
+
+    reader.close();
+    VVS_CHECK_TRUE(reader.isOpened() == false);
+    VVS_CHECK_EQUL(reader.countRecords(), 0);
+    std::remove(filename.c_str());
+
+    // Test a missing file and a text log
+    VVS_CHECK_TRUE(reader.open(filename) == false);
+    FILE* file = fopen(filename.c_str(), "wt");
+    VVS_CHECK_TRUE(file != nullptr);
+    fprintf(file, "timestamp,lat,lon\n100.0,36,127\n");
+    fclose(file);
+    VVS_CHECK_TRUE(dg::BinaryLogReader::isBinaryLog(filename) == false);
+    VVS_CHECK_TRUE(reader.open(filename) == false);
+    std::remove(filename.c_str());
+
+    return 0;
+}
+
+int testBinaryLogSeek(const std::string& filename = "test_binary_log.dglog")
+{
+    // Seek records by time through the chunk index
+    const int n_frames = 200;
+    VVS_CHECK_TRUE(writeTestBinaryLog(filename, n_frames, 512));
+    dg::BinaryLogReader reader;
+    VVS_CHECK_TRUE(reader.open(filename));
+    VVS_CHECK_TRUE(reader.countChunks() > 20);
+    std::vector<dg::BinaryLogReader::Record> records;
+    VVS_CHECK_TRUE(reader.getRecords(109.95, 110.95, records, dg::LogType::GPS));
+    VVS_CHECK_EQUL(records.size(), 10);
+    VVS_CHECK_NEAR(records.front().timestamp, 110.0);
+    VVS_CHECK_NEAR(records.back().timestamp, 110.9);
+    for (size_t i = 1; i < records.size(); i++) VVS_CHECK_TRUE(records[i].timestamp > records[i - 1].timestamp);
+    VVS_CHECK_TRUE(reader.getRecords(109.95, 110.95, records, dg::LogType::IMU));
+    VVS_CHECK_EQUL(records.size(), 10);
+    VVS_CHECK_NEAR(records.front().timestamp, 110.01);
+    VVS_CHECK_TRUE(reader.getRecords(119.5, 119.6, records, dg::LogType::RECOGNIZER));
+    VVS_CHECK_EQUL(records.size(), 1);
+    VVS_CHECK_EQUL(records[0].fnumber, 195);
+    VVS_CHECK_TRUE(reader.getRecords(0.0, 99.9, records, dg::LogType::GPS) == false);
+    VVS_CHECK_TRUE(reader.getRecords(200.0, 300.0, records, dg::LogType::GPS) == false);
+
+    // Seek records by frame number through the chunk index
+    VVS_CHECK_TRUE(reader.getRecords(150, records));
+    VVS_CHECK_EQUL(records.size(), 1);
+    VVS_CHECK_TRUE(records[0].type == dg::LogType::RECOGNIZER);
+    VVS_CHECK_NEAR(records[0].timestamp, 115.04);
+
+    reader.close();
+    std::remove(filename.c_str());
+    return 0;
+}
+
+int testBinaryLogTruncated(const std::string& filename = "test_binary_log.dglog", const std::string& truncated = "test_binary_log_cut.dglog")
+{
+    // Write a log, and find the record boundaries of its complete chunks
+    const int n_frames = 50;
+    VVS_CHECK_TRUE(writeTestBinaryLog(filename, n_frames, 1024));
+    dg::BinaryLogReader reader;
+    VVS_CHECK_TRUE(reader.open(filename));
+    int n_chunks = reader.countChunks();
+    VVS_CHECK_TRUE(n_chunks > 3);
+    std::vector<dg::BinaryLogReader::Record> records;
+    VVS_CHECK_TRUE(reader.getRecords(dg::LogType::GPS, records));
+    VVS_CHECK_EQUL(records.size(), n_frames);
+    reader.close();
+
+    // Cut the log in the middle of a record of the third chunk (no index, so the chunks are scanned)
+    FILE* file = fopen(filename.c_str(), "rb");
+    VVS_CHECK_TRUE(file != nullptr);
+    size_t offset = sizeof(dg::LOG_FILE_MAGIC);
+    uint64_t n_complete = 0;
+    for (int c = 0; c < 2; c++)
+    {
+        dg::LogChunkHeader header;
+        fseek(file, (long)offset, SEEK_SET);
+        VVS_CHECK_TRUE(fread(&header, sizeof(header), 1, file) == 1);
+        VVS_CHECK_EQUL(header.magic, dg::LOG_CHUNK_MAGIC);
+        offset += sizeof(header) + header.size;
+        n_complete += header.n_records;
+    }
+    fclose(file);
+    size_t cut = offset + sizeof(dg::LogChunkHeader) + sizeof(dg::LogRecordHeader) + 5;
+    VVS_CHECK_TRUE(truncateTestBinaryLog(filename, truncated, cut));
+    VVS_CHECK_TRUE(reader.open(truncated));
+    VVS_CHECK_EQUL(reader.countChunks(), 2);
+    VVS_CHECK_EQUL(reader.countRecords(), n_complete);
+    VVS_CHECK_TRUE(reader.getRecords(dg::LogType::GPS, records));
+    VVS_CHECK_TRUE(records.size() > 0 && records.size() < (size_t)n_frames);
+    dg::LogGPS gps;
+    VVS_CHECK_TRUE(records.back().get(gps));
+    VVS_CHECK_NEAR(gps.lat, 36 + (records.size() - 1) * 1e-5);
+    reader.close();
+
+    // Cut the log in the middle of the first chunk header and the file magic
+    VVS_CHECK_TRUE(truncateTestBinaryLog(filename, truncated, sizeof(dg::LOG_FILE_MAGIC) + 10));
+    VVS_CHECK_TRUE(reader.open(truncated));
+    VVS_CHECK_EQUL(reader.countChunks(), 0);
+    VVS_CHECK_TRUE(reader.getRecords(dg::LogType::GPS, records) == false);
+    reader.close();
+    VVS_CHECK_TRUE(truncateTestBinaryLog(filename, truncated, 4));
+    VVS_CHECK_TRUE(reader.open(truncated) == false);
+
+    std::remove(filename.c_str());
+    std::remove(truncated.c_str());
+    return 0;
+}
+
+#endif // End of '__TEST_UTILS_BINARY_LOG__'
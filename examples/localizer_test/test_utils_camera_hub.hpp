@@ -0,0 +1,95 @@
+#ifndef __TEST_UTILS_CAMERA_HUB__
+#define __TEST_UTILS_CAMERA_HUB__
+
+#include "vvs.h"
+#include "utils/camera_hub.hpp"
+
+int testCameraHub()
+{
+    // Test degenerate cases
+    dg::CameraHub hub;
+    VVS_CHECK_TRUE(hub.next("ocr") == nullptr);
+    VVS_CHECK_EQUL(hub.addCamera("front"), 0);
+    VVS_CHECK_EQUL(hub.addCamera("side"), 1);
+    VVS_CHECK_EQUL(hub.addCamera("front"), -1);
+    VVS_CHECK_EQUL(hub.size(), 2);
+    VVS_CHECK_EQUL(hub.findCamera("side"), 1);
+    VVS_CHECK_TRUE(hub.setPriority("ocr", 2, 1) == false);
+    VVS_CHECK_TRUE(hub.setPriority("ocr", 0, 3));
+    VVS_CHECK_TRUE(hub.setPriority("ocr", 1, 1));
+    VVS_CHECK_TRUE(hub.next("ocr") == nullptr);
+
+    // Test the shares of cameras by their priorities (3:1 while both cameras have new frames)
+    const cv::Mat image;
+    int n_taken[2] = { 0, 0 };
+    double t = 0;
+    for (int i = 0; i < 400; i++, t += 0.1)
+    {
+        hub.publish(0, image, t);
+        hub.publish(1, image, t);
+        dg::CameraHub::Handle frame = hub.next("ocr");
+        if (!frame || frame->camera < 0 || frame->camera > 1) return -1;
+        n_taken[frame->camera]++;
+    }
+    VVS_CHECK_TRUE(n_taken[0] >= 299 && n_taken[0] <= 301);
+    VVS_CHECK_EQUL(n_taken[0] + n_taken[1], 400);
+    VVS_CHECK_EQUL(hub.countProcessed("ocr", 0), n_taken[0]);
+    VVS_CHECK_EQUL(hub.countProcessed("ocr", 1), n_taken[1]);
+    VVS_CHECK_TRUE(hub.countProcessed("ocr", 1) + hub.countSkipped("ocr", 1) <= (uint64_t)hub.countFrames(1));
+    VVS_CHECK_TRUE(hub.countSkipped("ocr", 1) >= 290);
+
+    // Test the share of an idle camera given to the other
+    for (int i = 0; i < 100; i++, t += 0.1)
+    {
+        hub.publish(0, image, t);
+        dg::CameraHub::Handle frame = hub.next("ocr");
+        if (!frame || frame->camera != 0) return -1;
+    }
+    VVS_CHECK_TRUE(hub.next("ocr") == nullptr);
+
+    // Test no burst of the camera after its idle time (its share is not accumulated while idle)
+    n_taken[0] = n_taken[1] = 0;
+    for (int i = 0; i < 40; i++, t += 0.1)
+    {
+        hub.publish(0, image, t);
+        hub.publish(1, image, t);
+        dg::CameraHub::Handle frame = hub.next("ocr");
+        if (!frame) return -1;
+        n_taken[frame->camera]++;
+    }
+    VVS_CHECK_TRUE(n_taken[1] >= 9 && n_taken[1] <= 11);
+
+    // Test frames rejected by a filter (consumed and counted as skipped, but not taking the share of their camera)
+    VVS_CHECK_TRUE(hub.setPriority("vps", 0, 3));
+    VVS_CHECK_TRUE(hub.setPriority("vps", 1, 1));
+    int n_calls = 0;
+    auto every_fourth = [&n_calls](const dg::CameraFrame& frame) { return n_calls++ % 4 == 0; };
+    n_taken[0] = n_taken[1] = 0;
+    for (int i = 0; i < 400; i++, t += 0.1)
+    {
+        hub.publish(0, image, t);
+        hub.publish(1, image, t);
+        dg::CameraHub::Handle frame = hub.next("vps", every_fourth);
+        if (frame) n_taken[frame->camera]++;
+    }
+    VVS_CHECK_EQUL(n_taken[0] + n_taken[1], 100);
+    VVS_CHECK_TRUE(n_taken[0] >= 74 && n_taken[0] <= 76);
+    VVS_CHECK_EQUL(hub.countProcessed("vps", 0), n_taken[0]);
+    VVS_CHECK_EQUL(hub.countProcessed("vps", 1), n_taken[1]);
+    VVS_CHECK_TRUE(hub.countSkipped("vps", 0) + hub.countSkipped("vps", 1) >= 690);
+
+    // Test a module without priorities (only the first camera) and stale frames
+    dg::CameraHub::Handle frame = hub.next("logo");
+    VVS_CHECK_TRUE(frame != nullptr);
+    VVS_CHECK_EQUL(frame->camera, 0);
+    VVS_CHECK_EQUL(frame->fnumber, hub.countFrames(0) - 1);
+    VVS_CHECK_TRUE(hub.next("logo") == nullptr);
+    VVS_CHECK_TRUE(hub.isStale(*frame) == false);
+    hub.publish(0, image, t);
+    VVS_CHECK_TRUE(hub.isStale(*frame));
+    VVS_CHECK_EQUL(hub.countProcessed("logo", 1), 0);
+
+    return 0;
+}
+
+#endif // End of '__TEST_UTILS_CAMERA_HUB__'
@@ -0,0 +1,101 @@
+#ifndef __TEST_UTILS_FRAME_IMAGE__
+#define __TEST_UTILS_FRAME_IMAGE__
+
+#include "vvs.h"
+#include "utils/frame_image.hpp"
+
+int testFrameImageJPEGSize()
+{
+    // Test JPEG headers
+    cv::Mat image(480, 640, CV_8UC3, cv::Scalar(10, 20, 30));
+    std::vector<uchar> jpeg, png;
+    VVS_CHECK_TRUE(cv::imencode(".jpg", image, jpeg));
+    VVS_CHECK_TRUE(cv::imencode(".png", image, png));
+    cv::Size size;
+    VVS_CHECK_TRUE(dg::FrameImage::readJPEGSize(jpeg, size));
+    VVS_CHECK_EQUL(size.width, 640);
+    VVS_CHECK_EQUL(size.height, 480);
+
+    // Test a SOF segment after other segments (APP0, padding bytes, and a restart marker)
+    std::vector<uchar> header = { 0xFF, 0xD8, 0xFF, 0xE0, 0x00, 0x04, 0x00, 0x00, 0xFF, 0xFF, 0xD0, 0xFF, 0xC2, 0x00, 0x11, 0x08, 0x02, 0xD0, 0x05, 0x00 };
+    VVS_CHECK_TRUE(dg::FrameImage::readJPEGSize(header, size));
+    VVS_CHECK_EQUL(size.width, 1280);
+    VVS_CHECK_EQUL(size.height, 720);
+
+    // Test broken and non-JPEG images
+    VVS_CHECK_TRUE(dg::FrameImage::readJPEGSize(std::vector<uchar>(), size) == false);
+    VVS_CHECK_TRUE(dg::FrameImage::readJPEGSize(std::vector<uchar>(header.begin(), header.end() - 4), size) == false);
+    VVS_CHECK_TRUE(dg::FrameImage::readJPEGSize(std::vector<uchar>(jpeg.begin(), jpeg.begin() + 4), size) == false);
+    VVS_CHECK_TRUE(dg::FrameImage::readJPEGSize(png, size) == false);
+    header[12] = 0xC4; // DHT instead of SOF
+    VVS_CHECK_TRUE(dg::FrameImage::readJPEGSize(header, size) == false);
+
+    return 0;
+}
+
+int testFrameImageLevels()
+{
+    cv::Mat image(480, 640, CV_8UC3, cv::Scalar(10, 20, 30));
+    std::vector<uchar> jpeg, png;
+    VVS_CHECK_TRUE(cv::imencode(".jpg", image, jpeg));
+    VVS_CHECK_TRUE(cv::imencode(".png", image, png));
+    VVS_CHECK_EQUL(dg::FrameImage::toLevel(1), 0);
+    VVS_CHECK_EQUL(dg::FrameImage::toLevel(3), 1);
+    VVS_CHECK_EQUL(dg::FrameImage::toLevel(4), 2);
+    VVS_CHECK_EQUL(dg::FrameImage::toLevel(100), 3);
+
+    // Test the size of JPEG without decoding
+    dg::FrameImage frame(jpeg);
+    VVS_CHECK_TRUE(frame.isCompressed());
+    VVS_CHECK_EQUL(frame.getSize().width, 640);
+    VVS_CHECK_EQUL(frame.countDecodes(), 0);
+
+    // Test a reduced level decoded by DCT scaling, and its reuse
+    cv::Mat quarter = frame.get(4);
+    VVS_CHECK_EQUL(quarter.cols, 160);
+    VVS_CHECK_EQUL(quarter.rows, 120);
+    VVS_CHECK_EQUL(frame.countDecodes(), 1);
+    VVS_CHECK_EQUL(frame.countResizes(), 0);
+    VVS_CHECK_TRUE(frame.get(5).data == quarter.data);
+    VVS_CHECK_EQUL(frame.countDecodes(), 1);
+
+    // Test a coarser level resized from a finer level
+    cv::Mat eighth = frame.get(8);
+    VVS_CHECK_EQUL(eighth.cols, 80);
+    VVS_CHECK_EQUL(frame.countDecodes(), 1);
+    VVS_CHECK_EQUL(frame.countResizes(), 1);
+
+    // Test resized images from the coarsest sufficient level, and their cache
+    cv::Mat resized = frame.getResized(cv::Size(100, 75));
+    VVS_CHECK_EQUL(resized.cols, 100);
+    VVS_CHECK_EQUL(resized.rows, 75);
+    VVS_CHECK_EQUL(frame.countDecodes(), 1);
+    VVS_CHECK_EQUL(frame.countResizes(), 2);
+    VVS_CHECK_TRUE(frame.getResized(cv::Size(100, 75)).data == resized.data);
+    VVS_CHECK_EQUL(frame.countResizes(), 2);
+    VVS_CHECK_TRUE(frame.getResized(cv::Size(160, 120)).data == quarter.data);
+    VVS_CHECK_EQUL(frame.countResizes(), 2);
+    cv::Mat large = frame.getResized(cv::Size(400, 300));
+    VVS_CHECK_EQUL(large.cols, 400);
+    VVS_CHECK_EQUL(frame.countDecodes(), 2);
+    VVS_CHECK_TRUE(frame.getResized(cv::Size(0, 10)).empty());
+
+    // Test non-JPEG and decoded images
+    dg::FrameImage frame_png(png);
+    VVS_CHECK_EQUL(frame_png.getSize().height, 480);
+    VVS_CHECK_EQUL(frame_png.countDecodes(), 1);
+    VVS_CHECK_EQUL(frame_png.get(2).cols, 320);
+    VVS_CHECK_EQUL(frame_png.countDecodes(), 1);
+    dg::FrameImage frame_raw(image);
+    VVS_CHECK_TRUE(frame_raw.get().data == image.data);
+    VVS_CHECK_EQUL(frame_raw.get(2).cols, 320);
+    VVS_CHECK_EQUL(frame_raw.countDecodes(), 0);
+    dg::FrameImage frame_none;
+    VVS_CHECK_TRUE(frame_none.empty());
+    VVS_CHECK_TRUE(frame_none.get(2).empty());
+    VVS_CHECK_TRUE(frame_none.getResized(cv::Size(10, 10)).empty());
+
+    return 0;
+}
+
+#endif // End of '__TEST_UTILS_FRAME_IMAGE__'
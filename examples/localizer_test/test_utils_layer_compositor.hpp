@@ -0,0 +1,111 @@
+#ifndef __TEST_UTILS_LAYER_COMPOSITOR__
+#define __TEST_UTILS_LAYER_COMPOSITOR__
+
+#include "vvs.h"
+#include "utils/layer_compositor.hpp"
+
+int testLayerCompositor()
+{
+    // Test the compositor without the base image
+    dg::LayerCompositor compositor;
+    VVS_CHECK_EQUL(compositor.addLayer("none"), -1);
+    VVS_CHECK_TRUE(compositor.invalidate(0) == false);
+    VVS_CHECK_TRUE(compositor.compose().empty());
+    VVS_CHECK_TRUE(compositor.setBase(cv::Mat()) == false);
+
+    // Test the base image only (its index is the only valid one)
+    cv::Mat image(80, 100, CV_8UC3, cv::Scalar(10, 10, 10));
+    VVS_CHECK_TRUE(compositor.setBase(image));
+    VVS_CHECK_EQUL(compositor.size(), 1);
+    VVS_CHECK_TRUE(compositor.invalidate(0));
+    VVS_CHECK_TRUE(compositor.invalidate(1) == false);
+    VVS_CHECK_EQUL(compositor.compose().at<cv::Vec3b>(0, 0)[0], 10);
+
+    // Add two layers which count their drawings
+    int n_route = 0, n_marker = 0;
+    int route = compositor.addLayer("route", [&](cv::Mat& canvas) { cv::rectangle(canvas, cv::Rect(0, 0, 50, 40), cv::Scalar(20, 20, 20), cv::FILLED); n_route++; });
+    int marker = compositor.addLayer("marker", [&](cv::Mat& canvas) { cv::rectangle(canvas, cv::Rect(40, 30, 10, 10), cv::Scalar(30, 30, 30), cv::FILLED); n_marker++; });
+    VVS_CHECK_EQUL(route, 1);
+    VVS_CHECK_EQUL(marker, 2);
+    VVS_CHECK_TRUE(compositor.getLayerName(marker) == "marker");
+    VVS_CHECK_TRUE(compositor.getLayerName(3).empty());
+    VVS_CHECK_TRUE(compositor.invalidate(3) == false);
+    VVS_CHECK_TRUE(compositor.invalidate(-1) == false);
+    VVS_CHECK_TRUE(compositor.getLayerImage(3).empty());
+
+    // Test the first frame (all layers are drawn and the whole frame is restored)
+    cv::Mat& frame = compositor.compose();
+    VVS_CHECK_EQUL(n_route, 1);
+    VVS_CHECK_EQUL(n_marker, 1);
+    VVS_CHECK_EQUL(compositor.getRestoredArea(), 100 * 80);
+    VVS_CHECK_EQUL(frame.at<cv::Vec3b>(5, 5)[0], 20);
+    VVS_CHECK_EQUL(frame.at<cv::Vec3b>(35, 45)[0], 30);
+    VVS_CHECK_EQUL(frame.at<cv::Vec3b>(70, 90)[0], 10);
+    VVS_CHECK_EQUL(compositor.getLayerImage(route).at<cv::Vec3b>(35, 45)[0], 20);
+
+    // Test clean frames (nothing is redrawn, and only dirty regions are restored)
+    compositor.compose();
+    VVS_CHECK_EQUL(compositor.getRestoredArea(), 0);
+    cv::rectangle(frame, cv::Rect(60, 50, 5, 5), cv::Scalar(99, 99, 99), cv::FILLED);
+    compositor.markCircle(cv::Point(62, 52), 3);
+    compositor.markDirty(cv::Rect(95, 75, 10, 10));
+    compositor.markDirty(cv::Rect(200, 200, 10, 10));
+    compositor.compose();
+    VVS_CHECK_EQUL(n_route, 1);
+    VVS_CHECK_EQUL(n_marker, 1);
+    VVS_CHECK_EQUL(compositor.getRestoredArea(), 9 * 9 + 5 * 5);
+    VVS_CHECK_EQUL(frame.at<cv::Vec3b>(52, 62)[0], 10);
+
+    // Test a dirty upper layer (only it is redrawn on its valid lower layers)
+    VVS_CHECK_TRUE(compositor.invalidate(marker));
+    compositor.compose();
+    VVS_CHECK_EQUL(n_route, 1);
+    VVS_CHECK_EQUL(n_marker, 2);
+    VVS_CHECK_EQUL(compositor.getRestoredArea(), 100 * 80);
+    VVS_CHECK_EQUL(frame.at<cv::Vec3b>(5, 5)[0], 20);
+
+    // Test a dirty lower layer (its upper layers are also redrawn)
+    VVS_CHECK_TRUE(compositor.invalidate(route));
+    compositor.compose();
+    VVS_CHECK_EQUL(n_route, 2);
+    VVS_CHECK_EQUL(n_marker, 3);
+
+    // Test incremental drawing on the top layer (only its region is restored)
+    auto draw_dot = [](cv::Mat& canvas) { cv::rectangle(canvas, cv::Rect(80, 10, 4, 4), cv::Scalar(40, 40, 40), cv::FILLED); };
+    VVS_CHECK_TRUE(compositor.drawOnLayer(marker, draw_dot, cv::Rect(80, 10, 4, 4)));
+    compositor.compose();
+    VVS_CHECK_EQUL(n_marker, 3);
+    VVS_CHECK_EQUL(compositor.getRestoredArea(), 4 * 4);
+    VVS_CHECK_EQUL(frame.at<cv::Vec3b>(11, 81)[0], 40);
+
+    // Test incremental drawing on a lower layer (its upper layers are redrawn)
+    VVS_CHECK_TRUE(compositor.drawOnLayer(route, draw_dot, cv::Rect(80, 10, 4, 4)));
+    compositor.compose();
+    VVS_CHECK_EQUL(n_route, 2);
+    VVS_CHECK_EQUL(n_marker, 4);
+    VVS_CHECK_EQUL(compositor.getLayerImage(route).at<cv::Vec3b>(11, 81)[0], 40);
+    VVS_CHECK_TRUE(compositor.drawOnLayer(0, draw_dot, cv::Rect()) == false);
+    VVS_CHECK_TRUE(compositor.drawOnLayer(3, draw_dot, cv::Rect()) == false);
+    VVS_CHECK_TRUE(compositor.drawOnLayer(marker, nullptr, cv::Rect()) == false);
+
+    // Test too large dirty regions (the whole frame is restored instead)
+    compositor.setMaxDirtyRatio(0.1);
+    compositor.markDirty(cv::Rect(0, 0, 50, 50));
+    compositor.compose();
+    VVS_CHECK_EQUL(compositor.getRestoredArea(), 100 * 80);
+
+    // Test a new base image (all layers are redrawn)
+    VVS_CHECK_TRUE(compositor.setBase(cv::Mat(80, 100, CV_8UC3, cv::Scalar(50, 50, 50))));
+    compositor.compose();
+    VVS_CHECK_EQUL(n_route, 3);
+    VVS_CHECK_EQUL(n_marker, 5);
+    VVS_CHECK_EQUL(frame.at<cv::Vec3b>(70, 90)[0], 50);
+
+    compositor.clear();
+    VVS_CHECK_EQUL(compositor.size(), 0);
+    VVS_CHECK_TRUE(compositor.invalidate(0) == false);
+
+    return 0;
+}
+
+#endif // End of '__TEST_UTILS_LAYER_COMPOSITOR__'
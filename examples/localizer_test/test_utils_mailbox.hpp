@@ -0,0 +1,99 @@
+#ifndef __TEST_UTILS_MAILBOX__
+#define __TEST_UTILS_MAILBOX__
+
+#include "vvs.h"
+#include "utils/mailbox.hpp"
+#include <thread>
+
+int testMailbox()
+{
+    // Test the empty mailbox
+    dg::Mailbox<std::string> mailbox;
+    uint64_t seq = 1;
+    VVS_CHECK_TRUE(mailbox.latest(&seq) == nullptr);
+    VVS_CHECK_EQUL(seq, 0);
+    VVS_CHECK_EQUL(mailbox.sequence(), 0);
+    uint64_t last_seq = 0;
+    dg::Mailbox<std::string>::Handle handle;
+    VVS_CHECK_TRUE(mailbox.fetch(last_seq, handle) == false);
+
+    // Test overwriting the latest value (only the newest one is received, and only once)
+    VVS_CHECK_EQUL(mailbox.publish("first"), 1);
+    VVS_CHECK_EQUL(mailbox.publish("second"), 2);
+    VVS_CHECK_TRUE(mailbox.fetch(last_seq, handle));
+    VVS_CHECK_EQUL(last_seq, 2);
+    VVS_CHECK_TRUE(*handle == "second");
+    VVS_CHECK_TRUE(mailbox.fetch(last_seq, handle) == false);
+    VVS_CHECK_TRUE(*handle == "second");
+
+    // Test the lifetime of handles (valid after newer values are published and after the mailbox is cleared)
+    dg::Mailbox<std::string>::Handle old = mailbox.latest(&seq);
+    VVS_CHECK_EQUL(seq, 2);
+    VVS_CHECK_TRUE(old.get() == handle.get());
+    mailbox.publish("third");
+    VVS_CHECK_TRUE(*old == "second");
+    VVS_CHECK_TRUE(*mailbox.latest() == "third");
+    std::weak_ptr<const std::string> watch = mailbox.latest();
+    mailbox.clear();
+    VVS_CHECK_TRUE(mailbox.latest() == nullptr);
+    VVS_CHECK_EQUL(mailbox.sequence(), 0);
+    VVS_CHECK_TRUE(watch.expired());
+    VVS_CHECK_TRUE(*old == "second");
+    old.reset();
+    handle.reset();
+
+    // Test sequence numbers after clear() (not reused, so consumers do not miss new values)
+    VVS_CHECK_EQUL(mailbox.publish("fourth"), 4);
+    VVS_CHECK_TRUE(mailbox.fetch(last_seq, handle));
+    VVS_CHECK_TRUE(*handle == "fourth");
+
+    // Test a consumer thread which receives increasing values without copying or tearing
+    dg::Mailbox<std::vector<int>> numbers;
+    std::atomic<bool> done(false);
+    bool consistent = true;
+    int n_received = 0;
+    std::thread consumer([&]
+    {
+        uint64_t last = 0;
+        int last_value = -1;
+        dg::Mailbox<std::vector<int>>::Handle data;
+        while (!done || numbers.sequence() > last)
+        {
+            if (!numbers.fetch(last, data)) continue;
+            if (data->size() != 100 || data->front() != data->back() || data->front() <= last_value) consistent = false;
+            last_value = data->front();
+            n_received++;
+        }
+    });
+    for (int i = 0; i < 10000; i++) numbers.publish(std::vector<int>(100, i));
+    done = true;
+    consumer.join();
+    VVS_CHECK_TRUE(consistent);
+    VVS_CHECK_TRUE(n_received >= 1 && n_received <= 10000);
+    VVS_CHECK_EQUL(numbers.latest()->front(), 9999);
+
+    return 0;
+}
+
+int testMailboxCameraFrame()
+{
+    // Test sharing a frame without copying its image
+    dg::Mailbox<dg::CameraFrame> mailbox;
+    cv::Mat image(48, 64, CV_8UC3, cv::Scalar(1, 2, 3));
+    dg::CameraFrame frame;
+    frame.image = std::make_shared<dg::FrameImage>(image);
+    frame.capture_time = 1.5;
+    frame.fnumber = 7;
+    mailbox.publish(frame);
+
+    dg::Mailbox<dg::CameraFrame>::Handle first = mailbox.latest(), second = mailbox.latest();
+    VVS_CHECK_TRUE(first.get() == second.get());
+    VVS_CHECK_EQUL(first->fnumber, 7);
+    VVS_CHECK_EQUL(first->capture_time, 1.5);
+    VVS_CHECK_TRUE(first->getImage().data == image.data);
+    VVS_CHECK_TRUE(dg::CameraFrame().getImage().empty());
+
+    return 0;
+}
+
+#endif // End of '__TEST_UTILS_MAILBOX__'
@@ -0,0 +1,178 @@
+#ifndef __TEST_UTILS_MAP_TILES__
+#define __TEST_UTILS_MAP_TILES__
+
+#include "vvs.h"
+#include "utils/map_tiles.hpp"
+#include "utils/map_painter.hpp"
+
+/** Make a smooth color image whose pixels depend on their coordinates */
+cv::Mat makeTestMapImage(int width, int height)
+{
+    cv::Mat image(height, width, CV_8UC3);
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+            image.at<cv::Vec3b>(y, x) = cv::Vec3b(x * 255 / width, y * 255 / height, (x + y) * 255 / (width + height));
+    }
+    return image;
+}
+
+int testMapTilePyramid(const std::string& dir = ".")
+{
+    // Build a small pyramid (300 x 200 pixels with 64-pixel tiles; lossless tiles to compare pixels)
+    cv::Mat image = makeTestMapImage(300, 200);
+    VVS_CHECK_TRUE(dg::MapTilePyramid::build(cv::Mat(), dir, 64, ".png") == false);
+    VVS_CHECK_TRUE(dg::MapTilePyramid::build(image, dir, 64, ".png"));
+    dg::MapTilePyramid pyramid(2 * 64 * 64 * 3);
+    VVS_CHECK_TRUE(pyramid.open(dir + "/no_such_dir") == false);
+    VVS_CHECK_TRUE(pyramid.open(dir));
+    VVS_CHECK_EQUL(pyramid.getLevels(), 4); // 300 x 200, 150 x 100, 75 x 50, and 38 x 25
+    VVS_CHECK_TRUE(pyramid.getImageSize() == cv::Size(300, 200));
+    VVS_CHECK_EQUL(pyramid.getTileSize(), 64);
+
+    // Test the names and sizes of tiles
+    VVS_CHECK_TRUE(dg::MapTilePyramid::getTilePath(dir, 0, 3, 4, ".png") == dir + "/0_3_4.png");
+    cv::Mat tile = cv::imread(dg::MapTilePyramid::getTilePath(dir, 0, 3, 4, ".png"));
+    VVS_CHECK_TRUE(tile.size() == cv::Size(300 - 4 * 64, 200 - 3 * 64));
+    tile = cv::imread(dg::MapTilePyramid::getTilePath(dir, 3, 0, 0, ".png"));
+    VVS_CHECK_TRUE(tile.size() == cv::Size(38, 25));
+    VVS_CHECK_TRUE(pyramid.getTile(0, 4, 0).empty());
+    VVS_CHECK_TRUE(pyramid.getTile(4, 0, 0).empty());
+    VVS_CHECK_TRUE(pyramid.getTile(0, -1, 0).empty());
+
+    // Test rendering at the original resolution (the same as the original image)
+    cv::Mat canvas;
+    VVS_CHECK_TRUE(pyramid.render(canvas, cv::Size(120, 80), cv::Point2d(50, 30), 1));
+    VVS_CHECK_TRUE(canvas.size() == cv::Size(120, 80));
+    VVS_CHECK_EQUL(cv::norm(canvas, image(cv::Rect(50, 30, 120, 80)), cv::NORM_INF), 0);
+
+    // Test rendering out of the image (filled with the background color)
+    VVS_CHECK_TRUE(pyramid.render(canvas, cv::Size(120, 80), cv::Point2d(-40, 0), 1, cv::Scalar(1, 2, 3)));
+    VVS_CHECK_TRUE(canvas.at<cv::Vec3b>(10, 10) == cv::Vec3b(1, 2, 3));
+    VVS_CHECK_TRUE(canvas.at<cv::Vec3b>(10, 45) == image.at<cv::Vec3b>(10, 5));
+    VVS_CHECK_TRUE(pyramid.render(canvas, cv::Size(120, 80), cv::Point2d(0, 0), 0) == false);
+
+    // Test rendering at a quarter resolution (from the level 2, similar to the resized original image)
+    cv::Mat resized;
+    cv::resize(image, resized, cv::Size(75, 50), 0, 0, cv::INTER_AREA);
+    VVS_CHECK_TRUE(pyramid.render(canvas, cv::Size(75, 50), cv::Point2d(0, 0), 0.25));
+    VVS_CHECK_TRUE(cv::norm(canvas, resized, cv::NORM_INF) <= 2);
+
+    // Test the LRU cache (the least recently used tile is evicted)
+    pyramid.open(dir);
+    pyramid.getTile(0, 0, 0);
+    pyramid.getTile(0, 0, 1);
+    pyramid.getTile(0, 0, 0);
+    pyramid.getTile(0, 0, 2);
+    VVS_CHECK_EQUL(pyramid.countCachedTiles(), 2);
+    VVS_CHECK_EQUL(pyramid.getCacheBytes(), 2 * 64 * 64 * 3);
+    pyramid.getTile(0, 0, 0);
+    VVS_CHECK_EQUL(pyramid.countCacheHits(), 2);
+    VVS_CHECK_EQUL(pyramid.countCacheMisses(), 3);
+    pyramid.getTile(0, 0, 1);
+    VVS_CHECK_EQUL(pyramid.countCacheMisses(), 4);
+
+    // Test the memory bound while rendering more tiles than the cache
+    VVS_CHECK_TRUE(pyramid.render(canvas, cv::Size(300, 200), cv::Point2d(0, 0), 1));
+    VVS_CHECK_TRUE(pyramid.getCacheBytes() <= 2 * 64 * 64 * 3);
+    VVS_CHECK_TRUE(pyramid.countCachedTiles() <= 2);
+    VVS_CHECK_EQUL(cv::norm(canvas, image, cv::NORM_INF), 0);
+    pyramid.setCacheSize(0);
+    pyramid.getTile(1, 0, 0);
+    VVS_CHECK_EQUL(pyramid.countCachedTiles(), 1); // The latest tile is kept
+
+    pyramid.close();
+    VVS_CHECK_TRUE(pyramid.isOpened() == false);
+    VVS_CHECK_EQUL(pyramid.getCacheBytes(), 0);
+    for (int level = 0; level < 4; level++)
+    {
+        for (int row = 0; row < 4; row++)
+        {
+            for (int col = 0; col < 5; col++)
+                std::remove(dg::MapTilePyramid::getTilePath(dir, level, row, col, ".png").c_str());
+        }
+    }
+    std::remove((dir + "/tiles.yml").c_str());
+    return 0;
+}
+
+int testMapPainterCulling()
+{
+    // Build a map on a 200 x 100 canvas (10 pixels per meter, and the metric origin at the bottom-left corner)
+    dg::MapPainter painter;
+    VVS_CHECK_TRUE(painter.setReference(dg::LatLon(36.38, 127.37)));
+    VVS_CHECK_TRUE(painter.setParamValue("pixel_per_meter", 10));
+    VVS_CHECK_TRUE(painter.setParamValue("canvas_margin", 0));
+    VVS_CHECK_TRUE(painter.setParamValue("canvas_offset", { 0, 100 }));
+    dg::MapCanvasInfo info = painter.getCanvasInfo(cv::Size(200, 100));
+    VVS_CHECK_NEAR(info.ppm, 10);
+
+    dg::Map map, visible;
+    std::vector<dg::Node> nodes =
+    {
+        dg::Node(1, painter.toLatLon(dg::Point2(5, 5))),                            // Pixel: (50, 50)
+        dg::Node(2, painter.toLatLon(dg::Point2(15, 5)), dg::Node::NODE_JUNCTION),  // Pixel: (150, 50)
+        dg::Node(3, painter.toLatLon(dg::Point2(-50, 2))),                          // Pixel: (-500, 80)
+        dg::Node(4, painter.toLatLon(dg::Point2(25, 2))),                           // Pixel: (250, 80)
+        dg::Node(5, painter.toLatLon(dg::Point2(20.1, 8))),                         // Pixel: (201, 20), partially visible
+        dg::Node(6, painter.toLatLon(dg::Point2(-50, 50))),                         // Pixel: (-500, -400)
+    };
+    for (auto& node : nodes)
+    {
+        map.addNode(node);
+        if (node.id != 6) visible.addNode(node);
+    }
+    map.addEdge(1, 2, dg::Edge(12));
+    map.addEdge(3, 4, dg::Edge(34)); // Passing through the canvas
+    map.addEdge(3, 6, dg::Edge(36));
+    visible.addEdge(1, 2, dg::Edge(12));
+    visible.addEdge(3, 4, dg::Edge(34));
+    VVS_CHECK_TRUE(painter.cvtLatLon2Pixel(map.nodes[1], info) == cv::Point(150, 50));
+
+    // Test culling nodes (off-canvas nodes are skipped, but partially visible nodes are drawn)
+    const cv::Vec3b white(255, 255, 255), blue(255, 0, 0), red(0, 0, 255);
+    cv::Mat image(100, 200, CV_8UC3, cv::Scalar(255, 255, 255)), expected = image.clone();
+    VVS_CHECK_TRUE(painter.drawNodes(image, info, map, 0.5, 0, blue));
+    VVS_CHECK_TRUE(painter.drawNodes(expected, info, visible, 0.5, 0, blue));
+    VVS_CHECK_EQUL(cv::norm(image, expected, cv::NORM_INF), 0);
+    VVS_CHECK_TRUE(image.at<cv::Vec3b>(50, 50) == blue);
+    VVS_CHECK_TRUE(image.at<cv::Vec3b>(20, 198) == blue);
+
+    // Test culling edges (off-canvas edges are skipped, but edges passing through the canvas are drawn)
+    image = cv::Scalar(255, 255, 255);
+    expected = cv::Scalar(255, 255, 255);
+    VVS_CHECK_TRUE(painter.drawEdges(image, info, map, 0, red, 1));
+    VVS_CHECK_TRUE(painter.drawEdges(expected, info, visible, 0, red, 1));
+    VVS_CHECK_EQUL(cv::norm(image, expected, cv::NORM_INF), 0);
+    VVS_CHECK_TRUE(image.at<cv::Vec3b>(50, 100) == red);
+    VVS_CHECK_TRUE(image.at<cv::Vec3b>(80, 100) == red);
+
+    // Test the level of detail of nodes (only junctions, and no nodes if zoomed out more)
+    VVS_CHECK_TRUE(painter.setParamValue("lod_node_ppm", 20));
+    image = cv::Scalar(255, 255, 255);
+    VVS_CHECK_TRUE(painter.drawNodes(image, info, map, 0.5, 0, blue));
+    VVS_CHECK_TRUE(image.at<cv::Vec3b>(50, 50) == white);
+    VVS_CHECK_TRUE(image.at<cv::Vec3b>(50, 150) != white);
+    VVS_CHECK_TRUE(painter.setParamValue("lod_node_ppm", 30));
+    image = cv::Scalar(255, 255, 255);
+    VVS_CHECK_TRUE(painter.drawNodes(image, info, map, 0.5, 0, blue));
+    VVS_CHECK_TRUE(image.at<cv::Vec3b>(50, 150) == white);
+    VVS_CHECK_TRUE(image.at<cv::Vec3b>(20, 198) == white);
+
+    // Test the level of detail of edges (shorter edges are skipped)
+    VVS_CHECK_TRUE(painter.setParamValue("lod_edge_length", 150));
+    image = cv::Scalar(255, 255, 255);
+    VVS_CHECK_TRUE(painter.drawEdges(image, info, map, 0, red, 1));
+    VVS_CHECK_TRUE(image.at<cv::Vec3b>(50, 100) == white);
+    VVS_CHECK_TRUE(image.at<cv::Vec3b>(80, 100) == red);
+
+    // Test the canvas information of a zoomed view
+    dg::MapCanvasInfo view = painter.getViewInfo(info, dg::Point2(100, 0), 2, cv::Size(200, 100));
+    VVS_CHECK_NEAR(view.ppm, 20);
+    VVS_CHECK_TRUE(painter.cvtLatLon2Pixel(map.nodes[1], view) == cv::Point(100, 100));
+    VVS_CHECK_TRUE(painter.cvtLatLon2Pixel(map.nodes[0], view) == cv::Point(-100, 100));
+
+    return 0;
+}
+
+#endif // End of '__TEST_UTILS_MAP_TILES__'
@@ -0,0 +1,119 @@
+#ifndef __TEST_UTILS_METRICS__
+#define __TEST_UTILS_METRICS__
+
+#include "vvs.h"
+#include "utils/metrics.hpp"
+
+/** Find the summary of the given metric (its count is -1 if not exist) */
+dg::Metrics::Summary findMetricSummary(const std::string& name)
+{
+    std::vector<dg::Metrics::Summary> summaries = dg::Metrics::instance().summarize();
+    for (auto& s : summaries)
+    {
+        if (s.name == name) return s;
+    }
+    dg::Metrics::Summary none;
+    none.counter = -1;
+    return none;
+}
+
+/** Sleep for the given time [msec] in a traced scope */
+void runTracedScope(int msec)
+{
+    DG_TRACE_SCOPE("testMetrics::scope");
+    std::this_thread::sleep_for(std::chrono::milliseconds(msec));
+}
+
+int testMetricsHistogram()
+{
+    // Test the bins (8 bins per octave)
+    VVS_CHECK_EQUL(dg::LatencyHistogram::findBin(0.5), 0);
+    VVS_CHECK_EQUL(dg::LatencyHistogram::findBin(1), 1);
+    VVS_CHECK_EQUL(dg::LatencyHistogram::findBin(2), 9);
+    VVS_CHECK_EQUL(dg::LatencyHistogram::findBin(1e20), dg::LatencyHistogram::NUM_BINS - 1);
+    for (double usec = 1; usec < 1e9; usec *= 3.7)
+    {
+        double value = dg::LatencyHistogram::getBinValue(dg::LatencyHistogram::findBin(usec));
+        VVS_CHECK_TRUE(fabs(value - usec) / usec < 0.09);
+    }
+
+    // Test percentiles of latency from 1 to 1000 [usec]
+    dg::LatencyHistogram hist;
+    for (int i = 1; i <= 1000; i++) hist.add(i);
+    std::vector<uint64_t> bins;
+    uint64_t count = 0;
+    double sum = 0, max = 0;
+    hist.accumulate(bins, count, sum, max);
+    VVS_CHECK_EQUL(count, 1000);
+    VVS_CHECK_NEAR(sum, 500500);
+    VVS_CHECK_NEAR(max, 1000);
+    VVS_CHECK_TRUE(fabs(dg::LatencyHistogram::getPercentile(bins, count, 0.50) - 500) < 500 * 0.09);
+    VVS_CHECK_TRUE(fabs(dg::LatencyHistogram::getPercentile(bins, count, 0.95) - 950) < 950 * 0.09);
+    VVS_CHECK_EQUL(dg::LatencyHistogram::getPercentile(bins, 0, 0.50), 0);
+
+    return 0;
+}
+
+int testMetricsAggregation()
+{
+    // Test counters and gauges
+    dg::Metrics& metrics = dg::Metrics::instance();
+    int counter = metrics.registerName("testMetrics::counter");
+    VVS_CHECK_TRUE(counter >= 0);
+    VVS_CHECK_EQUL(metrics.registerName("testMetrics::counter"), counter);
+    int64_t base = metrics.getCounter(counter);
+    for (int i = 0; i < 3; i++) DG_COUNT("testMetrics::counter", 2);
+    VVS_CHECK_EQUL(metrics.getCounter(counter) - base, 6);
+    VVS_CHECK_EQUL(metrics.getCounter(-1), 0);
+    DG_GAUGE("testMetrics::gauge", 10);
+    int gauge = metrics.registerName("testMetrics::gauge");
+    VVS_CHECK_EQUL(metrics.getGauge(gauge), 10);
+    VVS_CHECK_EQUL(metrics.setGauge(gauge, 20), 10);
+    VVS_CHECK_EQUL(findMetricSummary("testMetrics::gauge").gauge, 20);
+
+    // Test latency recorded by several threads (merged by their per-thread histograms)
+    int timer = metrics.registerName("testMetrics::timer");
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++)
+    {
+        threads.push_back(std::thread([&metrics, timer, t]
+        {
+            for (int i = 0; i < 100; i++) metrics.addLatency(timer, dg::Metrics::now(), 100.0 * (t + 1));
+        }));
+    }
+    for (auto& thread : threads) thread.join();
+    dg::Metrics::Summary summary = findMetricSummary("testMetrics::timer");
+    VVS_CHECK_EQUL(summary.count, 400);
+    VVS_CHECK_NEAR(summary.mean, 250);
+    VVS_CHECK_NEAR(summary.max, 400);
+    VVS_CHECK_TRUE(summary.p50 >= 200 * 0.91 && summary.p50 <= 200 * 1.09);
+    VVS_CHECK_TRUE(summary.p99 >= 400 * 0.91 && summary.p99 <= 400 * 1.09);
+    metrics.addLatency(dg::Metrics::MAX_METRICS, 0, 1);
+
+    return 0;
+}
+
+int testMetricsTraceScope()
+{
+    // Test the scoped timer (registered once for all calls)
+    dg::Metrics::Summary before = findMetricSummary("testMetrics::scope");
+    uint64_t n_before = (before.counter < 0) ? 0 : before.count;
+    runTracedScope(10);
+    runTracedScope(20);
+    runTracedScope(30);
+    dg::Metrics::Summary summary = findMetricSummary("testMetrics::scope");
+    VVS_CHECK_EQUL(summary.count - n_before, 3);
+    VVS_CHECK_TRUE(summary.max >= 30000);
+    VVS_CHECK_TRUE(summary.mean >= 20000 * 0.99);
+    int n_names = 0;
+    for (auto& s : dg::Metrics::instance().summarize()) n_names += (s.name == "testMetrics::scope");
+    VVS_CHECK_EQUL(n_names, 1);
+
+    dg::ScopedTimer timer("testMetrics::elapsed");
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    VVS_CHECK_TRUE(timer.elapsed() >= 0.01 && timer.elapsed() < 1);
+
+    return 0;
+}
+
+#endif // End of '__TEST_UTILS_METRICS__'
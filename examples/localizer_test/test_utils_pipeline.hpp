@@ -0,0 +1,118 @@
+#ifndef __TEST_UTILS_PIPELINE__
+#define __TEST_UTILS_PIPELINE__
+
+#include "vvs.h"
+#include "utils/pipeline.hpp"
+
+int testBoundedQueue()
+{
+    // Test the capacity (not rounded up to the power of two) and the FIFO order
+    dg::BoundedQueue<int> queue(3);
+    VVS_CHECK_EQUL(queue.capacity(), 3);
+    VVS_CHECK_TRUE(queue.empty());
+    int item = 0;
+    VVS_CHECK_TRUE(queue.pop(item) == false);
+    VVS_CHECK_TRUE(queue.push(1));
+    VVS_CHECK_TRUE(queue.push(2));
+    VVS_CHECK_TRUE(queue.pop(item));
+    VVS_CHECK_EQUL(item, 1);
+
+    // Test DROP_OLDEST on the full queue (new items are always queued)
+    for (int i = 3; i <= 6; i++) VVS_CHECK_TRUE(queue.push(i));
+    VVS_CHECK_EQUL(queue.size(), 3);
+    VVS_CHECK_EQUL(queue.dropped(), 2);
+    for (int i = 4; i <= 6; i++)
+    {
+        VVS_CHECK_TRUE(queue.pop(item));
+        VVS_CHECK_EQUL(item, i);
+    }
+    VVS_CHECK_TRUE(queue.empty());
+
+    // Test DROP_NEWEST on the full queue (queued items are kept)
+    dg::BoundedQueue<int> keeper(2, dg::DropPolicy::DROP_NEWEST);
+    VVS_CHECK_TRUE(keeper.push(1));
+    VVS_CHECK_TRUE(keeper.push(2));
+    VVS_CHECK_TRUE(keeper.push(3) == false);
+    VVS_CHECK_EQUL(keeper.dropped(), 1);
+    VVS_CHECK_TRUE(keeper.pop(item));
+    VVS_CHECK_EQUL(item, 1);
+
+    // Test taking the newest item only
+    dg::BoundedQueue<int> latest(4);
+    for (int i = 1; i <= 3; i++) latest.push(i);
+    VVS_CHECK_TRUE(latest.popLatest(item));
+    VVS_CHECK_EQUL(item, 3);
+    VVS_CHECK_EQUL(latest.dropped(), 2);
+    VVS_CHECK_TRUE(latest.popLatest(item) == false);
+
+    return 0;
+}
+
+int testStageSignal()
+{
+    // Test timeout without notification (times are measured in [usec])
+    dg::StageSignal signal;
+    uint64_t seq = signal.sequence();
+    double start = dg::Metrics::now();
+    VVS_CHECK_TRUE(signal.wait(seq, 0.05) == false);
+    VVS_CHECK_TRUE(dg::Metrics::now() - start >= 0.04e6);
+
+    // Test a notification before waiting (not missed) and from another thread (waking up the waiting thread)
+    signal.notify();
+    VVS_CHECK_TRUE(signal.wait(seq, 0));
+    VVS_CHECK_EQUL(seq, signal.sequence());
+    std::thread notifier([&signal] { std::this_thread::sleep_for(std::chrono::milliseconds(20)); signal.notify(); });
+    start = dg::Metrics::now();
+    VVS_CHECK_TRUE(signal.wait(seq, 5));
+    VVS_CHECK_TRUE(dg::Metrics::now() - start < 1e6);
+    notifier.join();
+
+    // Test a queue which notifies its consumer
+    std::shared_ptr<dg::StageSignal> trigger = std::make_shared<dg::StageSignal>();
+    dg::BoundedQueue<int> queue(2, dg::DropPolicy::DROP_OLDEST, trigger);
+    seq = trigger->sequence();
+    queue.push(1);
+    VVS_CHECK_TRUE(trigger->wait(seq, 0));
+
+    return 0;
+}
+
+int testPipeline()
+{
+    // Test an event-driven stage which drains its input queue (its period is too long to poll the queue)
+    std::shared_ptr<dg::StageSignal> trigger = std::make_shared<dg::StageSignal>();
+    dg::BoundedQueue<int> queue(16, dg::DropPolicy::DROP_OLDEST, trigger);
+    std::atomic<int> sum(0);
+    dg::Pipeline pipeline;
+    VVS_CHECK_TRUE(pipeline.start() == false);
+    VVS_CHECK_TRUE(pipeline.addStage("sum", [&]()
+    {
+        int item;
+        if (!queue.pop(item)) return false;
+        sum += item;
+        return true;
+    }, trigger, 10));
+    VVS_CHECK_TRUE(pipeline.addStage("empty", nullptr) == false);
+    VVS_CHECK_TRUE(pipeline.start());
+    VVS_CHECK_TRUE(pipeline.isRunning());
+    VVS_CHECK_TRUE(pipeline.addStage("late", [] { return false; }) == false);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    for (int i = 1; i <= 10; i++) queue.push(i);
+    double start = dg::Metrics::now();
+    while (pipeline.countStageRuns("sum") < 10 && dg::Metrics::now() - start < 5e6) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    VVS_CHECK_EQUL(sum.load(), 55);
+    VVS_CHECK_EQUL(pipeline.countStageRuns("sum"), 10);
+    VVS_CHECK_EQUL(pipeline.countStageRuns("none"), 0);
+    VVS_CHECK_TRUE(dg::Metrics::now() - start < 1e6);
+
+    // Test stopping the stage which sleeps for its long period
+    start = dg::Metrics::now();
+    pipeline.stop();
+    VVS_CHECK_TRUE(pipeline.isRunning() == false);
+    VVS_CHECK_TRUE(dg::Metrics::now() - start < 1e6);
+
+    return 0;
+}
+
+#endif // End of '__TEST_UTILS_PIPELINE__'
@@ -0,0 +1,122 @@
+#ifndef __TEST_UTILS_RATE_POLICY__
+#define __TEST_UTILS_RATE_POLICY__
+
+#include "vvs.h"
+#include "utils/rate_policy.hpp"
+
+int testRatePolicy()
+{
+    // Test modules which are not registered (always accepted)
+    dg::RatePolicy policy;
+    VVS_CHECK_TRUE(policy.accept("logo", 0));
+    VVS_CHECK_EQUL(policy.getRate("logo"), -1);
+    VVS_CHECK_EQUL(policy.getBudget("logo", false), 1);
+    VVS_CHECK_EQUL(policy.getSavedTime("logo"), 0);
+    policy.addBusyTime("logo", 1);
+    VVS_CHECK_EQUL(policy.getBusyTime("logo"), 0);
+
+    // Test the idle rate (1 Hz) on frames at 10 Hz with 0.1 sec processing time
+    policy.setRates("ocr", 1, 5);
+    VVS_CHECK_TRUE(policy.isActive("ocr") == false);
+    VVS_CHECK_EQUL(policy.getRate("ocr"), 1);
+    for (int k = 0; k < 100; k++)
+    {
+        if (policy.accept("ocr", k / 10.0)) policy.addBusyTime("ocr", 0.1);
+    }
+    policy.addBusyTime("ocr", -1);
+    VVS_CHECK_EQUL(policy.countAccepted("ocr"), 10);
+    VVS_CHECK_EQUL(policy.countRejected("ocr"), 90);
+    VVS_CHECK_NEAR(policy.getMeanProcTime("ocr"), 0.1);
+    VVS_CHECK_NEAR(policy.getBusyTime("ocr"), 1.0);
+
+    // Test the budgets (rate x mean processing time) and the saved time (limited by the elapsed time of 9.9 sec)
+    VVS_CHECK_NEAR(policy.getBudget("ocr", false), 0.1);
+    VVS_CHECK_NEAR(policy.getBudget("ocr", true), 0.5);
+    VVS_CHECK_NEAR(policy.getSavedTime("ocr"), 9.9 - 1.0);
+
+    // Test the active rate (5 Hz) whose first frame is accepted immediately
+    VVS_CHECK_TRUE(policy.accept("ocr", 9.95) == false);
+    policy.setActive("ocr", true);
+    VVS_CHECK_TRUE(policy.isActive("ocr"));
+    VVS_CHECK_EQUL(policy.getRate("ocr"), 5);
+    VVS_CHECK_TRUE(policy.accept("ocr", 9.96));
+    VVS_CHECK_TRUE(policy.accept("ocr", 10.0) == false);
+    VVS_CHECK_TRUE(policy.accept("ocr", 10.2));
+    policy.setActive("ocr", true);
+    VVS_CHECK_TRUE(policy.accept("ocr", 10.3) == false);
+    VVS_CHECK_EQUL(policy.countAccepted("ocr"), 12);
+    VVS_CHECK_EQUL(policy.countRejected("ocr"), 93);
+    policy.setActive("ocr", false);
+    VVS_CHECK_EQUL(policy.getRate("ocr"), 1);
+
+    // Test the schedule which does not accumulate the credit of missing frames
+    VVS_CHECK_TRUE(policy.accept("ocr", 20.0));
+    VVS_CHECK_TRUE(policy.accept("ocr", 20.5) == false);
+    VVS_CHECK_TRUE(policy.accept("ocr", 21.0));
+
+    // Test the zero (not run) and unlimited rates
+    policy.setRates("vps", 0, -1);
+    VVS_CHECK_TRUE(policy.accept("vps", 0) == false);
+    VVS_CHECK_TRUE(policy.accept("vps", 100) == false);
+    VVS_CHECK_EQUL(policy.getBudget("vps", true), 1);
+    policy.setActive("vps", true);
+    VVS_CHECK_TRUE(policy.accept("vps", 100));
+    VVS_CHECK_TRUE(policy.accept("vps", 100));
+    VVS_CHECK_EQUL(policy.countAccepted("vps"), 2);
+
+    policy.clear();
+    VVS_CHECK_EQUL(policy.getRate("ocr"), -1);
+    VVS_CHECK_EQUL(policy.countAccepted("ocr"), 0);
+
+    return 0;
+}
+
+/**
+ * Simulate a walk with the default rates of dg_simple and typical processing times of recognizers
+ * Each module is active for a part of every period (e.g. approaching a junction every minute for 10 sec).
+ */
+int testRatePolicySimulation(double duration = 600, double fps = 15)
+{
+    struct SimModule
+    {
+        const char* name;
+        double rates[2];
+        double proc_time;
+        double active_period;
+        double active_time;
+    };
+    const SimModule modules[] =
+    {
+        { "intersection", { 0.5, 5 }, 0.05, 60, 10 },
+        { "vps", { 0.2, 2 }, 0.5, 30, 6 },
+        { "ocr", { 0.2, 3 }, 0.2, 100, 15 },
+        { "logo", { 0.2, 3 }, 0.1, 100, 15 },
+    };
+
+    dg::RatePolicy policy;
+    for (auto mod = std::begin(modules); mod != std::end(modules); mod++)
+        policy.setRates(mod->name, mod->rates[0], mod->rates[1]);
+    int n_frames = (int)(duration * fps);
+    for (int k = 0; k < n_frames; k++)
+    {
+        double t = k / fps;
+        for (auto mod = std::begin(modules); mod != std::end(modules); mod++)
+        {
+            policy.setActive(mod->name, fmod(t, mod->active_period) < mod->active_time);
+            if (policy.accept(mod->name, t)) policy.addBusyTime(mod->name, mod->proc_time);
+        }
+    }
+    policy.print();
+
+    // Check the saved compute against processing all frames (limited by the elapsed time)
+    for (auto mod = std::begin(modules); mod != std::end(modules); mod++)
+    {
+        double busy = policy.getBusyTime(mod->name), saved = policy.getSavedTime(mod->name);
+        double baseline = std::min(n_frames * mod->proc_time, (n_frames - 1) / fps);
+        VVS_CHECK_NEAR(busy + saved, baseline);
+        VVS_CHECK_TRUE(saved / baseline > 0.7);
+    }
+    return 0;
+}
+
+#endif // End of '__TEST_UTILS_RATE_POLICY__'
@@ -0,0 +1,104 @@
+#ifndef __TEST_UTILS_RESULT_CACHE__
+#define __TEST_UTILS_RESULT_CACHE__
+
+#include "vvs.h"
+#include "utils/result_cache.hpp"
+
+int testResultCacheHash()
+{
+    typedef dg::ResultCache<int> Cache;
+    VVS_CHECK_EQUL(Cache::calcImageHash(cv::Mat()), 0);
+    VVS_CHECK_EQUL(Cache::calcHashDistance(0, 0), 0);
+    VVS_CHECK_EQUL(Cache::calcHashDistance(0xFF, 0xC0), 6);
+    VVS_CHECK_EQUL(Cache::calcHashDistance(0, ~(uint64_t)0), 64);
+
+    // Test horizontal gradients (each bit tells whether a pixel is brighter than its right neighbor)
+    cv::Mat falling(64, 72, CV_8UC1), rising(64, 72, CV_8UC1), color(64, 72, CV_8UC3);
+    for (int y = 0; y < 64; y++)
+    {
+        for (int x = 0; x < 72; x++)
+        {
+            falling.ptr<uchar>(y)[x] = (uchar)(250 - 3 * x);
+            rising.ptr<uchar>(y)[x] = (uchar)(30 + 3 * x);
+            for (int c = 0; c < 3; c++) color.ptr<uchar>(y)[3 * x + c] = (uchar)(250 - 3 * x);
+        }
+    }
+    VVS_CHECK_EQUL(Cache::calcImageHash(falling), ~(uint64_t)0);
+    VVS_CHECK_EQUL(Cache::calcImageHash(rising), 0);
+    VVS_CHECK_EQUL(Cache::calcImageHash(color), Cache::calcImageHash(falling));
+
+    return 0;
+}
+
+int testResultCacheReuse()
+{
+    // Test the keys (camera, position cells of 2 m, and heading bins of 22.5 deg)
+    dg::ResultCache<int> cache(2, CV_PI / 8, 3, 6, 4);
+    int result = 0;
+    VVS_CHECK_TRUE(cache.find(dg::Pose2(0.5, 0.5, 0), 0, 0xFF, 0, result) == false);
+    cache.insert(dg::Pose2(0.5, 0.5, 0), 0, 0xFF, 0, 42, 0.2);
+    VVS_CHECK_EQUL(cache.size(), 1);
+    VVS_CHECK_TRUE(cache.find(dg::Pose2(1.5, 1.9, 0.1), 0, 0xFF, 1, result));
+    VVS_CHECK_EQUL(result, 42);
+    VVS_CHECK_TRUE(cache.find(dg::Pose2(0.5, 0.5, 2 * CV_PI - 0.01), 0, 0xFF, 1, result));
+    VVS_CHECK_TRUE(cache.find(dg::Pose2(2.5, 0.5, 0), 0, 0xFF, 1, result) == false);
+    VVS_CHECK_TRUE(cache.find(dg::Pose2(0.5, 0.5, CV_PI / 2), 0, 0xFF, 1, result) == false);
+    VVS_CHECK_TRUE(cache.find(dg::Pose2(0.5, 0.5, 0), 1, 0xFF, 1, result) == false);
+
+    // Test the age and the hash distance (an empty image, hash 0, is checked by its key and age only)
+    VVS_CHECK_TRUE(cache.find(dg::Pose2(0.5, 0.5, 0), 0, 0xFF, 3.5, result) == false);
+    VVS_CHECK_TRUE(cache.find(dg::Pose2(0.5, 0.5, 0), 0, 0xFF, -1, result) == false);
+    VVS_CHECK_TRUE(cache.find(dg::Pose2(0.5, 0.5, 0), 0, 0xC0, 1, result));
+    VVS_CHECK_TRUE(cache.find(dg::Pose2(0.5, 0.5, 0), 0, 0x80, 1, result) == false);
+    VVS_CHECK_TRUE(cache.find(dg::Pose2(0.5, 0.5, 0), 0, 0, 1, result));
+
+    // Test the statistics
+    VVS_CHECK_EQUL(cache.countHits(), 4);
+    VVS_CHECK_EQUL(cache.countMisses(), 7);
+    VVS_CHECK_NEAR(cache.getHitRate(), 4.0 / 11);
+    VVS_CHECK_NEAR(cache.getSavedTime(), 4 * 0.2);
+
+    // Test eviction of expired results first, and then the oldest one
+    for (int i = 0; i < 5; i++)
+        cache.insert(dg::Pose2(10.0 + 2 * i, 0, 0), 0, 0xFF, 10.0 + i, i, 0.2);
+    VVS_CHECK_EQUL(cache.size(), 4);
+    VVS_CHECK_TRUE(cache.find(dg::Pose2(10.0, 0, 0), 0, 0xFF, 14, result) == false);
+    VVS_CHECK_TRUE(cache.find(dg::Pose2(12.0, 0, 0), 0, 0xFF, 14, result));
+    VVS_CHECK_EQUL(result, 1);
+    cache.insert(dg::Pose2(20.0, 0, 0), 0, 0xFF, 14, 5, 0.2);
+    VVS_CHECK_EQUL(cache.size(), 4);
+    VVS_CHECK_TRUE(cache.find(dg::Pose2(12.0, 0, 0), 0, 0xFF, 14, result) == false);
+    VVS_CHECK_TRUE(cache.find(dg::Pose2(20.0, 0, 0), 0, 0xFF, 14, result));
+
+    cache.clear();
+    VVS_CHECK_EQUL(cache.size(), 0);
+    VVS_CHECK_TRUE(cache.find(dg::Pose2(20.0, 0, 0), 0, 0xFF, 14, result) == false);
+
+    return 0;
+}
+
+/**
+ * Simulate a walk which stands still for 60% of its time (5 Hz frames and 0.15 sec processing time)
+ * Frames are keyed by their poses only (e.g. replaying a data log without decoding video).
+ */
+int testResultCacheSimulation(int n_frames = 300, double fps = 5, double proc_time = 0.15)
+{
+    dg::ResultCache<int> cache;
+    double x = 0;
+    int result = 0;
+    for (int i = 0; i < n_frames; i++)
+    {
+        double t = i / fps;
+        bool still = (i / 50) % 5 < 3;
+        if (!still) x += 0.3;
+        if (!cache.find(dg::Pose2(x, 0, 0), 0, 0, t, result)) cache.insert(dg::Pose2(x, 0, 0), 0, 0, t, i, proc_time);
+    }
+    cache.print("simulation");
+    VVS_CHECK_EQUL(cache.countHits() + cache.countMisses(), n_frames);
+    VVS_CHECK_NEAR(cache.getSavedTime(), cache.countHits() * proc_time);
+    VVS_CHECK_TRUE(cache.getHitRate() > 0.8);
+
+    return 0;
+}
+
+#endif // End of '__TEST_UTILS_RESULT_CACHE__'
@@ -1,4 +1,7 @@
 #include "test_map_manager.hpp"
+#include "test_path_planner.hpp"
+#include "test_streetview_cache.hpp"
+#include "test_poi_index.hpp"
 
 int main()
 {
@@ -6,6 +9,18 @@ int main()
 
     // Test simple cases
     VVS_RUN_TEST(testSimpleMapManager());
+    VVS_RUN_TEST(testStreetViewPrefetch());
+
+    // Test local path planning (including the latency on a city-scale graph)
+    VVS_RUN_TEST(testPathPlannerSimple());
+    VVS_RUN_TEST(testPathPlannerBenchmark());
+    VVS_RUN_TEST(testContractionHierarchy());
+
+    // Test the StreetView image cache (with a fake server)
+    VVS_RUN_TEST(testStreetViewCache());
+
+    // Test the POI name index (including the latency on 100k POIs)
+    VVS_RUN_TEST(testPOIIndex());
 
     return 0;
 }
\ No newline at end of file
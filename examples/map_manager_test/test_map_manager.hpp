@@ -5,6 +5,9 @@
 #include "dg_map_manager.hpp"
 #include <stdint.h>
 #include <cstdint>
+#include <chrono>
+#include <thread>
+#include <mutex>
 
 int testSimpleMapManager()
 {
@@ -91,4 +94,70 @@ int testSimpleMapManager()
     return 0;
 }
 
+int testStreetViewPrefetch()
+{
+	// A map with a straight path (20 m edges) and four StreetViews
+	dg::Map map;
+	map.addNode(dg::Node(1, 36.38, 127.36));
+	map.addNode(dg::Node(2, 36.38, 127.36022));
+	map.addNode(dg::Node(3, 36.38, 127.36044));
+	map.addEdge(1, 2, dg::Edge(1001, 20));
+	map.addEdge(2, 3, dg::Edge(1002, 20));
+	dg::ID sv_ids[] = { 501, 502, 503, 504 };
+	double sv_lat[] = { 36.38, 36.38, 36.38027, 36.380009 };
+	double sv_lon[] = { 127.360033, 127.360089, 127.36, 127.36044 }; // 3 m and 8 m from Node 1, 30 m from Node 1, and 1 m from Node 3
+	for (int i = 0; i < 4; i++)
+	{
+		dg::StreetView view;
+		view.id = sv_ids[i];
+		view.lat = sv_lat[i];
+		view.lon = sv_lon[i];
+		map.addView(view);
+	}
+	dg::Path path;
+	path.pts.push_back(dg::PathElement(1, 1001));
+	path.pts.push_back(dg::PathElement(2, 1002));
+	path.pts.push_back(dg::PathElement(3, 0));
+
+	// A fake server which records requested StreetView images (after a delay)
+	dg::MapManager manager;
+	std::mutex fetched_mutex;
+	std::vector<dg::ID> fetched;
+	manager.getStreetViewCache().setFetcher([&](dg::ID sv_id, const std::string& cubic, std::vector<uchar>& bytes, int timeout)
+	{
+		{
+			std::lock_guard<std::mutex> lock(fetched_mutex);
+			fetched.push_back(sv_id);
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		cv::Mat image(10, 10, CV_8UC3, cv::Scalar((double)(sv_id % 256)));
+		return cv::imencode(".png", image, bytes);
+	});
+
+	// StreetViews near the first two nodes are prefetched (without changing the map or querying the server for StreetViews)
+	VVS_CHECK_EQUL(manager.prefetchStreetViewImages(path, map, 10, 2, "f"), 2);
+	auto t0 = std::chrono::steady_clock::now();
+	while ((!manager.getStreetViewCache().isCached(501, "f") || !manager.getStreetViewCache().isCached(502, "f")) && std::chrono::steady_clock::now() - t0 < std::chrono::seconds(5))
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	{
+		std::lock_guard<std::mutex> lock(fetched_mutex);
+		VVS_CHECK_EQUL(fetched.size(), 2);
+		VVS_CHECK_EQUL(fetched[0], 501);
+		VVS_CHECK_EQUL(fetched[1], 502);
+	}
+	VVS_CHECK_EQUL(map.views.size(), 4);
+	for (int i = 0; i < 4; i++)
+	{
+		if (map.views[i].id != sv_ids[i]) return -1;
+	}
+	VVS_CHECK_TRUE(manager.getMapSnapshot() == nullptr);
+
+	// Only StreetViews which are not cached are prefetched
+	VVS_CHECK_EQUL(manager.prefetchStreetViewImages(path, map, 10, 3, "f"), 1);
+	VVS_CHECK_EQUL(manager.prefetchStreetViewImages(path, map, 0.5, 3, "f"), 0);
+	VVS_CHECK_EQUL(map.views.size(), 4);
+
+	return 0;
+}
+
 #endif // End of '__TEST_SIMPLE_MAP__'
@@ -0,0 +1,216 @@
+#ifndef __TEST_PATH_PLANNER__
+#define __TEST_PATH_PLANNER__
+
+#include "utils/vvs.h"
+#include "map_manager/path_planner.hpp"
+#include "map_manager/contraction_hierarchy.hpp"
+#include <chrono>
+#include <random>
+
+/**
+ * Build a synthetic city block graph (rows x cols junctions with about 10 m spacing)
+ * Every 7th vertical street is a crosswalk, every 11th horizontal street is a stair, and a few edges are missing.
+ */
+dg::Map buildPlannerTestMap(int rows, int cols, unsigned seed = 0)
+{
+	std::mt19937 rng(seed);
+	std::uniform_real_distribution<double> jitter(1.0, 1.3);
+	const double lat0 = 36.38, lon0 = 127.36, step_lat = 9e-5, step_lon = 1.1e-4;
+
+	dg::Map map;
+	map.nodes.reserve(rows * cols);
+	map.edges.reserve(2 * rows * cols);
+	for (int r = 0; r < rows; r++)
+		for (int c = 0; c < cols; c++)
+			map.addNode(dg::Node(1 + r * cols + c, lat0 + r * step_lat, lon0 + c * step_lon));
+
+	dg::ID edge_id = 1;
+	for (int r = 0; r < rows; r++)
+	{
+		for (int c = 0; c < cols; c++)
+		{
+			dg::ID id = 1 + r * cols + c;
+			if (c + 1 < cols && rng() % 20 != 0)
+			{
+				int type = (r % 11 == 5) ? dg::Edge::EDGE_STAIR : dg::Edge::EDGE_SIDEWALK;
+				map.addEdge(id, id + 1, dg::Edge(edge_id++, 10 * jitter(rng), type));
+			}
+			if (r + 1 < rows && rng() % 20 != 0)
+			{
+				int type = (c % 7 == 3) ? dg::Edge::EDGE_CROSSWALK : dg::Edge::EDGE_ROAD;
+				map.addEdge(id, id + cols, dg::Edge(edge_id++, 10 * jitter(rng), type));
+			}
+		}
+	}
+	return map;
+}
+
+int testPathPlannerSimple()
+{
+	// 1 -- 2 -- 3
+	// |         |
+	// 4 ------- 5 (stair: 2-3)
+	dg::Map map;
+	map.addNode(dg::Node(1, 36.0000, 127.0000));
+	map.addNode(dg::Node(2, 36.0000, 127.0001));
+	map.addNode(dg::Node(3, 36.0000, 127.0002));
+	map.addNode(dg::Node(4, 35.9999, 127.0000));
+	map.addNode(dg::Node(5, 35.9999, 127.0002));
+	map.addEdge(1, 2, dg::Edge(12, 9));
+	map.addEdge(2, 3, dg::Edge(23, 15, dg::Edge::EDGE_STAIR));
+	map.addEdge(1, 4, dg::Edge(14, 11));
+	map.addEdge(4, 5, dg::Edge(45, 18));
+	map.addEdge(5, 3, dg::Edge(53, 11));
+
+	dg::PathPlanner planner;
+	VVS_CHECK_TRUE(planner.build(map));
+	VVS_CHECK_EQUL(planner.countNodes(), 5);
+	VVS_CHECK_EQUL(planner.countEdges(), 5);
+	VVS_CHECK_EQUL(planner.findNearestNode(dg::LatLon(36.00001, 127.00019)), 3);
+
+	// The shortest path has the same shape as the server output
+	dg::Path path;
+	VVS_CHECK_TRUE(planner.findPath(1, 3, path));
+	VVS_CHECK_EQUL(path.pts.size(), 3);
+	VVS_CHECK_EQUL(path.pts[0].node_id, 1);
+	VVS_CHECK_EQUL(path.pts[0].edge_id, 12);
+	VVS_CHECK_EQUL(path.pts[1].node_id, 2);
+	VVS_CHECK_EQUL(path.pts[1].edge_id, 23);
+	VVS_CHECK_EQUL(path.pts[2].node_id, 3);
+	VVS_CHECK_EQUL(path.pts[2].edge_id, 0);
+	VVS_CHECK_NEAR(planner.getPathCost(path), 24);
+
+	// The pedestrian profile avoids the stair, and the wheelchair profile forbids it
+	VVS_CHECK_TRUE(planner.findPath(1, 3, path, dg::PathCostProfile::pedestrian()));
+	VVS_CHECK_EQUL(path.pts.size(), 4);
+	VVS_CHECK_EQUL(path.pts[1].node_id, 4);
+	VVS_CHECK_TRUE(planner.findPathBidirectional(3, 1, path, dg::PathCostProfile::wheelchair()));
+	VVS_CHECK_EQUL(path.pts.size(), 4);
+	VVS_CHECK_EQUL(path.pts[0].node_id, 3);
+	VVS_CHECK_EQUL(path.pts[0].edge_id, 53);
+	VVS_CHECK_EQUL(path.pts[3].node_id, 1);
+	VVS_CHECK_EQUL(path.pts[3].edge_id, 0);
+	VVS_CHECK_NEAR(planner.getPathCost(path), 40);
+
+	// Alternative paths
+	std::vector<dg::Path> paths;
+	VVS_CHECK_TRUE(planner.findPaths(dg::LatLon(36.0000, 127.0000), dg::LatLon(36.0000, 127.0002), paths, 2));
+	VVS_CHECK_EQUL(paths.size(), 2);
+	VVS_CHECK_EQUL(paths[0].pts.size(), 3);
+	VVS_CHECK_EQUL(paths[1].pts.size(), 4);
+	VVS_CHECK_NEAR(paths[1].dest_pos.lon, 127.0002);
+	planner.setMaxSnapDistance(100);
+	VVS_CHECK_TRUE(planner.findPath(dg::LatLon(36.0000, 127.0000), dg::LatLon(36.0003, 127.0002), path));
+	VVS_CHECK_FALSE(planner.findPath(dg::LatLon(36.0000, 127.0000), dg::LatLon(36.0100, 127.0002), path));
+
+	// Directed edges and unreachable nodes
+	map.addNode(dg::Node(6, 36.0001, 127.0000));
+	map.addEdge(1, 6, dg::Edge(16, 11, dg::Edge::EDGE_SIDEWALK, true));
+	VVS_CHECK_TRUE(planner.build(map));
+	VVS_CHECK_TRUE(planner.findPath(1, 6, path));
+	VVS_CHECK_FALSE(planner.findPath(6, 1, path));
+	VVS_CHECK_FALSE(planner.findPathBidirectional(6, 1, path));
+	VVS_CHECK_TRUE(planner.findPath(4, 4, path));
+	VVS_CHECK_EQUL(path.pts.size(), 1);
+
+	return 0;
+}
+
+int testPathPlannerBenchmark(int rows = 300, int cols = 300, int n_queries = 200)
+{
+	dg::Map map = buildPlannerTestMap(rows, cols);
+	dg::PathPlanner planner;
+	auto t0 = std::chrono::steady_clock::now();
+	VVS_CHECK_TRUE(planner.build(map));
+	double t_build = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+	std::mt19937 rng(1);
+	std::uniform_int_distribution<int> pick(1, rows * cols);
+	double t_astar = 0, t_bidir = 0;
+	size_t n_astar = 0, n_bidir = 0;
+	int n_found = 0;
+	dg::PathCostProfile profile = dg::PathCostProfile::pedestrian();
+	for (int i = 0; i < n_queries; i++)
+	{
+		dg::ID from = pick(rng), to = pick(rng);
+		dg::Path p1, p2;
+		auto s1 = std::chrono::steady_clock::now();
+		bool ok1 = planner.findPath(from, to, p1, profile);
+		auto s2 = std::chrono::steady_clock::now();
+		n_astar += planner.countExpanded();
+		bool ok2 = planner.findPathBidirectional(from, to, p2, profile);
+		auto s3 = std::chrono::steady_clock::now();
+		n_bidir += planner.countExpanded();
+		t_astar += std::chrono::duration<double>(s2 - s1).count();
+		t_bidir += std::chrono::duration<double>(s3 - s2).count();
+
+		// Both searches are exact, so their costs should be the same
+		VVS_CHECK_EQUL(ok1, ok2);
+		if (ok1 && ok2)
+		{
+			VVS_CHECK_RANGE(planner.getPathCost(p1, profile), planner.getPathCost(p2, profile), 1e-6);
+			VVS_CHECK_EQUL(p1.pts.back().edge_id, 0);
+			n_found++;
+		}
+	}
+
+	printf(" * Graph: %zu nodes, %zu edges (build: %.1f ms)\n", planner.countNodes(), planner.countEdges(), t_build * 1000);
+	printf(" * A*: %.3f ms/query, %zu expanded nodes/query\n", t_astar * 1000 / n_queries, n_astar / n_queries);
+	printf(" * Bidirectional Dijkstra: %.3f ms/query, %zu expanded nodes/query\n", t_bidir * 1000 / n_queries, n_bidir / n_queries);
+	printf(" * Found paths: %d / %d\n", n_found, n_queries);
+
+	return 0;
+}
+
+int testContractionHierarchy(int rows = 50, int cols = 50, int n_queries = 200)
+{
+	dg::Map map = buildPlannerTestMap(rows, cols, 2);
+	dg::PathCostProfile profile = dg::PathCostProfile::pedestrian();
+	dg::PathPlanner planner;
+	dg::ContractionHierarchy hierarchy;
+	VVS_CHECK_TRUE(planner.build(map));
+	VVS_CHECK_TRUE(hierarchy.build(map, profile));
+	VVS_CHECK_EQUL(hierarchy.countNodes(), map.nodes.size());
+
+	// The saved hierarchy gives the same paths
+	const char* filename = "test_path_planner.dgch";
+	dg::ContractionHierarchy loaded;
+	VVS_CHECK_TRUE(hierarchy.save(filename));
+	VVS_CHECK_TRUE(loaded.load(filename));
+	VVS_CHECK_EQUL(loaded.countArcs(), hierarchy.countArcs());
+	remove(filename);
+	VVS_CHECK_FALSE(dg::ContractionHierarchy().load(filename));
+
+	// Paths on the hierarchy are as short as A* paths on the original map
+	std::mt19937 rng(3);
+	std::uniform_int_distribution<int> pick(1, rows * cols);
+	for (int i = 0; i < n_queries; i++)
+	{
+		dg::ID from = pick(rng), to = pick(rng);
+		dg::Path p1, p2;
+		double cost = -1;
+		bool ok1 = planner.findPath(from, to, p1, profile);
+		bool ok2 = loaded.findPath(from, to, p2, &cost);
+		VVS_CHECK_EQUL(ok1, ok2);
+		if (ok1 && ok2)
+		{
+			VVS_CHECK_RANGE(planner.getPathCost(p2, profile), planner.getPathCost(p1, profile), 1e-6);
+			VVS_CHECK_RANGE(cost, planner.getPathCost(p1, profile), 1e-6);
+			VVS_CHECK_EQUL(p2.pts.front().node_id, from);
+			VVS_CHECK_EQUL(p2.pts.back().node_id, to);
+			VVS_CHECK_EQUL(p2.pts.back().edge_id, 0);
+		}
+	}
+
+	// Nearest nodes are the same with the linear search
+	std::uniform_real_distribution<double> lat(36.379, 36.391), lon(127.359, 127.372);
+	for (int i = 0; i < 100; i++)
+	{
+		dg::LatLon ll(lat(rng), lon(rng));
+		VVS_CHECK_EQUL(loaded.findNearestNode(ll), planner.findNearestNode(ll));
+	}
+
+	return 0;
+}
+
+#endif // End of '__TEST_PATH_PLANNER__'
@@ -0,0 +1,126 @@
+#ifndef __TEST_POI_INDEX__
+#define __TEST_POI_INDEX__
+
+#include "utils/vvs.h"
+#include "map_manager/poi_index.hpp"
+#include <chrono>
+#include <random>
+
+dg::POI makeTestPOI(dg::ID id, const std::wstring& name, double lat, double lon)
+{
+	dg::POI poi;
+	poi.id = id;
+	poi.name = name;
+	poi.floor = 1;
+	poi.lat = lat;
+	poi.lon = lon;
+	return poi;
+}
+
+int testPOIIndex(int n_pois = 100000, int n_queries = 1000)
+{
+	// Test normalization (case, spaces, and Hangul jamo)
+	VVS_CHECK_TRUE(dg::POIIndex::normalize(L"Cafe 24") == dg::POIIndex::normalize(L"cafe24"));
+	VVS_CHECK_TRUE(dg::POIIndex::normalize(L"닭") == dg::POIIndex::normalize(L"다ㄺ"));
+	VVS_CHECK_TRUE(dg::POIIndex::normalize(L"스타벅ㅅ") == dg::POIIndex::normalize(L"스타벅스").substr(0, 8));
+
+	// Test simple cases
+	std::vector<dg::POI> pois;
+	pois.push_back(makeTestPOI(1, L"스타벅스 대전둔산점", 36.3510, 127.3780));
+	pois.push_back(makeTestPOI(2, L"스타벅스 유성점", 36.3620, 127.3560));
+	pois.push_back(makeTestPOI(3, L"한국전자통신연구원", 36.3840, 127.3670));
+	pois.push_back(makeTestPOI(4, L"둔산 스타벅스", 36.3500, 127.3790));
+	pois.push_back(makeTestPOI(5, L"스타벅스 유성점", 36.3630, 127.3570));
+	dg::POIIndex index;
+	VVS_CHECK_TRUE(index.build(pois));
+	VVS_CHECK_EQUL(index.size(), pois.size());
+	std::vector<int> exact;
+	VVS_CHECK_EQUL(index.findExact(L"스타벅스 유성점", exact), 2);
+	VVS_CHECK_EQUL(index.findExact(L"스타벅스", exact), 0);
+
+	std::vector<dg::POIIndex::Result> results;
+	VVS_CHECK_EQUL(index.search(L"스타벅ㅅ", results), 4);
+	VVS_CHECK_EQUL(results[0].match, dg::POIIndex::MATCH_PREFIX);
+	VVS_CHECK_EQUL(results.back().match, dg::POIIndex::MATCH_SUBSTRING);
+	VVS_CHECK_EQUL(results.back().poi.id, 4);
+	VVS_CHECK_EQUL(index.search(L"전자통신", results), 1);
+	VVS_CHECK_EQUL(results[0].poi.id, 3);
+	VVS_CHECK_EQUL(index.search(L"한국전지통신", results), 1);
+	VVS_CHECK_EQUL(results[0].match, dg::POIIndex::MATCH_FUZZY);
+	VVS_CHECK_EQUL(results[0].edits, 1);
+	VVS_CHECK_EQUL(index.search(L"맥도날드", results), 0);
+
+	// The nearer one is ranked first, and the radius limits results
+	VVS_CHECK_EQUL(index.search(L"스타벅스 유성", dg::LatLon(36.3631, 127.3571), -1, results), 2);
+	VVS_CHECK_EQUL(results[0].poi.id, 5);
+	VVS_CHECK_TRUE(results[0].distance < results[1].distance);
+	VVS_CHECK_EQUL(index.search(L"스타벅스", dg::LatLon(36.3505, 127.3785), 500, results), 2);
+
+	// Generate random POIs (brand names with branch names) around Daejeon
+	std::mt19937 rng(0);
+	std::uniform_real_distribution<double> uniform(0, 1);
+	std::vector<std::wstring> brands, branches;
+	for (int i = 0; i < 2000; i++)
+	{
+		std::wstring name;
+		int len = 2 + rng() % 4;
+		for (int k = 0; k < len; k++) name.push_back((wchar_t)(0xAC00 + rng() % 11172));
+		brands.push_back(name);
+	}
+	for (int i = 0; i < 200; i++)
+	{
+		std::wstring name;
+		for (int k = 0; k < 2; k++) name.push_back((wchar_t)(0xAC00 + rng() % 11172));
+		branches.push_back(name + L"점");
+	}
+	pois.clear();
+	for (int i = 0; i < n_pois; i++)
+	{
+		std::wstring name = brands[rng() % brands.size()] + L" " + branches[rng() % branches.size()];
+		pois.push_back(makeTestPOI(100 + i, name, 36.30 + 0.2 * uniform(rng), 127.30 + 0.2 * uniform(rng)));
+	}
+	auto t0 = std::chrono::steady_clock::now();
+	VVS_CHECK_TRUE(index.build(pois));
+	double t_build = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+	// Query partially typed names, names with a typo, and branch names
+	std::vector<std::wstring> queries;
+	for (int i = 0; i < n_queries; i++)
+	{
+		const std::wstring& name = pois[rng() % pois.size()].name;
+		if (i % 3 == 0) queries.push_back(name.substr(0, 2));
+		else if (i % 3 == 1)
+		{
+			std::wstring typo = name;
+			typo[1] = (wchar_t)(0xAC00 + ((typo[1] - 0xAC00) / 28) * 28 + (typo[1] - 0xAC00 + 1) % 28); // Change the final consonant
+			queries.push_back(typo);
+		}
+		else queries.push_back(name.substr(name.size() - 3));
+	}
+	dg::LatLon user(36.40, 127.40);
+	int n_found = 0;
+	t0 = std::chrono::steady_clock::now();
+	for (auto query = queries.begin(); query != queries.end(); query++)
+	{
+		if (index.search(*query, user, -1, results) > 0) n_found++;
+	}
+	double t_search = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+	VVS_CHECK_EQUL(n_found, n_queries);
+	printf(" * POI index: %d POIs built in %.3f sec, %.3f us/query (prefix, typo, and substring queries)\n", n_pois, t_build, t_search * 1e6 / n_queries);
+
+	// The linear scan for comparison (only exact substring matches)
+	t0 = std::chrono::steady_clock::now();
+	int n_scan = 0;
+	for (int i = 0; i < 20; i++)
+	{
+		for (auto poi = pois.begin(); poi != pois.end(); poi++)
+			if (poi->name.find(queries[3 * i + 2]) != std::wstring::npos) n_scan++;
+	}
+	double t_scan = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+	VVS_CHECK_TRUE(n_scan > 0);
+	printf(" * POI linear scan: %.3f us/query\n", t_scan * 1e6 / 20);
+
+	return 0;
+}
+
+#endif // End of '__TEST_POI_INDEX__'
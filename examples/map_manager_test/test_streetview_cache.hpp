@@ -0,0 +1,99 @@
+#ifndef __TEST_STREETVIEW_CACHE__
+#define __TEST_STREETVIEW_CACHE__
+
+#include "utils/vvs.h"
+#include "map_manager/streetview_cache.hpp"
+#include <chrono>
+#include <thread>
+#include <atomic>
+
+int testStreetViewCache(int n_threads = 8, int fetch_msec = 30)
+{
+	// A fake server which encodes an image filled with its ID after a delay
+	std::atomic<int> n_fetches(0), last_timeout(0);
+	auto fetch = [&](dg::ID sv_id, const std::string& cubic, std::vector<uchar>& bytes, int timeout)
+	{
+		n_fetches++;
+		last_timeout = timeout;
+		std::this_thread::sleep_for(std::chrono::milliseconds(fetch_msec));
+		if (sv_id == 0) return false;
+		cv::Mat image(100, 100, CV_8UC3, cv::Scalar((double)(sv_id % 256)));
+		return cv::imencode(".png", image, bytes);
+	};
+
+	// Concurrent requests of the same image are coalesced into a single fetch
+	dg::StreetViewCache cache(100 * 100 * 3 * 3, 4);
+	cache.setFetcher(fetch);
+	std::vector<cv::Mat> images(n_threads);
+	std::vector<std::thread> threads;
+	for (int i = 0; i < n_threads; i++)
+		threads.push_back(std::thread([&cache, &images, i]() { cache.get(7, images[i], "f"); }));
+	for (auto thread = threads.begin(); thread != threads.end(); thread++) thread->join();
+	VVS_CHECK_EQUL(n_fetches.load(), 1);
+	VVS_CHECK_EQUL(cache.countCoalesced() + 1, (size_t)n_threads);
+	for (int i = 0; i < n_threads; i++)
+	{
+		if (images[i].empty() || images[i].data != images[0].data) return -1;
+	}
+	VVS_CHECK_EQUL(images[0].at<uchar>(0, 0), 7);
+
+	// A cached image is served from memory, and a different face is another image
+	cv::Mat image;
+	auto t0 = std::chrono::steady_clock::now();
+	VVS_CHECK_TRUE(cache.get(7, image, "f"));
+	double t_hit = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+	VVS_CHECK_EQUL(cache.countHits(), 1);
+	VVS_CHECK_TRUE(cache.get(7, image, "b"));
+	VVS_CHECK_EQUL(n_fetches.load(), 2);
+	VVS_CHECK_TRUE(cache.get(0, image) == false);
+	VVS_CHECK_TRUE(image.empty());
+
+	// The fetch timeout is given by each request (not shared by other requests)
+	VVS_CHECK_TRUE(cache.get(8, image, "f", 10, 3));
+	VVS_CHECK_EQUL(last_timeout.load(), 3);
+	VVS_CHECK_TRUE(cache.get(9, image, "f"));
+	VVS_CHECK_EQUL(last_timeout.load(), 10);
+
+	// The memory is bounded (least recently used images are evicted)
+	for (dg::ID id = 100; id < 110; id++)
+	{
+		if (!cache.get(id, image, "f")) return -1;
+	}
+	VVS_CHECK_EQUL(cache.countCachedImages(), 3);
+	VVS_CHECK_TRUE(cache.getMemoryBytes() <= 100 * 100 * 3 * 3);
+	VVS_CHECK_TRUE(cache.isCached(109, "f"));
+	VVS_CHECK_TRUE(cache.isCached(7, "f") == false);
+
+	// Prefetched images are served without fetching
+	n_fetches = 0;
+	std::vector<dg::ID> ids = { 200, 201, 109 };
+	VVS_CHECK_EQUL(cache.prefetch(ids, "f"), 2);
+	t0 = std::chrono::steady_clock::now();
+	while ((!cache.isCached(200, "f") || !cache.isCached(201, "f")) && std::chrono::steady_clock::now() - t0 < std::chrono::seconds(5))
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	VVS_CHECK_EQUL(n_fetches.load(), 2);
+	size_t n_hits = cache.countHits();
+	VVS_CHECK_TRUE(cache.get(201, image, "f"));
+	VVS_CHECK_EQUL(cache.countHits(), n_hits + 1);
+	VVS_CHECK_EQUL(n_fetches.load(), 2);
+
+	// Compressed images are read from the disk cache after the memory is cleared
+	dg::StreetViewCache disk(100 * 100 * 3 * 3, 2);
+	disk.setFetcher(fetch);
+	disk.setDiskDir(".");
+	VVS_CHECK_TRUE(disk.get(300, image, "f"));
+	disk.clear();
+	n_fetches = 0;
+	VVS_CHECK_TRUE(disk.get(300, image, "f"));
+	VVS_CHECK_EQUL(n_fetches.load(), 0);
+	VVS_CHECK_EQUL(disk.countDiskHits(), 1);
+	VVS_CHECK_EQUL(image.at<uchar>(0, 0), 44);
+	remove("./300_f.jpg");
+
+	printf(" * StreetView cache: %.3f us for a memory hit (%d msec for a fetch), %zu hits, %zu misses, %zu coalesced\n",
+		t_hit * 1e6, fetch_msec, cache.countHits(), cache.countMisses(), cache.countCoalesced());
+
+	return 0;
+}
+
+#endif // End of '__TEST_STREETVIEW_CACHE__'
@@ -0,0 +1,113 @@
+#include "dg_core.hpp"
+#include "dg_map_manager.hpp"
+#include "../map_manager_test/test_path_planner.hpp"    // buildPlannerTestMap()
+#include <chrono>
+#include <random>
+
+using namespace dg;
+using namespace std;
+
+double elapsed(std::chrono::steady_clock::time_point since)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - since).count();
+}
+
+/** Compare the hierarchy with A* on random node pairs */
+void benchmark(const Map& map, ContractionHierarchy& hierarchy, int n_queries)
+{
+    const PathCostProfile& profile = hierarchy.getProfile();
+    PathPlanner planner;
+    if (!planner.build(map)) return;
+
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<size_t> pick(0, map.nodes.size() - 1);
+    double t_ch = 0, t_astar = 0;
+    size_t n_settled = 0, n_expanded = 0, n_pts = 0;
+    int n_found = 0, n_mismatch = 0;
+    for (int i = 0; i < n_queries; i++)
+    {
+        ID from = map.nodes[pick(rng)].id, to = map.nodes[pick(rng)].id;
+        Path p1, p2;
+        double cost = 0;
+        auto t0 = std::chrono::steady_clock::now();
+        bool ok1 = hierarchy.findPath(from, to, p1, &cost);
+        t_ch += elapsed(t0);
+        n_settled += hierarchy.countSettled();
+        t0 = std::chrono::steady_clock::now();
+        bool ok2 = planner.findPath(from, to, p2, profile);
+        t_astar += elapsed(t0);
+        n_expanded += planner.countExpanded();
+
+        if (ok1 != ok2) n_mismatch++;
+        else if (ok1)
+        {
+            if (fabs(planner.getPathCost(p1, profile) - planner.getPathCost(p2, profile)) > 1e-6) n_mismatch++;
+            n_pts += p1.pts.size();
+            n_found++;
+        }
+    }
+
+    printf("Queries: %d (found: %d, mismatched with A*: %d, average path length: %zu nodes)\n", n_queries, n_found, n_mismatch, n_found ? n_pts / n_found : 0);
+    printf("  Contraction hierarchy: %.4f ms/query (including unpacking), %zu settled nodes/query\n", t_ch * 1000 / n_queries, n_settled / n_queries);
+    printf("  A*                   : %.4f ms/query, %zu expanded nodes/query\n", t_astar * 1000 / n_queries, n_expanded / n_queries);
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3)
+    {
+        printf("Usage: %s grid <rows> <cols> [output.dgch] [queries]\n", argv[0]);
+        printf("       %s map <lat> <lon> <radius> [output.dgch] [queries] [server_ip]\n", argv[0]);
+        printf("It builds a contraction hierarchy with the pedestrian profile, saves and reloads it, and benchmarks it against A*.\n");
+        return 0;
+    }
+
+    // prepare a map snapshot
+    Map map;
+    std::string mode = argv[1];
+    std::string output = "route_hierarchy.dgch";
+    int n_queries = 1000;
+    if (mode == "grid" && argc >= 4)
+    {
+        map = buildPlannerTestMap(atoi(argv[2]), atoi(argv[3]));
+        if (argc > 4) output = argv[4];
+        if (argc > 5) n_queries = atoi(argv[5]);
+    }
+    else if (mode == "map" && argc >= 5)
+    {
+        MapManager manager;
+        manager.setIP((argc > 7) ? argv[7] : "129.254.87.96");
+        if (!manager.getMap(atof(argv[2]), atof(argv[3]), atof(argv[4]), map))
+        {
+            printf("Error: can't download the map\n");
+            return -1;
+        }
+        if (argc > 5) output = argv[5];
+        if (argc > 6) n_queries = atoi(argv[6]);
+    }
+    else
+    {
+        printf("Error: invalid arguments\n");
+        return -1;
+    }
+    printf("Map: %zu nodes, %zu edges\n", map.nodes.size(), map.edges.size());
+
+    // build and serialize the hierarchy
+    ContractionHierarchy hierarchy;
+    auto t0 = std::chrono::steady_clock::now();
+    if (!hierarchy.build(map, PathCostProfile::pedestrian()))
+    {
+        printf("Error: can't build the hierarchy\n");
+        return -1;
+    }
+    printf("Build: %.2f sec (%zu arcs, %zu shortcuts)\n", elapsed(t0), hierarchy.countArcs(), hierarchy.countShortcuts());
+    if (!hierarchy.save(output)) return -1;
+
+    ContractionHierarchy loaded;
+    t0 = std::chrono::steady_clock::now();
+    if (!loaded.load(output)) return -1;
+    printf("Saved to %s and loaded in %.1f ms\n", output.c_str(), elapsed(t0) * 1000);
+
+    benchmark(map, loaded, n_queries);
+    return 0;
+}
@@ -2,6 +2,7 @@
 #define __MAP__
 
 #include "core/basic_type.hpp"
+#include <memory>
 
 namespace dg
 {
@@ -292,6 +293,16 @@ public:
      * @return A pointer to the found node (`nullptr` if not exist)
      */
     Node* findNode(ID id)
+    {
+        return const_cast<Node*>(static_cast<const Map*>(this)->findNode(id));
+    }
+
+    /**
+     * Find a node using ID (time complexity: O(1))
+     * @param id ID to search
+     * @return A pointer to the found node (`nullptr` if not exist)
+     */
+    const Node* findNode(ID id) const
     {
         assert(nodes.size() == lookup_nodes.size() && lookup_nodes.count(id) <= 1); // Verify ID uniqueness (comment this line if you want speed-up in DEBUG mode)
         auto found = lookup_nodes.find(id);
@@ -305,6 +316,16 @@ public:
      * @return A pointer to the found edge (`nullptr` if not exist)
      */
     Edge* findEdge(ID id)
+    {
+        return const_cast<Edge*>(static_cast<const Map*>(this)->findEdge(id));
+    }
+
+    /**
+     * Find an edge using ID (time complexity: O(1))
+     * @param id ID to search
+     * @return A pointer to the found edge (`nullptr` if not exist)
+     */
+    const Edge* findEdge(ID id) const
     {
         assert(edges.size() == lookup_edges.size() && lookup_edges.count(id) <= 1); // Verify ID uniqueness (comment this line if you want speed-up in DEBUG mode)
         auto found = lookup_edges.find(id);
@@ -320,7 +341,18 @@ public:
      */
     Edge* findEdge(ID from, ID to)
     {
-        Node* from_ptr = findNode(from);
+        return const_cast<Edge*>(static_cast<const Map*>(this)->findEdge(from, to));
+    }
+
+    /**
+     * Find an edge using ID (time complexity: O(|E|))
+     * @param from ID of the start node
+     * @param to ID of the destination node
+     * @return A pointer to the found edge (`nullptr` if not exist)
+     */
+    const Edge* findEdge(ID from, ID to) const
+    {
+        const Node* from_ptr = findNode(from);
         if (from_ptr == nullptr) return nullptr;
         for (auto edge = from_ptr->edge_ids.begin(); edge != from_ptr->edge_ids.end(); edge++)
         {
@@ -357,6 +389,22 @@ public:
 		return view_idx;
 	}
 
+	/**
+	 * Find a Street-view using ID (time complexity: O(1), or O(|V|) if `views` was modified directly)
+	 * @param id ID to search
+	 * @return A pointer to the found Street-view (`nullptr` if not exist)
+	 */
+	const StreetView* findView(ID id) const
+	{
+		auto found = lookup_views.find(id);
+		if (found != lookup_views.end() && found->second < views.size() && views[found->second].id == id) return &views[found->second];
+		for (auto view = views.begin(); view != views.end(); view++)
+		{
+			if (view->id == id) return &(*view);
+		}
+		return nullptr;
+	}
+
 	/**
 	 * Get the union of two Map sets
 	 * @param set2 The given Map set of this union set
@@ -422,6 +470,13 @@ protected:
 	std::map<ID, size_t> lookup_views;
 };
 
+/**
+ * A shared, read-only map instance
+ *
+ * A snapshot is never modified after it is published, so guidance, localizer, and painter can refer to the same map without copying it.
+ */
+typedef std::shared_ptr<const Map> MapSnapshot;
+
 } // End of 'dg'
 
 #endif // End of '__MAP__'
@@ -6,8 +6,13 @@
 #include "localizer/directed_graph.hpp"
 #include "localizer/graph_painter.hpp"
 #include "localizer/road_map.hpp"
+#include "localizer/flat_road_map.hpp"
+#include "localizer/topo_beam.hpp"
+#include "localizer/map_matcher.hpp"
 #include "localizer/localizer_base.hpp"
 #include "localizer/localizer_simple.hpp"
+#include "localizer/imu_preintegration.hpp"
+#include "localizer/gps_dead_zone.hpp"
 #include "localizer/localizer_ekf.hpp"
 #include "localizer/localizer_ekf_variants.hpp"
 
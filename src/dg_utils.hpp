@@ -7,6 +7,17 @@
 #include "utils/opensx.hpp"
 #include "utils/tts.hpp"
 #include "utils/map_painter.hpp"
+#include "utils/map_tiles.hpp"
+#include "utils/layer_compositor.hpp"
 #include "utils/utility.hpp"
+#include "utils/pipeline.hpp"
+#include "utils/frame_image.hpp"
+#include "utils/mailbox.hpp"
+#include "utils/camera_hub.hpp"
+#include "utils/rate_policy.hpp"
+#include "utils/result_cache.hpp"
+#include "utils/metrics.hpp"
+#include "utils/binary_log.hpp"
+#include "utils/replay_log.hpp"
 
 #endif // End of '__DG_UTILS__'
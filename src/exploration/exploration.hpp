@@ -28,6 +28,8 @@ class ActiveNavigation : public PythonModuleWrapper
         */
         bool initialize(const char* module_name = "active_navigation", const char* module_path = "./../src/exploration", const char* class_name = "ActiveNavigationModule", const char* func_name_init = "initialize", const char* func_name_apply = "getExplorationGuidance")
         {
+            DG_TRACE_SCOPE("ActiveNavigation::initialize");
+
             PyGILState_STATE state;
             bool ret;
 
@@ -60,6 +62,8 @@ class ActiveNavigation : public PythonModuleWrapper
         */
         bool apply(cv::Mat image, GuidanceManager::Guidance guidance, dg::Timestamp t)
         {
+            DG_TRACE_SCOPE("ActiveNavigation::apply");
+
             PyGILState_STATE state;
             bool ret;
 
@@ -5,28 +5,76 @@
 
 using namespace dg;
 
-bool GuidanceManager::initiateNewGuidance(Path& path, Map& map)
+bool GuidanceManager::initiateNewGuidance(Path path, MapSnapshot map)
 {
+	DG_TRACE_SCOPE("GuidanceManager::initiateNewGuidance");
 	if (path.pts.size() < 1)
 	{
 		printf("[Error] GuidanceManager::initiateNewGuidance - No path input!\n");
 		return false;
 	}
-	if (!validatePath(path, map))
+	if (map == nullptr || !validatePath(path, *map))
 	{
 		printf("[Error] GuidanceManager::initiateNewGuidance - Path id is not in map!\n");
 		return false;
 	}
-	m_path = path;
-	m_map = map;
+	m_path = std::move(path);
+	m_map = std::move(map);
 
 	return buildGuides();
 }
 
 
+bool GuidanceManager::updateGuidancePath(Path path, MapSnapshot map)
+{
+	DG_TRACE_SCOPE("GuidanceManager::updateGuidancePath");
+	if (map == nullptr) map = m_map;
+	if (m_extendedPath.empty() || m_guide_idx < 0)
+		return initiateNewGuidance(std::move(path), std::move(map));
+
+	if (path.pts.size() < 1)
+	{
+		printf("[Error] GuidanceManager::updateGuidancePath - No path input!\n");
+		return false;
+	}
+	if (map == nullptr || !validatePath(path, *map))
+	{
+		printf("[Error] GuidanceManager::updateGuidancePath - Path id is not in map!\n");
+		return false;
+	}
+
+	// splice the new path where it leaves the remaining route
+	int splice_idx = getGuideIdxFromPose(TopometricPose(path.pts.front().node_id));
+	if (splice_idx < m_guide_idx)
+	{
+		// keep the walked guides and join the new path from the current guide if it starts off the remaining route
+		// (e.g. rerouting from the node where the user went out of the path; a new guidance if they are not adjacent)
+		ID cur_node_id = m_extendedPath[m_guide_idx].cur_node_id;
+		const Edge* join = map->findEdge(cur_node_id, path.pts.front().node_id);
+		if (join == nullptr) return initiateNewGuidance(std::move(path), std::move(map));
+		path.pts.insert(path.pts.begin(), PathElement(cur_node_id, join->id));
+		splice_idx = m_guide_idx;
+	}
+
+	m_map = std::move(map);
+	removeGuides(splice_idx);
+	m_path.pts.insert(m_path.pts.end(), path.pts.begin(), path.pts.end());
+	m_path.start_pos = path.start_pos;
+	m_path.dest_pos = path.dest_pos;
+	if (!appendGuides(splice_idx))
+	{
+		clearGuides();
+		return false;
+	}
+
+	return true;
+}
+
+
 bool GuidanceManager::buildGuides()
 {
-	if (m_map.nodes.empty())
+	DG_TRACE_SCOPE("GuidanceManager::buildGuides");
+	if (m_map == nullptr || m_map->nodes.empty())
 	{
 		printf("[Error] GuidanceManager::buildGuides - Empty Map\n");
 		return false;
@@ -37,68 +85,112 @@ bool GuidanceManager::buildGuides()
 		return false;
 	}
 
-	m_extendedPath.clear();
+	clearGuides();
+	if (!appendGuides(0)) return false;
+
+	m_guide_idx = 0;
+	m_arrival = false;
+
+	// for (size_t i = 0; i < m_extendedPath.size(); i++)
+	// {
+	// 	printf("[%d] Node id:%zu, Deg: %d \n", i, m_extendedPath[i].cur_node_id, m_extendedPath[i].cur_degree);
+	// }
+	
+	return true;
+
+}
+
+/** @brief appendGuides builds guides for m_path.pts[from_idx ~] after the first from_idx guides
+ *	Distances to/from junctions and next guides are updated only for the new guides
+ *	and the kept guides after the last junction before them.
+*/
+bool GuidanceManager::appendGuides(int from_idx)
+{
+	DG_TRACE_SCOPE("GuidanceManager::appendGuides");
+	if (from_idx < 0 || from_idx != (int)m_extendedPath.size() || from_idx >= (int)m_path.pts.size())
+	{
+		printf("[Error] GuidanceManager::appendGuides - Wrong index: %d\n", from_idx);
+		return false;
+	}
+	m_extendedPath.reserve(m_path.pts.size());
 
-	for (int i = 0; i < (int)m_path.pts.size() - 1; i++)
+	// look up nodes only once per path point
+	int first = std::max(from_idx - 1, 0);
+	std::vector<const Node*> nodes(m_path.pts.size() - first);
+	for (size_t i = 0; i < nodes.size(); i++)
+	{
+		nodes[i] = m_map->findNode(m_path.pts[first + i].node_id);
+		if (nodes[i] == nullptr)
+		{
+			printf("[Error] GuidanceManager::appendGuides - No Node-%zu found on map!\n", m_path.pts[first + i].node_id);
+			return false;
+		}
+	}
+
+	for (int i = from_idx; i < (int)m_path.pts.size() - 1; i++)
 	{
 		ID curnid = m_path.pts[i].node_id;
 		ID cureid = m_path.pts[i].edge_id;
 		ID nextnid = m_path.pts[i + 1].node_id;
 		ID nexteid = m_path.pts[i + 1].edge_id;
 
-		Node* curNode = m_map.findNode(curnid);
-		if (curNode == nullptr)
+		const Node* curNode = nodes[i - first];
+		const Edge* curEdge = m_map->findEdge(cureid);
+		if (curEdge == nullptr)
 		{
-			printf("[Error] GuidanceManager::buildGuides()\n");
+			printf("[Error] GuidanceManager::appendGuides - No Edge-%zu found on map!\n", cureid);
 			return false;
 		}
 
 		int angle = 0;
 		if (i > 0)
 		{
-			ID prevnid = m_path.pts[i - 1].node_id;
-			Node* prevNode = m_map.findNode(prevnid);
-			Node* nextNode = m_map.findNode(nextnid);
-
-			angle = getDegree(prevNode, curNode, nextNode);
+			angle = getDegree(nodes[i - 1 - first], curNode, nodes[i + 1 - first]);
 		}
 		ExtendedPathElement tmppath(curnid, cureid, nextnid, nexteid, angle);
 		if (curNode->type == Node::NODE_JUNCTION || curNode->type == Node::NODE_DOOR)
 		{
 			tmppath.is_junction = true;
 		}
+		tmppath.cur_edge_length = curEdge->length;
 		m_extendedPath.push_back(tmppath);
 	}
 
 	//add last node
-	Node* lastNode = m_map.findNode(m_path.pts.back().node_id);
+	const Node* lastNode = nodes.back();
 	ID lastEdge = lastNode->edge_ids[0];
 	m_finalTurn = 0;
 	m_extendedPath.push_back(ExtendedPathElement(m_path.pts.back().node_id, lastEdge, 0, 0, m_finalTurn));
 
+	//connect the kept guides to the new guides
+	if (from_idx > 0)
+	{
+		m_extendedPath[from_idx - 1].next_node_id = m_extendedPath[from_idx].cur_node_id;
+		m_extendedPath[from_idx - 1].next_edge_id = m_extendedPath[from_idx].cur_edge_id;
+	}
+
 	// update remain distance to next junction
 	double d_accumulated = 0;
 	for (int i = (int)m_extendedPath.size() - 2; i >= 0; i--)
 	{
-		ID eid = m_extendedPath[i].cur_edge_id;
-		Edge* edge = m_map.findEdge(eid);
-		d_accumulated += edge->length;
+		d_accumulated += m_extendedPath[i].cur_edge_length;
 
 		m_extendedPath[i].remain_distance_to_next_junction = d_accumulated;
 
 		if (m_extendedPath[i].is_junction)
 		{
+			if (i < from_idx) break;
 			d_accumulated = 0;
 		}
 	}
 
 	// update past distance from prev junction
 	d_accumulated = 0;
-	for (int i = 1; i < (int)m_extendedPath.size(); i++)
+	if (from_idx > 1 && !m_extendedPath[from_idx - 1].is_junction)
+		d_accumulated = m_extendedPath[from_idx - 1].past_distance_from_prev_junction;
+	for (int i = std::max(from_idx, 1); i < (int)m_extendedPath.size(); i++)
 	{
-		ID eid = m_extendedPath[i - 1].cur_edge_id;
-		Edge* edge = m_map.findEdge(eid);
-		d_accumulated += edge->length;
+		d_accumulated += m_extendedPath[i - 1].cur_edge_length;
 
 		m_extendedPath[i].past_distance_from_prev_junction = d_accumulated;
 
@@ -118,20 +210,49 @@ bool GuidanceManager::buildGuides()
 
 		if (m_extendedPath[i].is_junction)
 		{
+			if (i < from_idx) break;
 			next_guide_node_id = m_extendedPath[i].cur_node_id;
 			next_guide_edge_id = m_extendedPath[i].cur_edge_id;
 		}
 	}
 
-	m_guide_idx = 0;
+	buildGuideIndex(from_idx);
 
-	// for (size_t i = 0; i < m_extendedPath.size(); i++)
-	// {
-	// 	printf("[%d] Node id:%zu, Deg: %d \n", i, m_extendedPath[i].cur_node_id, m_extendedPath[i].cur_degree);
-	// }
-	
 	return true;
+}
+
+/** @brief removeGuides removes guides from from_idx to the end and their path points
+*/
+void GuidanceManager::removeGuides(int from_idx)
+{
+	for (int i = from_idx; i < (int)m_extendedPath.size(); i++)
+	{
+		auto node = m_guide_node_index.find(m_extendedPath[i].cur_node_id);
+		if (node != m_guide_node_index.end() && node->second >= from_idx) m_guide_node_index.erase(node);
+		auto edge = m_guide_edge_index.find(m_extendedPath[i].cur_edge_id);
+		if (edge != m_guide_edge_index.end() && edge->second >= from_idx) m_guide_edge_index.erase(edge);
+	}
+	if (from_idx < (int)m_extendedPath.size()) m_extendedPath.resize(from_idx);
+	if (from_idx < (int)m_path.pts.size()) m_path.pts.resize(from_idx);
+}
 
+/** @brief buildGuideIndex registers guides from from_idx to the end into the node/edge hash tables
+ *	(entries at or after from_idx should have been removed)
+*/
+void GuidanceManager::buildGuideIndex(int from_idx)
+{
+	for (int i = from_idx; i < (int)m_extendedPath.size(); i++)
+	{
+		m_guide_node_index.insert(std::make_pair(m_extendedPath[i].cur_node_id, i));
+		m_guide_edge_index.insert(std::make_pair(m_extendedPath[i].cur_edge_id, i));
+	}
+}
+
+void GuidanceManager::clearGuides()
+{
+	m_extendedPath.clear();
+	m_guide_node_index.clear();
+	m_guide_edge_index.clear();
 }
 
 // bool GuidanceManager::setTunBackGuide()
@@ -182,9 +303,9 @@ bool GuidanceManager::setInitialGuide()
 	{
 		//current robot's pose
 		ID curnid = m_curpose.node_id;
-		Node* curNode = m_map.findNode(curnid);
+		const Node* curNode = m_map->findNode(curnid);
 		ID cureid = curNode->edge_ids[m_curpose.edge_idx];
-		Edge* curEdge = m_map.findEdge(cureid);
+		const Edge* curEdge = m_map->findEdge(cureid);
 		ID nextnid = (curEdge->node_id1 == curnid) ? curEdge->node_id2 : curEdge->node_id1;
 
 		//if wrong direction
@@ -244,8 +365,8 @@ bool GuidanceManager::setInitialGuide()
 */
 GuidanceManager::Action GuidanceManager::setActionTurn(ID nid_cur, ID eid_cur, int degree_cur)
 {
-	Node* node = m_map.findNode(nid_cur);
-	Edge* edge = m_map.findEdge(eid_cur);
+	const Node* node = m_map->findNode(nid_cur);
+	const Edge* edge = m_map->findEdge(eid_cur);
 	if (node == nullptr || edge == nullptr)
 	{
 		printf("[Error] GuidanceManager::setActionTurn\n");
@@ -261,8 +382,8 @@ GuidanceManager::Action GuidanceManager::setActionTurn(ID nid_cur, ID eid_cur, i
 
 GuidanceManager::Action GuidanceManager::setActionGo(ID nid_next, ID eid_cur, int degree)
 {
-	Node* node = m_map.findNode(nid_next);
-	Edge* edge = m_map.findEdge(eid_cur);
+	const Node* node = m_map->findNode(nid_next);
+	const Edge* edge = m_map->findEdge(eid_cur);
 	if (node == nullptr || edge == nullptr)
 	{
 		printf("[Error] GuidanceManager::setActionGo - No node or edge\n");
@@ -342,6 +463,7 @@ GuidanceManager::Motion GuidanceManager::getMotion(int ntype, int etype, int deg
 
 bool GuidanceManager::update(TopometricPose pose, double conf)
 {
+	DG_TRACE_SCOPE("GuidanceManager::update");
 	//validate parameters
 	if (pose.node_id == 0)
 	{
@@ -376,7 +498,7 @@ bool GuidanceManager::applyPose(TopometricPose  pose)
 
 	//validate Current robot location 
 	ID curnid = pose.node_id;
-	Node* curnode = m_map.findNode(curnid);
+	const Node* curnode = m_map->findNode(curnid);
 	if (curnode == nullptr)
 	{
 		printf("[Error] GuidanceManager::applyPose - curnode == nullptr!\n");
@@ -403,7 +525,7 @@ bool GuidanceManager::applyPose(TopometricPose  pose)
 
 	ExtendedPathElement curEP = getCurExtendedPath(gidx);
 	ID cureid = curnode->edge_ids[pose.edge_idx];
-	Edge* curedge = m_map.findEdge(cureid);
+	const Edge* curedge = m_map->findEdge(cureid);
 
 	//check remain distance
 	double edgedist = curedge->length;
@@ -436,7 +558,6 @@ bool GuidanceManager::applyPose(TopometricPose  pose)
 		//if the robot is on crosswalk, maintain current guide
 		if (curedge->type == Edge::EDGE_CROSSWALK && m_rmdistance > curedge->length/2)
 			m_mvstatus = MoveStatus::ON_EDGE;
-		printf("curedge->type: %d, m_rmdistance: %.2f, curedge->length/2: %.2f\n",(int) curedge->type, m_rmdistance, curedge->length/2);
 	}
 	else
 		m_mvstatus = MoveStatus::ON_EDGE;
@@ -477,7 +598,7 @@ bool GuidanceManager::setGuideStatus(TopometricPose pose, double conf)
 	if (m_arrival && curNId != m_extendedPath.back().cur_node_id)
 	{
 		m_arrival = false;
-		m_extendedPath.clear();
+		clearGuides();
 		m_gstatus = GuideStatus::GUIDE_NOPATH;
 		return false;
 	}
@@ -490,7 +611,7 @@ bool GuidanceManager::setGuideStatus(TopometricPose pose, double conf)
 		return true;
 	}
 
-	Node* curnode = m_map.findNode(curNId);
+	const Node* curnode = m_map->findNode(curNId);
 	ID edgeid = curnode->edge_ids[pose.edge_idx];
 	if (isNodeInPath(curNId) > 0)
 	{//as long as curNId exists on path, everything is ok
@@ -707,7 +828,7 @@ bool GuidanceManager::setArrivalGuide()
 	if (!isForward(m_finalTurn))
 	{
 		ExtendedPathElement lastguide = m_extendedPath.back();
-		Node* dest = m_map.findNode(lastguide.cur_node_id);
+		const Node* dest = m_map->findNode(lastguide.cur_node_id);
 		if (dest == nullptr)
 		{
 			printf("[Error] GuidanceManager::setArrivalGuide - undefined last node: %zu!\n", lastguide.cur_node_id);
@@ -956,40 +1077,39 @@ std::string GuidanceManager::getStringGuidance(Guidance guidance, MoveStatus sta
 
 bool GuidanceManager::isNodeInPath(ID nodeid)
 {
-	for (size_t i = 0; i < m_extendedPath.size(); i++)
-	{
-		if (nodeid == m_extendedPath[i].cur_node_id)
-			return true;
-	}
-	return false;
+	return m_guide_node_index.count(nodeid) > 0;
 }
 
 bool GuidanceManager::isEdgeInPath(ID edgeid)
 {
-	for (size_t i = 0; i < m_extendedPath.size(); i++)
-	{
-		if (edgeid == m_extendedPath[i].cur_edge_id)
-			return true;
-}
- 	return false;
+	return m_guide_edge_index.count(edgeid) > 0;
 }
 
+/** @brief getGuideIdxFromPose searches a few guides forward from the current guide first,
+ *	because the robot mostly stays on the current guide or moves to the next one
+*/
 int GuidanceManager::getGuideIdxFromPose(TopometricPose pose)
 {
 	ID curnodei = pose.node_id;
-	for (size_t i = 0; i < m_extendedPath.size(); i++)
+	int from = std::max(m_guide_idx, 0);
+	int to = std::min(from + m_guide_search_window, (int)m_extendedPath.size());
+	for (int i = from; i < to; i++)
 	{
 		if (m_extendedPath[i].cur_node_id == curnodei)
 		{
-			return (int)i;
+			return i;
 		}
 	}
-	return -1;
+
+	auto found = m_guide_node_index.find(curnodei);
+	if (found == m_guide_node_index.end()) return -1;
+	return found->second;
 }
 
 
 bool GuidanceManager::applyPoseGPS(LatLon gps)
 {
+	DG_TRACE_SCOPE("GuidanceManager::applyPoseGPS");
 	if (gps.lat <= 0 || gps.lon <= 0)
 	{
 		printf("[Error] GuidanceManager::applyPoseGPS]No GPS info!\n");
@@ -1089,7 +1209,7 @@ void GuidanceManager::makeLostValue(double prevconf, double curconf)
 //	return result;
 //
 //}
-int GuidanceManager::getDegree(Node* node1, Node* node2, Node* node3)
+int GuidanceManager::getDegree(const Node* node1, const Node* node2, const Node* node3)
 {
 	double x1 = node1->lon;
 	double y1 = node1->lat;
@@ -1121,17 +1241,17 @@ int GuidanceManager::getDegree(Node* node1, Node* node2, Node* node3)
 
 }
 
-bool GuidanceManager::validatePath(Path& path, Map& map)
+bool GuidanceManager::validatePath(const Path& path, const Map& map)
 {
 	for (size_t i = 0; i < path.pts.size() - 2; i++)
 	{
-		Node* curnode = map.findNode(path.pts[i].node_id);
+		const Node* curnode = map.findNode(path.pts[i].node_id);
 		if (curnode == nullptr)
 		{
 			printf("No Node-%zu found on map!\n", path.pts[i].node_id);
 			return false;
 		}
-		Edge* curedge = map.findEdge(path.pts[i].edge_id);
+		const Edge* curedge = map.findEdge(path.pts[i].edge_id);
 		if (curedge == nullptr)
 		{
 			printf("No Edge-%zu found on map!\n", path.pts[i].edge_id);
@@ -1,6 +1,8 @@
 #ifndef __GUIDANCE__
 #define __GUIDANCE__
 #include "dg_core.hpp"
+#include "utils/metrics.hpp"
+#include <unordered_map>
 
 namespace dg
 {
@@ -164,12 +166,34 @@ namespace dg
 			double past_distance_from_prev_junction = 0;
 			ID next_guide_node_id = 0;
 			ID next_guide_edge_id = 0;
+
+			/** Length of the current EDGE [m] */
+			double cur_edge_length = 0;
 		};
 
 	public:
 		GuidanceManager() { }
 
-		bool initiateNewGuidance(Path& path, Map& map);
+		/**
+		 * Start a new guidance on a shared map snapshot
+		 * @param path A path to guide (it is moved into the manager)
+		 * @param map A snapshot of the map including the path (only its reference is kept, so re-guidance on the same map costs O(path length))
+		 * @return True if successful (false if failed)
+		 */
+		bool initiateNewGuidance(Path path, MapSnapshot map);
+		bool initiateNewGuidance(Path path, Map&& map) { return initiateNewGuidance(std::move(path), std::make_shared<const Map>(std::move(map))); };
+		bool initiateNewGuidance(Path& path, Map& map) { return initiateNewGuidance(Path(path), std::make_shared<const Map>(map)); };
+
+		/**
+		 * Replace the remaining route of the current guidance with a new path (e.g. after rerouting)
+		 * The walked guides and past guidances are kept, and only guides after the splice point are rebuilt,
+		 * so its cost does not depend on the length of the walked route.
+		 * A path which starts off the remaining route is joined from the current guide if its start node is adjacent to it.
+		 * @param path A new path from the current location to the destination
+		 * @param map A snapshot of the map including the path (`nullptr` to use the current map)
+		 * @return True if successful (false if failed)
+		 */
+		bool updateGuidancePath(Path path, MapSnapshot map = nullptr);
 
 		bool update(TopometricPose pose, double confidence);
 		bool applyPoseGPS(LatLon gps);
@@ -178,15 +202,26 @@ namespace dg
 		Guidance getGuidance() const { return m_curguidance; };
 
 	protected:
-		bool validatePath(Path& path, Map& map);
-		int getDegree(Node* node1, Node* node2, Node* node3);
+		bool validatePath(const Path& path, const Map& map);
+		int getDegree(const Node* node1, const Node* node2, const Node* node3);
 
 		Path m_path;
-		Map m_map;
+		MapSnapshot m_map;
 		std::vector <ExtendedPathElement> m_extendedPath;
 		int m_guide_idx = -1;	//starts with -1 because its pointing current guide.
 
+		/** Hash tables from node and edge IDs to their first guide index in m_extendedPath */
+		std::unordered_map<ID, int> m_guide_node_index;
+		std::unordered_map<ID, int> m_guide_edge_index;
+
+		/** The number of guides searched forward from the current guide before looking up the hash tables */
+		int m_guide_search_window = 3;
+
 		bool buildGuides();
+		bool appendGuides(int from_idx);
+		void removeGuides(int from_idx);
+		void buildGuideIndex(int from_idx = 0);
+		void clearGuides();
 		ExtendedPathElement getCurExtendedPath(int idx);
 		Action setActionTurn(ID nid_cur, ID eid_cur, int degree);
 		Action setActionGo(ID nid_next, ID eid_cur, int degree=0);
@@ -267,7 +302,7 @@ namespace dg
 		std::string getStringTurnDist(Action act, int ntype, double dist);
 		std::string getStringGuidance(Guidance guidance, MoveStatus status);
 		int getGuideIdxFromPose(TopometricPose pose);
-		Map getMap() { return m_map; };
+		MapSnapshot getMap() const { return m_map; };
 		MoveStatus getMoveStatus() { return m_mvstatus; };
 		LatLon getPoseGPS() { return m_latlon; };
 
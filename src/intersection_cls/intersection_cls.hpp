@@ -29,6 +29,8 @@ namespace dg
         */
         bool initialize(const char* module_name = "intersection_cls", const char* module_path = "./../src/intersection_cls", const char* class_name = "IntersectionClassifier", const char* func_name_init = "initialize", const char* func_name_apply = "apply")
         {
+            DG_TRACE_SCOPE("IntersectionClassifier::initialize");
+
             dg::Timestamp t1 = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count() / 1000.0;
 
             PyGILState_STATE state;
@@ -66,6 +68,8 @@ namespace dg
         */
         bool apply(cv::Mat image, dg::Timestamp ts)
         {
+            DG_TRACE_SCOPE("IntersectionClassifier::apply");
+
             dg::Timestamp t1 = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count() / 1000.0;
 
             PyGILState_STATE state;
@@ -180,7 +184,7 @@ namespace dg
 
         }
 
-        void write(std::ofstream& stream, int cam_fnumber = -1) const
+        void write(std::ostream& stream, int cam_fnumber = -1) const
         {
             std::string log = cv::format("%.3lf,%d,%s,%d,%.2lf,%.3lf", m_timestamp, cam_fnumber, name(), m_intersect.cls, m_intersect.confidence, m_processing_time);
             stream << log << std::endl;
@@ -0,0 +1,119 @@
+#ifndef __FLAT_ROAD_MAP__
+#define __FLAT_ROAD_MAP__
+
+#include "core/basic_type.hpp"
+#include "localizer/road_map.hpp"
+#include <unordered_map>
+
+namespace dg
+{
+
+/**
+ * @brief Flattened road map
+ *
+ * A <b>flattened road map</b> keeps nodes and edges of a RoadMap in arrays instead of linked lists.
+ * Edges are grouped by their start nodes (CSR layout), so the outgoing edges of node 'n' are from 'm_node_offset[n]' to 'm_node_offset[n + 1] - 1'.
+ * Nodes and edges are referred by their array indices, and each edge keeps its geometry and its reverse edge.
+ * It is the common base of trackers and matchers which evaluate many edges in tight loops.
+ */
+class FlatRoadMap
+{
+public:
+    /**
+     * Get the number of flattened nodes
+     * @return The number of nodes
+     */
+    int countNodes() const { return (int)m_node_id.size(); }
+
+    /**
+     * Get the number of flattened edges
+     * @return The number of edges
+     */
+    int countEdges() const { return (int)m_from.size(); }
+
+protected:
+    /**
+     * Flatten the given map
+     * @param map The road map to flatten
+     * @return True if successful (false if the map has no edge)
+     */
+    bool flatten(const RoadMap& map)
+    {
+        clearFlatMap();
+        std::unordered_map<const RoadMap::Node*, int> node_index;
+        for (auto node = map.getHeadNodeConst(); node != map.getTailNodeConst(); node++)
+        {
+            node_index.insert(std::make_pair(&(*node), (int)m_node_id.size()));
+            m_node_id.push_back(node->data.id);
+        }
+
+        // Flatten edges grouped by their start nodes (CSR layout)
+        m_node_offset.push_back(0);
+        for (auto node = map.getHeadNodeConst(); node != map.getTailNodeConst(); node++)
+        {
+            int edge_idx = 0;
+            int from = node_index[&(*node)];
+            for (auto edge = map.getHeadEdgeConst(node); edge != map.getTailEdgeConst(node); edge++, edge_idx++)
+            {
+                auto to = node_index.find(edge->to);
+                if (to == node_index.end()) continue;
+                double dx = edge->to->data.x - node->data.x, dy = edge->to->data.y - node->data.y;
+                m_edge_idx.push_back(edge_idx);
+                m_from.push_back(from);
+                m_to.push_back(to->second);
+                m_from_x.push_back(node->data.x);
+                m_from_y.push_back(node->data.y);
+                m_dx.push_back(dx);
+                m_dy.push_back(dy);
+                m_len.push_back(sqrt(dx * dx + dy * dy));
+                m_theta.push_back(atan2(dy, dx));
+            }
+            m_node_offset.push_back((int)m_from.size());
+        }
+        if (m_from.empty())
+        {
+            clearFlatMap();
+            return false;
+        }
+
+        // Find reverse edges
+        m_reverse.resize(m_from.size(), -1);
+        for (int e = 0; e < (int)m_from.size(); e++)
+            for (int r = m_node_offset[m_to[e]]; r < m_node_offset[m_to[e] + 1]; r++)
+                if (m_to[r] == m_from[e]) m_reverse[e] = r;
+        return true;
+    }
+
+    /**
+     * Remove the flattened map
+     */
+    void clearFlatMap()
+    {
+        m_node_id.clear();
+        m_node_offset.clear();
+        m_edge_idx.clear();
+        m_from.clear();
+        m_to.clear();
+        m_reverse.clear();
+        m_from_x.clear();
+        m_from_y.clear();
+        m_dx.clear();
+        m_dy.clear();
+        m_len.clear();
+        m_theta.clear();
+    }
+
+    /** The flattened nodes and their edge offsets */
+    std::vector<ID> m_node_id;
+    std::vector<int> m_node_offset;
+
+    /** The flattened edges (the edge index at its start node, node indices, and the index of its reverse edge; -1 if none) */
+    std::vector<int> m_edge_idx, m_from, m_to, m_reverse;
+
+    /** The geometry of the flattened edges (the start position, displacement, length, and direction) */
+    std::vector<double> m_from_x, m_from_y, m_dx, m_dy, m_len, m_theta;
+}; // End of 'FlatRoadMap'
+
+} // End of 'dg'
+
+#endif // End of '__FLAT_ROAD_MAP__'
@@ -0,0 +1,267 @@
+#ifndef __GPS_DEAD_ZONE__
+#define __GPS_DEAD_ZONE__
+
+#include "core/basic_type.hpp"
+#include <vector>
+#include <unordered_map>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+
+#define GPS_DEAD_ZONE_BUF_SIZE          (65536)
+
+namespace dg
+{
+
+/**
+ * @brief GPS dead-zone map
+ *
+ * A <b>GPS dead-zone map</b> stores polygonal zones where GPS positions are inaccurate (e.g. building canyons) with their noise levels.
+ * Zones are registered to a uniform grid by their bounding boxes, so a query tests only zones in a single grid cell.
+ * A zone file contains a zone per line as <i>ZONE, Noise [m], X1 [m], Y1 [m], X2 [m], Y2 [m], ...</i>, which is written in the same metric coordinate as a road map file.
+ */
+class GPSDeadZoneMap
+{
+public:
+    /**
+     * The default constructor
+     * @param cell_size The size of grid cells [m]
+     */
+    GPSDeadZoneMap(double cell_size = 50)
+    {
+        m_cell_size = cell_size;
+    }
+
+    /**
+     * Add a polygonal zone
+     * @param polygon The vertices of the zone
+     * @param noise The GPS noise in the zone [m] (non-positive to use the default noise of the user)
+     * @return True if successful (false if the polygon has less than three vertices)
+     */
+    bool add(const std::vector<Point2>& polygon, double noise = -1)
+    {
+        if (polygon.size() < 3) return false;
+
+        Zone zone;
+        zone.polygon = polygon;
+        zone.noise = noise;
+        zone.min = polygon.front();
+        zone.max = polygon.front();
+        for (auto pt = polygon.begin(); pt != polygon.end(); pt++)
+        {
+            zone.min.x = std::min(zone.min.x, pt->x);
+            zone.min.y = std::min(zone.min.y, pt->y);
+            zone.max.x = std::max(zone.max.x, pt->x);
+            zone.max.y = std::max(zone.max.y, pt->y);
+        }
+
+        // Register the zone to all cells overlapped with its bounding box
+        int index = (int)m_zones.size();
+        m_zones.push_back(zone);
+        int64_t cx1 = toCell(zone.min.x), cy1 = toCell(zone.min.y);
+        int64_t cx2 = toCell(zone.max.x), cy2 = toCell(zone.max.y);
+        for (int64_t cy = cy1; cy <= cy2; cy++)
+            for (int64_t cx = cx1; cx <= cx2; cx++)
+                m_grid[toKey(cx, cy)].push_back(index);
+        return true;
+    }
+
+    /**
+     * Add a rectangular zone
+     * @param p1 A corner of the zone
+     * @param p2 The opposite corner of the zone
+     * @param noise The GPS noise in the zone [m] (non-positive to use the default noise of the user)
+     * @return True if successful (false if failed)
+     */
+    bool addRect(const Point2& p1, const Point2& p2, double noise = -1)
+    {
+        std::vector<Point2> polygon = { p1, Point2(p2.x, p1.y), p2, Point2(p1.x, p2.y) };
+        return add(polygon, noise);
+    }
+
+    /**
+     * Find a zone which contains the given point
+     * @param p The point to query
+     * @param noise The GPS noise of the found zone [m] (the largest one if zones are overlapped; non-positive if the zone has no its own noise)
+     * @return The index of the found zone (-1 if the point is not in any zone)
+     */
+    int find(const Point2& p, double* noise = nullptr) const
+    {
+        auto cell = m_grid.find(toKey(toCell(p.x), toCell(p.y)));
+        if (cell == m_grid.end()) return -1;
+
+        int found = -1;
+        for (auto index = cell->second.begin(); index != cell->second.end(); index++)
+        {
+            const Zone& zone = m_zones[*index];
+            if (p.x < zone.min.x || p.y < zone.min.y || p.x > zone.max.x || p.y > zone.max.y) continue;
+            if (found >= 0 && zone.noise <= m_zones[found].noise) continue;
+            if (isInside(zone.polygon, p)) found = *index;
+        }
+        if (found >= 0 && noise != nullptr) *noise = m_zones[found].noise;
+        return found;
+    }
+
+    /**
+     * Check whether the given point is in the given polygon or not (even-odd rule)
+     * @param polygon The vertices of the polygon
+     * @param p The point to check
+     * @return True if the point is inside (false if not)
+     */
+    static bool isInside(const std::vector<Point2>& polygon, const Point2& p)
+    {
+        bool inside = false;
+        for (size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++)
+        {
+            const Point2& a = polygon[i];
+            const Point2& b = polygon[j];
+            if ((a.y > p.y) != (b.y > p.y) && p.x < a.x + (p.y - a.y) * (b.x - a.x) / (b.y - a.y))
+                inside = !inside;
+        }
+        return inside;
+    }
+
+    /**
+     * Remove all zones
+     */
+    void clear()
+    {
+        m_zones.clear();
+        m_grid.clear();
+    }
+
+    /**
+     * Check whether the map has no zone or not
+     * @return True if the map has no zone (false if not)
+     */
+    bool empty() const { return m_zones.empty(); }
+
+    /**
+     * Get the number of zones
+     * @return The number of zones
+     */
+    size_t size() const { return m_zones.size(); }
+
+    /**
+     * Get the vertices of a zone
+     * @param index The index of the zone
+     * @return The vertices of the zone
+     */
+    const std::vector<Point2>& getPolygon(int index) const { return m_zones[index].polygon; }
+
+    /**
+     * Get the GPS noise of a zone
+     * @param index The index of the zone
+     * @return The GPS noise of the zone [m] (non-positive if the zone has no its own noise)
+     */
+    double getNoise(int index) const { return m_zones[index].noise; }
+
+    /**
+     * Change the size of grid cells (all zones are registered again)
+     * @param cell_size The size of grid cells [m]
+     * @return True if successful (false if the size is not positive)
+     */
+    bool setCellSize(double cell_size)
+    {
+        if (cell_size <= 0) return false;
+        std::vector<Zone> zones;
+        zones.swap(m_zones);
+        clear();
+        m_cell_size = cell_size;
+        for (auto zone = zones.begin(); zone != zones.end(); zone++)
+            add(zone->polygon, zone->noise);
+        return true;
+    }
+
+    /**
+     * Read zones from the given file (the previous zones are removed)
+     * @param filename The filename to read zones
+     * @return True if successful (false if failed)
+     */
+    bool load(const char* filename)
+    {
+        clear();
+
+        FILE* fid = fopen(filename, "rt");
+        if (fid == nullptr) return false;
+
+        std::vector<char> buffer(GPS_DEAD_ZONE_BUF_SIZE);
+        while (!feof(fid))
+        {
+            if (fgets(buffer.data(), GPS_DEAD_ZONE_BUF_SIZE, fid) == nullptr) break;
+            char* token;
+            if ((token = strtok(buffer.data(), ",")) == nullptr) continue;
+            if (token[0] != 'Z' && token[0] != 'z') continue;
+
+            // Read a zone
+            if ((token = strtok(nullptr, ",")) == nullptr) goto GPSDEADZONE_LOAD_FAIL;
+            double noise = strtod(token, nullptr);
+            std::vector<Point2> polygon;
+            while ((token = strtok(nullptr, ",")) != nullptr)
+            {
+                double x = strtod(token, nullptr);
+                if ((token = strtok(nullptr, ",")) == nullptr) goto GPSDEADZONE_LOAD_FAIL;
+                double y = strtod(token, nullptr);
+                polygon.push_back(Point2(x, y));
+            }
+            if (!add(polygon, noise)) goto GPSDEADZONE_LOAD_FAIL;
+        }
+        fclose(fid);
+        return true;
+
+    GPSDEADZONE_LOAD_FAIL:
+        clear();
+        fclose(fid);
+        return false;
+    }
+
+    /**
+     * Write zones to the given file
+     * @param filename The filename to write zones
+     * @return True if successful (false if failed)
+     */
+    bool save(const char* filename) const
+    {
+        FILE* fid = fopen(filename, "wt");
+        if (fid == nullptr) return false;
+        fprintf(fid, "# ZONE, Noise [m], X1 [m], Y1 [m], X2 [m], Y2 [m], ...\n");
+        for (auto zone = m_zones.begin(); zone != m_zones.end(); zone++)
+        {
+            fprintf(fid, "ZONE, %lf", zone->noise);
+            for (auto pt = zone->polygon.begin(); pt != zone->polygon.end(); pt++)
+                fprintf(fid, ", %lf, %lf", pt->x, pt->y);
+            fprintf(fid, "\n");
+        }
+        fclose(fid);
+        return true;
+    }
+
+protected:
+    /** A zone with its bounding box */
+    struct Zone
+    {
+        std::vector<Point2> polygon;
+        double noise;
+        Point2 min, max;
+    };
+
+    int64_t toCell(double v) const { return (int64_t)floor(v / m_cell_size); }
+
+    static int64_t toKey(int64_t cx, int64_t cy) { return (int64_t)(((uint64_t)cx << 32) ^ ((uint64_t)cy & 0xFFFFFFFF)); }
+
+    /** The size of grid cells [m] */
+    double m_cell_size;
+
+    /** The registered zones */
+    std::vector<Zone> m_zones;
+
+    /** The grid cells with indices of overlapped zones */
+    std::unordered_map<int64_t, std::vector<int>> m_grid;
+}; // End of 'GPSDeadZoneMap'
+
+} // End of 'dg'
+
+#endif // End of '__GPS_DEAD_ZONE__'
@@ -0,0 +1,185 @@
+#ifndef __IMU_PREINTEGRATION__
+#define __IMU_PREINTEGRATION__
+
+#include <cmath>
+
+namespace dg
+{
+
+/**
+ * @brief IMU preintegration buffer
+ *
+ * An <b>IMU preintegration buffer</b> accumulates high-rate gyroscope and accelerometer samples into a single motion delta,
+ * which consists of the accumulated rotation, velocity change, and traveled distance by acceleration, with their covariance.
+ * Each sample is held until the next sample (zero-order hold), so the delta covers the interval from the last reset to the last sample or integration.
+ * The delta does not depend on the initial heading and velocity, so a filter can apply it as a single prediction.
+ */
+class IMUPreintegration
+{
+public:
+    /**
+     * The default constructor
+     * @param noise_gyro The noise density of the gyroscope [rad/s/sqrt(Hz)]
+     * @param noise_acc The noise density of the accelerometer [m/s^2/sqrt(Hz)]
+     */
+    IMUPreintegration(double noise_gyro = 0.01, double noise_acc = 0.1)
+    {
+        setNoise(noise_gyro, noise_acc);
+        m_time_start = -1;
+        m_time = -1;
+        m_gyro = 0;
+        m_acc = 0;
+        reset(-1);
+    }
+
+    /**
+     * Set noise densities of sensors
+     * @param noise_gyro The noise density of the gyroscope [rad/s/sqrt(Hz)]
+     * @param noise_acc The noise density of the accelerometer [m/s^2/sqrt(Hz)]
+     */
+    void setNoise(double noise_gyro, double noise_acc)
+    {
+        m_var_gyro = noise_gyro * noise_gyro;
+        m_var_acc = noise_acc * noise_acc;
+    }
+
+    /**
+     * Clear the accumulated delta and restart it at the given time (the last sample is kept for the zero-order hold)
+     * @param time The start time of the next delta (-1 to start at the next sample)
+     */
+    void reset(double time)
+    {
+        m_time_start = time;
+        m_time = time;
+        m_rotation = 0;
+        m_velocity = 0;
+        m_distance = 0;
+        for (int i = 0; i < 9; i++) m_cov[i] = 0;
+    }
+
+    /**
+     * Add a sample
+     * @param gyro The angular velocity around the vertical axis [rad/s]
+     * @param acc The forward acceleration without gravity [m/s^2]
+     * @param time The timestamp of the sample
+     * @return True if successful (false if the sample is older than the accumulated delta)
+     */
+    bool add(double gyro, double acc, double time)
+    {
+        if (m_time < 0)
+        {
+            m_time_start = time;
+            m_time = time;
+        }
+        if (time < m_time) return false;
+        integrate(time);
+        m_gyro = gyro;
+        m_acc = acc;
+        return true;
+    }
+
+    /**
+     * Extend the accumulated delta to the given time with the last sample
+     * @param time The end time of the delta
+     */
+    void integrate(double time)
+    {
+        double dt = time - m_time;
+        if (m_time < 0 || dt <= 0) return;
+
+        // Propagate the covariance of [ distance, rotation, velocity ] (P = A * P * A^T + B * Q * B^T)
+        double* P = m_cov;
+        double p00 = P[0] + dt * (P[2] + P[6]) + dt * dt * P[8];
+        double p01 = P[1] + dt * P[7];
+        double p02 = P[2] + dt * P[8];
+        double qa = m_var_acc * dt, qg = m_var_gyro * dt;
+        P[0] = p00 + qa * dt * dt / 4;
+        P[1] = P[3] = p01;
+        P[2] = P[6] = p02 + qa * dt / 2;
+        P[4] += qg;
+        P[8] += qa;
+
+        // Accumulate the delta
+        m_distance += m_velocity * dt + m_acc * dt * dt / 2;
+        m_velocity += m_acc * dt;
+        m_rotation += m_gyro * dt;
+        m_time = time;
+    }
+
+    /**
+     * Check whether the delta is empty or not
+     * @return True if the delta covers no time (false if not)
+     */
+    bool empty() const { return m_time_start < 0 || m_time <= m_time_start; }
+
+    /**
+     * Get the start time of the delta
+     * @return The start time (-1 if no sample)
+     */
+    double getStartTime() const { return m_time_start; }
+
+    /**
+     * Get the end time of the delta
+     * @return The end time (-1 if no sample)
+     */
+    double getEndTime() const { return m_time; }
+
+    /**
+     * Get the accumulated rotation
+     * @return The rotation [rad]
+     */
+    double getRotation() const { return m_rotation; }
+
+    /**
+     * Get the accumulated velocity change
+     * @return The velocity change [m/s]
+     */
+    double getVelocity() const { return m_velocity; }
+
+    /**
+     * Get the traveled distance by acceleration (excluding the initial velocity)
+     * @return The distance [m]
+     */
+    double getDistance() const { return m_distance; }
+
+    /**
+     * Get the covariance of the delta
+     * @return The 3x3 covariance of [ distance, rotation, velocity ] in row-major order
+     */
+    const double* getCovariance() const { return m_cov; }
+
+protected:
+    /** The variance density of the gyroscope */
+    double m_var_gyro;
+
+    /** The variance density of the accelerometer */
+    double m_var_acc;
+
+    /** The start time of the delta */
+    double m_time_start;
+
+    /** The end time of the delta */
+    double m_time;
+
+    /** The last angular velocity */
+    double m_gyro;
+
+    /** The last forward acceleration */
+    double m_acc;
+
+    /** The accumulated rotation */
+    double m_rotation;
+
+    /** The accumulated velocity change */
+    double m_velocity;
+
+    /** The traveled distance by acceleration */
+    double m_distance;
+
+    /** The covariance of [ distance, rotation, velocity ] */
+    double m_cov[9];
+}; // End of 'IMUPreintegration'
+
+} // End of 'dg'
+
+#endif // End of '__IMU_PREINTEGRATION__'
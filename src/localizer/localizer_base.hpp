@@ -3,7 +3,9 @@
 
 #include "core/map.hpp"
 #include "localizer/localizer.hpp"
+#include "localizer/topo_beam.hpp"
 #include "utils/opencx.hpp"
+#include "utils/metrics.hpp"
 #include <set>
 
 namespace dg
@@ -12,16 +14,18 @@ namespace dg
 class BaseLocalizer : public Localizer, public TopometricLocalizer, public UTMConverter
 {
 public:
-    virtual bool loadMap(Map& map, bool auto_cost = false)
+    virtual bool loadMap(const Map& map, bool auto_cost = false)
     {
         cv::AutoLock lock(m_mutex);
         m_map = cvtMap2RoadMap(map, *this, auto_cost);
+        m_topo_beam.clear();
         return true;
     }
 
     virtual bool loadMap(const RoadMap& map)
     {
         cv::AutoLock lock(m_mutex);
+        m_topo_beam.clear();
         return map.copyTo(&m_map);
     }
 
@@ -63,6 +67,7 @@ public:
 
     TopometricPose findNearestTopoPose(const Pose2& pose_m, double turn_weight = 0, double search_range = -1, const Pose2& search_pt = Pose2())
     {
+        DG_TRACE_SCOPE("BaseLocalizer::findNearestTopoPose");
         cv::AutoLock lock(m_mutex);
 
         // Find the nearest edge
@@ -114,6 +119,7 @@ public:
 
     TopometricPose trackTopoPose(const TopometricPose& topo_from, const Pose2& pose_m, double turn_weight = 0, int extend_depth = 1)
     {
+        DG_TRACE_SCOPE("BaseLocalizer::trackTopoPose");
         cv::AutoLock lock(m_mutex);
 
         // Check 'pose_m' on the current edge
@@ -147,7 +153,7 @@ public:
                 if (dist2.first < min_dist2.first)
                 {
                     min_dist2 = dist2;
-                    min_node_id = node_goal->data.id;
+                    min_node_id = node_pick->data.id;
                     min_edge_idx = edge_idx;
                 }
                 if (node_visit.find(to->data.id) == node_visit.end())
@@ -169,7 +175,46 @@ public:
         return pose_t;
     }
 
-    static RoadMap cvtMap2RoadMap(Map& map, const UTMConverter& converter, bool auto_cost = true)
+    /**
+     * Track a topometric pose with multiple hypotheses
+     * @param pose_m The metric pose
+     * @param travel The traveled distance since the last tracking [m]
+     * @param turn_weight The weight of heading difference
+     * @param drift_radius The distance to the best hypothesis to restart tracking [m]
+     * @return The topometric pose of the best hypothesis (an empty pose if failed)
+     */
+    TopometricPose trackTopoPoseBeam(const Pose2& pose_m, double travel, double turn_weight = 0, double drift_radius = 50)
+    {
+        DG_TRACE_SCOPE("BaseLocalizer::trackTopoPoseBeam");
+        cv::AutoLock lock(m_mutex);
+
+        if (!m_topo_beam.isBuilt() && !m_topo_beam.build(m_map)) return TopometricPose();
+        if (m_topo_beam.empty() || !m_topo_beam.update(pose_m, travel, turn_weight) || m_topo_beam.getBestOffset() > drift_radius)
+            m_topo_beam.initialize(pose_m, turn_weight);
+        return m_topo_beam.getBest();
+    }
+
+    /**
+     * Get the current hypotheses of topometric tracking
+     * @param poses The topometric poses of the hypotheses (sorted from the best)
+     * @param confidences The normalized confidences of the hypotheses
+     * @return True if successful (false if there is no hypothesis)
+     */
+    bool getTopoHypotheses(std::vector<TopometricPose>& poses, std::vector<double>& confidences) const
+    {
+        cv::AutoLock lock(m_mutex);
+        poses.clear();
+        confidences.clear();
+        const std::vector<TopometricBeam::Hypothesis>& beam = m_topo_beam.getHypotheses();
+        for (auto h = beam.begin(); h != beam.end(); h++)
+        {
+            poses.push_back(h->pose);
+            confidences.push_back(h->confidence);
+        }
+        return !poses.empty();
+    }
+
+    static RoadMap cvtMap2RoadMap(const Map& map, const UTMConverter& converter, bool auto_cost = true)
     {
         RoadMap road_map;
 
@@ -277,6 +322,8 @@ public:
 protected:
     RoadMap m_map;
 
+    TopometricBeam m_topo_beam;
+
     mutable cv::Mutex m_mutex;
 }; // End of 'BaseLocalizer'
 
@@ -2,6 +2,8 @@
 #define __EKF_LOCALIZER__
 
 #include "localizer/localizer_base.hpp"
+#include "localizer/imu_preintegration.hpp"
+#include "localizer/gps_dead_zone.hpp"
 
 namespace dg
 {
@@ -20,12 +22,18 @@ public:
         m_noise_gps = m_noise_gps_normal;
         m_noise_loc_clue = cv::Mat::eye(4, 4, CV_64F);
         m_offset_gps = cv::Vec2d(0, 0);
+        m_noise_imu = cv::Vec2d(0.01, 0.1);
         m_norm_conf_a = 1;
         m_norm_conf_b = 2;
 
         // Internal variables
         m_time_last_update = -1;
         m_time_last_delta = -1;
+        m_imu_delta.setNoise(m_noise_imu(0), m_noise_imu(1));
+        m_smoother_count = 0;
+        m_smoother_head = 0;
+        m_smoother_time = 0;
+        setParamSmootherLag(10);
 
         initialize(cv::Mat::zeros(5, 1, CV_64F), cv::Mat::eye(5, 5, CV_64F));
     }
@@ -40,7 +48,25 @@ public:
         CX_LOAD_PARAM_COUNT(fn, "noise_gps_deadzone", m_noise_gps_deadzone, n_read);
         CX_LOAD_PARAM_COUNT(fn, "noise_loc_clue", m_noise_loc_clue, n_read);
         CX_LOAD_PARAM_COUNT(fn, "offset_gps", m_offset_gps, n_read);
-        CX_LOAD_PARAM_COUNT(fn, "gps_dead_zones", m_gps_dead_zones, n_read);
+        std::vector<cv::Rect2d> gps_dead_zones;
+        std::string gps_dead_zone_file;
+        int n_zone_read = 0;
+        CX_LOAD_PARAM_COUNT(fn, "gps_dead_zones", gps_dead_zones, n_zone_read);
+        CX_LOAD_PARAM_COUNT(fn, "gps_dead_zone_file", gps_dead_zone_file, n_zone_read);
+        if (n_zone_read > 0)
+        {
+            // The given zones replace the previous ones (the file first, and then the rectangles)
+            m_gps_dead_zones.clear();
+            if (!gps_dead_zone_file.empty()) m_gps_dead_zones.load(gps_dead_zone_file.c_str());
+            for (auto zone = gps_dead_zones.begin(); zone != gps_dead_zones.end(); zone++)
+                m_gps_dead_zones.addRect(zone->tl(), zone->br());
+            n_read += n_zone_read;
+        }
+        CX_LOAD_PARAM_COUNT(fn, "noise_imu", m_noise_imu, n_read);
+        m_imu_delta.setNoise(m_noise_imu(0), m_noise_imu(1));
+        int smoother_lag = (int)m_smoother_steps.size() - 1;
+        CX_LOAD_PARAM_COUNT(fn, "smoother_lag", smoother_lag, n_read);
+        setParamSmootherLag(smoother_lag);
         return n_read;
     }
 
@@ -68,13 +94,79 @@ public:
         return true;
     }
 
-    bool addParamGPSDeadZone(const dg::Point2& p1, dg::Point2& p2)
+    bool setParamIMUNoise(double gyro, double acc)
+    {
+        cv::AutoLock lock(m_mutex);
+        m_noise_imu = cv::Vec2d(gyro, acc);
+        m_imu_delta.setNoise(gyro, acc);
+        return true;
+    }
+
+    /**
+     * Set the length of the fixed-lag smoothing window
+     * @param lag The number of past filter steps to smooth (0 to disable smoothing)
+     * @return True if successful (false if failed)
+     */
+    bool setParamSmootherLag(int lag)
     {
         cv::AutoLock lock(m_mutex);
-        m_gps_dead_zones.push_back(cv::Rect2d(p1, p2));
+        if (lag < 0) return false;
+        m_smoother_steps.resize(lag + 1);
+        for (auto step = m_smoother_steps.begin(); step != m_smoother_steps.end(); step++)
+        {
+            step->state_post.create(5, 1, CV_64F);
+            step->cov_post.create(5, 5, CV_64F);
+            step->state_prior.create(5, 1, CV_64F);
+            step->cov_prior.create(5, 5, CV_64F);
+            step->transit.create(5, 5, CV_64F);
+        }
+        resetSmoother();
         return true;
     }
 
+    /**
+     * Add a rectangular GPS dead zone
+     * @param p1 A corner of the zone
+     * @param p2 The opposite corner of the zone
+     * @param noise The GPS noise in the zone [m] (non-positive to use 'noise_gps_deadzone')
+     * @return True if successful (false if failed)
+     */
+    bool addParamGPSDeadZone(const dg::Point2& p1, const dg::Point2& p2, double noise = -1)
+    {
+        cv::AutoLock lock(m_mutex);
+        return m_gps_dead_zones.addRect(p1, p2, noise);
+    }
+
+    /**
+     * Add a polygonal GPS dead zone
+     * @param polygon The vertices of the zone
+     * @param noise The GPS noise in the zone [m] (non-positive to use 'noise_gps_deadzone')
+     * @return True if successful (false if failed)
+     */
+    bool addParamGPSDeadZone(const std::vector<dg::Point2>& polygon, double noise = -1)
+    {
+        cv::AutoLock lock(m_mutex);
+        return m_gps_dead_zones.add(polygon, noise);
+    }
+
+    /**
+     * Read GPS dead zones from the given file (the previous zones are removed)
+     * @param filename The filename to read zones (e.g. a zone file alongside the map file)
+     * @return True if successful (false if failed)
+     * @see GPSDeadZoneMap
+     */
+    bool loadGPSDeadZones(const char* filename)
+    {
+        cv::AutoLock lock(m_mutex);
+        return m_gps_dead_zones.load(filename);
+    }
+
+    /**
+     * Get the registered GPS dead zones
+     * @return The GPS dead-zone map
+     */
+    const GPSDeadZoneMap& getGPSDeadZones() const { return m_gps_dead_zones; }
+
     virtual Pose2 getPose()
     {
         cv::AutoLock lock(m_mutex);
@@ -97,6 +189,141 @@ public:
         return findNearestTopoPose(getPose());
     }
 
+    /**
+     * Get smoothed poses in the fixed-lag window
+     * The filtered states of the recent steps are smoothed by the Rauch-Tung-Striebel smoother, whose cost is bounded by the window length.
+     * @param poses The smoothed poses from the oldest to the latest (the latest one is the same with the filtered pose)
+     * @param times The timestamps of the smoothed poses
+     * @return True if successful (false if there is no filtered state)
+     */
+    virtual bool getPoseSmoothed(std::vector<Pose2>& poses, std::vector<Timestamp>& times)
+    {
+        DG_TRACE_SCOPE("EKFLocalizer::getPoseSmoothed");
+        cv::AutoLock lock(m_mutex);
+        poses.clear();
+        times.clear();
+        if (m_smoother_count <= 0) return false;
+        auto tick = std::chrono::steady_clock::now();
+
+        // Smooth the states backward from the latest one
+        poses.resize(m_smoother_count);
+        times.resize(m_smoother_count);
+        SmootherStep& last = getSmootherStep(m_smoother_count - 1);
+        last.state_post.copyTo(m_smooth_state);
+        last.cov_post.copyTo(m_smooth_cov);
+        for (int k = m_smoother_count - 1; k >= 0; k--)
+        {
+            SmootherStep& step = getSmootherStep(k);
+            if (k < m_smoother_count - 1)
+            {
+                SmootherStep& next = getSmootherStep(k + 1);
+                cv::invert(next.cov_prior, m_smooth_inv, cv::DECOMP_SVD);
+                m_smooth_gain = step.cov_post * next.transit.t() * m_smooth_inv;
+                m_smooth_diff = m_smooth_state - next.state_prior;
+                m_smooth_diff.at<double>(2) = cx::trimRad(m_smooth_diff.at<double>(2));
+                m_smooth_state = step.state_post + m_smooth_gain * m_smooth_diff;
+                m_smooth_cov = step.cov_post + m_smooth_gain * (m_smooth_cov - next.cov_prior) * m_smooth_gain.t();
+            }
+            poses[k] = Pose2(m_smooth_state.at<double>(0), m_smooth_state.at<double>(1), cx::trimRad(m_smooth_state.at<double>(2)));
+            times[k] = step.time;
+        }
+        m_smoother_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - tick).count();
+        return true;
+    }
+
+    /**
+     * Get the computing time of the last smoothing
+     * @return The computing time [sec]
+     */
+    double getSmootherTime() const
+    {
+        cv::AutoLock lock(m_mutex);
+        return m_smoother_time;
+    }
+
+    using cx::EKF::initialize;
+
+    /**
+     * Initialize the state variable and covariance (the smoothing window is emptied)
+     * @param state_vec The given state variable
+     * @param state_cov The given state covariance
+     * @return True if successful (false if failed)
+     */
+    virtual bool initialize(cv::InputArray state_vec, cv::InputArray state_cov = cv::noArray())
+    {
+        cv::AutoLock lock(m_mutex);
+        resetSmoother();
+        return cx::EKF::initialize(state_vec, state_cov);
+    }
+
+    /**
+     * Assign the state variable (the smoothing window is emptied)
+     * @param state The given state variable
+     * @return True if successful (false if failed)
+     */
+    bool setState(cv::InputArray state)
+    {
+        cv::AutoLock lock(m_mutex);
+        resetSmoother();
+        return cx::EKF::setState(state);
+    }
+
+    virtual bool loadMap(const Map& map, bool auto_cost = false)
+    {
+        cv::AutoLock lock(m_mutex);
+        resetSmoother();
+        return BaseLocalizer::loadMap(map, auto_cost);
+    }
+
+    virtual bool loadMap(const RoadMap& map)
+    {
+        cv::AutoLock lock(m_mutex);
+        resetSmoother();
+        return BaseLocalizer::loadMap(map);
+    }
+
+    virtual bool predict(cv::InputArray control)
+    {
+        if (m_smoother_steps.size() <= 1) return cx::EKF::predict(control);
+        cv::Mat u = control.getMat();
+        if (u.rows < u.cols) u = u.t();
+
+        // Keep the current state as the first step of the window
+        if (m_smoother_count <= 0)
+        {
+            SmootherStep& first = pushSmootherStep(m_time_last_update);
+            m_state_vec.copyTo(first.state_post);
+            m_state_cov.copyTo(first.cov_post);
+        }
+        double time = getSmootherStep(m_smoother_count - 1).time + u.at<double>(0);
+
+        // Predict the state (same with 'cx::EKF::predict' but keeping its Jacobian)
+        cv::Mat F, Q;
+        m_state_vec = transitFunc(m_state_vec, u, F, Q);
+        m_state_cov = F * m_state_cov * F.t() + Q;
+        m_state_cov = 0.5 * m_state_cov + 0.5 * m_state_cov.t();
+
+        SmootherStep& step = pushSmootherStep(time);
+        m_state_vec.copyTo(step.state_prior);
+        m_state_cov.copyTo(step.cov_prior);
+        m_state_vec.copyTo(step.state_post);
+        m_state_cov.copyTo(step.cov_post);
+        F.copyTo(step.transit);
+        return true;
+    }
+
+    virtual bool correct(cv::InputArray measure)
+    {
+        if (!cx::EKF::correct(measure)) return false;
+        if (m_smoother_count > 0)
+        {
+            SmootherStep& step = getSmootherStep(m_smoother_count - 1);
+            m_state_vec.copyTo(step.state_post);
+            m_state_cov.copyTo(step.cov_post);
+        }
+        return true;
+    }
+
     virtual double getPoseConfidence()
     {
         cv::AutoLock lock(m_mutex);
@@ -107,12 +334,14 @@ public:
 
     virtual bool applyOdometry(const Pose2& pose_curr, const Pose2& pose_prev, Timestamp time_curr = -1, Timestamp time_prev = -1, double confidence = -1)
     {
+        DG_TRACE_SCOPE("EKFLocalizer::applyOdometry");
         double dt = time_curr - time_prev;
         if (dt > DBL_EPSILON)
         {
             double dx = pose_curr.x - pose_prev.x, dy = pose_curr.y - pose_prev.y;
             double v = sqrt(dx * dx + dy * dy) / dt, w = cx::trimRad(pose_curr.theta - pose_prev.theta) / dt;
             cv::AutoLock lock(m_mutex);
+            applyIMUDelta(time_curr);
             double interval = time_curr - m_time_last_update;
             if (interval > DBL_EPSILON && predict(cv::Vec3d(interval, v, w)))
             {
@@ -126,12 +355,14 @@ public:
 
     virtual bool applyOdometry(const Polar2& delta, Timestamp time = -1, double confidence = -1)
     {
+        DG_TRACE_SCOPE("EKFLocalizer::applyOdometry");
         double dt = 0;
         cv::AutoLock lock(m_mutex);
         if (m_time_last_delta > 0) dt = time - m_time_last_delta;
         m_time_last_delta = time;
         if (dt > DBL_EPSILON)
         {
+            applyIMUDelta(time);
             double interval = time - m_time_last_update;
             if (interval > DBL_EPSILON && predict(cv::Vec3d(interval, delta.lin / dt, delta.ang / dt)))
             {
@@ -145,11 +376,13 @@ public:
 
     virtual bool applyOdometry(double theta_curr, double theta_prev, Timestamp time_curr = -1, Timestamp time_prev = -1, double confidence = -1)
     {
+        DG_TRACE_SCOPE("EKFLocalizer::applyOdometry");
         double dt = time_curr - time_prev;
         if (dt > DBL_EPSILON)
         {
             double w = cx::trimRad(theta_curr - theta_prev) / dt;
             cv::AutoLock lock(m_mutex);
+            applyIMUDelta(time_curr);
             double interval = time_curr - m_time_last_update;
             if (interval > DBL_EPSILON && predict(cv::Vec2d(interval, w)))
             {
@@ -161,6 +394,23 @@ public:
         return false;
     }
 
+    /**
+     * Apply an IMU sample
+     * The sample is accumulated into a preintegrated delta, which is applied as a single prediction before the next odometry, position, or clue.
+     * Odometry only predicts the interval after the applied delta, so the same motion is not counted twice.
+     * @param angvel The angular velocity around the vertical axis [rad/s]
+     * @param linacc The forward acceleration without gravity [m/s^2] (0 if unknown)
+     * @param time The timestamp of the sample
+     * @param confidence The confidence of the sample (not used)
+     * @return True if successful (false if failed)
+     */
+    virtual bool applyIMU(double angvel, double linacc = 0, Timestamp time = -1, double confidence = -1)
+    {
+        cv::AutoLock lock(m_mutex);
+        if (m_imu_delta.getEndTime() < 0 && m_time_last_update > 0 && time > m_time_last_update) m_imu_delta.reset(m_time_last_update);
+        return m_imu_delta.add(angvel, linacc, time);
+    }
+
     virtual bool applyPose(const Pose2& pose, Timestamp time = -1, double confidence = -1)
     {
         cv::AutoLock lock(m_mutex);
@@ -170,22 +420,17 @@ public:
 
     virtual bool applyPosition(const Point2& xy, Timestamp time = -1, double confidence = -1)
     {
+        DG_TRACE_SCOPE("EKFLocalizer::applyPosition");
         cv::AutoLock lock(m_mutex);
+        applyIMUDelta(time);
         double interval = 0;
         if (m_time_last_update > 0) interval = time - m_time_last_update;
         if (interval > m_threshold_time) predict(interval);
 
-        bool is_normal = true;
-        for (auto zone = m_gps_dead_zones.begin(); zone != m_gps_dead_zones.end(); zone++)
-        {
-            if (xy.x > zone->x && xy.y > zone->y && xy.x < zone->br().x && xy.y < zone->br().y)
-            {
-                is_normal = false;
-                m_noise_gps = m_noise_gps_deadzone;
-                break;
-            }
-        }
-        if (is_normal) m_noise_gps = m_noise_gps_normal;
+        double zone_noise = -1;
+        if (m_gps_dead_zones.find(xy, &zone_noise) < 0) m_noise_gps = m_noise_gps_normal;
+        else if (zone_noise > 0) m_noise_gps = (cv::Mat_<double>(2, 2) << zone_noise * zone_noise, 0, 0, zone_noise * zone_noise);
+        else m_noise_gps = m_noise_gps_deadzone;
         if (correct(cv::Vec2d(xy.x, xy.y)))
         {
             m_state_vec.at<double>(2) = cx::trimRad(m_state_vec.at<double>(2));
@@ -210,10 +455,12 @@ public:
 
     virtual bool applyLocClue(ID node_id, const Polar2& obs = Polar2(-1, CV_PI), Timestamp time = -1, double confidence = -1)
     {
+        DG_TRACE_SCOPE("EKFLocalizer::applyLocClue");
         cv::AutoLock lock(m_mutex);
         RoadMap::Node* node = m_map.getNode(Point2ID(node_id));
         if (node == nullptr) return false;
 
+        applyIMUDelta(time);
         double interval = 0;
         if (m_time_last_update > 0) interval = time - m_time_last_update;
         if (interval > m_threshold_time) predict(interval);
@@ -244,6 +491,60 @@ public:
     }
 
 protected:
+    /** A filtered state in the fixed-lag smoothing window */
+    struct SmootherStep
+    {
+        /** The timestamp of the state */
+        double time;
+
+        /** The corrected state and its covariance */
+        cv::Mat state_post, cov_post;
+
+        /** The predicted state and its covariance (before correction) */
+        cv::Mat state_prior, cov_prior;
+
+        /** The Jacobian of the transition from the previous state */
+        cv::Mat transit;
+    };
+
+    /** Remove the past steps of the smoothing window */
+    void resetSmoother()
+    {
+        m_smoother_count = 0;
+        m_smoother_head = 0;
+    }
+
+    SmootherStep& getSmootherStep(int k)
+    {
+        return m_smoother_steps[(m_smoother_head + k) % m_smoother_steps.size()];
+    }
+
+    SmootherStep& pushSmootherStep(double time)
+    {
+        if (m_smoother_count < (int)m_smoother_steps.size()) m_smoother_count++;
+        else m_smoother_head = (m_smoother_head + 1) % m_smoother_steps.size();
+        SmootherStep& step = getSmootherStep(m_smoother_count - 1);
+        step.time = time;
+        return step;
+    }
+
+    bool applyIMUDelta(Timestamp time)
+    {
+        if (m_imu_delta.getEndTime() < 0) return false;
+        m_imu_delta.integrate(time);
+        if (m_imu_delta.empty()) return false;
+        double interval = m_imu_delta.getEndTime() - m_imu_delta.getStartTime();
+        m_imu_cov = cv::Matx33d(m_imu_delta.getCovariance());
+        bool success = predict(cv::Vec4d(interval, m_imu_delta.getRotation(), m_imu_delta.getVelocity(), m_imu_delta.getDistance()));
+        if (success)
+        {
+            m_state_vec.at<double>(2) = cx::trimRad(m_state_vec.at<double>(2));
+            m_time_last_update = m_imu_delta.getEndTime();
+        }
+        m_imu_delta.reset(m_imu_delta.getEndTime());
+        return success;
+    }
+
     virtual cv::Mat transitFunc(const cv::Mat& state, const cv::Mat& control, cv::Mat& jacobian, cv::Mat& noise)
     {
         const double dt = control.at<double>(0);
@@ -299,7 +600,7 @@ protected:
                 1, 0,
                 0, 1);
         }
-        else if (control.rows >= 3)
+        else if (control.rows == 3)
         {
             // The control input: [ dt, v_c, w_c ]
             const double v = control.at<double>(1), w = control.at<double>(2);
@@ -324,6 +625,33 @@ protected:
                 1, 0,
                 0, 1);
         }
+        else if (control.rows >= 4)
+        {
+            // The control input: [ dt, delta_theta, delta_v, delta_d ] (preintegrated IMU)
+            const double dtheta = control.at<double>(1), dv = control.at<double>(2), dd = control.at<double>(3);
+            const double v = state.at<double>(3);
+            const double d = v * dt + dd;
+            const double c = cos(theta + dtheta / 2), s = sin(theta + dtheta / 2);
+            func = (cv::Mat_<double>(5, 1) <<
+                x + d * c,
+                y + d * s,
+                theta + dtheta,
+                v + dv,
+                dtheta / dt);
+            jacobian = (cv::Mat_<double>(5, 5) <<
+                1, 0, -d * s, dt * c, 0,
+                0, 1,  d * c, dt * s, 0,
+                0, 0,      1,      0, 0,
+                0, 0,      0,      1, 0,
+                0, 0,      0,      0, 0);
+            cv::Mat G = (cv::Mat_<double>(5, 3) <<
+                c, -d * s / 2, 0,
+                s,  d * c / 2, 0,
+                0, 1, 0,
+                0, 0, 1,
+                0, 1 / dt, 0);
+            noise = G * cv::Mat(m_imu_cov) * G.t();
+        }
         if (!W.empty()) noise = W * m_noise_motion * W.t();
         return func;
     }
@@ -389,7 +717,23 @@ protected:
 
     double m_time_last_delta;
 
-    std::vector<cv::Rect2d> m_gps_dead_zones;
+    GPSDeadZoneMap m_gps_dead_zones;
+
+    cv::Vec2d m_noise_imu;
+
+    IMUPreintegration m_imu_delta;
+
+    cv::Matx33d m_imu_cov;
+
+    std::vector<SmootherStep> m_smoother_steps;
+
+    int m_smoother_head;
+
+    int m_smoother_count;
+
+    double m_smoother_time;
+
+    cv::Mat m_smooth_state, m_smooth_cov, m_smooth_inv, m_smooth_gain, m_smooth_diff;
 
 }; // End of 'EKFLocalizer'
 
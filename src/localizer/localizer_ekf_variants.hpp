@@ -65,6 +65,15 @@ public:
     EKFLocalizerSinTrack()
     {
         m_track_converge = 0;
+        m_track_beam_size = 0;
+    }
+
+    virtual int readParam(const cv::FileNode& fn)
+    {
+        int n_read = EKFLocalizerHyperTan::readParam(fn);
+        CX_LOAD_PARAM_COUNT(fn, "track_beam_size", m_track_beam_size, n_read);
+        if (m_track_beam_size > 0) m_topo_beam.setParam(m_track_beam_size);
+        return n_read;
     }
 
     virtual Pose2 getPose()
@@ -88,7 +97,19 @@ public:
             const int converge_repeat = 5;
             const double drift_radius = 50;
             Pose2 pose_m = EKFLocalizerHyperTan::getPose();
-            if (m_track_topo.node_id == 0 || m_track_converge < converge_repeat)
+            if (m_track_beam_size > 0)
+            {
+                // Track with multiple hypotheses (the legacy single-edge tracker is used if 'track_beam_size' is 0)
+                double travel = 0;
+                if (m_track_topo.node_id != 0)
+                {
+                    double dx = pose_m.x - m_track_pose_prev.x, dy = pose_m.y - m_track_pose_prev.y;
+                    travel = sqrt(dx * dx + dy * dy);
+                }
+                m_track_topo = trackTopoPoseBeam(pose_m, travel, turn_weight, drift_radius);
+                m_track_pose_prev = pose_m;
+            }
+            else if (m_track_topo.node_id == 0 || m_track_converge < converge_repeat)
             {
                 m_track_topo = findNearestTopoPose(pose_m, turn_weight);
                 if (m_track_topo.node_id == m_track_prev.node_id && m_track_topo.edge_idx == m_track_prev.edge_idx && m_track_topo.dist > m_track_prev.dist) m_track_converge++;
@@ -122,7 +143,11 @@ protected:
 
     TopometricPose m_track_prev;
 
+    Pose2 m_track_pose_prev;
+
     int m_track_converge;
+
+    int m_track_beam_size;
 };
 
 } // End of 'dg'
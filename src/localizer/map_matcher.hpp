@@ -0,0 +1,376 @@
+#ifndef __MAP_MATCHER__
+#define __MAP_MATCHER__
+
+#include "core/basic_type.hpp"
+#include "localizer/flat_road_map.hpp"
+#include <unordered_map>
+#include <algorithm>
+#include <queue>
+#include <cfloat>
+
+namespace dg
+{
+
+/**
+ * @brief HMM-based map matcher
+ *
+ * A <b>map matcher</b> aligns a whole trajectory of metric positions (e.g. recorded GPS data) to edges of a RoadMap.
+ * Each position has candidate edges near it, which are found by a grid-based spatial index of edges.
+ * The matcher finds the most probable sequence of candidates with the Viterbi algorithm, where
+ * the emission cost is based on the distance from a position to its candidate and
+ * the transition cost is based on the difference between the route distance of two candidates and the straight distance of two positions.
+ * Route distances are calculated by a bounded Dijkstra search, and their results are cached for each start node.
+ */
+class MapMatcher : public FlatRoadMap
+{
+public:
+    /**
+     * Flatten the given map and build its spatial index
+     * @param map The road map to match on
+     * @return True if successful (false if the map has no edge)
+     */
+    bool build(const RoadMap& map)
+    {
+        clear();
+        if (!flatten(map)) return false;
+
+        buildGrid();
+        m_search_dist.assign(m_node_id.size(), DBL_MAX);
+        m_search_stamp.assign(m_from.size(), 0);
+        return true;
+    }
+
+    /**
+     * Remove the map and cached data
+     */
+    void clear()
+    {
+        clearFlatMap();
+        m_cell_offset.clear();
+        m_cell_edges.clear();
+        m_route_cache.clear();
+        m_search_dist.clear();
+        m_search_stamp.clear();
+    }
+
+    /**
+     * Check whether the map is given or not
+     * @return True if the map is given (false if not)
+     */
+    bool isBuilt() const { return !m_from.empty(); }
+
+    /**
+     * Set parameters
+     * @param sigma_gps The standard deviation of position noise [m]
+     * @param beta The scale of the difference between route and straight distances [m]
+     * @param search_radius The maximum distance from a position to its candidate edges [m]
+     * @param max_candidates The maximum number of candidate edges for each position
+     * @param max_route The maximum route distance between two consecutive positions [m]
+     */
+    void setParam(double sigma_gps = 5, double beta = 5, double search_radius = 30, int max_candidates = 8, double max_route = 300)
+    {
+        bool rebuild = isBuilt() && search_radius != m_search_radius;
+        m_sigma_gps = sigma_gps;
+        m_beta = beta;
+        m_search_radius = search_radius;
+        m_max_candidates = std::max(max_candidates, 1);
+        if (max_route != m_max_route) m_route_cache.clear();
+        m_max_route = max_route;
+        if (rebuild) buildGrid();
+    }
+
+    /**
+     * Align the given trajectory to the map
+     * @param track The sequence of metric positions
+     * @param result The sequence of matched topometric poses (a position without any candidate has an empty pose)
+     * @return True if successful (false if the map is not given)
+     */
+    bool match(const std::vector<Point2>& track, std::vector<TopometricPose>& result)
+    {
+        result.clear();
+        m_n_breaks = 0;
+        if (!isBuilt()) return false;
+        result.resize(track.size());
+        if (track.empty()) return true;
+
+        // Forward pass of the Viterbi algorithm
+        m_step_offset.assign(1, 0);
+        m_cand_edge.clear();
+        m_cand_along.clear();
+        m_cand_cost.clear();
+        m_cand_parent.clear();
+        m_segment_end.clear();
+        const double w_obs = 0.5 / (m_sigma_gps * m_sigma_gps);
+        int prev = -1;
+        for (size_t t = 0; t < track.size(); t++)
+        {
+            size_t begin = m_cand_edge.size();
+            findCandidates(track[t]);
+            size_t end = m_cand_edge.size();
+            m_step_offset.push_back((int)end);
+            if (begin == end) continue;
+
+            bool connected = false;
+            if (prev >= 0)
+            {
+                double sx = track[t].x - track[prev].x, sy = track[t].y - track[prev].y;
+                double straight = sqrt(sx * sx + sy * sy);
+                for (size_t j = begin; j < end; j++)
+                {
+                    double best = DBL_MAX;
+                    int parent = -1;
+                    for (int i = m_step_offset[prev]; i < m_step_offset[prev + 1]; i++)
+                    {
+                        if (m_cand_cost[i] >= best) continue;
+                        double route = getRouteDist(m_cand_edge[i], m_cand_along[i], m_cand_edge[j], m_cand_along[j]);
+                        if (route > m_max_route) continue;
+                        double cost = m_cand_cost[i] + fabs(route - straight) / m_beta;
+                        if (cost < best)
+                        {
+                            best = cost;
+                            parent = i;
+                        }
+                    }
+                    if (parent >= 0)
+                    {
+                        m_cand_cost[j] += best;
+                        m_cand_parent[j] = parent;
+                        connected = true;
+                    }
+                    else m_cand_cost[j] = DBL_MAX;
+                }
+                if (!connected)
+                {
+                    // Restart with emission costs (HMM break)
+                    m_segment_end.push_back(prev);
+                    m_n_breaks++;
+                    for (size_t j = begin; j < end; j++) m_cand_cost[j] = m_cand_offset2[j - begin] * w_obs;
+                }
+            }
+            prev = (int)t;
+        }
+        if (prev >= 0) m_segment_end.push_back(prev);
+
+        // Backtrack each segment
+        for (auto seg = m_segment_end.begin(); seg != m_segment_end.end(); seg++)
+        {
+            int best = -1;
+            for (int i = m_step_offset[*seg]; i < m_step_offset[*seg + 1]; i++)
+                if (best < 0 || m_cand_cost[i] < m_cand_cost[best]) best = i;
+            int t = *seg;
+            while (best >= 0)
+            {
+                while (best < m_step_offset[t]) t--;
+                int e = m_cand_edge[best];
+                TopometricPose& pose = result[t];
+                pose.node_id = m_node_id[m_from[e]];
+                pose.edge_idx = m_edge_idx[e];
+                pose.dist = m_cand_along[best];
+                pose.head = 0;
+                best = m_cand_parent[best];
+            }
+        }
+        return true;
+    }
+
+    /**
+     * Get the number of HMM breaks in the last matching
+     * @return The number of breaks (a trajectory is split where no route connects two consecutive positions)
+     */
+    int countBreaks() const { return m_n_breaks; }
+
+    /**
+     * Get the number of cached route searches
+     * @return The number of start nodes whose route distances are cached
+     */
+    size_t countCachedRoutes() const { return m_route_cache.size(); }
+
+protected:
+    void buildGrid()
+    {
+        m_grid_min = Point2(DBL_MAX, DBL_MAX);
+        Point2 grid_max(-DBL_MAX, -DBL_MAX);
+        for (size_t e = 0; e < m_from.size(); e++)
+        {
+            m_grid_min.x = std::min(m_grid_min.x, std::min(m_from_x[e], m_from_x[e] + m_dx[e]));
+            m_grid_min.y = std::min(m_grid_min.y, std::min(m_from_y[e], m_from_y[e] + m_dy[e]));
+            grid_max.x = std::max(grid_max.x, std::max(m_from_x[e], m_from_x[e] + m_dx[e]));
+            grid_max.y = std::max(grid_max.y, std::max(m_from_y[e], m_from_y[e] + m_dy[e]));
+        }
+        m_grid_cell = std::max(m_search_radius, 1.);
+        while (true)
+        {
+            m_grid_cols = (int)((grid_max.x - m_grid_min.x) / m_grid_cell) + 1;
+            m_grid_rows = (int)((grid_max.y - m_grid_min.y) / m_grid_cell) + 1;
+            if ((double)m_grid_rows * m_grid_cols <= 4.0 * m_from.size() + 1024) break;
+            m_grid_cell *= 2;
+        }
+
+        // Put each edge into the cells overlapped with its bounding box (CSR layout)
+        std::vector<std::vector<int>> cells((size_t)m_grid_rows * m_grid_cols);
+        for (int e = 0; e < (int)m_from.size(); e++)
+        {
+            int c0, r0, c1, r1, unused;
+            getCellRange(std::min(m_from_x[e], m_from_x[e] + m_dx[e]), std::min(m_from_y[e], m_from_y[e] + m_dy[e]), 0, c0, r0, unused, unused);
+            getCellRange(std::max(m_from_x[e], m_from_x[e] + m_dx[e]), std::max(m_from_y[e], m_from_y[e] + m_dy[e]), 0, c1, r1, unused, unused);
+            for (int r = r0; r <= r1; r++)
+                for (int c = c0; c <= c1; c++)
+                    cells[(size_t)r * m_grid_cols + c].push_back(e);
+        }
+        m_cell_offset.assign(1, 0);
+        m_cell_edges.clear();
+        for (auto cell = cells.begin(); cell != cells.end(); cell++)
+        {
+            m_cell_edges.insert(m_cell_edges.end(), cell->begin(), cell->end());
+            m_cell_offset.push_back((int)m_cell_edges.size());
+        }
+    }
+
+    void getCellRange(double x, double y, double radius, int& c0, int& r0, int& c1, int& r1) const
+    {
+        c0 = std::min(std::max((int)floor((x - radius - m_grid_min.x) / m_grid_cell), 0), m_grid_cols - 1);
+        r0 = std::min(std::max((int)floor((y - radius - m_grid_min.y) / m_grid_cell), 0), m_grid_rows - 1);
+        c1 = std::min(std::max((int)floor((x + radius - m_grid_min.x) / m_grid_cell), 0), m_grid_cols - 1);
+        r1 = std::min(std::max((int)floor((y + radius - m_grid_min.y) / m_grid_cell), 0), m_grid_rows - 1);
+    }
+
+    /** Append the nearest edges to the given position into the candidate arrays */
+    void findCandidates(const Point2& p)
+    {
+        m_stamp++;
+        m_near.clear();
+        const double range2 = m_search_radius * m_search_radius;
+        int c0, r0, c1, r1;
+        getCellRange(p.x, p.y, m_search_radius, c0, r0, c1, r1);
+        for (int r = r0; r <= r1; r++)
+        {
+            for (int c = c0; c <= c1; c++)
+            {
+                size_t cell = (size_t)r * m_grid_cols + c;
+                for (int k = m_cell_offset[cell]; k < m_cell_offset[cell + 1]; k++)
+                {
+                    int e = m_cell_edges[k];
+                    if (m_search_stamp[e] == m_stamp) continue;
+                    m_search_stamp[e] = m_stamp;
+                    double px = p.x - m_from_x[e], py = p.y - m_from_y[e];
+                    double l2 = std::max(m_dx[e] * m_dx[e] + m_dy[e] * m_dy[e], DBL_EPSILON);
+                    double s = std::min(std::max((px * m_dx[e] + py * m_dy[e]) / l2, 0.), 1.);
+                    double ex = px - s * m_dx[e], ey = py - s * m_dy[e];
+                    double d2 = ex * ex + ey * ey;
+                    if (d2 <= range2) m_near.push_back(Candidate(d2, e, s * m_len[e]));
+                }
+            }
+        }
+
+        size_t n = std::min(m_near.size(), (size_t)m_max_candidates);
+        std::partial_sort(m_near.begin(), m_near.begin() + n, m_near.end());
+        const double w_obs = 0.5 / (m_sigma_gps * m_sigma_gps);
+        m_cand_offset2.resize(n);
+        for (size_t i = 0; i < n; i++)
+        {
+            m_cand_edge.push_back(m_near[i].edge);
+            m_cand_along.push_back(m_near[i].along);
+            m_cand_cost.push_back(m_near[i].dist2 * w_obs);
+            m_cand_parent.push_back(-1);
+            m_cand_offset2[i] = m_near[i].dist2;
+        }
+    }
+
+    /** Get the route distance from (edge 'ea', distance 'sa') to (edge 'eb', distance 'sb') */
+    double getRouteDist(int ea, double sa, int eb, double sb)
+    {
+        if (ea == eb) return fabs(sb - sa);
+        if (eb == m_reverse[ea]) return fabs(m_len[ea] - sb - sa);
+        double rest = m_len[ea] - sa + sb;
+        if (rest > m_max_route) return DBL_MAX;
+        int from = m_to[ea], to = m_from[eb];
+        if (from == to) return rest;
+        const std::vector<std::pair<int, double>>& routes = getRoutes(from);
+        auto found = std::lower_bound(routes.begin(), routes.end(), std::make_pair(to, -DBL_MAX));
+        if (found == routes.end() || found->first != to) return DBL_MAX;
+        return rest + found->second;
+    }
+
+    /** Get distances from the given node to its reachable nodes within 'm_max_route' (sorted by node indices) */
+    const std::vector<std::pair<int, double>>& getRoutes(int from)
+    {
+        auto cached = m_route_cache.find(from);
+        if (cached != m_route_cache.end()) return cached->second;
+        if (m_route_cache.size() >= m_max_cached_routes) m_route_cache.clear();
+
+        // Bounded Dijkstra search
+        std::vector<std::pair<int, double>>& routes = m_route_cache[from];
+        typedef std::pair<double, int> QueueItem;
+        std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> queue;
+        m_search_dist[from] = 0;
+        queue.push(QueueItem(0, from));
+        while (!queue.empty())
+        {
+            QueueItem item = queue.top();
+            queue.pop();
+            if (item.first > m_search_dist[item.second]) continue;
+            routes.push_back(std::make_pair(item.second, item.first));
+            for (int e = m_node_offset[item.second]; e < m_node_offset[item.second + 1]; e++)
+            {
+                double dist = item.first + m_len[e];
+                if (dist > m_max_route || dist >= m_search_dist[m_to[e]]) continue;
+                m_search_dist[m_to[e]] = dist;
+                queue.push(QueueItem(dist, m_to[e]));
+            }
+        }
+        for (auto route = routes.begin(); route != routes.end(); route++) m_search_dist[route->first] = DBL_MAX;
+        std::sort(routes.begin(), routes.end());
+        return routes;
+    }
+
+    struct Candidate
+    {
+        Candidate(double _dist2, int _edge, double _along) : dist2(_dist2), edge(_edge), along(_along) { }
+        bool operator<(const Candidate& rhs) const { return dist2 < rhs.dist2; }
+        double dist2;
+        int edge;
+        double along;
+    };
+
+    /** The standard deviation of position noise [m] */
+    double m_sigma_gps = 5;
+
+    /** The scale of the difference between route and straight distances [m] */
+    double m_beta = 5;
+
+    /** The maximum distance from a position to its candidate edges [m] */
+    double m_search_radius = 30;
+
+    /** The maximum number of candidate edges for each position */
+    int m_max_candidates = 8;
+
+    /** The maximum route distance between two consecutive positions [m] */
+    double m_max_route = 300;
+
+    /** The maximum number of cached route searches */
+    size_t m_max_cached_routes = 100000;
+
+    /** The spatial index of edges */
+    Point2 m_grid_min;
+    double m_grid_cell = 0;
+    int m_grid_rows = 0, m_grid_cols = 0;
+    std::vector<int> m_cell_offset, m_cell_edges;
+
+    /** The cached route searches */
+    std::unordered_map<int, std::vector<std::pair<int, double>>> m_route_cache;
+    std::vector<double> m_search_dist;
+
+    /** The candidate search buffers */
+    std::vector<int> m_search_stamp;
+    int m_stamp = 0;
+    std::vector<Candidate> m_near;
+
+    /** The Viterbi trellis */
+    std::vector<int> m_step_offset, m_cand_edge, m_cand_parent, m_segment_end;
+    std::vector<double> m_cand_along, m_cand_cost, m_cand_offset2;
+    int m_n_breaks = 0;
+}; // End of 'MapMatcher'
+
+} // End of 'dg'
+
+#endif // End of '__MAP_MATCHER__'
@@ -0,0 +1,328 @@
+#ifndef __TOPOMETRIC_BEAM__
+#define __TOPOMETRIC_BEAM__
+
+#include "core/basic_type.hpp"
+#include "localizer/flat_road_map.hpp"
+#include "utils/opencx.hpp"
+#include <unordered_map>
+#include <algorithm>
+#include <cfloat>
+
+namespace dg
+{
+
+/**
+ * @brief Multi-hypothesis topometric tracker
+ *
+ * A <b>topometric beam</b> keeps a bounded number of topometric hypotheses (an edge and a distance on it) with their costs.
+ * Every update propagates the hypotheses along edges of a RoadMap by the traveled distance, branches them at nodes,
+ * scores the candidates with the given metric pose, and keeps the best ones.
+ * The edges of the RoadMap are flattened into arrays (FlatRoadMap), and all buffers are allocated when the map is given,
+ * so an update does not allocate memory and evaluates candidates in a tight loop.
+ */
+class TopometricBeam : public FlatRoadMap
+{
+public:
+    /**
+     * @brief A topometric hypothesis
+     */
+    struct Hypothesis
+    {
+        /** The topometric pose */
+        TopometricPose pose;
+
+        /** The accumulated cost (0 for the best hypothesis) */
+        double cost = 0;
+
+        /** The normalized confidence (the sum over the beam is 1) */
+        double confidence = 0;
+
+        /** The distance from the metric pose to the edge [m] */
+        double offset = 0;
+
+        /** The index of the edge in the flattened edge arrays */
+        int edge = -1;
+    };
+
+    /**
+     * The default constructor
+     * @param beam_size The maximum number of hypotheses
+     */
+    TopometricBeam(int beam_size = 8) : m_beam_size(std::max(beam_size, 1)) { }
+
+    /**
+     * Flatten the given map and allocate buffers
+     * @param map The road map to track on
+     * @return True if successful (false if the map has no edge)
+     */
+    bool build(const RoadMap& map)
+    {
+        clear();
+        if (!flatten(map)) return false;
+
+        // Allocate buffers (candidates of a hypothesis: itself, its reverse, and branches of two levels)
+        int max_degree = 0;
+        for (int n = 0; n < (int)m_node_id.size(); n++) max_degree = std::max(max_degree, m_node_offset[n + 1] - m_node_offset[n]);
+        size_t capacity = std::max(m_from.size(), m_beam_size * (2 + max_degree + max_degree * max_degree));
+        m_cand_edge.reserve(capacity);
+        m_cand_prior.reserve(capacity);
+        m_cand_pred.reserve(capacity);
+        m_cand_cost.resize(capacity);
+        m_cand_along.resize(capacity);
+        m_cand_offset2.resize(capacity);
+        m_gx.resize(capacity);
+        m_gy.resize(capacity);
+        m_gdx.resize(capacity);
+        m_gdy.resize(capacity);
+        m_glen.resize(capacity);
+        m_gdh.resize(capacity);
+        m_order.reserve(capacity);
+        m_beam.reserve(m_beam_size);
+        return true;
+    }
+
+    /**
+     * Remove the map and hypotheses
+     */
+    void clear()
+    {
+        clearFlatMap();
+        m_beam.clear();
+    }
+
+    /**
+     * Remove the hypotheses (the map is kept)
+     */
+    void reset() { m_beam.clear(); }
+
+    /**
+     * Check whether the map is given or not
+     * @return True if the map is given (false if not)
+     */
+    bool isBuilt() const { return !m_from.empty(); }
+
+    /**
+     * Check whether the beam has hypotheses or not
+     * @return True if there is no hypothesis (false if not)
+     */
+    bool empty() const { return m_beam.empty(); }
+
+    /**
+     * Initialize hypotheses with the nearest edges to the given pose
+     * @param pose_m The metric pose
+     * @param turn_weight The weight of heading difference
+     * @return True if successful (false if failed)
+     */
+    bool initialize(const Pose2& pose_m, double turn_weight = 0)
+    {
+        if (!isBuilt()) return false;
+        m_cand_edge.clear();
+        m_cand_prior.clear();
+        m_cand_pred.clear();
+        for (int e = 0; e < (int)m_from.size(); e++) addCandidate(e, 0, 0);
+        evaluateCandidates(pose_m, turn_weight, 0);
+        return selectCandidates(pose_m);
+    }
+
+    /**
+     * Propagate hypotheses by the traveled distance and score them with the given pose
+     * @param pose_m The metric pose
+     * @param travel The traveled distance since the last update [m]
+     * @param turn_weight The weight of heading difference
+     * @return True if successful (false if failed)
+     */
+    bool update(const Pose2& pose_m, double travel, double turn_weight = 0)
+    {
+        if (!isBuilt() || m_beam.empty()) return false;
+        m_cand_edge.clear();
+        m_cand_prior.clear();
+        m_cand_pred.clear();
+        for (auto h = m_beam.begin(); h != m_beam.end(); h++)
+        {
+            int e = h->edge;
+            double prior = m_forget * h->cost;
+            double dist = h->pose.dist + travel;
+            addCandidate(e, std::min(dist, m_len[e]), prior);
+            if (m_reverse[e] >= 0) addCandidate(m_reverse[e], std::max(m_len[e] - h->pose.dist + travel, 0.), prior);
+            if (dist + m_branch_margin < m_len[e]) continue;
+
+            // Branch at the end of the edge (two levels)
+            int to = m_to[e];
+            for (int e1 = m_node_offset[to]; e1 < m_node_offset[to + 1]; e1++)
+            {
+                double dist1 = std::max(dist - m_len[e], 0.);
+                addCandidate(e1, std::min(dist1, m_len[e1]), prior);
+                if (dist1 + m_branch_margin < m_len[e1]) continue;
+                int to1 = m_to[e1];
+                for (int e2 = m_node_offset[to1]; e2 < m_node_offset[to1 + 1]; e2++)
+                    addCandidate(e2, std::min(std::max(dist1 - m_len[e1], 0.), m_len[e2]), prior);
+            }
+        }
+        evaluateCandidates(pose_m, turn_weight, 1);
+        return selectCandidates(pose_m);
+    }
+
+    /**
+     * Get the best hypothesis
+     * @return The topometric pose of the best hypothesis (an empty pose if no hypothesis)
+     */
+    TopometricPose getBest() const
+    {
+        if (m_beam.empty()) return TopometricPose();
+        return m_beam.front().pose;
+    }
+
+    /**
+     * Get the distance from the metric pose to the best hypothesis
+     * @return The distance [m] (-1 if no hypothesis)
+     */
+    double getBestOffset() const
+    {
+        if (m_beam.empty()) return -1;
+        return m_beam.front().offset;
+    }
+
+    /**
+     * Get all hypotheses (sorted by their costs)
+     * @return A vector of hypotheses
+     */
+    const std::vector<Hypothesis>& getHypotheses() const { return m_beam; }
+
+    /**
+     * Set parameters
+     * @param beam_size The maximum number of hypotheses
+     * @param sigma_obs The standard deviation of the distance from a metric pose to its edge [m]
+     * @param sigma_odo The standard deviation of the traveled distance [m]
+     * @param forget The decaying factor of accumulated costs (0 ~ 1)
+     */
+    void setParam(int beam_size, double sigma_obs = 5, double sigma_odo = 5, double forget = 0.8)
+    {
+        m_beam_size = std::max(beam_size, 1);
+        m_sigma_obs = sigma_obs;
+        m_sigma_odo = sigma_odo;
+        m_forget = forget;
+        m_beam.reserve(m_beam_size);
+    }
+
+protected:
+    void addCandidate(int edge, double pred, double prior)
+    {
+        m_cand_edge.push_back(edge);
+        m_cand_pred.push_back(pred);
+        m_cand_prior.push_back(prior);
+    }
+
+    void evaluateCandidates(const Pose2& pose_m, double turn_weight, double odo_weight)
+    {
+        const int n = (int)m_cand_edge.size();
+        if ((int)m_cand_cost.size() < n)
+        {
+            m_cand_cost.resize(n);
+            m_cand_along.resize(n);
+            m_cand_offset2.resize(n);
+            m_gx.resize(n);
+            m_gy.resize(n);
+            m_gdx.resize(n);
+            m_gdy.resize(n);
+            m_glen.resize(n);
+            m_gdh.resize(n);
+        }
+
+        // Gather edge data into contiguous arrays
+        for (int i = 0; i < n; i++)
+        {
+            int e = m_cand_edge[i];
+            m_gx[i] = pose_m.x - m_from_x[e];
+            m_gy[i] = pose_m.y - m_from_y[e];
+            m_gdx[i] = m_dx[e];
+            m_gdy[i] = m_dy[e];
+            m_glen[i] = m_len[e];
+            m_gdh[i] = (turn_weight > 0) ? cx::trimRad(pose_m.theta - m_theta[e]) : 0;
+        }
+
+        // Evaluate all candidates (branch-free, so the compiler can vectorize this loop)
+        const double w_obs = 1 / (m_sigma_obs * m_sigma_obs), w_odo = odo_weight / (m_sigma_odo * m_sigma_odo);
+        const double gain = w_odo / (w_obs + w_odo); // Fuse the projected and predicted distances
+        const double* px = m_gx.data(), *py = m_gy.data(), *dx = m_gdx.data(), *dy = m_gdy.data(), *len = m_glen.data(), *dh = m_gdh.data();
+        const double* prior = m_cand_prior.data(), *pred = m_cand_pred.data();
+        double* cost = m_cand_cost.data(), *along = m_cand_along.data(), *offset2 = m_cand_offset2.data();
+        for (int i = 0; i < n; i++)
+        {
+            double l2 = std::max(dx[i] * dx[i] + dy[i] * dy[i], DBL_EPSILON);
+            double t = std::min(std::max((px[i] * dx[i] + py[i] * dy[i]) / l2, 0.), 1.);
+            double ex = px[i] - t * dx[i], ey = py[i] - t * dy[i];
+            double d2 = ex * ex + ey * ey;
+            double a = t * len[i];
+            double da = a - pred[i];
+            along[i] = std::min(std::max(a - gain * da, 0.), len[i]);
+            offset2[i] = d2;
+            cost[i] = prior[i] + w_obs * (d2 + turn_weight * dh[i] * dh[i]) + w_odo * da * da;
+        }
+    }
+
+    bool selectCandidates(const Pose2& pose_m)
+    {
+        const int n = (int)m_cand_edge.size();
+        if (n <= 0)
+        {
+            m_beam.clear();
+            return false;
+        }
+
+        // Remove duplicated edges (keep the cheapest one)
+        m_order.resize(n);
+        for (int i = 0; i < n; i++) m_order[i] = i;
+        std::sort(m_order.begin(), m_order.end(), [&](int a, int b) { return (m_cand_edge[a] != m_cand_edge[b]) ? (m_cand_edge[a] < m_cand_edge[b]) : (m_cand_cost[a] < m_cand_cost[b]); });
+        auto last = std::unique(m_order.begin(), m_order.end(), [&](int a, int b) { return m_cand_edge[a] == m_cand_edge[b]; });
+        m_order.erase(last, m_order.end());
+
+        // Select the best candidates
+        size_t k = std::min(m_order.size(), m_beam_size);
+        std::partial_sort(m_order.begin(), m_order.begin() + k, m_order.end(), [&](int a, int b) { return m_cand_cost[a] < m_cand_cost[b]; });
+        m_beam.resize(k);
+        double min_cost = m_cand_cost[m_order[0]], sum = 0;
+        for (size_t j = 0; j < k; j++)
+        {
+            int i = m_order[j], e = m_cand_edge[i];
+            Hypothesis& h = m_beam[j];
+            h.edge = e;
+            h.cost = m_cand_cost[i] - min_cost;
+            h.confidence = exp(-0.5 * h.cost);
+            h.offset = sqrt(m_cand_offset2[i]);
+            h.pose.node_id = m_node_id[m_from[e]];
+            h.pose.edge_idx = m_edge_idx[e];
+            h.pose.dist = m_cand_along[i];
+            h.pose.head = cx::trimRad(pose_m.theta - m_theta[e]);
+            sum += h.confidence;
+        }
+        for (auto h = m_beam.begin(); h != m_beam.end(); h++) h->confidence /= sum;
+        return true;
+    }
+
+    /** The maximum number of hypotheses */
+    size_t m_beam_size;
+
+    /** The standard deviation of the distance from a metric pose to its edge [m] */
+    double m_sigma_obs = 5;
+
+    /** The standard deviation of the traveled distance [m] */
+    double m_sigma_odo = 5;
+
+    /** The decaying factor of accumulated costs */
+    double m_forget = 0.8;
+
+    /** The distance to the end of an edge where hypotheses start branching [m] */
+    double m_branch_margin = 10;
+
+    /** The candidate buffers */
+    std::vector<int> m_cand_edge, m_order;
+    std::vector<double> m_cand_prior, m_cand_pred, m_cand_cost, m_cand_along, m_cand_offset2;
+    std::vector<double> m_gx, m_gy, m_gdx, m_gdy, m_glen, m_gdh;
+
+    /** The current hypotheses */
+    std::vector<Hypothesis> m_beam;
+}; // End of 'TopometricBeam'
+
+} // End of 'dg'
+
+#endif // End of '__TOPOMETRIC_BEAM__'
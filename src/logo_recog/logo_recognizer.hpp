@@ -30,6 +30,8 @@ namespace dg
         */
         bool initialize(const char* module_name = "logo_recognizer", const char* module_path = "./../src/logo_recog", const char* class_name = "LogoRecognizer", const char* func_name_init = "initialize", const char* func_name_apply = "apply")
         {
+            DG_TRACE_SCOPE("LogoRecognizer::initialize");
+
             dg::Timestamp t1 = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count() / 1000.0;
 
             PyGILState_STATE state;
@@ -68,6 +70,8 @@ namespace dg
         */
         bool apply(cv::Mat image, dg::Timestamp ts)
         {
+            DG_TRACE_SCOPE("LogoRecognizer::apply");
+
             dg::Timestamp t1 = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count() / 1000.0;
 
             PyGILState_STATE state;
@@ -213,7 +217,7 @@ namespace dg
             }
         }
 
-        void write(std::ofstream& stream, int cam_fnumber = -1) const
+        void write(std::ostream& stream, int cam_fnumber = -1) const
         {
             for (int k = 0; k < m_logos.size(); k++)
             {
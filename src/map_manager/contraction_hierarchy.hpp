@@ -0,0 +1,752 @@
+#ifndef __CONTRACTION_HIERARCHY__
+#define __CONTRACTION_HIERARCHY__
+
+#include "map_manager/path_planner.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace dg
+{
+
+#pragma pack(push, 1)
+
+/** File header of a serialized contraction hierarchy */
+struct CHFileHeader
+{
+	char magic[8];
+	uint32_t n_nodes;
+	uint32_t n_arcs;
+	double factor[Edge::TYPE_NUM];
+};
+
+/** Node record of a serialized contraction hierarchy */
+struct CHFileNode
+{
+	uint64_t id;
+	double lat;
+	double lon;
+	int32_t rank;
+};
+
+/** Arc record of a serialized contraction hierarchy */
+struct CHFileArc
+{
+	int32_t from;
+	int32_t to;
+	double cost;
+	int32_t child1;
+	int32_t child2;
+	uint64_t edge_id;
+};
+
+#pragma pack(pop)
+
+static const char CH_FILE_MAGIC[8] = { 'D', 'G', 'C', 'H', 'I', '0', '0', '1' };
+
+/**
+ * @brief Contraction hierarchy for fast point-to-point routing
+ *
+ * build() contracts the nodes of a map snapshot one by one (in the order of edge difference) and adds shortcut arcs
+ * which preserve the shortest distances among the remaining nodes. A query runs bidirectional Dijkstra search
+ * only on the arcs toward higher ranked nodes, so it settles a few hundred nodes even on city-scale maps.
+ * Shortcuts are recursively unpacked into the original edges, so the found path has the same shape as the server output.
+ *
+ * The edge costs are fixed by the cost profile given to build(). Building is an offline step, and
+ * the hierarchy can be saved and loaded with save() and load().
+ * A hierarchy is not thread-safe for queries because queries share their working buffers.
+ */
+class ContractionHierarchy
+{
+public:
+	/**
+	 * Build the hierarchy from the given map
+	 * @param map The topological map
+	 * @param profile The cost profile of edge types
+	 * @param witness_limit The maximum number of settled nodes in a witness search
+	 * @return True if successful (false if the map has no node)
+	 */
+	bool build(const Map& map, const PathCostProfile& profile = PathCostProfile(), int witness_limit = 200)
+	{
+		clear();
+		if (map.nodes.empty()) return false;
+		m_profile = profile;
+
+		int n_nodes = (int)map.nodes.size();
+		m_node_ids.resize(n_nodes);
+		m_node_pos.resize(n_nodes);
+		for (int i = 0; i < n_nodes; i++)
+		{
+			m_node_ids[i] = map.nodes[i].id;
+			m_node_pos[i] = map.nodes[i];
+			m_lookup_nodes.insert(std::make_pair(map.nodes[i].id, i));
+		}
+		for (auto edge = map.edges.begin(); edge != map.edges.end(); edge++)
+		{
+			int n1, n2;
+			if (!findNodeIndex(edge->node_id1, n1) || !findNodeIndex(edge->node_id2, n2) || n1 == n2) continue;
+			int type = (edge->type >= 0 && edge->type < Edge::TYPE_NUM) ? edge->type : Edge::EDGE_SIDEWALK;
+			if (profile.factor[type] < 0) continue;
+			double length = (edge->length > 0) ? edge->length : greatCircleDistance(m_node_pos[n1], m_node_pos[n2]);
+			m_arcs.push_back(Arc(n1, n2, length * profile.factor[type], edge->id));
+			if (!edge->directed) m_arcs.push_back(Arc(n2, n1, length * profile.factor[type], edge->id));
+		}
+
+		contract(witness_limit);
+		buildSearchGraph();
+		buildGrid();
+		return true;
+	}
+
+	void clear()
+	{
+		m_node_ids.clear();
+		m_node_pos.clear();
+		m_lookup_nodes.clear();
+		m_rank.clear();
+		m_arcs.clear();
+		m_up_offset[0].clear();
+		m_up_offset[1].clear();
+		m_up_arcs[0].clear();
+		m_up_arcs[1].clear();
+		m_grid.clear();
+		m_n_settled = 0;
+	}
+
+	bool isBuilt() const { return !m_rank.empty(); }
+
+	size_t countNodes() const { return m_node_ids.size(); }
+
+	/** Get the number of arcs (including shortcuts) */
+	size_t countArcs() const { return m_arcs.size(); }
+
+	/** Get the number of shortcut arcs */
+	size_t countShortcuts() const
+	{
+		size_t n = 0;
+		for (auto arc = m_arcs.begin(); arc != m_arcs.end(); arc++)
+			if (arc->child1 >= 0) n++;
+		return n;
+	}
+
+	/** Get the number of settled nodes by the last query */
+	size_t countSettled() const { return m_n_settled; }
+
+	/**
+	 * Set the maximum distance between a given position and its nearest node
+	 * @param dist The maximum distance (Unit: [m], non-positive: unlimited)
+	 */
+	void setMaxSnapDistance(double dist) { m_max_snap_dist = dist; }
+
+	/** Get the cost profile which the hierarchy was built with */
+	const PathCostProfile& getProfile() const { return m_profile; }
+
+	/**
+	 * Find the nearest node of the given position
+	 * @param ll The given position
+	 * @return ID of the nearest node (0 if the hierarchy is empty)
+	 */
+	ID findNearestNode(const LatLon& ll) const
+	{
+		int idx = nearestNode(ll);
+		return (idx < 0) ? 0 : m_node_ids[idx];
+	}
+
+	/**
+	 * Find the shortest path between two nodes
+	 * @param start_id ID of the start node
+	 * @param dest_id ID of the destination node
+	 * @param path The found path
+	 * @param cost The cost of the found path (optional)
+	 * @return True if successful (false if failed)
+	 */
+	bool findPath(ID start_id, ID dest_id, Path& path, double* cost = nullptr)
+	{
+		int start, dest;
+		if (!findNodeIndex(start_id, start) || !findNodeIndex(dest_id, dest)) return false;
+		return search(start, dest, path, cost);
+	}
+
+	/**
+	 * Find the shortest path between two positions
+	 * @param start_pos The start position (starting at its nearest node)
+	 * @param dest_pos The destination position (ending at its nearest node)
+	 * @param path The found path
+	 * @param cost The cost of the found path (optional)
+	 * @return True if successful (false if failed)
+	 */
+	bool findPath(const LatLon& start_pos, const LatLon& dest_pos, Path& path, double* cost = nullptr)
+	{
+		int start = nearestNode(start_pos), dest = nearestNode(dest_pos);
+		if (start < 0 || dest < 0) return false;
+		if (m_max_snap_dist > 0 && (greatCircleDistance(start_pos, m_node_pos[start]) > m_max_snap_dist || greatCircleDistance(dest_pos, m_node_pos[dest]) > m_max_snap_dist)) return false;
+		if (!search(start, dest, path, cost)) return false;
+		path.start_pos = start_pos;
+		path.dest_pos = dest_pos;
+		return true;
+	}
+
+	/**
+	 * Save the hierarchy to a binary file
+	 * @param filename The name of the file
+	 * @return True if successful (false if failed)
+	 */
+	bool save(const std::string& filename) const
+	{
+		if (!isBuilt()) return false;
+		FILE* file = fopen(filename.c_str(), "wb");
+		if (file == nullptr)
+		{
+			printf("[ContractionHierarchy] Error: can't open %s\n", filename.c_str());
+			return false;
+		}
+
+		CHFileHeader header;
+		memcpy(header.magic, CH_FILE_MAGIC, sizeof(CH_FILE_MAGIC));
+		header.n_nodes = (uint32_t)m_node_ids.size();
+		header.n_arcs = (uint32_t)m_arcs.size();
+		for (int i = 0; i < Edge::TYPE_NUM; i++) header.factor[i] = m_profile.factor[i];
+		bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+		for (size_t i = 0; ok && i < m_node_ids.size(); i++)
+		{
+			CHFileNode node = { m_node_ids[i], m_node_pos[i].lat, m_node_pos[i].lon, m_rank[i] };
+			ok = fwrite(&node, sizeof(node), 1, file) == 1;
+		}
+		for (size_t i = 0; ok && i < m_arcs.size(); i++)
+		{
+			const Arc& a = m_arcs[i];
+			CHFileArc arc = { a.from, a.to, a.cost, a.child1, a.child2, a.edge_id };
+			ok = fwrite(&arc, sizeof(arc), 1, file) == 1;
+		}
+		fclose(file);
+		return ok;
+	}
+
+	/**
+	 * Load the hierarchy from a binary file
+	 * @param filename The name of the file
+	 * @return True if successful (false if failed)
+	 */
+	bool load(const std::string& filename)
+	{
+		clear();
+		FILE* file = fopen(filename.c_str(), "rb");
+		if (file == nullptr)
+		{
+			printf("[ContractionHierarchy] Error: can't open %s\n", filename.c_str());
+			return false;
+		}
+
+		CHFileHeader header;
+		bool ok = fread(&header, sizeof(header), 1, file) == 1 && memcmp(header.magic, CH_FILE_MAGIC, sizeof(CH_FILE_MAGIC)) == 0;
+		if (ok)
+		{
+			for (int i = 0; i < Edge::TYPE_NUM; i++) m_profile.factor[i] = header.factor[i];
+			m_node_ids.resize(header.n_nodes);
+			m_node_pos.resize(header.n_nodes);
+			m_rank.resize(header.n_nodes);
+			m_arcs.resize(header.n_arcs);
+		}
+		for (uint32_t i = 0; ok && i < header.n_nodes; i++)
+		{
+			CHFileNode node;
+			ok = fread(&node, sizeof(node), 1, file) == 1;
+			m_node_ids[i] = node.id;
+			m_node_pos[i] = LatLon(node.lat, node.lon);
+			m_rank[i] = node.rank;
+			m_lookup_nodes.insert(std::make_pair(node.id, (int)i));
+		}
+		for (uint32_t i = 0; ok && i < header.n_arcs; i++)
+		{
+			CHFileArc arc;
+			ok = fread(&arc, sizeof(arc), 1, file) == 1;
+			ok = ok && arc.from >= 0 && arc.from < (int)header.n_nodes && arc.to >= 0 && arc.to < (int)header.n_nodes && arc.child1 < (int)i && arc.child2 < (int)i;
+			m_arcs[i] = Arc(arc.from, arc.to, arc.cost, arc.edge_id, arc.child1, arc.child2);
+		}
+		fclose(file);
+		if (!ok)
+		{
+			printf("[ContractionHierarchy] Error: %s is not a valid hierarchy\n", filename.c_str());
+			clear();
+			return false;
+		}
+		buildSearchGraph();
+		buildGrid();
+		return true;
+	}
+
+protected:
+	/** An arc of the hierarchy (an original edge if child1 < 0, otherwise a shortcut of the two child arcs) */
+	struct Arc
+	{
+		Arc(int _from = 0, int _to = 0, double _cost = 0, ID _edge_id = 0, int _child1 = -1, int _child2 = -1) : from(_from), to(_to), cost(_cost), child1(_child1), child2(_child2), edge_id(_edge_id) { }
+		int from;
+		int to;
+		double cost;
+		int child1;
+		int child2;
+		ID edge_id;
+	};
+
+	/** An upward arc in the compressed search graph */
+	struct UpArc
+	{
+		int node;
+		double cost;
+		int arc;
+	};
+
+	typedef std::pair<double, int> QueueItem;
+	typedef std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> MinQueue;
+
+	static double greatCircleDistance(const LatLon& a, const LatLon& b)
+	{
+		const double d2r = CV_PI / 180;
+		double dlat = (b.lat - a.lat) * d2r, dlon = (b.lon - a.lon) * d2r;
+		double h = sin(dlat / 2) * sin(dlat / 2) + cos(a.lat * d2r) * cos(b.lat * d2r) * sin(dlon / 2) * sin(dlon / 2);
+		return 2 * 6371000 * asin(std::min(1.0, sqrt(h)));
+	}
+
+	bool findNodeIndex(ID id, int& idx) const
+	{
+		auto found = m_lookup_nodes.find(id);
+		if (found == m_lookup_nodes.end()) return false;
+		idx = found->second;
+		return true;
+	}
+
+	/** Contract all nodes in the order of their priorities (lazy update) */
+	void contract(int witness_limit)
+	{
+		int n_nodes = (int)m_node_ids.size();
+		m_out.assign(n_nodes, std::vector<int>());
+		m_in.assign(n_nodes, std::vector<int>());
+		for (int a = 0; a < (int)m_arcs.size(); a++)
+		{
+			m_out[m_arcs[a].from].push_back(a);
+			m_in[m_arcs[a].to].push_back(a);
+		}
+		m_rank.assign(n_nodes, -1);
+		m_deleted_neighbors.assign(n_nodes, 0);
+		m_witness_dist.assign(n_nodes, 0);
+		m_witness_stamp.assign(n_nodes, 0);
+		m_witness_target.assign(n_nodes, 0);
+		m_witness_query = 0;
+		m_witness_limit = witness_limit;
+
+		MinQueue queue;
+		for (int v = 0; v < n_nodes; v++) queue.push(QueueItem(priority(v), v));
+		int rank = 0;
+		while (!queue.empty())
+		{
+			int v = queue.top().second;
+			queue.pop();
+			if (m_rank[v] >= 0) continue;
+			double p = priority(v);
+			if (!queue.empty() && p > queue.top().first)
+			{
+				queue.push(QueueItem(p, v));
+				continue;
+			}
+
+			contractNode(v, true);
+			m_rank[v] = rank++;
+			std::vector<int> neighbors;
+			for (auto a = m_out[v].begin(); a != m_out[v].end(); a++)
+			{
+				neighbors.push_back(m_arcs[*a].to);
+				removeArc(m_in[m_arcs[*a].to], v, false);
+			}
+			for (auto a = m_in[v].begin(); a != m_in[v].end(); a++)
+			{
+				neighbors.push_back(m_arcs[*a].from);
+				removeArc(m_out[m_arcs[*a].from], v, true);
+			}
+			std::vector<int>().swap(m_out[v]);
+			std::vector<int>().swap(m_in[v]);
+			std::sort(neighbors.begin(), neighbors.end());
+			neighbors.erase(std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
+			for (auto u = neighbors.begin(); u != neighbors.end(); u++)
+			{
+				m_deleted_neighbors[*u]++;
+				queue.push(QueueItem(priority(*u), *u));
+			}
+		}
+
+		m_out.clear();
+		m_in.clear();
+		m_deleted_neighbors.clear();
+		m_witness_dist.clear();
+		m_witness_stamp.clear();
+		m_witness_target.clear();
+	}
+
+	/** Remove the arcs toward (outgoing) or from (incoming) the given node in the adjacency list */
+	void removeArc(std::vector<int>& arcs, int node, bool outgoing)
+	{
+		for (size_t i = 0; i < arcs.size();)
+		{
+			const Arc& arc = m_arcs[arcs[i]];
+			if ((outgoing ? arc.to : arc.from) == node)
+			{
+				arcs[i] = arcs.back();
+				arcs.pop_back();
+			}
+			else i++;
+		}
+	}
+
+	/** Priority of contraction (edge difference + the number of contracted neighbors) */
+	double priority(int v)
+	{
+		int degree = (int)(m_out[v].size() + m_in[v].size());
+		return 2.0 * (contractNode(v, false) - degree) + m_deleted_neighbors[v];
+	}
+
+	/**
+	 * Contract a node (or simulate its contraction)
+	 * @param v The node to contract
+	 * @param apply True to add shortcuts (false to count them only)
+	 * @return The number of (required) shortcuts
+	 */
+	int contractNode(int v, bool apply)
+	{
+		int n_shortcuts = 0;
+		std::vector<int> in_arcs = m_in[v], out_arcs = m_out[v];
+		for (auto in = in_arcs.begin(); in != in_arcs.end(); in++)
+		{
+			int u = m_arcs[*in].from;
+			if (m_rank[u] >= 0) continue;
+			double max_cost = 0;
+			int n_targets = 0;
+			m_witness_query++;
+			for (auto out = out_arcs.begin(); out != out_arcs.end(); out++)
+			{
+				int w = m_arcs[*out].to;
+				if (w == u || m_rank[w] >= 0) continue;
+				max_cost = std::max(max_cost, m_arcs[*in].cost + m_arcs[*out].cost);
+				if (m_witness_target[w] != m_witness_query)
+				{
+					m_witness_target[w] = m_witness_query;
+					n_targets++;
+				}
+			}
+			if (n_targets == 0) continue;
+
+			witnessSearch(u, v, max_cost, n_targets);
+			for (auto out = out_arcs.begin(); out != out_arcs.end(); out++)
+			{
+				int w = m_arcs[*out].to;
+				if (w == u || m_rank[w] >= 0) continue;
+				double cost = m_arcs[*in].cost + m_arcs[*out].cost;
+				if (m_witness_stamp[w] == m_witness_query && m_witness_dist[w] <= cost) continue;
+				n_shortcuts++;
+				if (apply)
+				{
+					// replace a parallel arc if exists
+					int a = (int)m_arcs.size();
+					m_arcs.push_back(Arc(u, w, cost, 0, *in, *out));
+					removeArc(m_out[u], w, true);
+					removeArc(m_in[w], u, false);
+					m_out[u].push_back(a);
+					m_in[w].push_back(a);
+				}
+			}
+		}
+		return n_shortcuts;
+	}
+
+	/** Search the shortest distances from the source to the targets without the given node (bounded by the cost and the number of settled nodes) */
+	void witnessSearch(int source, int excluded, double max_cost, int n_targets)
+	{
+		m_witness_stamp[source] = m_witness_query;
+		m_witness_dist[source] = 0;
+		std::vector<QueueItem>& heap = m_witness_heap;
+		std::greater<QueueItem> later;
+		heap.clear();
+		heap.push_back(QueueItem(0, source));
+		int n_settled = 0;
+		while (!heap.empty() && n_settled < m_witness_limit)
+		{
+			std::pop_heap(heap.begin(), heap.end(), later);
+			double d = heap.back().first;
+			int u = heap.back().second;
+			heap.pop_back();
+			if (d > m_witness_dist[u]) continue;
+			if (d > max_cost) break;
+			if (m_witness_target[u] == m_witness_query && --n_targets <= 0) break;
+			n_settled++;
+			for (auto a = m_out[u].begin(); a != m_out[u].end(); a++)
+			{
+				int w = m_arcs[*a].to;
+				if (w == excluded || m_rank[w] >= 0) continue;
+				double nd = d + m_arcs[*a].cost;
+				if (m_witness_stamp[w] != m_witness_query || nd < m_witness_dist[w])
+				{
+					m_witness_stamp[w] = m_witness_query;
+					m_witness_dist[w] = nd;
+					heap.push_back(QueueItem(nd, w));
+					std::push_heap(heap.begin(), heap.end(), later);
+				}
+			}
+		}
+	}
+
+	/** Build the upward graphs of the forward search (dir = 0) and the backward search (dir = 1) */
+	void buildSearchGraph()
+	{
+		int n_nodes = (int)m_node_ids.size();
+		for (int dir = 0; dir < 2; dir++)
+		{
+			m_up_offset[dir].assign(n_nodes + 1, 0);
+			m_up_arcs[dir].clear();
+		}
+		for (auto arc = m_arcs.begin(); arc != m_arcs.end(); arc++)
+		{
+			if (m_rank[arc->to] > m_rank[arc->from]) m_up_offset[0][arc->from + 1]++;
+			else m_up_offset[1][arc->to + 1]++;
+		}
+		for (int dir = 0; dir < 2; dir++)
+		{
+			for (int i = 0; i < n_nodes; i++) m_up_offset[dir][i + 1] += m_up_offset[dir][i];
+			m_up_arcs[dir].resize(m_up_offset[dir][n_nodes]);
+		}
+		std::vector<int> fill[2] = { std::vector<int>(m_up_offset[0].begin(), m_up_offset[0].end() - 1), std::vector<int>(m_up_offset[1].begin(), m_up_offset[1].end() - 1) };
+		for (int a = 0; a < (int)m_arcs.size(); a++)
+		{
+			const Arc& arc = m_arcs[a];
+			if (m_rank[arc.to] > m_rank[arc.from])
+			{
+				UpArc up = { arc.to, arc.cost, a };
+				m_up_arcs[0][fill[0][arc.from]++] = up;
+			}
+			else
+			{
+				UpArc up = { arc.from, arc.cost, a };
+				m_up_arcs[1][fill[1][arc.to]++] = up;
+			}
+		}
+
+		for (int dir = 0; dir < 2; dir++)
+		{
+			m_dist[dir].assign(n_nodes, 0);
+			m_parent[dir].assign(n_nodes, -1);
+			m_stamp[dir].assign(n_nodes, 0);
+		}
+		m_query = 0;
+	}
+
+	double distance(int dir, int node) const { return (m_stamp[dir][node] == m_query) ? m_dist[dir][node] : std::numeric_limits<double>::max(); }
+
+	/** Check whether a node is reached with a shorter distance through a higher ranked node (stall-on-demand) */
+	bool isStalled(int dir, int u, double d) const
+	{
+		const std::vector<UpArc>& arcs = m_up_arcs[1 - dir];
+		for (int a = m_up_offset[1 - dir][u]; a < m_up_offset[1 - dir][u + 1]; a++)
+		{
+			double dx = distance(dir, arcs[a].node);
+			if (dx < std::numeric_limits<double>::max() && dx + arcs[a].cost < d) return true;
+		}
+		return false;
+	}
+
+	bool search(int start, int dest, Path& path, double* cost)
+	{
+		m_query++;
+		if (m_query == 0)
+		{
+			std::fill(m_stamp[0].begin(), m_stamp[0].end(), 0);
+			std::fill(m_stamp[1].begin(), m_stamp[1].end(), 0);
+			m_query = 1;
+		}
+		m_n_settled = 0;
+
+		MinQueue queue[2];
+		int source[2] = { start, dest };
+		for (int dir = 0; dir < 2; dir++)
+		{
+			m_stamp[dir][source[dir]] = m_query;
+			m_dist[dir][source[dir]] = 0;
+			m_parent[dir][source[dir]] = -1;
+			queue[dir].push(QueueItem(0, source[dir]));
+		}
+
+		double best = std::numeric_limits<double>::max();
+		int meet = -1;
+		while (true)
+		{
+			double top[2];
+			for (int dir = 0; dir < 2; dir++) top[dir] = queue[dir].empty() ? std::numeric_limits<double>::max() : queue[dir].top().first;
+			if (std::min(top[0], top[1]) >= best) break;
+			int dir = (top[0] <= top[1]) ? 0 : 1;
+			double d = top[dir];
+			int u = queue[dir].top().second;
+			queue[dir].pop();
+			if (d > m_dist[dir][u]) continue;
+			m_n_settled++;
+
+			double other = distance(1 - dir, u);
+			if (other < std::numeric_limits<double>::max() && d + other < best)
+			{
+				best = d + other;
+				meet = u;
+			}
+			if (isStalled(dir, u, d)) continue;
+
+			const std::vector<UpArc>& arcs = m_up_arcs[dir];
+			for (int a = m_up_offset[dir][u]; a < m_up_offset[dir][u + 1]; a++)
+			{
+				int w = arcs[a].node;
+				double nd = d + arcs[a].cost;
+				if (nd < distance(dir, w))
+				{
+					m_stamp[dir][w] = m_query;
+					m_dist[dir][w] = nd;
+					m_parent[dir][w] = arcs[a].arc;
+					queue[dir].push(QueueItem(nd, w));
+				}
+			}
+		}
+		if (meet < 0) return false;
+
+		// collect the arcs from the start to the destination through the meeting node
+		std::vector<int> arcs;
+		for (int node = meet; m_parent[0][node] >= 0; node = m_arcs[m_parent[0][node]].from) arcs.push_back(m_parent[0][node]);
+		std::reverse(arcs.begin(), arcs.end());
+		for (int node = meet; m_parent[1][node] >= 0; node = m_arcs[m_parent[1][node]].to) arcs.push_back(m_parent[1][node]);
+
+		path.pts.clear();
+		for (auto a = arcs.begin(); a != arcs.end(); a++) unpack(*a, path);
+		path.pts.push_back(PathElement(m_node_ids[dest], 0));
+		if (cost) *cost = best;
+		return true;
+	}
+
+	/** Unpack an arc into the original edges and append them to the path */
+	void unpack(int arc, Path& path) const
+	{
+		std::vector<int> stack(1, arc);
+		while (!stack.empty())
+		{
+			const Arc& a = m_arcs[stack.back()];
+			stack.pop_back();
+			if (a.child1 < 0)
+			{
+				path.pts.push_back(PathElement(m_node_ids[a.from], a.edge_id));
+				continue;
+			}
+			stack.push_back(a.child2);
+			stack.push_back(a.child1);
+		}
+	}
+
+	/** Build a uniform grid of nodes for nearest node search */
+	void buildGrid()
+	{
+		m_grid.clear();
+		if (m_node_pos.empty()) return;
+		m_grid_min = m_node_pos[0];
+		LatLon grid_max = m_node_pos[0];
+		for (auto p = m_node_pos.begin(); p != m_node_pos.end(); p++)
+		{
+			m_grid_min.lat = std::min(m_grid_min.lat, p->lat);
+			m_grid_min.lon = std::min(m_grid_min.lon, p->lon);
+			grid_max.lat = std::max(grid_max.lat, p->lat);
+			grid_max.lon = std::max(grid_max.lon, p->lon);
+		}
+		m_grid_cell = 0.001;
+		while (true)
+		{
+			m_grid_cols = (int)((grid_max.lon - m_grid_min.lon) / m_grid_cell) + 1;
+			m_grid_rows = (int)((grid_max.lat - m_grid_min.lat) / m_grid_cell) + 1;
+			if ((double)m_grid_rows * m_grid_cols <= 4.0 * m_node_pos.size() + 1024) break;
+			m_grid_cell *= 2;
+		}
+		m_grid.assign((size_t)m_grid_rows * m_grid_cols, std::vector<int>());
+		for (int i = 0; i < (int)m_node_pos.size(); i++)
+		{
+			int r = (int)((m_node_pos[i].lat - m_grid_min.lat) / m_grid_cell);
+			int c = (int)((m_node_pos[i].lon - m_grid_min.lon) / m_grid_cell);
+			m_grid[(size_t)r * m_grid_cols + c].push_back(i);
+		}
+	}
+
+	/** Find the nearest node by searching the grid cells ring by ring */
+	int nearestNode(const LatLon& ll) const
+	{
+		if (m_grid.empty()) return -1;
+		int r0 = std::min(std::max((int)floor((ll.lat - m_grid_min.lat) / m_grid_cell), 0), m_grid_rows - 1);
+		int c0 = std::min(std::max((int)floor((ll.lon - m_grid_min.lon) / m_grid_cell), 0), m_grid_cols - 1);
+		double cos_lat = cos(ll.lat * CV_PI / 180);
+		double cell_min = m_grid_cell * std::min(cos_lat, 1.0);
+		int best = -1;
+		double best_d2 = std::numeric_limits<double>::max();
+		int max_ring = std::max(m_grid_rows, m_grid_cols);
+		for (int ring = 0; ring <= max_ring; ring++)
+		{
+			// stop if no node in this ring can be closer (a cell is shorter in longitude than in latitude)
+			double ring_min = std::max(ring - 1, 0) * cell_min;
+			if (best >= 0 && ring_min * ring_min >= best_d2) break;
+			for (int r = r0 - ring; r <= r0 + ring; r++)
+			{
+				if (r < 0 || r >= m_grid_rows) continue;
+				for (int c = c0 - ring; c <= c0 + ring; c++)
+				{
+					if (c < 0 || c >= m_grid_cols) continue;
+					if (abs(r - r0) != ring && abs(c - c0) != ring) continue;
+					const std::vector<int>& cell = m_grid[(size_t)r * m_grid_cols + c];
+					for (auto i = cell.begin(); i != cell.end(); i++)
+					{
+						double dlat = m_node_pos[*i].lat - ll.lat, dlon = (m_node_pos[*i].lon - ll.lon) * cos_lat;
+						double d2 = dlat * dlat + dlon * dlon;
+						if (d2 < best_d2)
+						{
+							best_d2 = d2;
+							best = *i;
+						}
+					}
+				}
+			}
+		}
+		return best;
+	}
+
+	PathCostProfile m_profile;
+	std::vector<ID> m_node_ids;
+	std::vector<LatLon> m_node_pos;
+	std::unordered_map<ID, int> m_lookup_nodes;
+	std::vector<int> m_rank;
+	std::vector<Arc> m_arcs;
+
+	// contraction
+	std::vector<std::vector<int>> m_out;
+	std::vector<std::vector<int>> m_in;
+	std::vector<int> m_deleted_neighbors;
+	std::vector<double> m_witness_dist;
+	std::vector<uint32_t> m_witness_stamp;
+	std::vector<uint32_t> m_witness_target;
+	std::vector<QueueItem> m_witness_heap;
+	uint32_t m_witness_query = 0;
+	int m_witness_limit = 200;
+
+	// query
+	std::vector<int> m_up_offset[2];
+	std::vector<UpArc> m_up_arcs[2];
+	std::vector<double> m_dist[2];
+	std::vector<int> m_parent[2];
+	std::vector<uint32_t> m_stamp[2];
+	uint32_t m_query = 0;
+	size_t m_n_settled = 0;
+
+	// nearest node search
+	std::vector<std::vector<int>> m_grid;
+	LatLon m_grid_min;
+	double m_grid_cell = 0.001;     // about 100 m (enlarged if the map is too sparse)
+	int m_grid_rows = 0, m_grid_cols = 0;
+	double m_max_snap_dist = -1;
+};
+
+} // End of 'dg'
+
+#endif // End of '__CONTRACTION_HIERARCHY__'
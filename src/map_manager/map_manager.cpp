@@ -8,6 +8,7 @@ bool MapManager::initialize()
 {
 	m_map = new Map();
 	m_isMap = true;
+	m_map_version++;
 
 	std::vector<POI> poi_vec;
 	bool ok = getPOI(36.384063, 127.374733, 40000.0, poi_vec);	// Korea
@@ -18,11 +19,7 @@ bool MapManager::initialize()
 
 		return false;
 	}	
-	for (std::vector<POI>::iterator it = m_map->pois.begin(); it != m_map->pois.end(); ++it)
-	{
-		lookup_pois_name.insert(std::make_pair(it->name, LatLon(it->lat, it->lon)));
-		//lookup_pois_id.insert(std::make_pair(it->id, LatLon(it->lat, it->lon)));
-	}
+	m_poi_index.build(m_map->pois);
 	m_map->pois.clear();
 
 	//std::vector<StreetView> sv_vec;
@@ -93,6 +90,7 @@ size_t MapManager::write_callback(void* ptr, size_t size, size_t count, void* st
 	
 bool MapManager::query2server(std::string url)
 {
+	DG_TRACE_SCOPE("MapManager::query2server");
 #ifdef _WIN32
 	SetConsoleOutputCP(65001);
 #endif
@@ -249,6 +247,7 @@ bool MapManager::downloadMap(cv::Point2i tile)
 
 bool MapManager::parseMap(const char* json)
 {
+	DG_TRACE_SCOPE("MapManager::parseMap");
 	Document document;
 	document.Parse(json);
 
@@ -400,8 +399,20 @@ Map& MapManager::getMap()
 	return *m_map;
 }
 
+MapSnapshot MapManager::getMapSnapshot()
+{
+	if (!m_isMap) return nullptr;
+	if (m_snapshot == nullptr || m_snapshot_version != m_map_version)
+	{
+		m_snapshot = std::make_shared<const Map>(*m_map);
+		m_snapshot_version = m_map_version;
+	}
+	return m_snapshot;
+}
+
 bool MapManager::getMap(double lat, double lon, double radius, Map& map)
 {
+	DG_TRACE_SCOPE("MapManager::getMap");
 	if (m_isMap)
 	{
 		delete m_map;
@@ -412,6 +423,7 @@ bool MapManager::getMap(double lat, double lon, double radius, Map& map)
 	}
 	m_map = new Map();
 	m_isMap = true;
+	m_map_version++;
 	//m_map->nodes.clear();
 	m_json = "";
 
@@ -443,6 +455,7 @@ bool MapManager::getMap(ID node_id, double radius, Map& map)
 	}
 	m_map = new Map();
 	m_isMap = true;
+	m_map_version++;
 	//m_map->nodes.clear();
 	m_json = "";
 
@@ -474,6 +487,7 @@ bool MapManager::getMap(cv::Point2i tile, Map& map)
 	}
 	m_map = new Map();
 	m_isMap = true;
+	m_map_version++;
 	//m_map->nodes.clear();
 	m_json = "";
 
@@ -495,6 +509,7 @@ bool MapManager::getMap(cv::Point2i tile, Map& map)
 
 bool MapManager::getMap(Path path, Map& map, double alpha)
 {
+	DG_TRACE_SCOPE("MapManager::getMap(path)");
 	/*double lat = 36.38;
 	double lon = 127.373;
 	double r = 1000.0;
@@ -548,6 +563,7 @@ bool MapManager::getMap(Path path, Map& map, double alpha)
 	}
 	m_map = new Map();
 	m_isMap = true;
+	m_map_version++;
 	//m_map->nodes.clear();
 	m_json = "";
 
@@ -566,6 +582,7 @@ bool MapManager::getMap(Path path, Map& map, double alpha)
 
 bool MapManager::getMap_expansion(Path path, Map& map, double alpha)
 {
+	DG_TRACE_SCOPE("MapManager::getMap_expansion");
 	/*double lat = 36.38;
 	double lon = 127.373;
 	double r = 1000.0;
@@ -641,6 +658,7 @@ bool MapManager::getMap_expansion(Path path, Map& map, double alpha)
 	}
 	m_map = new Map();
 	m_isMap = true;
+	m_map_version++;
 	//m_map->nodes.clear();
 	m_json = "";
 
@@ -701,6 +719,7 @@ bool MapManager::downloadPath(double start_lat, double start_lon, double dest_la
 
 bool MapManager::parsePath(const char* json)
 {
+	DG_TRACE_SCOPE("MapManager::parsePath");
 	Document document;
 	document.Parse(json);
 
@@ -931,6 +950,7 @@ Path MapManager::getPath()
 
 bool MapManager::getPath(double start_lat, double start_lon, double dest_lat, double dest_lon, Path& path, int num_paths)
 {
+	DG_TRACE_SCOPE("MapManager::getPath");
 	bool ok = generatePath(start_lat, start_lon, dest_lat, dest_lon, num_paths);
 	if (!ok) return false;
 
@@ -941,6 +961,7 @@ bool MapManager::getPath(double start_lat, double start_lon, double dest_lat, do
 
 bool MapManager::getPath_expansion(double start_lat, double start_lon, double dest_lat, double dest_lon, Path& path, int num_paths)
 {
+	DG_TRACE_SCOPE("MapManager::getPath_expansion");
 	bool ok = generatePath_expansion(start_lat, start_lon, dest_lat, dest_lon, num_paths);
 	if (!ok) return false;
 
@@ -949,6 +970,79 @@ bool MapManager::getPath_expansion(double start_lat, double start_lon, double de
 	return true;
 }
 
+bool MapManager::getPath_local(double start_lat, double start_lon, double dest_lat, double dest_lon, Path& path, const PathCostProfile& profile)
+{
+	DG_TRACE_SCOPE("MapManager::getPath_local");
+	if (!m_isMap || m_map->nodes.empty()) return false;
+
+	// the precomputed hierarchy first (its map snapshot may differ from the current map)
+	Path found;
+	bool ok = false;
+	if (m_hierarchy.isBuilt() && memcmp(m_hierarchy.getProfile().factor, profile.factor, sizeof(profile.factor)) == 0)
+	{
+		ok = m_hierarchy.findPath(LatLon(start_lat, start_lon), LatLon(dest_lat, dest_lon), found);
+		for (auto pt = found.pts.begin(); ok && pt != found.pts.end(); ++pt)
+			ok = (m_map->findNode(pt->node_id) != nullptr);
+	}
+	if (!ok)
+	{
+		if (!preparePlanner()) return false;
+		ok = m_planner.findPath(LatLon(start_lat, start_lon), LatLon(dest_lat, dest_lon), found, profile);
+		if (!ok) return false;
+	}
+
+	setLocalPath(found);
+	path = m_path;
+
+	return true;
+}
+
+bool MapManager::getPath_local(double start_lat, double start_lon, double dest_lat, double dest_lon, std::vector<Path>& paths, int num_paths, const PathCostProfile& profile)
+{
+	DG_TRACE_SCOPE("MapManager::getPath_local");
+	paths.clear();
+	if (!m_isMap || m_map->nodes.empty() || num_paths < 1) return false;
+
+	// the hierarchy finds only the shortest path, so alternatives are searched by the planner
+	if (!preparePlanner()) return false;
+	bool ok = m_planner.findPaths(LatLon(start_lat, start_lon), LatLon(dest_lat, dest_lon), paths, num_paths, profile);
+	if (!ok || paths.empty()) return false;
+
+	setLocalPath(paths.front());
+
+	return true;
+}
+
+bool MapManager::preparePlanner()
+{
+	if (!m_planner.isBuilt() || m_planner_version != m_map_version)
+	{
+		if (!m_planner.build(*m_map)) return false;
+		m_planner.setMaxSnapDistance(100);
+		m_planner_version = m_map_version;
+	}
+	return true;
+}
+
+void MapManager::setLocalPath(const Path& path)
+{
+	m_path = path;
+	m_json = "";
+	lookup_path.clear();
+	for (auto pt = m_path.pts.begin(); pt != m_path.pts.end(); ++pt)
+	{
+		Node* node = m_map->findNode(pt->node_id);
+		if (node) lookup_path.insert(std::make_pair(node->id, LatLon(node->lat, node->lon)));
+	}
+}
+
+bool MapManager::loadHierarchy(const std::string& filename)
+{
+	if (!m_hierarchy.load(filename)) return false;
+	m_hierarchy.setMaxSnapDistance(100);
+	return true;
+}
+
 bool MapManager::getPath(const char* filename, Path& path)
 {
 	m_path.pts.clear();
@@ -1014,6 +1108,7 @@ bool MapManager::downloadPOI_poi(ID poi_id, double radius)
 
 bool MapManager::parsePOI(const char* json)
 {
+	DG_TRACE_SCOPE("MapManager::parsePOI");
 	Document document;
 	document.Parse(json);
 
@@ -1250,24 +1345,69 @@ std::vector<POI> MapManager::getPOI_sorting(const std::string poi_name, LatLon l
 
 std::vector<POI> MapManager::getPOI(const std::string poi_name)
 {
+	DG_TRACE_SCOPE("MapManager::getPOI(name)");
 	std::wstring name;
 	utf8to16(poi_name.c_str(), name);
-	auto found = lookup_pois_name.find(name);
-	if (found == lookup_pois_name.end()) 
+	std::vector<int> indices;
+	if (m_poi_index.findExact(name, indices) <= 0)
 		return std::vector<POI>();
 
-	return getPOI(poi_name, found->second, 10.0);
+	// The POIs with the same name within 10 m from the first one
+	std::vector<POI> poi_vec;
+	const POI& first = m_poi_index.getPOI(indices[0]);
+	for (std::vector<int>::iterator it = indices.begin(); it != indices.end(); ++it)
+	{
+		if (m_poi_index.getDistance(*it, LatLon(first.lat, first.lon)) <= 10.0)
+			poi_vec.push_back(m_poi_index.getPOI(*it));
+	}
+
+	return poi_vec;
 }
 
 std::vector<POI> MapManager::getPOI_sorting(const std::string poi_name, LatLon cur_latlon)
 {
+	DG_TRACE_SCOPE("MapManager::getPOI_sorting(name)");
 	std::wstring name;
 	utf8to16(poi_name.c_str(), name);
-	auto found = lookup_pois_name.find(name);
-	if (found == lookup_pois_name.end())
+	std::vector<int> indices;
+	if (m_poi_index.findExact(name, indices) <= 0)
 		return std::vector<POI>();
 
-	return getPOI_sorting(poi_name, found->second, 10.0, cur_latlon);
+	// The POIs with the same name within 10 m from the first one (sorted by the distance from current location)
+	std::vector<std::pair<double, int>> pois_dist;
+	const POI& first = m_poi_index.getPOI(indices[0]);
+	for (std::vector<int>::iterator it = indices.begin(); it != indices.end(); ++it)
+	{
+		if (m_poi_index.getDistance(*it, LatLon(first.lat, first.lon)) <= 10.0)
+			pois_dist.push_back(std::make_pair(m_poi_index.getDistance(*it, cur_latlon), *it));
+	}
+	std::sort(pois_dist.begin(), pois_dist.end());
+
+	std::vector<POI> poi_vec;
+	for (std::vector<std::pair<double, int>>::iterator it = pois_dist.begin(); it != pois_dist.end(); ++it)
+		poi_vec.push_back(m_poi_index.getPOI(it->second));
+
+	return poi_vec;
+}
+
+std::vector<POIIndex::Result> MapManager::searchPOI(const std::string query, int max_results)
+{
+	DG_TRACE_SCOPE("MapManager::searchPOI");
+	std::wstring text;
+	utf8to16(query.c_str(), text);
+	std::vector<POIIndex::Result> results;
+	m_poi_index.search(text, results, max_results);
+	return results;
+}
+
+std::vector<POIIndex::Result> MapManager::searchPOI(const std::string query, LatLon cur_latlon, int max_results, double radius)
+{
+	DG_TRACE_SCOPE("MapManager::searchPOI");
+	std::wstring text;
+	utf8to16(query.c_str(), text);
+	std::vector<POIIndex::Result> results;
+	m_poi_index.search(text, cur_latlon, radius, results, max_results);
+	return results;
 }
 
 bool MapManager::downloadStreetView(double lat, double lon, double radius)
@@ -1305,6 +1445,8 @@ bool MapManager::downloadStreetView_sv(ID sv_id, double radius)
 
 bool MapManager::parseStreetView(const char* json)
 {
+	DG_TRACE_SCOPE("MapManager::parseStreetView");
+	m_snapshot = nullptr; // Street-views are replaced without a new map version, so the next snapshot is copied again
 	Document document;
 	document.Parse(json);
 
@@ -1473,41 +1615,56 @@ size_t MapManager::writeImage_callback(char* ptr, size_t size, size_t nmemb, voi
 	return count;
 }
 
+bool MapManager::queryBytes2server(const std::string& url, std::vector<uchar>& bytes, int timeout)
+{
+	DG_TRACE_SCOPE("MapManager::queryBytes2server");
+
+	// A curl handle per thread, which is cleaned up when the thread exits
+	struct CurlHandle
+	{
+		CurlHandle() { curl = curl_easy_init(); }
+		~CurlHandle() { if (curl) curl_easy_cleanup(curl); }
+		CURL* curl;
+	};
+	static std::once_flag curl_init;
+	std::call_once(curl_init, []() { curl_global_init(CURL_GLOBAL_ALL); });
+	static thread_local CurlHandle handle;
+	if (handle.curl == nullptr) return false;
+
+	// Reset options, but keep the connection alive
+	CURL* curl = handle.curl;
+	curl_easy_reset(curl);
+	bytes.clear();
+	curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+	curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, writeImage_callback);
+	curl_easy_setopt(curl, CURLOPT_WRITEDATA, &bytes);
+	curl_easy_setopt(curl, CURLOPT_TIMEOUT, timeout);
+	curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+
+	CURLcode res = curl_easy_perform(curl);
+	if (res != CURLE_OK)
+	{
+		fprintf(stderr, "curl_easy_perform() failed: %s\n", curl_easy_strerror(res));
+		bytes.clear();
+		return false;
+	}
+	return !bytes.empty();
+}
+
 cv::Mat MapManager::queryImage2server(std::string url, int timeout)
 {
+	DG_TRACE_SCOPE("MapManager::queryImage2server");
 #ifdef _WIN32
 	SetConsoleOutputCP(65001);
 #endif
 
 	std::vector<uchar> stream;
-	curl_global_init(CURL_GLOBAL_ALL);
-	CURL* curl = curl_easy_init();
-	CURLcode res;
-
-	if (curl)
+	if (queryBytes2server(url, stream, timeout))
 	{
-		curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-		curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, writeImage_callback);
-		curl_easy_setopt(curl, CURLOPT_WRITEDATA, &stream);
-		curl_easy_setopt(curl, CURLOPT_TIMEOUT, timeout);
-
-		// Perform the request, res will get the return code.
-		res = curl_easy_perform(curl);
-
-		// Always cleanup.
-		curl_easy_cleanup(curl);
-		curl_global_cleanup();
-
-		// Check for errors.
-		if (res == CURLE_OK && !stream.empty())
-		{
-			const unsigned char* novalid = reinterpret_cast<const unsigned char*>("No valid");
-			unsigned char part[8] = { stream[0], stream[1], stream[2], stream[3], stream[4], stream[5], stream[6], stream[7] };
-			if (*part == *novalid)
-				m_portErr = true;
+		if (stream.size() >= 8 && memcmp(stream.data(), "No valid", 8) == 0)
+			m_portErr = true;
 
-			return cv::imdecode(stream, -1);      
-		}
+		return cv::imdecode(stream, -1);
 	}
 
 	return cv::Mat();
@@ -1528,23 +1685,78 @@ cv::Mat MapManager::downloadStreetViewImage(ID sv_id, const std::string cubic, i
 	}
 }
 
+bool MapManager::fetchStreetViewImage(ID sv_id, const std::string& cubic, std::vector<uchar>& bytes, int timeout)
+{
+	const char* url_middles[] = { ":10000/", ":10001/" };
+	for (int i = 0; i < 2; i++)
+	{
+		std::string url = "http://" + m_ip + url_middles[i] + std::to_string(sv_id);
+		if (cubic != "") url += "/" + cubic;
+		if (!queryBytes2server(url, bytes, timeout)) return false;
+
+		// The server responds "No valid ..." if the image is served by the other port
+		if (bytes.size() < 8 || memcmp(bytes.data(), "No valid", 8) != 0) return true;
+	}
+	bytes.clear();
+	return false;
+}
+
 bool MapManager::getStreetViewImage(ID sv_id, cv::Mat& sv_image, std::string cubic, int timeout)
+{
+	DG_TRACE_SCOPE("MapManager::getStreetViewImage");
+	if (!(cubic == "f" || cubic == "b" || cubic == "l" || cubic == "r" || cubic == "u" || cubic == "d"))
+		cubic = "";
+
+	// Two ports can be tried in a fetch
+	return m_sv_cache.get(sv_id, sv_image, cubic, 2 * timeout + 1, timeout);
+}
+
+std::shared_future<cv::Mat> MapManager::requestStreetViewImage(ID sv_id, std::string cubic)
 {
 	if (!(cubic == "f" || cubic == "b" || cubic == "l" || cubic == "r" || cubic == "u" || cubic == "d"))
 		cubic = "";
 
-	sv_image = downloadStreetViewImage(sv_id, cubic, timeout);
+	return m_sv_cache.request(sv_id, cubic);
+}
+
+int MapManager::prefetchStreetViewImages(const std::vector<ID>& sv_ids, std::string cubic)
+{
+	if (!(cubic == "f" || cubic == "b" || cubic == "l" || cubic == "r" || cubic == "u" || cubic == "d"))
+		cubic = "";
+
+	return m_sv_cache.prefetch(sv_ids, cubic);
+}
 
-	if (m_portErr == true)
+int MapManager::prefetchStreetViewImages(const Path& path, const Map& map, double radius, int max_nodes, std::string cubic)
+{
+	DG_TRACE_SCOPE("MapManager::prefetchStreetViewImages");
+
+	// Collect StreetViews of the given map near the path nodes (nearer views first, without querying the server)
+	const double meter_per_deg = 6378137 * CV_PI / 180;
+	std::vector<ID> sv_ids;
+	std::set<ID> sv_found;
+	std::vector<std::pair<double, ID>> sv_near;
+	int n_nodes = 0;
+	for (auto pt = path.pts.begin(); pt != path.pts.end() && n_nodes < max_nodes; pt++, n_nodes++)
 	{
-		const std::string url_middle = ":10001/";
-		sv_image = downloadStreetViewImage(sv_id, cubic, timeout, url_middle);
-		m_portErr = false;
+		const Node* node = map.findNode(pt->node_id);
+		if (node == nullptr) continue;
+		double cos_lat = cos(node->lat * CV_PI / 180);
+		sv_near.clear();
+		for (auto sv = map.views.begin(); sv != map.views.end(); sv++)
+		{
+			double dx = (sv->lon - node->lon) * meter_per_deg * cos_lat, dy = (sv->lat - node->lat) * meter_per_deg;
+			double d2 = dx * dx + dy * dy;
+			if (d2 <= radius * radius) sv_near.push_back(std::make_pair(d2, sv->id));
+		}
+		std::sort(sv_near.begin(), sv_near.end());
+		for (auto sv = sv_near.begin(); sv != sv_near.end(); sv++)
+		{
+			if (sv_found.insert(sv->second).second) sv_ids.push_back(sv->second);
+		}
 	}
 
-	if (sv_image.empty())	return false;
-
-	return true;
+	return prefetchStreetViewImages(sv_ids, cubic);
 }
 
 } // End of 'dg'
@@ -8,6 +8,8 @@
 #include "rapidjson/stringbuffer.h"
 #include "rapidjson/prettywriter.h"
 #include <fstream>
+#include <set>
+#include <cstring>
 using namespace rapidjson;
 
 #define CURL_STATICLIB
@@ -28,6 +30,11 @@ using namespace rapidjson;
 #include <atlstr.h> 
 #endif
 #include "localizer/utm_converter.hpp"
+#include "utils/metrics.hpp"
+#include "map_manager/path_planner.hpp"
+#include "map_manager/contraction_hierarchy.hpp"
+#include "map_manager/streetview_cache.hpp"
+#include "map_manager/poi_index.hpp"
 #define M_PI 3.14159265358979323846
 
 namespace dg
@@ -52,6 +59,7 @@ public:
 		m_isMap = false;
 		m_ip = "localhost";
 		m_portErr = false;
+		m_sv_cache.setFetcher([this](ID sv_id, const std::string& cubic, std::vector<uchar>& bytes, int timeout) { return fetchStreetViewImage(sv_id, cubic, bytes, timeout); });
 	}
 
 	/**
@@ -59,6 +67,7 @@ public:
 	 */
 	~MapManager()
 	{
+		m_sv_cache.stop();
 		if (m_isMap)
 		{
 			delete m_map;
@@ -144,6 +153,13 @@ public:
 	 */
 	Map& getMap();
 
+	/**
+	 * Get a shared, read-only copy of the current topological map
+	 * The copy is made once whenever the map topology is changed and shared with all callers until the next change.
+	 * @return A snapshot of the current map (`nullptr` if no map)
+	 */
+	MapSnapshot getMapSnapshot();
+
 	/**
 	 * Get the path from the origin to the destination
 	 * @param start_lat The given origin latitude of this path (Unit: [deg])
@@ -167,6 +183,40 @@ public:
 	 * @return True if successful (false if failed)
 	 */
 	bool getPath_expansion(double start_lat, double start_lon, double dest_lat, double dest_lon, Path& path, int num_paths = 2);
+
+	/**
+	 * Get the path on the current topological map without the routing server
+	 * @param start_lat The given origin latitude of this path (Unit: [deg])
+	 * @param start_lon The given origin longitude of this path (Unit: [deg])
+	 * @param dest_lat The given destination latitude of this path (Unit: [deg])
+	 * @param dest_lon The given destination longitude of this path (Unit: [deg])
+	 * @param path A reference to gotten path (the shortest one)
+	 * @param profile The cost profile of edge types
+	 * @return True if successful (false if failed)
+	 */
+	bool getPath_local(double start_lat, double start_lon, double dest_lat, double dest_lon, Path& path, const PathCostProfile& profile = PathCostProfile());
+
+	/**
+	 * Get alternative paths on the current topological map without the routing server
+	 * The shortest path becomes the current path of the map manager.
+	 * @param start_lat The given origin latitude of this path (Unit: [deg])
+	 * @param start_lon The given origin longitude of this path (Unit: [deg])
+	 * @param dest_lat The given destination latitude of this path (Unit: [deg])
+	 * @param dest_lon The given destination longitude of this path (Unit: [deg])
+	 * @param paths A reference to gotten paths (sorted by their costs)
+	 * @param num_paths The maximum number of paths (default: 2)
+	 * @param profile The cost profile of edge types
+	 * @return True if successful (false if failed)
+	 */
+	bool getPath_local(double start_lat, double start_lon, double dest_lat, double dest_lon, std::vector<Path>& paths, int num_paths = 2, const PathCostProfile& profile = PathCostProfile());
+
+	/**
+	 * Load a precomputed contraction hierarchy for getPath_local()
+	 * It is used instead of the path planner when its cost profile is the requested one and its path is valid on the current map.
+	 * @param filename The filename of the hierarchy (built by the 'route_hierarchy' example)
+	 * @return True if successful (false if failed)
+	 */
+	bool loadHierarchy(const std::string& filename);
 	
 	/**
 	 * Read the path from the given file
@@ -252,7 +302,7 @@ public:
 	std::vector<POI> getPOI_sorting(const std::string poi_name, LatLon latlon, double radius, LatLon cur_latlon);
 
 	/**
-	 * Get the POIs corresponding to a certain POI name
+	 * Get the POIs corresponding to a certain POI name (served from the POI index without the server)
 	 * @param poi_name The given POI name of this POI
 	 * @return A vector of gotten POIs
 	 */
@@ -266,6 +316,30 @@ public:
 	 */
 	std::vector<POI> getPOI_sorting(const std::string poi_name, LatLon cur_latlon);
 
+	/**
+	 * Search POIs by prefix, substring, and typo-tolerant matching of their names
+	 * @param query The query text in UTF-8 (e.g. a partially typed name)
+	 * @param max_results The maximum number of results
+	 * @return The found POIs (ranked by their match types and edit distances)
+	 */
+	std::vector<POIIndex::Result> searchPOI(const std::string query, int max_results = 10);
+
+	/**
+	 * Search POIs by prefix, substring, and typo-tolerant matching of their names around the current location
+	 * @param query The query text in UTF-8 (e.g. a partially typed name)
+	 * @param cur_latlon The given latitude and longitude of current location (Unit: [deg])
+	 * @param max_results The maximum number of results
+	 * @param radius The search radius from the current location (Unit: [m], non-positive: unlimited)
+	 * @return The found POIs (ranked by their match types, edit distances, and distances from the current location)
+	 */
+	std::vector<POIIndex::Result> searchPOI(const std::string query, LatLon cur_latlon, int max_results = 10, double radius = -1);
+
+	/**
+	 * Get the POI name index
+	 * @return A reference to the POI name index
+	 */
+	const POIIndex& getPOIIndex() const { return m_poi_index; }
+
 	/**
 	 * Get the StreetViews within a certain radius based on latitude and longitude
 	 * @param lat The given latitude of these StreetViews (Unit: [deg])
@@ -326,14 +400,57 @@ public:
 	 */
 	bool getStreetViewImage(ID sv_id, cv::Mat& sv_image, std::string cubic = "", int timeout = 10);
 
+	/**
+	 * Request the StreetView image corresponding to a certain StreetView ID asynchronously
+	 * @param sv_id The given StreetView ID of this StreetView image
+	 * @param cubic The face of an image cube - 360: "", front: "f", back: "b", left: "l", right: "r", up: "u", down: "d" (default: "")
+	 * @return The future of the StreetView image (empty if failed)
+	 */
+	std::shared_future<cv::Mat> requestStreetViewImage(ID sv_id, std::string cubic = "");
+
+	/**
+	 * Prefetch the StreetView images in the background
+	 * @param sv_ids The given StreetView IDs of these StreetView images (in the order of prefetching)
+	 * @param cubic The face of an image cube - 360: "", front: "f", back: "b", left: "l", right: "r", up: "u", down: "d" (default: "f")
+	 * @return The number of images to be downloaded
+	 */
+	int prefetchStreetViewImages(const std::vector<ID>& sv_ids, std::string cubic = "f");
+
+	/**
+	 * Prefetch the StreetView images near a path in the background
+	 * The StreetViews are selected from the given map, so neither the server is queried nor the current map is changed.
+	 * @param path The given path
+	 * @param map The map which contains the path and StreetViews (e.g. a snapshot of the current map)
+	 * @param radius The given radius of StreetViews from each node (Unit: [m])
+	 * @param max_nodes The maximum number of nodes from the start of the path
+	 * @param cubic The face of an image cube - 360: "", front: "f", back: "b", left: "l", right: "r", up: "u", down: "d" (default: "f")
+	 * @return The number of images to be downloaded
+	 */
+	int prefetchStreetViewImages(const Path& path, const Map& map, double radius = 10.0, int max_nodes = 10, std::string cubic = "f");
+
+	/**
+	 * Get the StreetView image cache (e.g. to set its disk directory and memory budget)
+	 * @return A reference to the StreetView image cache
+	 */
+	StreetViewCache& getStreetViewCache() { return m_sv_cache; }
+
 protected:
 	Map* m_map;
 	Path m_path;
 	std::string m_json;
 	/** A hash table for finding Path points */
 	std::map<ID, LatLon> lookup_path;
-	/** A hash table for finding POIs by name */
-	std::map<std::wstring, LatLon> lookup_pois_name;
+	/** A local path planner built on the current map */
+	PathPlanner m_planner;
+	/** The map version when the planner was built (the planner is rebuilt when the map is changed) */
+	size_t m_planner_version = 0;
+	/** A precomputed contraction hierarchy (optional) */
+	ContractionHierarchy m_hierarchy;
+	/** The latest snapshot of the map and the map versions (the version is increased whenever the map topology is changed) */
+	MapSnapshot m_snapshot;
+	size_t m_map_version = 0, m_snapshot_version = 0;
+	/** A text index for finding POIs by name */
+	POIIndex m_poi_index;
 	///** A hash table for finding POIs by ID */
 	//std::map<ID, LatLon> lookup_pois_id;
 	///** A hash table for finding StreetViews */
@@ -355,6 +472,18 @@ protected:
 	 * @return The size of total data
 	 */
 	static size_t write_callback(void* ptr, size_t size, size_t count, void* stream);
+
+	/**
+	 * Build the local path planner if the map is changed
+	 * @return True if the planner is ready (false if failed)
+	 */
+	bool preparePlanner();
+
+	/**
+	 * Set the current path found without the routing server
+	 * @param path The found path
+	 */
+	void setLocalPath(const Path& path);
 		
 	/**
 	 * Request to server and receive response
@@ -541,6 +670,25 @@ protected:
 	 */
 	cv::Mat queryImage2server(std::string url, int timeout = 10);
 
+	/**
+	 * Request data to server and receive it (a curl handle is reused on each thread to keep the connection alive)
+	 * @param url A web address to request to the server
+	 * @param bytes A reference to received data
+	 * @param timeout The timeout value of curl (default: 10)
+	 * @return True if successful (false if failed)
+	 */
+	static bool queryBytes2server(const std::string& url, std::vector<uchar>& bytes, int timeout = 10);
+
+	/**
+	 * Download the compressed StreetView image (the fetch function of the StreetView image cache)
+	 * @param sv_id The given StreetView ID of this StreetView image
+	 * @param cubic The face of an image cube
+	 * @param bytes A reference to downloaded image bytes
+	 * @param timeout The timeout value of curl for each port (default: 10)
+	 * @return True if successful (false if failed)
+	 */
+	bool fetchStreetViewImage(ID sv_id, const std::string& cubic, std::vector<uchar>& bytes, int timeout = 10);
+
 	/**
 	 * Download the StreetView image corresponding to a certain StreetView ID
 	 * @param sv_id The given StreetView ID of this StreetView image
@@ -555,6 +703,8 @@ private:
 	bool m_isMap;
 	std::string m_ip;
 	bool m_portErr;
+	/** The StreetView image cache (declared last to stop its workers first) */
+	StreetViewCache m_sv_cache;
 };
 
 class EdgeTemp : public Edge
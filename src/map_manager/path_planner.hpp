@@ -0,0 +1,550 @@
+#ifndef __PATH_PLANNER__
+#define __PATH_PLANNER__
+
+#include "core/map.hpp"
+#include "core/path.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+namespace dg
+{
+
+/**
+ * @brief Cost profile of path planning
+ *
+ * The cost of an edge is its length multiplied by the factor of its type.
+ * A negative factor forbids the edge type.
+ */
+struct PathCostProfile
+{
+	/** The default profile (every edge type costs its length) */
+	PathCostProfile()
+	{
+		for (int i = 0; i < Edge::TYPE_NUM; i++) factor[i] = 1;
+	}
+
+	/** Pedestrian profile (avoiding stairs and roads, preferring crosswalks) */
+	static PathCostProfile pedestrian()
+	{
+		PathCostProfile profile;
+		profile.factor[Edge::EDGE_ROAD] = 1.2;
+		profile.factor[Edge::EDGE_CROSSWALK] = 0.9;
+		profile.factor[Edge::EDGE_STAIR] = 3;
+		return profile;
+	}
+
+	/** Wheelchair profile (forbidding stairs and escalators) */
+	static PathCostProfile wheelchair()
+	{
+		PathCostProfile profile;
+		profile.factor[Edge::EDGE_ESCALATOR] = -1;
+		profile.factor[Edge::EDGE_STAIR] = -1;
+		return profile;
+	}
+
+	/** The cost factor of each edge type (negative: forbidden) */
+	double factor[Edge::TYPE_NUM];
+};
+
+/**
+ * @brief Shortest path engine on the loaded topological map
+ *
+ * It copies the map into compact adjacency arrays (build()) and finds paths without the routing server.
+ * A* uses the chord distance on the earth as its heuristic, scaled down to stay consistent with the edge lengths.
+ * Alternative paths are found by penalizing the edges of the previously found paths.
+ * The found paths have the same shape as the server output: the last element has zero edge ID.
+ * A planner is not thread-safe because queries share their working buffers.
+ */
+class PathPlanner
+{
+public:
+	/**
+	 * Build the search graph from the given map
+	 * @param map The topological map
+	 * @return True if successful (false if the map has no node)
+	 */
+	bool build(const Map& map)
+	{
+		clear();
+		if (map.nodes.empty()) return false;
+
+		size_t n_nodes = map.nodes.size();
+		m_node_ids.resize(n_nodes);
+		m_node_pos.resize(n_nodes);
+		for (size_t i = 0; i < n_nodes; i++)
+		{
+			const Node& node = map.nodes[i];
+			m_node_ids[i] = node.id;
+			m_node_pos[i] = toUnitSphere(node);
+			m_lookup_nodes.insert(std::make_pair(node.id, (int)i));
+		}
+
+		// collect arcs of both directions and the scale of the heuristic
+		std::vector<std::pair<int, Arc>> out_arcs, in_arcs;
+		out_arcs.reserve(map.edges.size() * 2);
+		in_arcs.reserve(map.edges.size() * 2);
+		m_heuristic_scale = 1;
+		for (size_t i = 0; i < map.edges.size(); i++)
+		{
+			const Edge& edge = map.edges[i];
+			auto found1 = m_lookup_nodes.find(edge.node_id1);
+			auto found2 = m_lookup_nodes.find(edge.node_id2);
+			if (found1 == m_lookup_nodes.end() || found2 == m_lookup_nodes.end()) continue;
+
+			int edge_idx = (int)m_edge_ids.size();
+			double chord = chordDistance(found1->second, found2->second);
+			double length = (edge.length > 0) ? edge.length : chord;
+			if (chord > 0) m_heuristic_scale = std::min(m_heuristic_scale, length / chord);
+			m_edge_ids.push_back(edge.id);
+			m_lookup_edges.insert(std::make_pair(edge.id, edge_idx));
+			m_edge_length.push_back(length);
+			m_edge_type.push_back((edge.type >= 0 && edge.type < Edge::TYPE_NUM) ? edge.type : Edge::EDGE_SIDEWALK);
+
+			out_arcs.push_back(std::make_pair(found1->second, Arc(found2->second, edge_idx)));
+			in_arcs.push_back(std::make_pair(found2->second, Arc(found1->second, edge_idx)));
+			if (!edge.directed)
+			{
+				out_arcs.push_back(std::make_pair(found2->second, Arc(found1->second, edge_idx)));
+				in_arcs.push_back(std::make_pair(found1->second, Arc(found2->second, edge_idx)));
+			}
+		}
+		buildAdjacency(n_nodes, out_arcs, m_out_offset, m_out_arcs);
+		buildAdjacency(n_nodes, in_arcs, m_in_offset, m_in_arcs);
+
+		for (int dir = 0; dir < 2; dir++)
+		{
+			m_g[dir].resize(n_nodes);
+			m_parent_node[dir].resize(n_nodes);
+			m_parent_edge[dir].resize(n_nodes);
+		}
+		m_stamp[0].assign(n_nodes, 0);
+		m_stamp[1].assign(n_nodes, 0);
+		m_closed[0].assign(n_nodes, 0);
+		m_closed[1].assign(n_nodes, 0);
+		m_penalty.assign(m_edge_ids.size(), 1);
+		m_query = 0;
+		return true;
+	}
+
+	void clear()
+	{
+		m_node_ids.clear();
+		m_node_pos.clear();
+		m_lookup_nodes.clear();
+		m_edge_ids.clear();
+		m_lookup_edges.clear();
+		m_edge_length.clear();
+		m_edge_type.clear();
+		m_out_offset.clear();
+		m_out_arcs.clear();
+		m_in_offset.clear();
+		m_in_arcs.clear();
+		m_penalty.clear();
+		m_n_expanded = 0;
+	}
+
+	bool isBuilt() const { return !m_node_ids.empty(); }
+
+	size_t countNodes() const { return m_node_ids.size(); }
+
+	size_t countEdges() const { return m_edge_ids.size(); }
+
+	/** Get the number of expanded nodes by the last query */
+	size_t countExpanded() const { return m_n_expanded; }
+
+	/**
+	 * Set the maximum distance between a given position and its nearest node
+	 * @param dist The maximum distance (Unit: [m], non-positive: unlimited)
+	 */
+	void setMaxSnapDistance(double dist) { m_max_snap_dist = dist; }
+
+	/**
+	 * Find the nearest node of the given position
+	 * @param ll The given position
+	 * @return ID of the nearest node (0 if the graph is empty)
+	 */
+	ID findNearestNode(const LatLon& ll) const
+	{
+		int idx = nearestNode(ll);
+		return (idx < 0) ? 0 : m_node_ids[idx];
+	}
+
+	/**
+	 * Find the shortest path between two nodes using A*
+	 * @param start_id ID of the start node
+	 * @param dest_id ID of the destination node
+	 * @param path The found path
+	 * @param profile The cost profile
+	 * @return True if successful (false if failed)
+	 */
+	bool findPath(ID start_id, ID dest_id, Path& path, const PathCostProfile& profile = PathCostProfile())
+	{
+		int start, dest;
+		if (!findNodeIndex(start_id, start) || !findNodeIndex(dest_id, dest)) return false;
+		return searchAStar(start, dest, profile, path);
+	}
+
+	/**
+	 * Find the shortest path between two positions using A*
+	 * @param start_pos The start position (starting at its nearest node)
+	 * @param dest_pos The destination position (ending at its nearest node)
+	 * @param path The found path
+	 * @param profile The cost profile
+	 * @return True if successful (false if failed)
+	 */
+	bool findPath(const LatLon& start_pos, const LatLon& dest_pos, Path& path, const PathCostProfile& profile = PathCostProfile())
+	{
+		int start = snapNode(start_pos), dest = snapNode(dest_pos);
+		if (start < 0 || dest < 0 || !searchAStar(start, dest, profile, path)) return false;
+		path.start_pos = start_pos;
+		path.dest_pos = dest_pos;
+		return true;
+	}
+
+	/**
+	 * Find the shortest path between two nodes using bidirectional Dijkstra search
+	 * @param start_id ID of the start node
+	 * @param dest_id ID of the destination node
+	 * @param path The found path
+	 * @param profile The cost profile
+	 * @return True if successful (false if failed)
+	 */
+	bool findPathBidirectional(ID start_id, ID dest_id, Path& path, const PathCostProfile& profile = PathCostProfile())
+	{
+		int start, dest;
+		if (!findNodeIndex(start_id, start) || !findNodeIndex(dest_id, dest)) return false;
+		return searchBidirectional(start, dest, profile, path);
+	}
+
+	/**
+	 * Find the shortest path and its alternatives between two positions
+	 * @param start_pos The start position (starting at its nearest node)
+	 * @param dest_pos The destination position (ending at its nearest node)
+	 * @param paths The found paths (the shortest one comes first)
+	 * @param num_paths The number of paths requested
+	 * @param profile The cost profile
+	 * @param penalty The cost factor for the edges of the previously found paths
+	 * @return True if at least one path is found (false if failed)
+	 */
+	bool findPaths(const LatLon& start_pos, const LatLon& dest_pos, std::vector<Path>& paths, int num_paths = 2, const PathCostProfile& profile = PathCostProfile(), double penalty = 1.5)
+	{
+		paths.clear();
+		int start = snapNode(start_pos), dest = snapNode(dest_pos);
+		if (start < 0 || dest < 0 || num_paths < 1) return false;
+
+		std::vector<int> penalized;
+		for (int trial = 0; trial < 2 * num_paths && (int)paths.size() < num_paths; trial++)
+		{
+			Path path;
+			if (!searchAStar(start, dest, profile, path)) break;
+			bool duplicated = false;
+			for (auto p = paths.begin(); p != paths.end() && !duplicated; p++)
+				duplicated = isSamePath(*p, path);
+			if (!duplicated)
+			{
+				path.start_pos = start_pos;
+				path.dest_pos = dest_pos;
+				paths.push_back(path);
+			}
+
+			// penalize the edges of the found path for the next search
+			for (auto& pt : path.pts)
+			{
+				if (pt.edge_id == 0) continue;
+				int edge_idx = m_lookup_edges[pt.edge_id];
+				if (m_penalty[edge_idx] == 1) penalized.push_back(edge_idx);
+				m_penalty[edge_idx] *= penalty;
+			}
+		}
+		for (auto idx = penalized.begin(); idx != penalized.end(); idx++) m_penalty[*idx] = 1;
+		return !paths.empty();
+	}
+
+	/**
+	 * Calculate the cost of the given path
+	 * @param path The given path
+	 * @param profile The cost profile
+	 * @return The cost of the path (negative if the path is not valid on the graph)
+	 */
+	double getPathCost(const Path& path, const PathCostProfile& profile = PathCostProfile()) const
+	{
+		double cost = 0;
+		for (size_t i = 0; i + 1 < path.pts.size(); i++)
+		{
+			int from, to;
+			if (!findNodeIndex(path.pts[i].node_id, from) || !findNodeIndex(path.pts[i + 1].node_id, to)) return -1;
+			double best = -1;
+			for (int a = m_out_offset[from]; a < m_out_offset[from + 1]; a++)
+			{
+				const Arc& arc = m_out_arcs[a];
+				if (arc.node != to || m_edge_ids[arc.edge] != path.pts[i].edge_id) continue;
+				double f = profile.factor[m_edge_type[arc.edge]];
+				if (f >= 0) best = m_edge_length[arc.edge] * f;
+			}
+			if (best < 0) return -1;
+			cost += best;
+		}
+		return cost;
+	}
+
+protected:
+	struct Arc
+	{
+		Arc(int _node = 0, int _edge = 0) : node(_node), edge(_edge) { }
+		int node;
+		int edge;
+	};
+
+	struct Pos3
+	{
+		double x, y, z;
+	};
+
+	typedef std::pair<double, int> QueueItem;
+	typedef std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> MinQueue;
+
+	static Pos3 toUnitSphere(const LatLon& ll)
+	{
+		double lat = ll.lat * CV_PI / 180, lon = ll.lon * CV_PI / 180;
+		Pos3 p = { cos(lat) * cos(lon), cos(lat) * sin(lon), sin(lat) };
+		return p;
+	}
+
+	/** Straight-line distance through the earth, which is a lower bound of the great-circle distance [m] */
+	double chordDistance(const Pos3& a, const Pos3& b) const
+	{
+		double dx = a.x - b.x, dy = a.y - b.y, dz = a.z - b.z;
+		return EARTH_RADIUS * sqrt(dx * dx + dy * dy + dz * dz);
+	}
+
+	double chordDistance(int a, int b) const { return chordDistance(m_node_pos[a], m_node_pos[b]); }
+
+	/** Build compressed adjacency arrays where the arcs of the i-th node are adjacency[offset[i]] ~ adjacency[offset[i + 1] - 1] */
+	static void buildAdjacency(size_t n_nodes, const std::vector<std::pair<int, Arc>>& arcs, std::vector<int>& offset, std::vector<Arc>& adjacency)
+	{
+		offset.assign(n_nodes + 1, 0);
+		for (auto a = arcs.begin(); a != arcs.end(); a++) offset[a->first + 1]++;
+		for (size_t i = 0; i < n_nodes; i++) offset[i + 1] += offset[i];
+		adjacency.resize(arcs.size());
+		std::vector<int> fill(offset.begin(), offset.end() - 1);
+		for (auto a = arcs.begin(); a != arcs.end(); a++) adjacency[fill[a->first]++] = a->second;
+	}
+
+	bool findNodeIndex(ID id, int& idx) const
+	{
+		auto found = m_lookup_nodes.find(id);
+		if (found == m_lookup_nodes.end()) return false;
+		idx = found->second;
+		return true;
+	}
+
+	int nearestNode(const LatLon& ll) const
+	{
+		Pos3 p = toUnitSphere(ll);
+		int best = -1;
+		double best_d2 = std::numeric_limits<double>::max();
+		for (size_t i = 0; i < m_node_pos.size(); i++)
+		{
+			double dx = m_node_pos[i].x - p.x, dy = m_node_pos[i].y - p.y, dz = m_node_pos[i].z - p.z;
+			double d2 = dx * dx + dy * dy + dz * dz;
+			if (d2 < best_d2)
+			{
+				best_d2 = d2;
+				best = (int)i;
+			}
+		}
+		return best;
+	}
+
+	/** Get the nearest node within the maximum snapping distance (-1 if not exist) */
+	int snapNode(const LatLon& ll) const
+	{
+		int idx = nearestNode(ll);
+		if (idx >= 0 && m_max_snap_dist > 0 && chordDistance(toUnitSphere(ll), m_node_pos[idx]) > m_max_snap_dist) return -1;
+		return idx;
+	}
+
+	double arcCost(const Arc& arc, const PathCostProfile& profile) const
+	{
+		double f = profile.factor[m_edge_type[arc.edge]];
+		if (f < 0) return -1;
+		return m_edge_length[arc.edge] * f * m_penalty[arc.edge];
+	}
+
+	/** Start a new query by increasing the stamp instead of clearing the working buffers */
+	void beginQuery()
+	{
+		m_query++;
+		if (m_query == 0)
+		{
+			std::fill(m_stamp[0].begin(), m_stamp[0].end(), 0);
+			std::fill(m_stamp[1].begin(), m_stamp[1].end(), 0);
+			std::fill(m_closed[0].begin(), m_closed[0].end(), 0);
+			std::fill(m_closed[1].begin(), m_closed[1].end(), 0);
+			m_query = 1;
+		}
+		m_n_expanded = 0;
+	}
+
+	double distance(int dir, int node) const { return (m_stamp[dir][node] == m_query) ? m_g[dir][node] : std::numeric_limits<double>::max(); }
+
+	bool relax(int dir, int node, double g, int parent_node, int parent_edge)
+	{
+		if (g >= distance(dir, node)) return false;
+		m_stamp[dir][node] = m_query;
+		m_g[dir][node] = g;
+		m_parent_node[dir][node] = parent_node;
+		m_parent_edge[dir][node] = parent_edge;
+		return true;
+	}
+
+	bool searchAStar(int start, int dest, const PathCostProfile& profile, Path& path)
+	{
+		beginQuery();
+		double min_factor = std::numeric_limits<double>::max();
+		for (int i = 0; i < Edge::TYPE_NUM; i++)
+			if (profile.factor[i] >= 0) min_factor = std::min(min_factor, profile.factor[i]);
+		if (min_factor == std::numeric_limits<double>::max()) return false;
+		double h_scale = m_heuristic_scale * min_factor;
+		const Pos3& goal = m_node_pos[dest];
+
+		MinQueue open;
+		relax(0, start, 0, -1, -1);
+		open.push(QueueItem(h_scale * chordDistance(m_node_pos[start], goal), start));
+		while (!open.empty())
+		{
+			int u = open.top().second;
+			open.pop();
+			if (m_closed[0][u] == m_query) continue;
+			m_closed[0][u] = m_query;
+			m_n_expanded++;
+			if (u == dest) return tracePath(start, dest, path);
+
+			double g_u = m_g[0][u];
+			for (int a = m_out_offset[u]; a < m_out_offset[u + 1]; a++)
+			{
+				const Arc& arc = m_out_arcs[a];
+				if (m_closed[0][arc.node] == m_query) continue;
+				double cost = arcCost(arc, profile);
+				if (cost < 0) continue;
+				if (relax(0, arc.node, g_u + cost, u, arc.edge))
+					open.push(QueueItem(g_u + cost + h_scale * chordDistance(m_node_pos[arc.node], goal), arc.node));
+			}
+		}
+		return false;
+	}
+
+	bool searchBidirectional(int start, int dest, const PathCostProfile& profile, Path& path)
+	{
+		beginQuery();
+		MinQueue open[2];
+		relax(0, start, 0, -1, -1);
+		relax(1, dest, 0, -1, -1);
+		open[0].push(QueueItem(0, start));
+		open[1].push(QueueItem(0, dest));
+		double best = std::numeric_limits<double>::max();
+		int meet = -1;
+		while (!open[0].empty() && !open[1].empty())
+		{
+			if (open[0].top().first + open[1].top().first >= best) break;
+			int dir = (open[0].size() <= open[1].size()) ? 0 : 1;
+			int u = open[dir].top().second;
+			double g_u = open[dir].top().first;
+			open[dir].pop();
+			if (m_closed[dir][u] == m_query || g_u > distance(dir, u)) continue;
+			m_closed[dir][u] = m_query;
+			m_n_expanded++;
+
+			const std::vector<int>& offset = dir ? m_in_offset : m_out_offset;
+			const std::vector<Arc>& arcs = dir ? m_in_arcs : m_out_arcs;
+			for (int a = offset[u]; a < offset[u + 1]; a++)
+			{
+				const Arc& arc = arcs[a];
+				double cost = arcCost(arc, profile);
+				if (cost < 0) continue;
+				if (relax(dir, arc.node, g_u + cost, u, arc.edge)) open[dir].push(QueueItem(g_u + cost, arc.node));
+				double through = distance(dir, arc.node) + distance(1 - dir, arc.node);
+				if (distance(1 - dir, arc.node) < std::numeric_limits<double>::max() && through < best)
+				{
+					best = through;
+					meet = arc.node;
+				}
+			}
+		}
+		if (start == dest) meet = start;
+		if (meet < 0) return false;
+
+		// connect the forward half and the backward half at the meeting node
+		Path forward;
+		tracePath(start, meet, forward);
+		path.pts.assign(forward.pts.begin(), forward.pts.end() - 1);
+		int node = meet;
+		while (node != dest)
+		{
+			path.pts.push_back(PathElement(m_node_ids[node], m_edge_ids[m_parent_edge[1][node]]));
+			node = m_parent_node[1][node];
+		}
+		path.pts.push_back(PathElement(m_node_ids[dest], 0));
+		return true;
+	}
+
+	/** Trace the forward search tree from the destination to the start */
+	bool tracePath(int start, int dest, Path& path) const
+	{
+		path.pts.clear();
+		path.pts.push_back(PathElement(m_node_ids[dest], 0));
+		int node = dest;
+		while (node != start)
+		{
+			path.pts.push_back(PathElement(m_node_ids[m_parent_node[0][node]], m_edge_ids[m_parent_edge[0][node]]));
+			node = m_parent_node[0][node];
+		}
+		std::reverse(path.pts.begin(), path.pts.end());
+		return true;
+	}
+
+	static bool isSamePath(const Path& a, const Path& b)
+	{
+		if (a.pts.size() != b.pts.size()) return false;
+		for (size_t i = 0; i < a.pts.size(); i++)
+		{
+			if (a.pts[i].node_id != b.pts[i].node_id || a.pts[i].edge_id != b.pts[i].edge_id) return false;
+		}
+		return true;
+	}
+
+	const double EARTH_RADIUS = 6371000;
+
+	std::vector<ID> m_node_ids;
+	std::vector<Pos3> m_node_pos;
+	std::unordered_map<ID, int> m_lookup_nodes;
+	std::vector<ID> m_edge_ids;
+	std::unordered_map<ID, int> m_lookup_edges;
+	std::vector<double> m_edge_length;
+	std::vector<int> m_edge_type;
+	std::vector<int> m_out_offset;
+	std::vector<Arc> m_out_arcs;
+	std::vector<int> m_in_offset;
+	std::vector<Arc> m_in_arcs;
+	double m_heuristic_scale = 1;
+	double m_max_snap_dist = -1;
+
+	std::vector<double> m_g[2];
+	std::vector<int> m_parent_node[2];
+	std::vector<int> m_parent_edge[2];
+	std::vector<uint32_t> m_stamp[2];
+	std::vector<uint32_t> m_closed[2];
+	std::vector<double> m_penalty;
+	uint32_t m_query = 0;
+	size_t m_n_expanded = 0;
+};
+
+} // End of 'dg'
+
+#endif // End of '__PATH_PLANNER__'
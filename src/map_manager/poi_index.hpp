@@ -0,0 +1,472 @@
+#ifndef __POI_INDEX__
+#define __POI_INDEX__
+
+#include "core/map.hpp"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace dg
+{
+
+/**
+ * @brief In-memory text index of POI names
+ *
+ * A <b>POI index</b> finds POIs by prefix, substring, and typo-tolerant matching of their names.
+ * Names are normalized before indexing and searching: letters are lowercased, spaces and punctuation are removed,
+ * and Hangul syllables are decomposed into jamo, so a partially typed syllable (e.g. "스타벅ㅅ") still matches.
+ * Prefixes are found on sorted names, substrings on an inverted index of jamo 4-grams,
+ * and typos by the edit distance of candidates which share enough 4-grams with the query.
+ * Results are ranked by their match types, edit distances, and distances to the user.
+ * This class is thread-safe for searching after building.
+ */
+class POIIndex
+{
+public:
+	/** Match types (a smaller one is better) */
+	enum
+	{
+		MATCH_EXACT = 0,
+		MATCH_PREFIX = 1,
+		MATCH_SUBSTRING = 2,
+		MATCH_FUZZY = 3
+	};
+
+	/** A search result */
+	struct Result
+	{
+		/** The found POI */
+		POI poi;
+
+		/** The match type */
+		int match;
+
+		/** The edit distance of the name (only for MATCH_FUZZY) */
+		int edits;
+
+		/** The distance from the user (Unit: [m], negative if the user position is not given) */
+		double distance;
+	};
+
+	/**
+	 * Build the index of the given POIs (the previous index is removed)
+	 * @param pois The POIs to index
+	 * @return True if successful (false if no POI is given)
+	 */
+	bool build(const std::vector<POI>& pois)
+	{
+		clear();
+		if (pois.empty()) return false;
+		m_pois = pois;
+
+		// Project positions on a local plane around their mean latitude
+		double lat_sum = 0;
+		for (auto poi = pois.begin(); poi != pois.end(); poi++) lat_sum += poi->lat;
+		m_cos_lat = cos(lat_sum / pois.size() * CV_PI / 180);
+		m_xy.resize(pois.size());
+		for (size_t i = 0; i < pois.size(); i++) m_xy[i] = toXY(pois[i]);
+
+		// Group POIs by their names
+		std::unordered_map<std::wstring, int> name2idx;
+		for (size_t i = 0; i < pois.size(); i++)
+		{
+			auto found = name2idx.insert(std::make_pair(pois[i].name, (int)m_names.size()));
+			if (found.second)
+			{
+				Name name;
+				name.text = pois[i].name;
+				name.key = normalize(pois[i].name);
+				m_names.push_back(name);
+			}
+			m_names[found.first->second].pois.push_back((int)i);
+		}
+
+		// Sort normalized names for prefix search and build gram postings for substring and fuzzy search
+		m_sorted.resize(m_names.size());
+		for (size_t n = 0; n < m_names.size(); n++)
+		{
+			m_sorted[n] = (int)n;
+			const std::wstring& key = m_names[n].key;
+			for (size_t k = 0; k + GRAM_LENGTH <= key.size(); k++)
+			{
+				std::vector<int>& posting = m_grams[toGram(key, k)];
+				if (posting.empty() || posting.back() != (int)n) posting.push_back((int)n);
+			}
+		}
+		std::sort(m_sorted.begin(), m_sorted.end(), [this](int a, int b) { return m_names[a].key < m_names[b].key; });
+		return true;
+	}
+
+	/**
+	 * Remove all POIs
+	 */
+	void clear()
+	{
+		m_pois.clear();
+		m_xy.clear();
+		m_names.clear();
+		m_sorted.clear();
+		m_grams.clear();
+		m_cos_lat = 1;
+	}
+
+	/**
+	 * Get the number of indexed POIs
+	 * @return The number of POIs
+	 */
+	size_t size() const { return m_pois.size(); }
+
+	/**
+	 * Get an indexed POI
+	 * @param index The index of the POI
+	 * @return The POI
+	 */
+	const POI& getPOI(int index) const { return m_pois[index]; }
+
+	/**
+	 * Find POIs whose names are exactly the same with the given name (not normalized)
+	 * @param name The name of POIs
+	 * @param indices The indices of the found POIs (in the order of indexing)
+	 * @return The number of found POIs
+	 */
+	int findExact(const std::wstring& name, std::vector<int>& indices) const
+	{
+		indices.clear();
+		std::wstring key = normalize(name);
+		auto first = std::lower_bound(m_sorted.begin(), m_sorted.end(), key, [this](int n, const std::wstring& k) { return m_names[n].key < k; });
+		for (auto n = first; n != m_sorted.end() && m_names[*n].key == key; n++)
+		{
+			if (m_names[*n].text == name) indices.insert(indices.end(), m_names[*n].pois.begin(), m_names[*n].pois.end());
+		}
+		std::sort(indices.begin(), indices.end());
+		return (int)indices.size();
+	}
+
+	/**
+	 * Search POIs by the given query
+	 * @param query The query text (e.g. a partially typed name)
+	 * @param results The found POIs (ranked by their match types and edit distances)
+	 * @param max_results The maximum number of results
+	 * @param max_edits The maximum edit distance in jamo and letters for typo-tolerant matching (-1: automatically selected by the query length)
+	 * @return The number of results
+	 */
+	int search(const std::wstring& query, std::vector<Result>& results, int max_results = 10, int max_edits = -1) const
+	{
+		return search(query, false, LatLon(), -1, results, max_results, max_edits);
+	}
+
+	/**
+	 * Search POIs by the given query near the user
+	 * @param query The query text (e.g. a partially typed name)
+	 * @param user The position of the user
+	 * @param radius The maximum distance from the user (Unit: [m], non-positive: unlimited)
+	 * @param results The found POIs (ranked by their match types, edit distances, and distances from the user)
+	 * @param max_results The maximum number of results
+	 * @param max_edits The maximum edit distance in jamo and letters for typo-tolerant matching (-1: automatically selected by the query length)
+	 * @return The number of results
+	 */
+	int search(const std::wstring& query, const LatLon& user, double radius, std::vector<Result>& results, int max_results = 10, int max_edits = -1) const
+	{
+		return search(query, true, user, radius, results, max_results, max_edits);
+	}
+
+	/**
+	 * Get the distance from an indexed POI
+	 * @param index The index of the POI
+	 * @param p The position to measure
+	 * @return The distance (Unit: [m])
+	 */
+	double getDistance(int index, const LatLon& p) const
+	{
+		Point2 xy = toXY(p);
+		return sqrt((xy.x - m_xy[index].x) * (xy.x - m_xy[index].x) + (xy.y - m_xy[index].y) * (xy.y - m_xy[index].y));
+	}
+
+	/**
+	 * Normalize a text for matching (lowercased letters and decomposed Hangul jamo without spaces and punctuation)
+	 * @param text The text to normalize
+	 * @return The normalized text
+	 */
+	static std::wstring normalize(const std::wstring& text)
+	{
+		// Compatibility jamo of initial consonants and final consonants (compound final consonants are split)
+		static const wchar_t initials[] = { 0x3131, 0x3132, 0x3134, 0x3137, 0x3138, 0x3139, 0x3141, 0x3142, 0x3143, 0x3145, 0x3146, 0x3147, 0x3148, 0x3149, 0x314A, 0x314B, 0x314C, 0x314D, 0x314E };
+		static const wchar_t finals[][2] = { { 0, 0 },
+			{ 0x3131, 0 }, { 0x3132, 0 }, { 0x3131, 0x3145 }, { 0x3134, 0 }, { 0x3134, 0x3148 }, { 0x3134, 0x314E }, { 0x3137, 0 },
+			{ 0x3139, 0 }, { 0x3139, 0x3131 }, { 0x3139, 0x3141 }, { 0x3139, 0x3142 }, { 0x3139, 0x3145 }, { 0x3139, 0x314C }, { 0x3139, 0x314D },
+			{ 0x3139, 0x314E }, { 0x3141, 0 }, { 0x3142, 0 }, { 0x3142, 0x3145 }, { 0x3145, 0 }, { 0x3146, 0 }, { 0x3147, 0 }, { 0x3148, 0 },
+			{ 0x314A, 0 }, { 0x314B, 0 }, { 0x314C, 0 }, { 0x314D, 0 }, { 0x314E, 0 } };
+		static const wchar_t compounds[][3] = { { 0x3133, 0x3131, 0x3145 }, { 0x3135, 0x3134, 0x3148 }, { 0x3136, 0x3134, 0x314E },
+			{ 0x313A, 0x3139, 0x3131 }, { 0x313B, 0x3139, 0x3141 }, { 0x313C, 0x3139, 0x3142 }, { 0x313D, 0x3139, 0x3145 },
+			{ 0x313E, 0x3139, 0x314C }, { 0x313F, 0x3139, 0x314D }, { 0x3140, 0x3139, 0x314E }, { 0x3144, 0x3142, 0x3145 } };
+
+		std::wstring key;
+		key.reserve(3 * text.size());
+		for (auto ch = text.begin(); ch != text.end(); ch++)
+		{
+			wchar_t c = *ch;
+			if (c >= 0xFF01 && c <= 0xFF5E) c = (wchar_t)(c - 0xFEE0); // Full-width ASCII
+			if (c >= L'A' && c <= L'Z') c = (wchar_t)(c - L'A' + L'a');
+			if (c < 128 && !((c >= L'a' && c <= L'z') || (c >= L'0' && c <= L'9'))) continue; // Spaces and punctuation
+			if (c == 0x00B7 || c == 0x3000 || c == 0x30FB) continue; // Middle dots and an ideographic space
+
+			if (c >= 0xAC00 && c <= 0xD7A3)
+			{
+				// A Hangul syllable
+				int s = c - 0xAC00;
+				key.push_back(initials[s / (21 * 28)]);
+				key.push_back((wchar_t)(0x314F + (s / 28) % 21));
+				const wchar_t* f = finals[s % 28];
+				if (f[0]) key.push_back(f[0]);
+				if (f[1]) key.push_back(f[1]);
+				continue;
+			}
+			bool split = false;
+			for (size_t i = 0; i < sizeof(compounds) / sizeof(compounds[0]); i++)
+			{
+				if (c == compounds[i][0])
+				{
+					key.push_back(compounds[i][1]);
+					key.push_back(compounds[i][2]);
+					split = true;
+					break;
+				}
+			}
+			if (!split) key.push_back(c);
+		}
+		return key;
+	}
+
+protected:
+	/** The length of grams in the inverted index (in jamo and letters) */
+	static const size_t GRAM_LENGTH = 4;
+
+	/** A group of POIs with the same name */
+	struct Name
+	{
+		std::wstring text;
+		std::wstring key;
+		std::vector<int> pois;
+	};
+
+	static uint64_t toGram(const std::wstring& key, size_t k)
+	{
+		uint64_t gram = 0;
+		for (size_t i = k; i < k + GRAM_LENGTH; i++) gram = (gram << 16) | (uint64_t)(key[i] & 0xFFFF);
+		return gram;
+	}
+
+	Point2 toXY(const LatLon& ll) const
+	{
+		const double meter_per_deg = 6378137 * CV_PI / 180;
+		return Point2(ll.lon * meter_per_deg * m_cos_lat, ll.lat * meter_per_deg);
+	}
+
+	/**
+	 * Calculate the minimum edit distance between the query and prefixes of the key
+	 * @return The edit distance (max_edits + 1 if it is larger than max_edits)
+	 */
+	static int calcPrefixEdits(const std::wstring& query, const std::wstring& key, int max_edits)
+	{
+		// Only the diagonal band within max_edits is calculated, and the others are regarded as (max_edits + 1)
+		const int n = (int)key.size(), inf = max_edits + 1;
+		static thread_local std::vector<int> prev, curr;
+		if ((int)prev.size() < n + 2)
+		{
+			prev.resize(n + 2);
+			curr.resize(n + 2);
+		}
+		for (int j = 0; j <= std::min(n + 1, inf); j++) prev[j] = std::min(j, inf);
+		for (int i = 1; i <= (int)query.size(); i++)
+		{
+			if (i - max_edits > n) return inf;
+			int lo = std::max(1, i - max_edits), hi = std::min(n, i + max_edits);
+			curr[lo - 1] = (lo == 1) ? std::min(i, inf) : inf;
+			int row_min = curr[lo - 1];
+			for (int j = lo; j <= hi; j++)
+			{
+				int cost = (query[i - 1] == key[j - 1]) ? 0 : 1;
+				curr[j] = std::min(std::min(std::min(prev[j] + 1, curr[j - 1] + 1), prev[j - 1] + cost), inf);
+				row_min = std::min(row_min, curr[j]);
+			}
+			curr[hi + 1] = inf;
+			if (row_min >= inf) return inf;
+			prev.swap(curr);
+		}
+		int edits = inf;
+		for (int j = std::max(0, (int)query.size() - max_edits); j <= std::min(n, (int)query.size() + max_edits); j++) edits = std::min(edits, prev[j]);
+		return edits;
+	}
+
+	int search(const std::wstring& query, bool has_user, const LatLon& user, double radius, std::vector<Result>& results, int max_results, int max_edits) const
+	{
+		results.clear();
+		std::wstring q = normalize(query);
+		if (q.empty() || m_names.empty() || max_results <= 0) return 0;
+		if (max_edits < 0) max_edits = (q.size() >= 12) ? 2 : (q.size() >= 5) ? 1 : 0;
+
+		// Matched names with their match types and edit distances (the scratch marks matched names)
+		struct Match
+		{
+			int name, match, edits;
+		};
+		std::vector<Match> matched;
+		static thread_local std::vector<uint8_t> marked, counts;
+		if (marked.size() < m_names.size())
+		{
+			marked.resize(m_names.size(), 0);
+			counts.resize(m_names.size(), 0);
+		}
+
+		// Exact and prefix matches
+		auto first = std::lower_bound(m_sorted.begin(), m_sorted.end(), q, [this](int n, const std::wstring& k) { return m_names[n].key < k; });
+		for (auto n = first; n != m_sorted.end(); n++)
+		{
+			const std::wstring& key = m_names[*n].key;
+			if (key.compare(0, q.size(), q) != 0) break;
+			Match m = { *n, (key.size() == q.size()) ? MATCH_EXACT : MATCH_PREFIX, 0 };
+			matched.push_back(m);
+			marked[*n] = 1;
+		}
+
+		if (q.size() >= GRAM_LENGTH)
+		{
+			// Collect postings of distinct query grams (shortest first)
+			std::vector<uint64_t> grams;
+			for (size_t k = 0; k + GRAM_LENGTH <= q.size(); k++) grams.push_back(toGram(q, k));
+			std::sort(grams.begin(), grams.end());
+			grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+			std::vector<const std::vector<int>*> postings;
+			for (auto gram = grams.begin(); gram != grams.end(); gram++)
+			{
+				auto found = m_grams.find(*gram);
+				if (found != m_grams.end()) postings.push_back(&found->second);
+			}
+			std::sort(postings.begin(), postings.end(), [](const std::vector<int>* a, const std::vector<int>* b) { return a->size() < b->size(); });
+
+			// Substring matches: verify names in the shortest posting
+			if (postings.size() == grams.size())
+			{
+				for (auto n = postings[0]->begin(); n != postings[0]->end(); n++)
+				{
+					if (marked[*n] || m_names[*n].key.find(q) == std::wstring::npos) continue;
+					Match m = { *n, MATCH_SUBSTRING, 0 };
+					matched.push_back(m);
+					marked[*n] = 1;
+				}
+			}
+
+			// Fuzzy matches (only if not enough): a name within the edit distance shares at least (#grams - GRAM_LENGTH * max_edits) grams with the query,
+			// so it appears in one of the shortest (#postings - #shared + 1) postings, and its other shared grams are counted on the longer postings
+			if (max_edits > 0 && !postings.empty() && (int)matched.size() < max_results)
+			{
+				int min_shared = std::max((int)grams.size() - (int)GRAM_LENGTH * max_edits, 1);
+				int n_short = (int)postings.size() - min_shared + 1;
+				if (n_short > 0)
+				{
+					std::vector<int> touched;
+					for (int p = 0; p < n_short; p++)
+					{
+						for (auto n = postings[p]->begin(); n != postings[p]->end(); n++)
+						{
+							if (counts[*n] == 0) touched.push_back(*n);
+							if (counts[*n] < 255) counts[*n]++;
+						}
+					}
+					for (auto n = touched.begin(); n != touched.end(); n++)
+					{
+						int shared = counts[*n];
+						counts[*n] = 0;
+						if (marked[*n]) continue;
+						for (size_t p = n_short; p < postings.size() && shared < min_shared; p++)
+						{
+							if (shared + (int)(postings.size() - p) < min_shared) break;
+							if (std::binary_search(postings[p]->begin(), postings[p]->end(), *n)) shared++;
+						}
+						if (shared < min_shared) continue;
+						int edits = calcPrefixEdits(q, m_names[*n].key, max_edits);
+						if (edits > max_edits) continue;
+						Match m = { *n, MATCH_FUZZY, edits };
+						matched.push_back(m);
+						marked[*n] = 1;
+					}
+				}
+			}
+		}
+
+		// Rank POIs of matched names
+		struct Candidate
+		{
+			int poi, match, edits;
+			double distance;
+		};
+		std::vector<Candidate> candidates;
+		Point2 user_xy = toXY(user);
+		for (auto m = matched.begin(); m != matched.end(); m++)
+		{
+			marked[m->name] = 0;
+			const Name& name = m_names[m->name];
+			for (auto p = name.pois.begin(); p != name.pois.end(); p++)
+			{
+				double distance = -1;
+				if (has_user)
+				{
+					double dx = m_xy[*p].x - user_xy.x, dy = m_xy[*p].y - user_xy.y;
+					distance = sqrt(dx * dx + dy * dy);
+					if (radius > 0 && distance > radius) continue;
+				}
+				Candidate candidate = { *p, m->match, m->edits, distance };
+				candidates.push_back(candidate);
+			}
+		}
+		auto rank = [this](const Candidate& a, const Candidate& b)
+		{
+			if (a.match != b.match) return a.match < b.match;
+			if (a.edits != b.edits) return a.edits < b.edits;
+			if (a.distance != b.distance) return a.distance < b.distance;
+			if (m_pois[a.poi].name.size() != m_pois[b.poi].name.size()) return m_pois[a.poi].name.size() < m_pois[b.poi].name.size();
+			return a.poi < b.poi;
+		};
+		if ((int)candidates.size() > max_results)
+		{
+			std::partial_sort(candidates.begin(), candidates.begin() + max_results, candidates.end(), rank);
+			candidates.resize(max_results);
+		}
+		else std::sort(candidates.begin(), candidates.end(), rank);
+
+		results.resize(candidates.size());
+		for (size_t i = 0; i < candidates.size(); i++)
+		{
+			results[i].poi = m_pois[candidates[i].poi];
+			results[i].match = candidates[i].match;
+			results[i].edits = candidates[i].edits;
+			results[i].distance = candidates[i].distance;
+		}
+		return (int)results.size();
+	}
+
+	/** The indexed POIs */
+	std::vector<POI> m_pois;
+
+	/** The positions of POIs on the local plane (Unit: [m]) */
+	std::vector<Point2> m_xy;
+
+	/** The cosine of the mean latitude for the local plane */
+	double m_cos_lat = 1;
+
+	/** The groups of POIs with the same name */
+	std::vector<Name> m_names;
+
+	/** The indices of names sorted by their normalized names */
+	std::vector<int> m_sorted;
+
+	/** The inverted index from grams of normalized names to the indices of names (ascending) */
+	std::unordered_map<uint64_t, std::vector<int>> m_grams;
+}; // End of 'POIIndex'
+
+} // End of 'dg'
+
+#endif // End of '__POI_INDEX__'
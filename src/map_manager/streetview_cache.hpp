@@ -0,0 +1,487 @@
+#ifndef __STREETVIEW_CACHE__
+#define __STREETVIEW_CACHE__
+
+#include "core/basic_type.hpp"
+#include "utils/metrics.hpp"
+#include "opencv2/opencv.hpp"
+#include <string>
+#include <vector>
+#include <deque>
+#include <list>
+#include <unordered_map>
+#include <functional>
+#include <future>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdio>
+
+namespace dg
+{
+
+/**
+ * @brief Two-level StreetView image cache with asynchronous fetching
+ *
+ * A <b>StreetView image cache</b> keeps decoded images in memory under a byte budget (LRU) and their compressed bytes on disk.
+ * Images which are not cached are fetched (by the given fetch function) and decoded on a pool of worker threads.
+ * Concurrent requests of the same image (a StreetView ID and a cube face) are coalesced into a single fetch, which uses the fetch timeout of the first request.
+ * Prefetch requests are served after all demand requests, and a new prefetch list replaces the previous one which is not started yet.
+ * Returned images share the cached memory, so they should not be modified.
+ * This class is thread-safe.
+ */
+class StreetViewCache
+{
+public:
+	/** Fetch function of compressed image bytes with its timeout [sec] (it is called on worker threads) */
+	typedef std::function<bool(ID sv_id, const std::string& cubic, std::vector<uchar>& bytes, int timeout)> FetchFunc;
+
+	/**
+	 * The default constructor
+	 * @param memory_bytes The maximum memory of decoded images [byte]
+	 * @param n_workers The number of worker threads
+	 */
+	StreetViewCache(size_t memory_bytes = 256 * 1024 * 1024, int n_workers = 4)
+	{
+		m_memory_limit = memory_bytes;
+		m_memory_bytes = 0;
+		m_n_workers = std::max(n_workers, 1);
+		m_running = false;
+		m_n_hits = 0;
+		m_n_misses = 0;
+		m_n_coalesced = 0;
+		m_n_disk_hits = 0;
+		m_n_fetches = 0;
+	}
+
+	/** The destructor */
+	virtual ~StreetViewCache() { stop(); }
+
+	/**
+	 * Set the fetch function of compressed image bytes
+	 * @param fetch The fetch function
+	 */
+	void setFetcher(FetchFunc fetch)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_fetch = fetch;
+	}
+
+	/**
+	 * Set the directory to store compressed images (it should exist)
+	 * @param dir The directory (empty to disable the disk cache)
+	 */
+	void setDiskDir(const std::string& dir)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_disk_dir = dir;
+	}
+
+	/**
+	 * Set the maximum memory of decoded images
+	 * @param memory_bytes The maximum memory [byte]
+	 */
+	void setMemoryBudget(size_t memory_bytes)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_memory_limit = memory_bytes;
+		evict();
+	}
+
+	/**
+	 * Set the number of worker threads (applied when workers are started)
+	 * @param n_workers The number of worker threads
+	 */
+	void setWorkers(int n_workers) { m_n_workers = std::max(n_workers, 1); }
+
+	/**
+	 * Request an image asynchronously
+	 * @param sv_id The StreetView ID of the image
+	 * @param cubic The face of an image cube - 360: "", front: "f", back: "b", left: "l", right: "r", up: "u", down: "d"
+	 * @param fetch_timeout The timeout of the fetch function [sec]
+	 * @return The future of the image (empty if failed)
+	 */
+	std::shared_future<cv::Mat> request(ID sv_id, const std::string& cubic = "", int fetch_timeout = 10)
+	{
+		return enqueue(sv_id, cubic, false, fetch_timeout);
+	}
+
+	/**
+	 * Get an image (fetched and decoded if not cached)
+	 * @param sv_id The StreetView ID of the image
+	 * @param image The image
+	 * @param cubic The face of an image cube - 360: "", front: "f", back: "b", left: "l", right: "r", up: "u", down: "d"
+	 * @param timeout The maximum waiting time [sec]
+	 * @param fetch_timeout The timeout of the fetch function [sec]
+	 * @return True if successful (false if failed or timed out)
+	 */
+	bool get(ID sv_id, cv::Mat& image, const std::string& cubic = "", double timeout = 10, int fetch_timeout = 10)
+	{
+		std::shared_future<cv::Mat> future = request(sv_id, cubic, fetch_timeout);
+		if (future.wait_for(std::chrono::duration<double>(timeout)) != std::future_status::ready)
+		{
+			image = cv::Mat();
+			return false;
+		}
+		image = future.get();
+		return !image.empty();
+	}
+
+	/**
+	 * Prefetch images in the background (not-started prefetch requests before are cancelled)
+	 * @param sv_ids The StreetView IDs of images (in the order of prefetching)
+	 * @param cubic The face of an image cube - 360: "", front: "f", back: "b", left: "l", right: "r", up: "u", down: "d"
+	 * @param fetch_timeout The timeout of the fetch function [sec]
+	 * @return The number of queued images (not cached yet)
+	 */
+	int prefetch(const std::vector<ID>& sv_ids, const std::string& cubic = "", int fetch_timeout = 10)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			for (auto key = m_prefetch_queue.begin(); key != m_prefetch_queue.end(); key++)
+			{
+				auto job = m_jobs.find(*key);
+				if (job == m_jobs.end() || job->second.started || !job->second.prefetch) continue;
+				job->second.promise->set_value(cv::Mat());
+				m_jobs.erase(job);
+			}
+			m_prefetch_queue.clear();
+		}
+
+		int n_queued = 0;
+		for (auto sv_id = sv_ids.begin(); sv_id != sv_ids.end(); sv_id++)
+		{
+			std::shared_future<cv::Mat> future = enqueue(*sv_id, cubic, true, fetch_timeout);
+			if (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready) n_queued++;
+		}
+		return n_queued;
+	}
+
+	/**
+	 * Check whether an image is in memory or not
+	 * @param sv_id The StreetView ID of the image
+	 * @param cubic The face of an image cube
+	 * @return True if the image is in memory (false if not)
+	 */
+	bool isCached(ID sv_id, const std::string& cubic = "")
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_images.find(getKey(sv_id, cubic)) != m_images.end();
+	}
+
+	/**
+	 * Remove all images in memory (the disk cache is kept)
+	 */
+	void clear()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_images.clear();
+		m_lru.clear();
+		m_memory_bytes = 0;
+	}
+
+	/**
+	 * Stop worker threads (pending requests are finished with empty images)
+	 */
+	void stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (!m_running) return;
+			m_running = false;
+		}
+		m_cv.notify_all();
+		for (auto worker = m_workers.begin(); worker != m_workers.end(); worker++)
+			if (worker->joinable()) worker->join();
+		m_workers.clear();
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (auto job = m_jobs.begin(); job != m_jobs.end(); job++)
+			job->second.promise->set_value(cv::Mat());
+		m_jobs.clear();
+		m_demand_queue.clear();
+		m_prefetch_queue.clear();
+	}
+
+	/** Get the memory of decoded images [byte] */
+	size_t getMemoryBytes()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_memory_bytes;
+	}
+
+	/** Get the number of decoded images in memory */
+	size_t countCachedImages()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_images.size();
+	}
+
+	/** Get the number of requests served from memory */
+	size_t countHits() const { return m_n_hits; }
+
+	/** Get the number of requests not served from memory */
+	size_t countMisses() const { return m_n_misses; }
+
+	/** Get the number of requests merged into another pending request */
+	size_t countCoalesced() const { return m_n_coalesced; }
+
+	/** Get the number of images read from the disk cache */
+	size_t countDiskHits() const { return m_n_disk_hits; }
+
+	/** Get the number of calls of the fetch function */
+	size_t countFetches() const { return m_n_fetches; }
+
+protected:
+	/** A pending request */
+	struct Job
+	{
+		ID sv_id;
+		std::string cubic;
+		int fetch_timeout;
+		std::shared_ptr<std::promise<cv::Mat>> promise;
+		std::shared_future<cv::Mat> future;
+		bool prefetch;
+		bool started;
+	};
+
+	static std::string getKey(ID sv_id, const std::string& cubic)
+	{
+		return cubic.empty() ? std::to_string(sv_id) : std::to_string(sv_id) + "_" + cubic;
+	}
+
+	/**
+	 * Serve a request from memory or queue it
+	 */
+	std::shared_future<cv::Mat> enqueue(ID sv_id, const std::string& cubic, bool prefetch, int fetch_timeout)
+	{
+		std::string key = getKey(sv_id, cubic);
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		// Serve from memory
+		auto cached = m_images.find(key);
+		if (cached != m_images.end())
+		{
+			m_lru.splice(m_lru.begin(), m_lru, cached->second.second);
+			if (!prefetch)
+			{
+				m_n_hits++;
+				DG_COUNT("StreetViewCache::hit", 1);
+			}
+			std::promise<cv::Mat> promise;
+			promise.set_value(cached->second.first);
+			return promise.get_future().share();
+		}
+		if (!prefetch)
+		{
+			m_n_misses++;
+			DG_COUNT("StreetViewCache::miss", 1);
+		}
+
+		// Coalesce with a pending request (a demanded prefetch request is promoted)
+		auto pending = m_jobs.find(key);
+		if (pending != m_jobs.end())
+		{
+			if (!prefetch)
+			{
+				m_n_coalesced++;
+				if (pending->second.prefetch && !pending->second.started)
+				{
+					pending->second.prefetch = false;
+					m_demand_queue.push_back(key);
+					m_cv.notify_one();
+				}
+			}
+			return pending->second.future;
+		}
+
+		if (!m_fetch && m_disk_dir.empty())
+		{
+			std::promise<cv::Mat> promise;
+			promise.set_value(cv::Mat());
+			return promise.get_future().share();
+		}
+
+		// Queue a new request
+		if (!m_running)
+		{
+			m_running = true;
+			for (int i = 0; i < m_n_workers; i++)
+				m_workers.push_back(std::thread(&StreetViewCache::run, this));
+		}
+		Job job;
+		job.sv_id = sv_id;
+		job.cubic = cubic;
+		job.fetch_timeout = fetch_timeout;
+		job.promise = std::make_shared<std::promise<cv::Mat>>();
+		job.future = job.promise->get_future().share();
+		job.prefetch = prefetch;
+		job.started = false;
+		m_jobs[key] = job;
+		if (prefetch) m_prefetch_queue.push_back(key);
+		else m_demand_queue.push_back(key);
+		m_cv.notify_one();
+		return job.future;
+	}
+
+	/**
+	 * Read compressed bytes from the disk cache or fetch them, and decode them
+	 */
+	cv::Mat load(const Job& job, const std::string& key, const std::string& disk_dir, const FetchFunc& fetch)
+	{
+		DG_TRACE_SCOPE("StreetViewCache::load");
+		std::vector<uchar> bytes;
+		std::string path = disk_dir + "/" + key + ".jpg";
+		if (!disk_dir.empty())
+		{
+			FILE* fid = fopen(path.c_str(), "rb");
+			if (fid != nullptr)
+			{
+				fseek(fid, 0, SEEK_END);
+				long size = ftell(fid);
+				fseek(fid, 0, SEEK_SET);
+				if (size > 0)
+				{
+					bytes.resize(size);
+					if (fread(bytes.data(), 1, size, fid) != (size_t)size) bytes.clear();
+				}
+				fclose(fid);
+			}
+		}
+		if (!bytes.empty())
+		{
+			cv::Mat image = cv::imdecode(bytes, cv::IMREAD_UNCHANGED);
+			if (!image.empty())
+			{
+				m_n_disk_hits++;
+				return image;
+			}
+			bytes.clear();
+		}
+
+		if (!fetch) return cv::Mat();
+		m_n_fetches++;
+		if (!fetch(job.sv_id, job.cubic, bytes, job.fetch_timeout) || bytes.empty()) return cv::Mat();
+		cv::Mat image = cv::imdecode(bytes, cv::IMREAD_UNCHANGED);
+		if (!image.empty() && !disk_dir.empty())
+		{
+			// Write to a temporary file first not to leave a broken file
+			std::string temp = path + ".tmp";
+			FILE* fid = fopen(temp.c_str(), "wb");
+			if (fid != nullptr)
+			{
+				bool ok = (fwrite(bytes.data(), 1, bytes.size(), fid) == bytes.size());
+				fclose(fid);
+				if (!ok || rename(temp.c_str(), path.c_str()) != 0) remove(temp.c_str());
+			}
+		}
+		return image;
+	}
+
+	/**
+	 * Evict the least recently used images until the memory is under the budget (the lock should be held)
+	 */
+	void evict()
+	{
+		while (m_memory_bytes > m_memory_limit && !m_lru.empty())
+		{
+			auto victim = m_images.find(m_lru.back());
+			m_memory_bytes -= victim->second.first.total() * victim->second.first.elemSize();
+			m_images.erase(victim);
+			m_lru.pop_back();
+		}
+	}
+
+	/** Serve queued requests until stopped */
+	void run()
+	{
+		while (true)
+		{
+			Job job;
+			std::string key, disk_dir;
+			FetchFunc fetch;
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_cv.wait(lock, [this] { return !m_running || !m_demand_queue.empty() || !m_prefetch_queue.empty(); });
+				if (!m_running) break;
+				std::deque<std::string>& queue = m_demand_queue.empty() ? m_prefetch_queue : m_demand_queue;
+				key = queue.front();
+				queue.pop_front();
+				auto found = m_jobs.find(key);
+				if (found == m_jobs.end() || found->second.started) continue; // Promoted or cancelled
+				found->second.started = true;
+				job = found->second;
+				disk_dir = m_disk_dir;
+				fetch = m_fetch;
+			}
+
+			cv::Mat image = load(job, key, disk_dir, fetch);
+
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				if (!image.empty())
+				{
+					size_t bytes = image.total() * image.elemSize();
+					if (m_images.find(key) == m_images.end() && bytes <= m_memory_limit)
+					{
+						m_lru.push_front(key);
+						m_images[key] = std::make_pair(image, m_lru.begin());
+						m_memory_bytes += bytes;
+						evict();
+					}
+				}
+				m_jobs.erase(key);
+			}
+			job.promise->set_value(image);
+		}
+	}
+
+	/** The fetch function of compressed image bytes */
+	FetchFunc m_fetch;
+
+	/** The directory of compressed images (empty if not used) */
+	std::string m_disk_dir;
+
+	/** The decoded images and their positions in the LRU list */
+	std::unordered_map<std::string, std::pair<cv::Mat, std::list<std::string>::iterator>> m_images;
+
+	/** The keys of decoded images (most recently used first) */
+	std::list<std::string> m_lru;
+
+	/** The maximum memory of decoded images */
+	size_t m_memory_limit;
+
+	/** The memory of decoded images */
+	size_t m_memory_bytes;
+
+	/** The pending requests */
+	std::unordered_map<std::string, Job> m_jobs;
+
+	/** The keys of demand requests */
+	std::deque<std::string> m_demand_queue;
+
+	/** The keys of prefetch requests */
+	std::deque<std::string> m_prefetch_queue;
+
+	/** The number of worker threads */
+	int m_n_workers;
+
+	/** The worker threads */
+	std::vector<std::thread> m_workers;
+
+	/** The flag of worker threads */
+	bool m_running;
+
+	/** The lock of all members */
+	std::mutex m_mutex;
+
+	/** The condition to wake up worker threads */
+	std::condition_variable m_cv;
+
+	/** The statistics of requests */
+	std::atomic<size_t> m_n_hits, m_n_misses, m_n_coalesced, m_n_disk_hits, m_n_fetches;
+}; // End of 'StreetViewCache'
+
+} // End of 'dg'
+
+#endif // End of '__STREETVIEW_CACHE__'
@@ -44,6 +44,8 @@ namespace dg
         */
         bool initialize(const char* module_name = "ocr_recognizer", const char* module_path = "./../src/ocr_recog", const char* class_name = "OCRRecognizer", const char* func_name_init = "initialize", const char* func_name_apply = "apply")
         {
+            DG_TRACE_SCOPE("OCRRecognizer::initialize");
+
             dg::Timestamp t1 = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count() / 1000.0;
 
             PyGILState_STATE state;
@@ -87,6 +89,8 @@ namespace dg
         */
         bool apply(cv::Mat image, dg::Timestamp ts)
         {
+            DG_TRACE_SCOPE("OCRRecognizer::apply");
+
             dg::Timestamp t1 = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count() / 1000.0;
 
             PyGILState_STATE state;
@@ -257,7 +261,7 @@ namespace dg
             }
         }
 
-        void write(std::ofstream& stream, int cam_fnumber = -1) const
+        void write(std::ostream& stream, int cam_fnumber = -1) const
         {
             for (int k = 0; k < m_ocrs.size(); k++)
             {
@@ -3,6 +3,8 @@
 
 #include "dg_core.hpp"
 #include "utils/python_embedding.hpp"
+#include "utils/utility.hpp"
+#include <fstream>
 #include <chrono>
 
 using namespace std;
@@ -22,6 +24,8 @@ namespace dg
         */
         bool initialize(const char* module_name = "road_direction_recognizer", const char* module_path = "./../src/road_recog", const char* class_name = "RoadDirectionRecognizer", const char* func_name_init = "initialize", const char* func_name_apply = "apply")
         {
+            DG_TRACE_SCOPE("RoadDirectionRecognizer::initialize");
+
             dg::Timestamp t1 = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count() / 1000.0;
 
             PyGILState_STATE state;
@@ -63,6 +67,8 @@ namespace dg
         */
         bool apply(cv::Mat image, dg::Timestamp t)
         {
+            DG_TRACE_SCOPE("RoadDirectionRecognizer::apply");
+
             dg::Timestamp t1 = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count() / 1000.0;
 
             PyGILState_STATE state;
@@ -165,6 +171,44 @@ namespace dg
             return m_processing_time;
         }
 
+        void print() const
+        {
+            printf("[%s] proctime = %.3lf, timestamp = %.3lf\n", name(), procTime(), m_timestamp);
+            printf("\tangle: %.2lf (%.2lf)\n", m_angle, m_prob);
+        }
+
+        void write(std::ostream& stream, int cam_fnumber = -1) const
+        {
+            std::string log = cv::format("%.3lf,%d,%s,%.2lf,%.2lf,%.3lf", m_timestamp, cam_fnumber, name(), m_angle, m_prob, m_processing_time);
+            stream << log << std::endl;
+        }
+
+        void read(const std::vector<std::string>& stream)
+        {
+            for (int k = 0; k < (int)stream.size(); k++)
+            {
+                std::vector<std::string> elems = splitStr(stream[k].c_str(), (int)stream[k].length(), ',');
+                if (elems.size() != 6)
+                {
+                    printf("[roadtheta] Invalid log data %s\n", stream[k].c_str());
+                    return;
+                }
+                std::string module_name = elems[2];
+                if (module_name == name())
+                {
+                    m_angle = atof(elems[3].c_str());
+                    m_prob = atof(elems[4].c_str());
+                    m_timestamp = atof(elems[0].c_str());
+                    m_processing_time = atof(elems[5].c_str());
+                }
+            }
+        }
+
+        static const char* name()
+        {
+            return "roadtheta";
+        }
+
     protected:
         double m_angle = -1;
         double m_prob = -1;
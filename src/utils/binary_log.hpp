@@ -0,0 +1,683 @@
+#ifndef __DG_UTILS_BINARY_LOG__
+#define __DG_UTILS_BINARY_LOG__
+
+#include "core/basic_type.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace dg
+{
+
+/** Types of binary log records */
+enum class LogType : uint16_t
+{
+    /** GPS position (LogGPS) */
+    GPS = 1,
+    /** IMU measurement (LogIMU) */
+    IMU = 2,
+    /** Recognizer result (text lines written by the recognizer's write()) */
+    RECOGNIZER = 3,
+    /** Localizer state (LogPose) */
+    POSE = 4,
+    /** Guidance output (LogGuidance followed by its message) */
+    GUIDANCE = 5
+};
+
+#pragma pack(push, 1)
+
+/** Header of a log record (followed by its payload) */
+struct LogRecordHeader
+{
+    uint32_t size;          // size of payload
+    uint16_t type;
+    uint16_t reserved;
+    int32_t fnumber;        // camera frame number (-1 if not related to a camera frame)
+    double timestamp;
+};
+
+/** Header of a log chunk (followed by its records) */
+struct LogChunkHeader
+{
+    uint32_t magic;
+    uint32_t size;          // size of records
+    uint32_t n_records;
+    int32_t fnumber_min;
+    int32_t fnumber_max;
+    double ts_min;
+    double ts_max;
+};
+
+/** An entry of the chunk index written at the end of the log */
+struct LogIndexEntry
+{
+    uint64_t offset;        // file offset of the chunk header
+    uint32_t size;
+    uint32_t n_records;
+    int32_t fnumber_min;
+    int32_t fnumber_max;
+    double ts_min;
+    double ts_max;
+};
+
+/** Trailer of the log which locates the chunk index */
+struct LogTrailer
+{
+    uint64_t index_offset;
+    uint32_t n_chunks;
+    uint32_t magic;
+};
+
+struct LogGPS
+{
+    double lat, lon;
+};
+
+struct LogIMU
+{
+    double ori_w, ori_x, ori_y, ori_z;
+    double angvel_x, angvel_y, angvel_z;
+    double linacc_x, linacc_y, linacc_z;
+};
+
+struct LogPose
+{
+    double x, y, theta;
+    double lat, lon;
+    uint64_t node_id;
+    int32_t edge_idx;
+    double dist;
+    double confidence;
+};
+
+struct LogGuidance
+{
+    int32_t status;
+    int32_t cmd;            // the first action (-1 if no action)
+    uint64_t heading_node_id;
+    double distance_to_remain;
+};
+
+#pragma pack(pop)
+
+static const char LOG_FILE_MAGIC[8] = { 'D', 'G', 'L', 'O', 'G', '0', '0', '1' };
+static const uint32_t LOG_CHUNK_MAGIC = 0x4B4E4843;     // "CHNK"
+static const uint32_t LOG_INDEX_MAGIC = 0x58444E49;     // "INDX"
+
+/**
+ * @brief Append-only writer of binary chunked logs
+ *
+ * Records are appended to an in-memory chunk, and a full chunk is written to the file by a background thread.
+ * Callers only copy their records under a short lock, so they are never blocked by file I/O.
+ * The chunk index is written at the end by close(). If the program is terminated before that, readers rebuild the index by scanning the chunks.
+ */
+class BinaryLogWriter
+{
+public:
+    BinaryLogWriter() : m_file(nullptr), m_running(false), m_n_records(0) {}
+
+    ~BinaryLogWriter() { close(); }
+
+    /**
+     * Open a log file
+     * @param filename The name of the log file
+     * @param chunk_size The size of a chunk to write at once [byte]
+     * @return True if successful (false if failed)
+     */
+    bool open(const std::string& filename, size_t chunk_size = 1 << 16)
+    {
+        close();
+        m_file = fopen(filename.c_str(), "wb");
+        if (m_file == nullptr)
+        {
+            printf("[BinaryLogWriter] Error: can't open %s\n", filename.c_str());
+            return false;
+        }
+        fwrite(LOG_FILE_MAGIC, 1, sizeof(LOG_FILE_MAGIC), m_file);
+        m_offset = sizeof(LOG_FILE_MAGIC);
+        m_chunk_size = chunk_size;
+        m_chunk = Chunk();
+        m_chunk.data.reserve(m_chunk_size);
+        m_index.clear();
+        m_n_records = 0;
+        m_running = true;
+        m_flush_thread = std::thread(&BinaryLogWriter::runFlush, this);
+        return true;
+    }
+
+    /** Write all remaining records and the chunk index, and close the file */
+    void close()
+    {
+        if (!m_running) return;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            pushChunk();
+            m_running = false;
+        }
+        m_flush_cond.notify_all();
+        if (m_flush_thread.joinable()) m_flush_thread.join();
+
+        LogTrailer trailer;
+        trailer.index_offset = m_offset;
+        trailer.n_chunks = (uint32_t)m_index.size();
+        trailer.magic = LOG_INDEX_MAGIC;
+        if (!m_index.empty()) fwrite(m_index.data(), sizeof(LogIndexEntry), m_index.size(), m_file);
+        fwrite(&trailer, sizeof(trailer), 1, m_file);
+        fclose(m_file);
+        m_file = nullptr;
+    }
+
+    bool isOpened() const { return m_running; }
+
+    /**
+     * Append a record
+     * @param type The type of the record
+     * @param ts The timestamp of the record
+     * @param fnumber The camera frame number of the record (-1 if not related to a camera frame)
+     * @param data The payload of the record
+     * @param size The size of the payload
+     * @return True if successful (false if not opened)
+     */
+    bool write(LogType type, Timestamp ts, int fnumber, const void* data, size_t size)
+    {
+        LogRecordHeader header;
+        header.size = (uint32_t)size;
+        header.type = (uint16_t)type;
+        header.reserved = 0;
+        header.fnumber = fnumber;
+        header.timestamp = ts;
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_running) return false;
+        const char* h = (const char*)&header;
+        m_chunk.data.insert(m_chunk.data.end(), h, h + sizeof(header));
+        if (size > 0) m_chunk.data.insert(m_chunk.data.end(), (const char*)data, (const char*)data + size);
+        if (fnumber >= 0 && (m_chunk.fnumber_min < 0 || fnumber < m_chunk.fnumber_min)) m_chunk.fnumber_min = fnumber;
+        if (fnumber > m_chunk.fnumber_max) m_chunk.fnumber_max = fnumber;
+        if (m_chunk.n_records == 0 || ts < m_chunk.ts_min) m_chunk.ts_min = ts;
+        if (m_chunk.n_records == 0 || ts > m_chunk.ts_max) m_chunk.ts_max = ts;
+        m_chunk.n_records++;
+        m_n_records++;
+        if (m_chunk.data.size() >= m_chunk_size) pushChunk();
+        return true;
+    }
+
+    bool writeText(LogType type, Timestamp ts, int fnumber, const std::string& text)
+    {
+        if (text.empty()) return true;
+        return write(type, ts, fnumber, text.data(), text.size());
+    }
+
+    bool writeGPS(const LatLon& gps, Timestamp ts)
+    {
+        LogGPS data;
+        data.lat = gps.lat;
+        data.lon = gps.lon;
+        return write(LogType::GPS, ts, -1, &data, sizeof(data));
+    }
+
+    bool writeIMU(const LogIMU& imu, Timestamp ts)
+    {
+        return write(LogType::IMU, ts, -1, &imu, sizeof(imu));
+    }
+
+    bool writePose(const LogPose& pose, Timestamp ts)
+    {
+        return write(LogType::POSE, ts, -1, &pose, sizeof(pose));
+    }
+
+    bool writeGuidance(const LogGuidance& guidance, const std::string& msg, Timestamp ts)
+    {
+        std::vector<char> data(sizeof(guidance) + msg.size());
+        memcpy(data.data(), &guidance, sizeof(guidance));
+        if (!msg.empty()) memcpy(data.data() + sizeof(guidance), msg.data(), msg.size());
+        return write(LogType::GUIDANCE, ts, -1, data.data(), data.size());
+    }
+
+    /** Get the number of written records */
+    uint64_t countRecords() const { return m_n_records; }
+
+protected:
+    struct Chunk
+    {
+        std::vector<char> data;
+        uint32_t n_records = 0;
+        int32_t fnumber_min = -1;
+        int32_t fnumber_max = -1;
+        double ts_min = 0;
+        double ts_max = 0;
+    };
+
+    /** Pass the current chunk to the flush thread (m_mutex should be locked) */
+    void pushChunk()
+    {
+        if (m_chunk.n_records == 0) return;
+        m_pending.push_back(std::move(m_chunk));
+        m_chunk = Chunk();
+        m_chunk.data.reserve(m_chunk_size);
+        m_flush_cond.notify_one();
+    }
+
+    void runFlush()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true)
+        {
+            m_flush_cond.wait(lock, [&] { return !m_pending.empty() || !m_running; });
+            if (m_pending.empty() && !m_running) break;
+
+            Chunk chunk = std::move(m_pending.front());
+            m_pending.pop_front();
+            lock.unlock();
+
+            LogChunkHeader header;
+            header.magic = LOG_CHUNK_MAGIC;
+            header.size = (uint32_t)chunk.data.size();
+            header.n_records = chunk.n_records;
+            header.fnumber_min = chunk.fnumber_min;
+            header.fnumber_max = chunk.fnumber_max;
+            header.ts_min = chunk.ts_min;
+            header.ts_max = chunk.ts_max;
+            fwrite(&header, sizeof(header), 1, m_file);
+            fwrite(chunk.data.data(), 1, chunk.data.size(), m_file);
+            fflush(m_file);
+
+            LogIndexEntry entry;
+            entry.offset = m_offset;
+            entry.size = header.size;
+            entry.n_records = header.n_records;
+            entry.fnumber_min = header.fnumber_min;
+            entry.fnumber_max = header.fnumber_max;
+            entry.ts_min = header.ts_min;
+            entry.ts_max = header.ts_max;
+            m_index.push_back(entry);
+            m_offset += sizeof(header) + chunk.data.size();
+
+            lock.lock();
+        }
+    }
+
+    FILE* m_file;
+    uint64_t m_offset = 0;
+    size_t m_chunk_size = 1 << 16;
+    Chunk m_chunk;
+    std::deque<Chunk> m_pending;
+    std::vector<LogIndexEntry> m_index;
+    std::thread m_flush_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_flush_cond;
+    std::atomic<bool> m_running;
+    std::atomic<uint64_t> m_n_records;
+};
+
+/**
+ * @brief Random-access reader of binary chunked logs
+ *
+ * The log file is memory-mapped, and records are returned as pointers into the mapped file without copy.
+ * Records of a frame (or a time range) are found by the chunk index, so only a few chunks are scanned.
+ */
+class BinaryLogReader
+{
+public:
+    /** A log record (valid while the reader is opened) */
+    struct Record
+    {
+        LogType type;
+        int fnumber;
+        Timestamp timestamp;
+        const char* data;
+        uint32_t size;
+
+        /** Copy the payload to a fixed-size structure */
+        template <typename T>
+        bool get(T& value) const
+        {
+            if (size < sizeof(T)) return false;
+            memcpy(&value, data, sizeof(T));
+            return true;
+        }
+
+        /** Get the text of RECOGNIZER records (or the message of GUIDANCE records) */
+        std::string text() const
+        {
+            if (type == LogType::GUIDANCE) return (size > sizeof(LogGuidance)) ? std::string(data + sizeof(LogGuidance), size - sizeof(LogGuidance)) : std::string();
+            return std::string(data, size);
+        }
+    };
+
+    BinaryLogReader() {}
+
+    ~BinaryLogReader() { close(); }
+
+    /** Check whether the given file is a binary log */
+    static bool isBinaryLog(const std::string& filename)
+    {
+        FILE* file = fopen(filename.c_str(), "rb");
+        if (file == nullptr) return false;
+        char magic[sizeof(LOG_FILE_MAGIC)];
+        bool ok = fread(magic, 1, sizeof(magic), file) == sizeof(magic) && memcmp(magic, LOG_FILE_MAGIC, sizeof(magic)) == 0;
+        fclose(file);
+        return ok;
+    }
+
+    /**
+     * Open a log file
+     * @param filename The name of the log file
+     * @return True if successful (false if failed)
+     */
+    bool open(const std::string& filename)
+    {
+        close();
+        if (!map(filename))
+        {
+            printf("[BinaryLogReader] Error: can't open %s\n", filename.c_str());
+            return false;
+        }
+        if (m_size < sizeof(LOG_FILE_MAGIC) || memcmp(m_data, LOG_FILE_MAGIC, sizeof(LOG_FILE_MAGIC)) != 0)
+        {
+            printf("[BinaryLogReader] Error: %s is not a binary log\n", filename.c_str());
+            close();
+            return false;
+        }
+        if (!loadIndex()) scanChunks();
+
+        m_n_records = 0;
+        m_fnumber_max = -1;
+        for (auto& entry : m_index)
+        {
+            m_n_records += entry.n_records;
+            if (entry.fnumber_max > m_fnumber_max) m_fnumber_max = entry.fnumber_max;
+        }
+        return true;
+    }
+
+    void close()
+    {
+        unmap();
+        m_index.clear();
+        m_n_records = 0;
+        m_fnumber_max = -1;
+    }
+
+    bool isOpened() const { return m_data != nullptr; }
+
+    /** Get the number of frames (the last recorded frame number + 1) */
+    int size() const { return m_fnumber_max + 1; }
+
+    int countChunks() const { return (int)m_index.size(); }
+
+    uint64_t countRecords() const { return m_n_records; }
+
+    /**
+     * Get the records of the given frame
+     * @param fnumber The camera frame number
+     * @param records The found records in the written order
+     * @return True if any record is found (false if not)
+     */
+    bool getRecords(int fnumber, std::vector<Record>& records) const
+    {
+        records.clear();
+        if (fnumber < 0) return false;
+        for (auto& entry : m_index)
+        {
+            if (fnumber < entry.fnumber_min || fnumber > entry.fnumber_max) continue;
+            scanRecords(entry, [&](const Record& r) { if (r.fnumber == fnumber) records.push_back(r); });
+        }
+        return !records.empty();
+    }
+
+    /**
+     * Get the records in the given time range
+     * @param ts_from The start time (inclusive)
+     * @param ts_to The end time (inclusive)
+     * @param records The found records in the written order
+     * @param type The type of records to find
+     * @return True if any record is found (false if not)
+     */
+    bool getRecords(Timestamp ts_from, Timestamp ts_to, std::vector<Record>& records, LogType type) const
+    {
+        records.clear();
+        for (auto& entry : m_index)
+        {
+            if (ts_to < entry.ts_min || ts_from > entry.ts_max) continue;
+            scanRecords(entry, [&](const Record& r) { if (r.type == type && r.timestamp >= ts_from && r.timestamp <= ts_to) records.push_back(r); });
+        }
+        return !records.empty();
+    }
+
+    /**
+     * Get all records of the given type
+     * @param type The type of records to find
+     * @param records The found records in the written order
+     * @return True if any record is found (false if not)
+     */
+    bool getRecords(LogType type, std::vector<Record>& records) const
+    {
+        records.clear();
+        for (auto& entry : m_index)
+        {
+            scanRecords(entry, [&](const Record& r) { if (r.type == type) records.push_back(r); });
+        }
+        return !records.empty();
+    }
+
+    /**
+     * Get the recorded lines of a recognizer at the given frame
+     * @param fnumber The camera frame number
+     * @param name The module name
+     * @param lines The recorded lines
+     * @return True if any line is found (false if not)
+     */
+    bool getLines(int fnumber, const std::string& name, std::vector<std::string>& lines) const
+    {
+        lines.clear();
+        std::vector<Record> records;
+        if (!getRecords(fnumber, records)) return false;
+        for (auto& r : records)
+        {
+            if (r.type != LogType::RECOGNIZER) continue;
+            const char* p = r.data;
+            const char* end = r.data + r.size;
+            while (p < end)
+            {
+                const char* eol = (const char*)memchr(p, '\n', end - p);
+                if (eol == nullptr) eol = end;
+                std::string line(p, eol);
+                if (!line.empty() && line.back() == '\r') line.pop_back();
+                if (getModuleName(line) == name) lines.push_back(line);
+                p = eol + 1;
+            }
+        }
+        return !lines.empty();
+    }
+
+    /**
+     * Feed the recorded outputs of the given frame to a recognizer
+     * @param module The recognizer which has read() and name()
+     * @param fnumber The camera frame number
+     * @return True if the recorded outputs exist (false if not)
+     */
+    template <typename T>
+    bool read(T& module, int fnumber) const
+    {
+        std::vector<std::string> lines;
+        if (!getLines(fnumber, module.name(), lines)) return false;
+        module.read(lines);
+        return true;
+    }
+
+protected:
+    /** Get the module name from a line 'timestamp,cam_fnumber,module_name,...' */
+    static std::string getModuleName(const std::string& line)
+    {
+        size_t p1 = line.find(',');
+        if (p1 == std::string::npos) return std::string();
+        size_t p2 = line.find(',', p1 + 1);
+        if (p2 == std::string::npos) return std::string();
+        size_t p3 = line.find(',', p2 + 1);
+        return line.substr(p2 + 1, (p3 == std::string::npos) ? std::string::npos : p3 - p2 - 1);
+    }
+
+    template <typename F>
+    void scanRecords(const LogIndexEntry& entry, F func) const
+    {
+        const char* p = m_data + entry.offset + sizeof(LogChunkHeader);
+        const char* end = p + entry.size;
+        while (p + sizeof(LogRecordHeader) <= end)
+        {
+            LogRecordHeader header;
+            memcpy(&header, p, sizeof(header));
+            p += sizeof(header);
+            if (p + header.size > end) break;
+
+            Record r;
+            r.type = (LogType)header.type;
+            r.fnumber = header.fnumber;
+            r.timestamp = header.timestamp;
+            r.data = p;
+            r.size = header.size;
+            func(r);
+            p += header.size;
+        }
+    }
+
+    /** Load the chunk index written at the end of the log */
+    bool loadIndex()
+    {
+        if (m_size < sizeof(LOG_FILE_MAGIC) + sizeof(LogTrailer)) return false;
+        LogTrailer trailer;
+        memcpy(&trailer, m_data + m_size - sizeof(trailer), sizeof(trailer));
+        if (trailer.magic != LOG_INDEX_MAGIC || trailer.index_offset > m_size) return false;
+        if (trailer.index_offset + (uint64_t)trailer.n_chunks * sizeof(LogIndexEntry) + sizeof(trailer) != m_size) return false;
+
+        m_index.resize(trailer.n_chunks);
+        if (trailer.n_chunks > 0) memcpy(m_index.data(), m_data + trailer.index_offset, trailer.n_chunks * sizeof(LogIndexEntry));
+
+        // reject the index if any chunk is out of the file (e.g. a corrupted index)
+        for (auto entry = m_index.begin(); entry != m_index.end(); entry++)
+        {
+            if (entry->offset < sizeof(LOG_FILE_MAGIC) || entry->offset > trailer.index_offset
+                || trailer.index_offset - entry->offset < sizeof(LogChunkHeader) + (uint64_t)entry->size)
+            {
+                m_index.clear();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /** Rebuild the chunk index by scanning the chunks (for logs without the index) */
+    void scanChunks()
+    {
+        m_index.clear();
+        uint64_t offset = sizeof(LOG_FILE_MAGIC);
+        while (offset + sizeof(LogChunkHeader) <= m_size)
+        {
+            LogChunkHeader header;
+            memcpy(&header, m_data + offset, sizeof(header));
+            if (header.magic != LOG_CHUNK_MAGIC || offset + sizeof(header) + header.size > m_size) break;
+
+            LogIndexEntry entry;
+            entry.offset = offset;
+            entry.size = header.size;
+            entry.n_records = header.n_records;
+            entry.fnumber_min = header.fnumber_min;
+            entry.fnumber_max = header.fnumber_max;
+            entry.ts_min = header.ts_min;
+            entry.ts_max = header.ts_max;
+            m_index.push_back(entry);
+            offset += sizeof(header) + header.size;
+        }
+    }
+
+#ifdef _WIN32
+    bool map(const std::string& filename)
+    {
+        m_hfile = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (m_hfile == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(m_hfile, &size) || size.QuadPart == 0)
+        {
+            unmap();
+            return false;
+        }
+        m_hmap = CreateFileMappingA(m_hfile, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (m_hmap == NULL)
+        {
+            unmap();
+            return false;
+        }
+        m_data = (const char*)MapViewOfFile(m_hmap, FILE_MAP_READ, 0, 0, 0);
+        m_size = (uint64_t)size.QuadPart;
+        if (m_data == nullptr)
+        {
+            unmap();
+            return false;
+        }
+        return true;
+    }
+
+    void unmap()
+    {
+        if (m_data) UnmapViewOfFile(m_data);
+        if (m_hmap != NULL) CloseHandle(m_hmap);
+        if (m_hfile != INVALID_HANDLE_VALUE) CloseHandle(m_hfile);
+        m_data = nullptr;
+        m_size = 0;
+        m_hmap = NULL;
+        m_hfile = INVALID_HANDLE_VALUE;
+    }
+
+    HANDLE m_hfile = INVALID_HANDLE_VALUE;
+    HANDLE m_hmap = NULL;
+#else
+    bool map(const std::string& filename)
+    {
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0)
+        {
+            ::close(fd);
+            return false;
+        }
+        void* data = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (data == MAP_FAILED) return false;
+        m_data = (const char*)data;
+        m_size = (uint64_t)st.st_size;
+        return true;
+    }
+
+    void unmap()
+    {
+        if (m_data) munmap((void*)m_data, (size_t)m_size);
+        m_data = nullptr;
+        m_size = 0;
+    }
+#endif
+
+    const char* m_data = nullptr;
+    uint64_t m_size = 0;
+    std::vector<LogIndexEntry> m_index;
+    uint64_t m_n_records = 0;
+    int m_fnumber_max = -1;
+};
+
+} // End of 'dg'
+
+#endif // End of '__DG_UTILS_BINARY_LOG__'
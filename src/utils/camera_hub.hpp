@@ -0,0 +1,337 @@
+#ifndef __DG_UTILS_CAMERA_HUB__
+#define __DG_UTILS_CAMERA_HUB__
+
+#include "utils/mailbox.hpp"
+#include "utils/pipeline.hpp"
+#include "utils/metrics.hpp"
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace dg
+{
+
+/**
+ * @brief Multiple camera streams with a priority scheduler of recognizers
+ *
+ * Each camera has its own latest-value mailbox and frame numbers, so cameras are published independently.
+ * A recognizer module takes frames through next(), which selects a camera by stride scheduling on the priorities of the module.
+ * For example, OCR can take the front camera three times as often as the side camera while the logo recognizer prefers the side camera.
+ * Only cameras with new frames for the module are selected, so the share of an idle camera is given to the others.
+ * Processed and skipped frames are counted per module and camera to measure their throughput.
+ * Cameras and priorities should be set before publishing frames, and publish() and next() are thread-safe.
+ */
+class CameraHub
+{
+public:
+    typedef Mailbox<CameraFrame>::Handle Handle;
+
+    CameraHub() : m_start_time(-1) {}
+
+    /**
+     * Add a camera
+     * @param name The name of the camera
+     * @return The index of the camera (-1 if the name already exists)
+     */
+    int addCamera(const std::string& name)
+    {
+        if (name.empty() || findCamera(name) >= 0) return -1;
+        std::unique_ptr<Camera> camera(new Camera());
+        camera->name = name;
+        m_cameras.push_back(std::move(camera));
+        return (int)m_cameras.size() - 1;
+    }
+
+    /** Remove all cameras, priorities, and statistics */
+    void clear()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_cameras.clear();
+        m_modules.clear();
+        m_start_time = -1;
+    }
+
+    /** Get the number of cameras */
+    int size() const { return (int)m_cameras.size(); }
+
+    /**
+     * Find a camera by its name
+     * @return The index of the camera (-1 if not exist)
+     */
+    int findCamera(const std::string& name) const
+    {
+        for (size_t i = 0; i < m_cameras.size(); i++)
+        {
+            if (m_cameras[i]->name == name) return (int)i;
+        }
+        return -1;
+    }
+
+    /** Get the name of a camera (empty if not exist) */
+    std::string getName(int camera) const { return isValid(camera) ? m_cameras[camera]->name : std::string(); }
+
+    /**
+     * Set the signal which is notified whenever a frame is published
+     * @param signal The wake-up signal of recognizer stages (nullptr to remove)
+     */
+    void setSignal(std::shared_ptr<StageSignal> signal) { std::atomic_store(&m_signal, signal); }
+
+    /**
+     * Set the priority of a camera for a module
+     * A module without any priority takes frames only from the first camera.
+     * @param module The name of the module
+     * @param camera The index of the camera
+     * @param priority The relative share of the camera (0: not used by the module)
+     * @return True if successful (false if failed)
+     */
+    bool setPriority(const std::string& module, int camera, double priority)
+    {
+        if (!isValid(camera) || priority < 0) return false;
+        std::lock_guard<std::mutex> lock(m_mutex);
+        getModule(module).cameras[camera].priority = priority;
+        return true;
+    }
+
+    /**
+     * Publish a new frame of a camera
+     * @param camera The index of the camera
+     * @param image The captured image
+     * @param capture_time The capture time
+     * @param gps The GPS position at the capture time
+     * @return The frame number of the camera (-1 if the camera does not exist)
+     */
+    int publish(int camera, const cv::Mat& image, Timestamp capture_time, const LatLon& gps = LatLon())
+    {
+        return publish(camera, std::make_shared<const FrameImage>(image), capture_time, gps);
+    }
+
+    /**
+     * Publish a new frame of a camera with a compressed image
+     * The image is not decoded until a consumer asks for it.
+     * @param camera The index of the camera
+     * @param bytes The compressed image (e.g. JPEG)
+     * @param capture_time The capture time
+     * @param gps The GPS position at the capture time
+     * @return The frame number of the camera (-1 if the camera does not exist)
+     */
+    int publish(int camera, std::vector<uchar> bytes, Timestamp capture_time, const LatLon& gps = LatLon())
+    {
+        return publish(camera, std::make_shared<const FrameImage>(std::move(bytes)), capture_time, gps);
+    }
+
+    /**
+     * Publish a new frame of a camera with a shared image
+     * @param camera The index of the camera
+     * @param image The captured image
+     * @param capture_time The capture time
+     * @param gps The GPS position at the capture time
+     * @return The frame number of the camera (-1 if the camera does not exist)
+     */
+    int publish(int camera, std::shared_ptr<const FrameImage> image, Timestamp capture_time, const LatLon& gps = LatLon())
+    {
+        if (!isValid(camera)) return -1;
+        Camera& cam = *m_cameras[camera];
+        CameraFrame frame;
+        frame.image = std::move(image);
+        frame.capture_time = capture_time;
+        frame.gps = gps;
+        frame.fnumber = ++cam.fnumber;
+        frame.camera = camera;
+        cam.mailbox.publish(frame);
+        double start_time = -1;
+        m_start_time.compare_exchange_strong(start_time, Metrics::now());
+
+        std::shared_ptr<StageSignal> signal = std::atomic_load(&m_signal);
+        if (signal) signal->notify();
+        return frame.fnumber;
+    }
+
+    /**
+     * Get the newest frame of a camera
+     * @return The handle of the newest frame (nullptr if nothing is published)
+     */
+    Handle latest(int camera = 0) const { return isValid(camera) ? m_cameras[camera]->mailbox.latest() : nullptr; }
+
+    /**
+     * Check whether a newer frame is published by the camera of the given frame
+     */
+    bool isStale(const CameraFrame& frame) const
+    {
+        Handle newest = latest(frame.camera);
+        return newest && newest->fnumber > frame.fnumber;
+    }
+
+    /**
+     * Take a new frame for a module
+     * The camera with the smallest virtual time among cameras with new frames is selected, and its virtual time advances by the inverse of its priority.
+     * A frame rejected by the given filter (e.g. a rate policy) is consumed but counted as skipped, and the virtual time of its camera does not advance.
+     * @param module The name of the module
+     * @param accept The filter which checks whether the module processes the frame (nullptr to accept all frames)
+     * @return The handle of the newest frame of the selected camera (nullptr if there is no new frame for the module or it is rejected)
+     */
+    Handle next(const std::string& module, const std::function<bool(const CameraFrame&)>& accept = nullptr)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Module& mod = getModule(module);
+        int selected = -1;
+        double selected_pass = 0;
+        for (int i = 0; i < (int)m_cameras.size(); i++)
+        {
+            Share& share = mod.cameras[i];
+            if (share.priority <= 0 || m_cameras[i]->mailbox.sequence() <= share.seq) continue;
+            double pass = std::max(share.pass, mod.vtime);
+            if (selected < 0 || pass < selected_pass)
+            {
+                selected = i;
+                selected_pass = pass;
+            }
+        }
+        if (selected < 0) return nullptr;
+
+        Share& share = mod.cameras[selected];
+        Handle frame;
+        if (!m_cameras[selected]->mailbox.fetch(share.seq, frame)) return nullptr;
+        if (accept && !accept(*frame)) return nullptr;
+        mod.vtime = selected_pass;
+        share.pass = selected_pass + 1 / share.priority;
+
+        // count processed frames and frames which are published but skipped by the module
+        Metrics& metrics = Metrics::instance();
+        share.n_processed++;
+        metrics.count(share.metric_processed);
+        if (share.fnumber >= 0 && frame->fnumber > share.fnumber + 1)
+        {
+            share.n_skipped += frame->fnumber - share.fnumber - 1;
+            metrics.count(share.metric_skipped, frame->fnumber - share.fnumber - 1);
+        }
+        share.fnumber = frame->fnumber;
+        return frame;
+    }
+
+    /** Get the number of published frames of a camera */
+    int countFrames(int camera) const { return isValid(camera) ? m_cameras[camera]->fnumber + 1 : 0; }
+
+    /** Get the number of frames of a camera taken by a module */
+    uint64_t countProcessed(const std::string& module, int camera) const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto found = m_modules.find(module);
+        if (found == m_modules.end() || camera < 0 || camera >= (int)found->second.cameras.size()) return 0;
+        return found->second.cameras[camera].n_processed;
+    }
+
+    /** Get the number of frames of a camera which are published but skipped by a module */
+    uint64_t countSkipped(const std::string& module, int camera) const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto found = m_modules.find(module);
+        if (found == m_modules.end() || camera < 0 || camera >= (int)found->second.cameras.size()) return 0;
+        return found->second.cameras[camera].n_skipped;
+    }
+
+    /**
+     * Get the throughput of a module on a camera
+     * @return The number of processed frames per second since the first frame is published [Hz]
+     */
+    double getThroughput(const std::string& module, int camera) const
+    {
+        double elapsed = getElapsedTime();
+        return (elapsed > 0) ? countProcessed(module, camera) / elapsed : 0;
+    }
+
+    /**
+     * Get the frame rate of a camera
+     * @return The number of published frames per second since the first frame is published [Hz]
+     */
+    double getFrameRate(int camera) const
+    {
+        double elapsed = getElapsedTime();
+        return (elapsed > 0) ? countFrames(camera) / elapsed : 0;
+    }
+
+    /** Print the frame rate of each camera and the throughput of each module on it */
+    void print() const
+    {
+        std::vector<std::string> modules;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (auto mod = m_modules.begin(); mod != m_modules.end(); mod++) modules.push_back(mod->first);
+        }
+        for (int i = 0; i < size(); i++)
+        {
+            printf("[camera] %s: %d frames (%.1f Hz)\n", getName(i).c_str(), countFrames(i), getFrameRate(i));
+            for (auto mod = modules.begin(); mod != modules.end(); mod++)
+            {
+                uint64_t n_processed = countProcessed(*mod, i);
+                if (n_processed > 0) printf("\t%s: %d frames (%.1f Hz), %d skipped\n", mod->c_str(), (int)n_processed, getThroughput(*mod, i), (int)countSkipped(*mod, i));
+            }
+        }
+    }
+
+protected:
+    struct Camera
+    {
+        std::string name;
+        Mailbox<CameraFrame> mailbox;
+        std::atomic<int> fnumber{ -1 };
+    };
+
+    /** The share of a camera for a module */
+    struct Share
+    {
+        double priority = 0;
+        double pass = 0;
+        uint64_t seq = 0;
+        int fnumber = -1;
+        uint64_t n_processed = 0;
+        uint64_t n_skipped = 0;
+        int metric_processed = -1;
+        int metric_skipped = -1;
+    };
+
+    struct Module
+    {
+        std::vector<Share> cameras;
+        double vtime = 0;
+    };
+
+    bool isValid(int camera) const { return camera >= 0 && camera < (int)m_cameras.size(); }
+
+    double getElapsedTime() const
+    {
+        double start = m_start_time.load();
+        return (start >= 0) ? (Metrics::now() - start) / 1e6 : 0;
+    }
+
+    /** Get the scheduling state of a module, which has the shares of all cameras (m_mutex should be locked) */
+    Module& getModule(const std::string& name)
+    {
+        auto found = m_modules.find(name);
+        if (found == m_modules.end()) found = m_modules.insert(std::make_pair(name, Module())).first;
+        std::vector<Share>& shares = found->second.cameras;
+        Metrics& metrics = Metrics::instance();
+        for (size_t i = shares.size(); i < m_cameras.size(); i++)
+        {
+            shares.push_back(Share());
+            if (i == 0) shares[i].priority = 1;
+            shares[i].metric_processed = metrics.registerName(name + "." + m_cameras[i]->name + ".frames");
+            shares[i].metric_skipped = metrics.registerName(name + "." + m_cameras[i]->name + ".dropped_frames");
+        }
+        return found->second;
+    }
+
+    std::vector<std::unique_ptr<Camera>> m_cameras;
+    std::map<std::string, Module> m_modules;
+    std::shared_ptr<StageSignal> m_signal;
+    std::atomic<double> m_start_time;
+    mutable std::mutex m_mutex;
+};
+
+} // End of 'dg'
+
+#endif // End of '__DG_UTILS_CAMERA_HUB__'
@@ -0,0 +1,207 @@
+#ifndef __DG_UTILS_FRAME_IMAGE__
+#define __DG_UTILS_FRAME_IMAGE__
+
+#include "opencv2/opencv.hpp"
+#include "utils/metrics.hpp"
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace dg
+{
+
+/**
+ * @brief Lazily decoded camera image with a resize pyramid shared among consumers
+ *
+ * A frame image keeps a compressed image (e.g. JPEG of ROS compressed image topics) and decodes it only when a consumer asks for it,
+ * so frames which are skipped by all consumers are never decoded.
+ * A consumer which needs a small input asks for a reduced level (1/2, 1/4, or 1/8), which is decoded by JPEG DCT scaling
+ * ('cv::IMREAD_REDUCED_COLOR_*') or resized from a finer level if it is already decoded.
+ * Decoded levels and resized images are cached and shared by all consumers, so they should not be modified.
+ * All member functions are thread-safe, and the decoding runs on the thread of the first consumer which asks for it.
+ * The decoding holds the lock of the frame, so concurrent consumers wait for it and share its result instead of decoding the same image twice.
+ * Consumers of the frame are serialized only while it is decoded, and those of other frames are not blocked.
+ */
+class FrameImage
+{
+public:
+    /** The number of reduced levels (1, 1/2, 1/4, and 1/8) */
+    static const int LEVELS = 4;
+
+    /** The maximum number of cached resized images */
+    static const int MAX_RESIZED = 4;
+
+    /**
+     * The constructor with a decoded image
+     * @param image The decoded image, which becomes the finest level
+     */
+    FrameImage(const cv::Mat& image = cv::Mat()) : m_n_decodes(0), m_n_resizes(0)
+    {
+        m_levels[0] = image;
+        if (!image.empty()) m_size = cv::Size(image.cols, image.rows);
+    }
+
+    /**
+     * The constructor with a compressed image
+     * @param bytes The compressed image (e.g. JPEG or PNG)
+     */
+    FrameImage(std::vector<uchar> bytes) : m_bytes(std::move(bytes)), m_n_decodes(0), m_n_resizes(0)
+    {
+        readJPEGSize(m_bytes, m_size);
+    }
+
+    /** Check whether the image has nothing */
+    bool empty() const { return m_bytes.empty() && m_levels[0].empty(); }
+
+    /** Check whether the image is given as compressed */
+    bool isCompressed() const { return !m_bytes.empty(); }
+
+    /** Get the compressed image (empty if the image is given as decoded) */
+    const std::vector<uchar>& getBytes() const { return m_bytes; }
+
+    /**
+     * Get the size of the original image
+     * The size of JPEG is read from its header without decoding, but other formats are decoded.
+     */
+    cv::Size getSize() const
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_size.area() > 0 || empty()) return m_size;
+        }
+        get(1);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_size;
+    }
+
+    /**
+     * Get the image at a reduced level
+     * @param reduction The reduction factor (1, 2, 4, or 8; others are rounded down to one of them)
+     * @return The image whose width and height are divided by the reduction factor (empty if failed)
+     */
+    cv::Mat get(int reduction = 1) const
+    {
+        int level = toLevel(reduction);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return getLevel(level);
+    }
+
+    /**
+     * Get the image resized to the given size
+     * It is resized from the coarsest level which is not smaller than the size, and the result is cached for other consumers.
+     * @param size The size of the resized image
+     * @return The resized image (empty if failed)
+     */
+    cv::Mat getResized(const cv::Size& size) const
+    {
+        if (size.width <= 0 || size.height <= 0) return cv::Mat();
+        cv::Size original = getSize();
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto found = m_resized.find(std::make_pair(size.width, size.height));
+        if (found != m_resized.end()) return found->second;
+
+        int level = 0;
+        while (level + 1 < LEVELS && (original.width >> (level + 1)) >= size.width && (original.height >> (level + 1)) >= size.height) level++;
+        cv::Mat source = getLevel(level);
+        if (source.empty()) return cv::Mat();
+        cv::Mat resized = source;
+        if (source.cols != size.width || source.rows != size.height)
+        {
+            cv::resize(source, resized, size, 0, 0, cv::INTER_AREA);
+            m_n_resizes++;
+            DG_COUNT("FrameImage::resize", 1);
+        }
+        if (m_resized.size() >= MAX_RESIZED) m_resized.clear();
+        m_resized[std::make_pair(size.width, size.height)] = resized;
+        return resized;
+    }
+
+    /** Get the number of decoding of the compressed image */
+    int countDecodes() const { std::lock_guard<std::mutex> lock(m_mutex); return m_n_decodes; }
+
+    /** Get the number of resizing (including reduced levels resized from finer levels) */
+    int countResizes() const { std::lock_guard<std::mutex> lock(m_mutex); return m_n_resizes; }
+
+    /** Convert a reduction factor to its level */
+    static int toLevel(int reduction)
+    {
+        int level = 0;
+        while (level + 1 < LEVELS && (2 << level) <= reduction) level++;
+        return level;
+    }
+
+    /**
+     * Read the image size from the header of JPEG
+     * @param bytes The compressed image
+     * @param size The image size
+     * @return True if successful (false if the image is not JPEG or its header is broken)
+     */
+    static bool readJPEGSize(const std::vector<uchar>& bytes, cv::Size& size)
+    {
+        size_t n = bytes.size();
+        if (n < 4 || bytes[0] != 0xFF || bytes[1] != 0xD8) return false;
+        size_t i = 2;
+        while (i + 3 < n)
+        {
+            if (bytes[i] != 0xFF) return false;
+            uchar marker = bytes[i + 1];
+            if (marker == 0xFF) { i++; continue; }
+            if (marker == 0xD8 || marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)) { i += 2; continue; }
+            if (marker == 0xD9 || marker == 0xDA) return false;
+            size_t length = ((size_t)bytes[i + 2] << 8) | bytes[i + 3];
+            if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC)
+            {
+                if (i + 8 >= n) return false;
+                size.height = (bytes[i + 5] << 8) | bytes[i + 6];
+                size.width = (bytes[i + 7] << 8) | bytes[i + 8];
+                return size.area() > 0;
+            }
+            i += 2 + length;
+        }
+        return false;
+    }
+
+protected:
+    /** Get the image at a level, decoding or resizing it if not exist (m_mutex should be locked, and it is kept locked while decoding) */
+    cv::Mat getLevel(int level) const
+    {
+        if (!m_levels[level].empty()) return m_levels[level];
+
+        // Resize from the coarsest finer level if it exists
+        int finer = level - 1;
+        while (finer >= 0 && m_levels[finer].empty()) finer--;
+        if (finer >= 0 || m_bytes.empty())
+        {
+            if (finer < 0) return cv::Mat();
+            const cv::Mat& source = m_levels[finer];
+            int scale = 1 << (level - finer);
+            cv::resize(source, m_levels[level], cv::Size((source.cols + scale - 1) / scale, (source.rows + scale - 1) / scale), 0, 0, cv::INTER_AREA);
+            m_n_resizes++;
+            DG_COUNT("FrameImage::resize", 1);
+            return m_levels[level];
+        }
+
+        // Decode the compressed image (JPEG is decoded at the reduced resolution by DCT scaling)
+        static const int flags[LEVELS] = { cv::IMREAD_COLOR, cv::IMREAD_REDUCED_COLOR_2, cv::IMREAD_REDUCED_COLOR_4, cv::IMREAD_REDUCED_COLOR_8 };
+        DG_TRACE_SCOPE("FrameImage::decode");
+        m_levels[level] = cv::imdecode(m_bytes, flags[level]);
+        m_n_decodes++;
+        DG_COUNT("FrameImage::decode", 1);
+        if (level == 0 && !m_levels[0].empty()) m_size = cv::Size(m_levels[0].cols, m_levels[0].rows);
+        return m_levels[level];
+    }
+
+    std::vector<uchar> m_bytes;
+    mutable cv::Mat m_levels[LEVELS];
+    mutable std::map<std::pair<int, int>, cv::Mat> m_resized;
+    mutable cv::Size m_size;
+    mutable int m_n_decodes;
+    mutable int m_n_resizes;
+    mutable std::mutex m_mutex;
+};
+
+} // End of 'dg'
+
+#endif // End of '__DG_UTILS_FRAME_IMAGE__'
@@ -0,0 +1,293 @@
+#ifndef __DG_UTILS_LAYER_COMPOSITOR__
+#define __DG_UTILS_LAYER_COMPOSITOR__
+
+#include "opencv2/opencv.hpp"
+#include <functional>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+namespace dg
+{
+
+/**
+ * @brief Layered GUI compositor with dirty-region updates
+ *
+ * A <b>layered compositor</b> keeps a stack of cached layers on a static base image (e.g. a map image).
+ * Each cached layer holds the composition of the layers below and its own drawing, which is redrawn only when the layer is invalidated.
+ * A layer can also be drawn incrementally (e.g. a new point of a trajectory) without redrawing it.
+ * Overlays which change every frame (e.g. recognizer results and guidance messages) are drawn on the composed frame by the user,
+ * who marks their regions so that only those regions are restored from the cached layers at the next frame.
+ * Therefore, the cost of a frame is proportional to the size of changed regions, not the size of the base image.
+ * This class is not thread-safe, so the user should lock it if layers are drawn by other threads.
+ */
+class LayerCompositor
+{
+public:
+    /** Drawing function of a layer (drawing on the given canvas in the coordinate of the base image) */
+    typedef std::function<void(cv::Mat& canvas)> DrawFunc;
+
+    /**
+     * The default constructor
+     */
+    LayerCompositor()
+    {
+        m_full_restore = true;
+        m_restored_area = 0;
+        m_max_dirty_ratio = 0.5;
+    }
+
+    /**
+     * Set the base image (all layers are redrawn at the next frame)
+     * @param image The base image
+     * @return True if successful (false if the image is empty)
+     */
+    bool setBase(const cv::Mat& image)
+    {
+        if (image.empty()) return false;
+        if (m_layers.empty()) m_layers.resize(1);
+        m_layers.front().name = "base";
+        m_layers.front().cache = image.clone();
+        m_layers.front().valid = true;
+        return invalidate(0);
+    }
+
+    /**
+     * Add a cached layer on the top
+     * @param name The name of the layer
+     * @param draw The function to draw the whole layer (nullptr if the layer is drawn only incrementally)
+     * @return The index of the added layer (-1 if the base image is not set)
+     */
+    int addLayer(const std::string& name, DrawFunc draw = nullptr)
+    {
+        if (m_layers.empty()) return -1;
+        Layer layer;
+        layer.name = name;
+        layer.draw = draw;
+        layer.valid = false;
+        m_layers.push_back(layer);
+        return (int)m_layers.size() - 1;
+    }
+
+    /**
+     * Invalidate a layer and its upper layers to be redrawn at the next frame
+     * @param layer The index of the layer
+     * @return True if successful (false if the index is invalid)
+     */
+    bool invalidate(int layer)
+    {
+        if (layer < 0 || layer >= (int)m_layers.size()) return false;
+        for (size_t i = std::max(layer, 1); i < m_layers.size(); i++)
+            m_layers[i].valid = false;
+        return true;
+    }
+
+    /**
+     * Draw on a cached layer incrementally
+     * @param layer The index of the layer
+     * @param draw The function to draw (it should also be included in the drawing function of the layer to survive redrawing)
+     * @param rect The region changed by the drawing
+     * @return True if successful (false if the index is invalid)
+     */
+    bool drawOnLayer(int layer, DrawFunc draw, const cv::Rect& rect)
+    {
+        if (layer <= 0 || layer >= (int)m_layers.size() || !draw) return false;
+        for (int i = 1; i <= layer; i++)
+        {
+            if (!m_layers[i].valid) return true; // It will be redrawn as a whole
+        }
+        draw(m_layers[layer].cache);
+        if (layer == (int)m_layers.size() - 1) markDirty(rect);
+        else invalidate(layer + 1);
+        return true;
+    }
+
+    /**
+     * Compose a frame by redrawing invalid layers and restoring dirty regions
+     * @return The composed frame (overlays can be drawn on it until the next call)
+     */
+    cv::Mat& compose()
+    {
+        m_restored_area = 0;
+        if (m_layers.empty()) return m_frame;
+
+        // Redraw invalid layers
+        for (size_t i = 1; i < m_layers.size(); i++)
+        {
+            Layer& layer = m_layers[i];
+            if (layer.valid) continue;
+            m_layers[i - 1].cache.copyTo(layer.cache);
+            if (layer.draw) layer.draw(layer.cache);
+            layer.valid = true;
+            m_full_restore = true;
+        }
+
+        // Restore dirty regions from the top layer
+        const cv::Mat& top = m_layers.back().cache;
+        if (m_full_restore || m_frame.size() != top.size() || m_frame.type() != top.type())
+        {
+            top.copyTo(m_frame);
+            m_restored_area = top.cols * top.rows;
+        }
+        else
+        {
+            for (auto rect = m_dirty.begin(); rect != m_dirty.end(); rect++)
+            {
+                top(*rect).copyTo(m_frame(*rect));
+                m_restored_area += rect->area();
+            }
+        }
+        m_dirty.clear();
+        m_full_restore = false;
+        return m_frame;
+    }
+
+    /**
+     * Mark a region of the frame to be restored at the next frame
+     * @param rect The region drawn by overlays or changed on the top layer
+     */
+    void markDirty(const cv::Rect& rect)
+    {
+        if (m_full_restore || m_layers.empty()) return;
+        const cv::Mat& base = m_layers.front().cache;
+        cv::Rect r = rect & cv::Rect(0, 0, base.cols, base.rows);
+        if (r.area() <= 0) return;
+
+        // Merge overlapped regions
+        int dirty_area = 0;
+        for (auto prev = m_dirty.begin(); prev != m_dirty.end(); prev++)
+        {
+            if ((*prev & r).area() > 0)
+            {
+                *prev |= r;
+                r = cv::Rect();
+            }
+            dirty_area += prev->area();
+        }
+        if (r.area() > 0)
+        {
+            m_dirty.push_back(r);
+            dirty_area += r.area();
+        }
+        if (dirty_area > m_max_dirty_ratio * base.cols * base.rows)
+        {
+            m_dirty.clear();
+            m_full_restore = true;
+        }
+    }
+
+    /**
+     * Mark the region of a text on the frame
+     * @param text The text drawn by cv::putText()
+     * @param org The bottom-left corner of the text
+     * @param font_face The font type
+     * @param font_scale The font scale
+     * @param thickness The thickness of the text
+     */
+    void markText(const std::string& text, const cv::Point& org, int font_face, double font_scale, int thickness)
+    {
+        int baseline = 0;
+        cv::Size sz = cv::getTextSize(text, font_face, font_scale, thickness, &baseline);
+        markDirty(cv::Rect(org.x - thickness, org.y - sz.height - thickness, sz.width + 2 * thickness, sz.height + baseline + 2 * thickness));
+    }
+
+    /**
+     * Mark the region of a circle on the frame
+     * @param center The center of the circle
+     * @param radius The radius of the circle (including its thickness) [pixel]
+     */
+    void markCircle(const cv::Point& center, int radius)
+    {
+        markDirty(cv::Rect(center.x - radius - 1, center.y - radius - 1, 2 * radius + 3, 2 * radius + 3));
+    }
+
+    /**
+     * Restore the whole frame at the next frame
+     */
+    void markAll() { m_full_restore = true; }
+
+    /**
+     * Remove all layers including the base image
+     */
+    void clear()
+    {
+        m_layers.clear();
+        m_dirty.clear();
+        m_frame.release();
+        m_full_restore = true;
+        m_restored_area = 0;
+    }
+
+    /**
+     * Get the number of layers including the base image
+     * @return The number of layers
+     */
+    int size() const { return (int)m_layers.size(); }
+
+    /**
+     * Get the cached image of a layer (composed with its lower layers)
+     * @param layer The index of the layer
+     * @return The cached image (empty if the index is invalid or the layer is not drawn yet)
+     */
+    cv::Mat getLayerImage(int layer) const
+    {
+        if (layer < 0 || layer >= (int)m_layers.size()) return cv::Mat();
+        return m_layers[layer].cache;
+    }
+
+    /**
+     * Get the name of a layer
+     * @param layer The index of the layer
+     * @return The name of the layer (empty if the index is invalid)
+     */
+    std::string getLayerName(int layer) const
+    {
+        if (layer < 0 || layer >= (int)m_layers.size()) return std::string();
+        return m_layers[layer].name;
+    }
+
+    /**
+     * Get the number of restored pixels at the last frame
+     * @return The number of restored pixels
+     */
+    int getRestoredArea() const { return m_restored_area; }
+
+    /**
+     * Set the ratio of dirty regions to restore the whole frame instead
+     * @param ratio The ratio of dirty regions to the base image
+     */
+    void setMaxDirtyRatio(double ratio) { m_max_dirty_ratio = ratio; }
+
+protected:
+    /** A cached layer */
+    struct Layer
+    {
+        Layer() : valid(false) { }
+        std::string name;
+        DrawFunc draw;
+        cv::Mat cache;
+        bool valid;
+    };
+
+    /** The base image and cached layers (bottom to top) */
+    std::vector<Layer> m_layers;
+
+    /** The composed frame */
+    cv::Mat m_frame;
+
+    /** The regions to restore at the next frame */
+    std::vector<cv::Rect> m_dirty;
+
+    /** The flag to restore the whole frame at the next frame */
+    bool m_full_restore;
+
+    /** The number of restored pixels at the last frame */
+    int m_restored_area;
+
+    /** The ratio of dirty regions to restore the whole frame instead */
+    double m_max_dirty_ratio;
+}; // End of 'LayerCompositor'
+
+} // End of 'dg'
+
+#endif // End of '__DG_UTILS_LAYER_COMPOSITOR__'
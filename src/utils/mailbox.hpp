@@ -0,0 +1,126 @@
+#ifndef __DG_UTILS_MAILBOX__
+#define __DG_UTILS_MAILBOX__
+
+#include "core/basic_type.hpp"
+#include "utils/frame_image.hpp"
+#include <atomic>
+#include <memory>
+
+namespace dg
+{
+
+/**
+ * @brief Latest-value mailbox for sharing sensor data among threads
+ *
+ * A producer publishes a new value without waiting for its consumers, and the mailbox keeps only the newest one.
+ * Each consumer receives a reference-counted read-only handle to the value so that no copy is made,
+ * and the value remains valid while the consumer holds its handle even if newer ones are published.
+ * Each published value is tagged with an increasing sequence number to check whether it is new.
+ */
+template <typename T>
+class Mailbox
+{
+public:
+    /** Read-only handle of a published value */
+    typedef std::shared_ptr<const T> Handle;
+
+    Mailbox() : m_seq(0) {}
+
+    /**
+     * Publish a new value
+     * @param data The value to publish
+     * @return The sequence number of the published value (starting from 1)
+     */
+    uint64_t publish(T data)
+    {
+        std::shared_ptr<Letter> letter = std::make_shared<Letter>();
+        letter->data = std::move(data);
+        letter->seq = ++m_seq;
+        std::atomic_store(&m_letter, std::shared_ptr<const Letter>(letter));
+        return letter->seq;
+    }
+
+    /**
+     * Get the newest value
+     * @param seq The sequence number of the returned value (0 if nothing is published)
+     * @return The handle of the newest value (nullptr if nothing is published)
+     */
+    Handle latest(uint64_t* seq = nullptr) const
+    {
+        std::shared_ptr<const Letter> letter = std::atomic_load(&m_letter);
+        if (seq) *seq = letter ? letter->seq : 0;
+        if (!letter) return nullptr;
+        return Handle(letter, &letter->data);
+    }
+
+    /**
+     * Get the newest value only if it is newer than the last received one
+     * @param last_seq The sequence number of the last received value (updated if a newer one is returned)
+     * @param handle The handle of the newest value
+     * @return True if a newer value is returned (false if not)
+     */
+    bool fetch(uint64_t& last_seq, Handle& handle) const
+    {
+        uint64_t seq = 0;
+        Handle data = latest(&seq);
+        if (!data || seq <= last_seq) return false;
+        last_seq = seq;
+        handle = data;
+        return true;
+    }
+
+    /** Get the sequence number of the newest value (0 if nothing is published) */
+    uint64_t sequence() const
+    {
+        std::shared_ptr<const Letter> letter = std::atomic_load(&m_letter);
+        return letter ? letter->seq : 0;
+    }
+
+    /** Remove the published value (consumers still keep their handles) */
+    void clear()
+    {
+        std::atomic_store(&m_letter, std::shared_ptr<const Letter>());
+    }
+
+protected:
+    struct Letter
+    {
+        T data;
+        uint64_t seq;
+    };
+
+    std::shared_ptr<const Letter> m_letter;
+    std::atomic<uint64_t> m_seq;
+};
+
+/**
+ * @brief A camera frame with its capture information
+ */
+struct CameraFrame
+{
+    /** The captured image (decoded on demand and shared among consumers, so it should not be modified) */
+    std::shared_ptr<const FrameImage> image;
+
+    /** The capture time */
+    Timestamp capture_time = -1;
+
+    /** The GPS position at the capture time */
+    LatLon gps;
+
+    /** The frame number (counted per camera) */
+    int fnumber = -1;
+
+    /** The index of the camera which captured the frame */
+    int camera = 0;
+
+    /**
+     * Get the captured image at a reduced level
+     * @param reduction The reduction factor (1, 2, 4, or 8)
+     * @return The image (empty if there is no image or its decoding is failed)
+     */
+    cv::Mat getImage(int reduction = 1) const { return image ? image->get(reduction) : cv::Mat(); }
+};
+
+} // End of 'dg'
+
+#endif // End of '__DG_UTILS_MAILBOX__'
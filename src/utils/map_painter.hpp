@@ -60,6 +60,9 @@ public:
         m_edge_color = cx::COLOR_GREEN;
         m_edge_thickness = 2;
         m_edge_arrow_length = 0.05;
+
+        m_lod_node_ppm = 0;
+        m_lod_edge_length = 0;
     }
 
     virtual ~MapPainter() { }
@@ -98,6 +101,9 @@ public:
         CX_LOAD_PARAM_COUNT(fn, "edge_thickness", m_edge_thickness, n_read);
         CX_LOAD_PARAM_COUNT(fn, "edge_arrow_length", m_edge_arrow_length, n_read);
 
+        CX_LOAD_PARAM_COUNT(fn, "lod_node_ppm", m_lod_node_ppm, n_read);
+        CX_LOAD_PARAM_COUNT(fn, "lod_edge_length", m_lod_edge_length, n_read);
+
         return n_read;
     }
 
@@ -134,12 +140,15 @@ public:
             fs << "edge_color" << m_edge_color;
             fs << "edge_thickness" << m_edge_thickness;
             fs << "edge_arrow_length" << m_edge_arrow_length;
+
+            fs << "lod_node_ppm" << m_lod_node_ppm;
+            fs << "lod_edge_length" << m_lod_edge_length;
             return true;
         }
         return false;
     }
 
-    bool drawMap(cv::Mat& image, const MapCanvasInfo& info, dg::Map& map)
+    bool drawMap(cv::Mat& image, const MapCanvasInfo& info, const dg::Map& map)
     {
         drawGrid(image, info, m_grid_step, m_grid_color, m_grid_thickness, m_grid_unit_font_scale, m_grid_unit_color, m_grid_unit_pos);
         drawBox(image, info, m_box_color, m_box_thickness);
@@ -155,18 +164,22 @@ public:
         return false;
     }
 
-    bool drawMap(cv::Mat& image, dg::Map& map)
+    bool drawMap(cv::Mat& image, const dg::Map& map)
     {
         MapCanvasInfo info = getCanvasInfo(image);
         return drawMap(image, info, map);
     }
 
     MapCanvasInfo getCanvasInfo(cv::Mat& image)
+    {
+        return getCanvasInfo(image.size());
+    }
+
+    MapCanvasInfo getCanvasInfo(const cv::Size& sz)
     {
         // get metric
-        cv::Rect2d box(0, 0, image.cols, image.rows);
+        cv::Rect2d box(0, 0, sz.width, sz.height);
         MapCanvasInfo info = buildCanvasInfo(box, m_pixel_per_meter, m_canvas_margin);
-        cv::Size sz = image.size();
         if (sz.width > 0 && sz.height > 0)
         {
             info.width = sz.width;
@@ -191,6 +204,34 @@ public:
         return info;
     }
 
+    /**
+     * Get the canvas information of a view on a canvas (e.g. a panned and zoomed window of a large map image)
+     * @param info The canvas information of the whole canvas
+     * @param view_tl The top-left corner of the view on the whole canvas [pixel]
+     * @param zoom The scale from the whole canvas to the view
+     * @param size The size of the view [pixel]
+     * @return The canvas information of the view
+     */
+    MapCanvasInfo getViewInfo(const MapCanvasInfo& info, const Point2& view_tl, double zoom, const cv::Size& size)
+    {
+        MapCanvasInfo view = info;
+        view.width = size.width;
+        view.height = size.height;
+        view.ppm = info.ppm * zoom;
+        view.margin = 0;
+        view.box_p = cv::Rect(0, 0, size.width, size.height);
+        view.offset.x = (info.offset.x - view_tl.x) * zoom;
+        view.offset.y = (info.offset.y - view_tl.y) * zoom;
+
+        Point2 p1 = cvtPixel2Meter(Point2(0, 0), view);
+        Point2 p2 = cvtPixel2Meter(Point2(size.width, size.height), view);
+        view.box_m.x = (p1.x < p2.x) ? p1.x : p2.x;
+        view.box_m.y = (p1.y < p2.y) ? p1.y : p2.y;
+        view.box_m.width = fabs(p2.x - p1.x);
+        view.box_m.height = fabs(p2.y - p1.y);
+        return view;
+    }
+
     MapCanvasInfo buildCanvasInfo(const cv::Rect2d& box, double ppm, double margin)
     {
         MapCanvasInfo info;
@@ -276,13 +317,13 @@ public:
         return true;
     }
 
-    bool drawPath(cv::Mat& image, const MapCanvasInfo& info, dg::Map& map, const dg::Path& path, const cv::Vec3b& ecolor = cv::Vec3b(255, 0, 0), const cv::Vec3b& ncolor = cv::Vec3b(0, 255, 255), int nradius = 5, int ethickness = 2)
+    bool drawPath(cv::Mat& image, const MapCanvasInfo& info, const dg::Map& map, const dg::Path& path, const cv::Vec3b& ecolor = cv::Vec3b(255, 0, 0), const cv::Vec3b& ncolor = cv::Vec3b(0, 255, 255), int nradius = 5, int ethickness = 2)
     {
-        Node* node_prev = nullptr;
+        const Node* node_prev = nullptr;
         for (int idx = 0; idx < (int)path.pts.size(); idx++)
         {
             dg::ID node_id = path.pts[idx].node_id;
-            Node* node = map.findNode(node_id);
+            const Node* node = map.findNode(node_id);
             if (node) {
                 if (node_prev) drawEdge(image, info, node_prev, node, 0, ecolor, ethickness);
                 if (node_prev)
@@ -310,7 +351,7 @@ public:
         return true;
     }
 
-    bool drawNode(cv::Mat& image, const MapCanvasInfo& info, Node* node, double radius, double font_scale, const cv::Vec3b& color, int thickness = -1)
+    bool drawNode(cv::Mat& image, const MapCanvasInfo& info, const Node* node, double radius, double font_scale, const cv::Vec3b& color, int thickness = -1)
     {
         CV_DbgAssert(!image.empty());
 
@@ -326,18 +367,25 @@ public:
         return true;
     }
 
-    bool drawNodes(cv::Mat& image, const MapCanvasInfo& info, Map& map, double radius, double font_scale, const cv::Vec3b& color, int thickness = -1)
+    bool drawNodes(cv::Mat& image, const MapCanvasInfo& info, const Map& map, double radius, double font_scale, const cv::Vec3b& color, int thickness = -1)
     {
         CV_DbgAssert(!image.empty());
 
+        // Level of detail: only junctions are drawn if zoomed out, and nothing is drawn if zoomed out more
+        if (info.ppm < m_lod_node_ppm / 2) return true;
+        const bool junction_only = (info.ppm < m_lod_node_ppm);
+
         const int r = std::max(static_cast<int>(radius * info.ppm + 0.5), 1);
         const cv::Point font_offset(-r / 2, r / 2);
         cv::Vec3b font_color = color;
         if (thickness < 0) font_color = cv::Vec3b(255, 255, 255) - color;
+        const cv::Rect visible(-r, -r, image.cols + 2 * r, image.rows + 2 * r);
         for (size_t i=0; i<map.nodes.size(); i++)
         {
+            if (junction_only && map.nodes[i].type != Node::NODE_JUNCTION) continue;
             LatLon ll(map.nodes[i].lat, map.nodes[i].lon);
             const cv::Point p = cvtLatLon2Pixel(ll, info);
+            if (!visible.contains(p)) continue;
             cv::circle(image, p, r, color, thickness);
             if (map.nodes[i].type == Node::NODE_JUNCTION)
             {
@@ -350,7 +398,7 @@ public:
         return true;
     }
 
-    bool drawEdge(cv::Mat& image, const MapCanvasInfo& info, Node* from, Node* to, double radius, const cv::Vec3b& color, int thickness = 1, double arrow_length = -1)
+    bool drawEdge(cv::Mat& image, const MapCanvasInfo& info, const Node* from, const Node* to, double radius, const cv::Vec3b& color, int thickness = 1, double arrow_length = -1)
     {
         CV_DbgAssert(!image.empty());
         if (thickness <= 0) return false;
@@ -381,17 +429,18 @@ public:
         return true;
     }
 
-    bool drawEdges(cv::Mat& image, const MapCanvasInfo& info, Map& map, double radius, const cv::Vec3b& color, int thickness = 1, double arrow_length = -1)
+    bool drawEdges(cv::Mat& image, const MapCanvasInfo& info, const Map& map, double radius, const cv::Vec3b& color, int thickness = 1, double arrow_length = -1)
     {
         CV_DbgAssert(!image.empty());
         if (thickness <= 0 ) return false;
 
         const double r = radius * info.ppm;
         const double a = arrow_length * info.ppm;
+        const double m = std::max(a, 0.) + thickness;
         for (size_t i=0; i<map.edges.size(); i++)
         {
-            Node* node1 = map.findNode(map.edges[i].node_id1);
-            Node* node2 = map.findNode(map.edges[i].node_id2);
+            const Node* node1 = map.findNode(map.edges[i].node_id1);
+            const Node* node2 = map.findNode(map.edges[i].node_id2);
             if (node1 == nullptr || node2 == nullptr) continue;
 
             // Draw an edge
@@ -399,6 +448,11 @@ public:
             LatLon ll2(node2->lat, node2->lon);
             Point2 p = cvtLatLon2Pixel(ll1, info);
             Point2 q = cvtLatLon2Pixel(ll2, info);
+
+            // Skip edges out of the image or shorter than the level of detail
+            if (std::max(p.x, q.x) < -m || std::min(p.x, q.x) > image.cols + m || std::max(p.y, q.y) < -m || std::min(p.y, q.y) > image.rows + m) continue;
+            if (m_lod_edge_length > 0 && fabs(q.x - p.x) + fabs(q.y - p.y) < m_lod_edge_length) continue;
+
             double theta = atan2(q.y - p.y, q.x - p.x);
             Point2 delta(r * cos(theta), r * sin(theta));
             p = p + delta;
@@ -497,6 +551,10 @@ protected:
 
     double m_edge_arrow_length;
 
+    double m_lod_node_ppm;
+
+    double m_lod_edge_length;
+
 }; // End of 'MapPainter'
 
 } // End of 'dg'
@@ -0,0 +1,308 @@
+#ifndef __DG_UTILS_MAP_TILES__
+#define __DG_UTILS_MAP_TILES__
+
+#include "opencv2/opencv.hpp"
+#include <string>
+#include <list>
+#include <unordered_map>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace dg
+{
+
+/**
+ * @brief Tiled image pyramid for large map images
+ *
+ * A <b>tiled image pyramid</b> stores a large map image as square tiles at multiple resolutions.
+ * Level 0 is the original resolution, and each upper level halves the resolution of its lower level.
+ * Tiles are decoded only when they are drawn, and decoded tiles are kept in an LRU cache whose memory is bounded.
+ * Its directory contains 'tiles.yml' (the image size, tile size, and number of levels) and tile images named as '<level>_<row>_<col><ext>'.
+ * This class is not thread-safe.
+ */
+class MapTilePyramid
+{
+public:
+    /**
+     * The default constructor
+     * @param cache_bytes The maximum memory of decoded tiles [byte]
+     */
+    MapTilePyramid(size_t cache_bytes = 256 * 1024 * 1024)
+    {
+        m_cache_limit = cache_bytes;
+        close();
+    }
+
+    /**
+     * Build a pyramid from the given image
+     * @param image The original map image
+     * @param dir The directory to write tiles (it should exist)
+     * @param tile_size The width and height of tiles [pixel]
+     * @param ext The file extension of tiles (e.g. ".jpg" and ".png")
+     * @return True if successful (false if failed)
+     */
+    static bool build(const cv::Mat& image, const std::string& dir, int tile_size = 256, const std::string& ext = ".jpg")
+    {
+        if (image.empty() || tile_size <= 0) return false;
+
+        cv::Mat level_image = image;
+        int level = 0;
+        while (true)
+        {
+            for (int y = 0, row = 0; y < level_image.rows; y += tile_size, row++)
+            {
+                for (int x = 0, col = 0; x < level_image.cols; x += tile_size, col++)
+                {
+                    cv::Rect rect(x, y, std::min(tile_size, level_image.cols - x), std::min(tile_size, level_image.rows - y));
+                    if (!cv::imwrite(getTilePath(dir, level, row, col, ext), level_image(rect))) return false;
+                }
+            }
+            if (level_image.cols <= tile_size && level_image.rows <= tile_size) break;
+            cv::resize(level_image, level_image, cv::Size((level_image.cols + 1) / 2, (level_image.rows + 1) / 2), 0, 0, cv::INTER_AREA);
+            level++;
+        }
+
+        cv::FileStorage fs(dir + "/tiles.yml", cv::FileStorage::WRITE);
+        if (!fs.isOpened()) return false;
+        fs << "image_width" << image.cols;
+        fs << "image_height" << image.rows;
+        fs << "tile_size" << tile_size;
+        fs << "levels" << level + 1;
+        fs << "ext" << ext;
+        return true;
+    }
+
+    /**
+     * Open a pyramid
+     * @param dir The directory of the pyramid
+     * @return True if successful (false if failed)
+     */
+    bool open(const std::string& dir)
+    {
+        close();
+        cv::FileStorage fs(dir + "/tiles.yml", cv::FileStorage::READ);
+        if (!fs.isOpened()) return false;
+        fs["image_width"] >> m_image_size.width;
+        fs["image_height"] >> m_image_size.height;
+        fs["tile_size"] >> m_tile_size;
+        fs["levels"] >> m_levels;
+        fs["ext"] >> m_ext;
+        if (m_image_size.width <= 0 || m_image_size.height <= 0 || m_tile_size <= 0 || m_levels <= 0)
+        {
+            close();
+            return false;
+        }
+        m_dir = dir;
+        return true;
+    }
+
+    /**
+     * Close the pyramid and remove all cached tiles
+     */
+    void close()
+    {
+        m_dir.clear();
+        m_ext.clear();
+        m_image_size = cv::Size();
+        m_tile_size = 0;
+        m_levels = 0;
+        m_cache.clear();
+        m_lru.clear();
+        m_cache_bytes = 0;
+        m_cache_hits = 0;
+        m_cache_misses = 0;
+    }
+
+    /**
+     * Check whether a pyramid is opened or not
+     * @return True if opened (false if not)
+     */
+    bool isOpened() const { return m_levels > 0; }
+
+    /**
+     * Get the size of the original map image
+     * @return The image size at level 0
+     */
+    cv::Size getImageSize() const { return m_image_size; }
+
+    /**
+     * Get the number of levels
+     * @return The number of levels
+     */
+    int getLevels() const { return m_levels; }
+
+    /**
+     * Get the size of tiles
+     * @return The width and height of tiles [pixel]
+     */
+    int getTileSize() const { return m_tile_size; }
+
+    /**
+     * Get a tile (decoded if not cached)
+     * @param level The level of the tile
+     * @param row The row index of the tile
+     * @param col The column index of the tile
+     * @return The tile image (empty if not exist)
+     */
+    cv::Mat getTile(int level, int row, int col)
+    {
+        if (!isOpened() || level < 0 || level >= m_levels || row < 0 || col < 0) return cv::Mat();
+        uint64_t key = ((uint64_t)level << 48) | ((uint64_t)row << 24) | (uint64_t)col;
+        auto found = m_cache.find(key);
+        if (found != m_cache.end())
+        {
+            m_lru.splice(m_lru.begin(), m_lru, found->second.second);
+            m_cache_hits++;
+            return found->second.first;
+        }
+
+        m_cache_misses++;
+        cv::Mat tile = cv::imread(getTilePath(m_dir, level, row, col, m_ext));
+        m_lru.push_front(key);
+        m_cache[key] = std::make_pair(tile, m_lru.begin());
+        m_cache_bytes += tile.total() * tile.elemSize();
+
+        // Evict the least recently used tiles (except the new one)
+        while (m_cache_bytes > m_cache_limit && m_lru.size() > 1)
+        {
+            auto victim = m_cache.find(m_lru.back());
+            m_cache_bytes -= victim->second.first.total() * victim->second.first.elemSize();
+            m_cache.erase(victim);
+            m_lru.pop_back();
+        }
+        return tile;
+    }
+
+    /**
+     * Draw a view of the map image
+     * @param canvas The image to draw the view (allocated as the given size and type of tiles)
+     * @param size The size of the canvas
+     * @param view_tl The top-left corner of the view in the original map image [pixel]
+     * @param zoom The scale from the original map image to the canvas
+     * @param bg_color The background color outside of the map image
+     * @return True if successful (false if failed)
+     */
+    bool render(cv::Mat& canvas, const cv::Size& size, const cv::Point2d& view_tl, double zoom, const cv::Scalar& bg_color = cv::Scalar(0, 0, 0))
+    {
+        if (!isOpened() || size.width <= 0 || size.height <= 0 || zoom <= 0) return false;
+        canvas.create(size, CV_8UC3);
+        canvas = bg_color;
+
+        // Select the level whose resolution is just above the view
+        int level = (zoom >= 1) ? 0 : static_cast<int>(floor(log2(1 / zoom)));
+        level = std::min(level, m_levels - 1);
+        double scale = 1.0 / (1 << level);
+        int level_cols = static_cast<int>(ceil(m_image_size.width * scale)), level_rows = static_cast<int>(ceil(m_image_size.height * scale));
+        int n_cols = (level_cols + m_tile_size - 1) / m_tile_size, n_rows = (level_rows + m_tile_size - 1) / m_tile_size;
+
+        // Draw visible tiles
+        double x1 = view_tl.x * scale, x2 = (view_tl.x + size.width / zoom) * scale;
+        double y1 = view_tl.y * scale, y2 = (view_tl.y + size.height / zoom) * scale;
+        int col1 = std::max(static_cast<int>(floor(x1 / m_tile_size)), 0), col2 = std::min(static_cast<int>(floor(x2 / m_tile_size)), n_cols - 1);
+        int row1 = std::max(static_cast<int>(floor(y1 / m_tile_size)), 0), row2 = std::min(static_cast<int>(floor(y2 / m_tile_size)), n_rows - 1);
+        cv::Rect canvas_rect(0, 0, size.width, size.height);
+        cv::Mat resized;
+        for (int row = row1; row <= row2; row++)
+        {
+            for (int col = col1; col <= col2; col++)
+            {
+                cv::Mat tile = getTile(level, row, col);
+                if (tile.empty()) continue;
+
+                // Place the tile on the canvas
+                double tx = col * m_tile_size / scale, ty = row * m_tile_size / scale;
+                int u1 = cvRound((tx - view_tl.x) * zoom), v1 = cvRound((ty - view_tl.y) * zoom);
+                int u2 = cvRound((tx + tile.cols / scale - view_tl.x) * zoom), v2 = cvRound((ty + tile.rows / scale - view_tl.y) * zoom);
+                cv::Rect dst(u1, v1, u2 - u1, v2 - v1);
+                cv::Rect visible = dst & canvas_rect;
+                if (visible.area() <= 0) continue;
+                cv::resize(tile, resized, dst.size(), 0, 0, (zoom / scale > 1) ? cv::INTER_LINEAR : cv::INTER_AREA);
+                resized(visible - dst.tl()).copyTo(canvas(visible));
+            }
+        }
+        return true;
+    }
+
+    /**
+     * Set the maximum memory of decoded tiles
+     * @param cache_bytes The maximum memory [byte]
+     */
+    void setCacheSize(size_t cache_bytes) { m_cache_limit = cache_bytes; }
+
+    /**
+     * Get the memory of cached tiles
+     * @return The memory of cached tiles [byte]
+     */
+    size_t getCacheBytes() const { return m_cache_bytes; }
+
+    /**
+     * Get the number of cached tiles
+     * @return The number of cached tiles
+     */
+    size_t countCachedTiles() const { return m_cache.size(); }
+
+    /**
+     * Get the number of tile requests served from the cache
+     * @return The number of cache hits
+     */
+    size_t countCacheHits() const { return m_cache_hits; }
+
+    /**
+     * Get the number of tile requests decoded from files
+     * @return The number of cache misses
+     */
+    size_t countCacheMisses() const { return m_cache_misses; }
+
+    /**
+     * Get the file path of a tile
+     * @param dir The directory of the pyramid
+     * @param level The level of the tile
+     * @param row The row index of the tile
+     * @param col The column index of the tile
+     * @param ext The file extension of tiles
+     * @return The file path
+     */
+    static std::string getTilePath(const std::string& dir, int level, int row, int col, const std::string& ext)
+    {
+        return dir + cv::format("/%d_%d_%d", level, row, col) + ext;
+    }
+
+protected:
+    /** The directory of the pyramid */
+    std::string m_dir;
+
+    /** The file extension of tiles */
+    std::string m_ext;
+
+    /** The size of the original map image */
+    cv::Size m_image_size;
+
+    /** The width and height of tiles */
+    int m_tile_size;
+
+    /** The number of levels */
+    int m_levels;
+
+    /** The decoded tiles and their positions in the LRU list */
+    std::unordered_map<uint64_t, std::pair<cv::Mat, std::list<uint64_t>::iterator>> m_cache;
+
+    /** The keys of decoded tiles (most recently used first) */
+    std::list<uint64_t> m_lru;
+
+    /** The maximum memory of decoded tiles */
+    size_t m_cache_limit;
+
+    /** The memory of decoded tiles */
+    size_t m_cache_bytes;
+
+    /** The number of cache hits */
+    size_t m_cache_hits;
+
+    /** The number of cache misses */
+    size_t m_cache_misses;
+}; // End of 'MapTilePyramid'
+
+} // End of 'dg'
+
+#endif // End of '__DG_UTILS_MAP_TILES__'
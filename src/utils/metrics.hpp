@@ -0,0 +1,496 @@
+#ifndef __DG_UTILS_METRICS__
+#define __DG_UTILS_METRICS__
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace dg
+{
+
+/**
+ * @brief Latency histogram with logarithmic bins
+ *
+ * Each octave of latency (in [usec]) is divided into 8 bins, so percentiles are estimated within 9% of relative error.
+ * It is written by its owner thread only, and it can be read by other threads at any time without locking.
+ */
+class LatencyHistogram
+{
+public:
+    static const int BINS_PER_OCTAVE = 8;
+    static const int NUM_BINS = 32 * BINS_PER_OCTAVE;   // Up to 2^32 [usec] (about 70 minutes)
+
+    LatencyHistogram() { reset(); }
+
+    /** Add a latency value [usec] (only by the owner thread) */
+    void add(double usec)
+    {
+        int bin = findBin(usec);
+        m_bins[bin].store(m_bins[bin].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        m_count.store(m_count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        m_sum.store(m_sum.load(std::memory_order_relaxed) + usec, std::memory_order_relaxed);
+        if (usec > m_max.load(std::memory_order_relaxed)) m_max.store(usec, std::memory_order_relaxed);
+    }
+
+    /** Accumulate this histogram to the given bins */
+    void accumulate(std::vector<uint64_t>& bins, uint64_t& count, double& sum, double& max) const
+    {
+        if (bins.size() != NUM_BINS) bins.resize(NUM_BINS, 0);
+        for (int i = 0; i < NUM_BINS; i++) bins[i] += m_bins[i].load(std::memory_order_relaxed);
+        count += m_count.load(std::memory_order_relaxed);
+        sum += m_sum.load(std::memory_order_relaxed);
+        max = std::max(max, m_max.load(std::memory_order_relaxed));
+    }
+
+    void reset()
+    {
+        for (int i = 0; i < NUM_BINS; i++) m_bins[i].store(0);
+        m_count.store(0);
+        m_sum.store(0);
+        m_max.store(0);
+    }
+
+    /** Get the bin index of the given latency [usec] */
+    static int findBin(double usec)
+    {
+        if (usec < 1) return 0;
+        int bin = 1 + (int)(std::log2(usec) * BINS_PER_OCTAVE);
+        return std::min(bin, NUM_BINS - 1);
+    }
+
+    /** Get the representative latency [usec] of the given bin (geometric center of the bin) */
+    static double getBinValue(int bin)
+    {
+        if (bin <= 0) return 0.5;
+        return std::pow(2., (bin - 0.5) / BINS_PER_OCTAVE);
+    }
+
+    /** Estimate the given percentile [0, 1] from the bins */
+    static double getPercentile(const std::vector<uint64_t>& bins, uint64_t count, double p)
+    {
+        if (count == 0 || bins.empty()) return 0;
+        uint64_t rank = (uint64_t)std::ceil(p * count);
+        if (rank < 1) rank = 1;
+        uint64_t acc = 0;
+        for (size_t i = 0; i < bins.size(); i++)
+        {
+            acc += bins[i];
+            if (acc >= rank) return getBinValue((int)i);
+        }
+        return getBinValue((int)bins.size() - 1);
+    }
+
+protected:
+    std::atomic<uint64_t> m_bins[NUM_BINS];
+    std::atomic<uint64_t> m_count;
+    std::atomic<double> m_sum;
+    std::atomic<double> m_max;
+};
+
+/**
+ * @brief Registry of latency histograms, counters, gauges, and trace events
+ *
+ * Metrics are identified by their names, and each name is registered once to get its integer ID.
+ * Latency is recorded to the histogram of the calling thread, so recording does not need any lock among threads.
+ * Counters and gauges are global atomic variables.
+ * The collected metrics can be summarized (p50/p95/p99), written as a CSV file periodically, and written as a Chrome trace file (chrome://tracing).
+ *
+ * Please use the macros, DG_TRACE_SCOPE, DG_COUNT, and DG_GAUGE, which become empty if DG_NO_METRICS is defined.
+ */
+class Metrics
+{
+public:
+    static const int MAX_METRICS = 512;
+
+    /** Summary of a metric */
+    struct Summary
+    {
+        std::string name;
+        uint64_t count = 0;     // The number of latency records
+        double mean = 0;        // [usec]
+        double p50 = 0;         // [usec]
+        double p95 = 0;         // [usec]
+        double p99 = 0;         // [usec]
+        double max = 0;         // [usec]
+        int64_t counter = 0;
+        int64_t gauge = 0;
+    };
+
+    static Metrics& instance()
+    {
+        static Metrics metrics;
+        return metrics;
+    }
+
+    ~Metrics() { stopDump(); }
+
+    /**
+     * Register a metric name
+     * @param name The name of a metric
+     * @return The ID of the name (-1 if there is no more room)
+     */
+    int registerName(const std::string& name)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (size_t i = 0; i < m_names.size(); i++)
+        {
+            if (m_names[i] == name) return (int)i;
+        }
+        if ((int)m_names.size() >= MAX_METRICS) return -1;
+        m_names.push_back(name);
+        return (int)m_names.size() - 1;
+    }
+
+    /** Get the current time [usec] from the beginning of the program */
+    static double now()
+    {
+        static const std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - origin).count();
+    }
+
+    /**
+     * Record a latency
+     * @param id The ID of a metric
+     * @param start The start time [usec] (from Metrics::now())
+     * @param duration The latency [usec]
+     */
+    void addLatency(int id, double start, double duration)
+    {
+        if (id < 0 || id >= MAX_METRICS) return;
+        ThreadData* data = getThreadData();
+        LatencyHistogram* hist = data->hists[id].load(std::memory_order_acquire);
+        if (hist == nullptr)
+        {
+            hist = new LatencyHistogram();
+            data->hists[id].store(hist, std::memory_order_release);
+        }
+        hist->add(duration);
+
+        if (m_trace_enabled.load(std::memory_order_relaxed))
+        {
+            if (data->events.empty()) data->events.resize(m_trace_capacity.load());
+            size_t idx = data->n_events.load(std::memory_order_relaxed);
+            TraceEvent& evt = data->events[idx % data->events.size()];
+            evt.id = id;
+            evt.start = start;
+            evt.duration = duration;
+            data->n_events.store(idx + 1, std::memory_order_release);
+        }
+    }
+
+    /** Increase a counter */
+    void count(int id, int64_t n = 1)
+    {
+        if (id < 0 || id >= MAX_METRICS) return;
+        m_counters[id].fetch_add(n, std::memory_order_relaxed);
+    }
+
+    /**
+     * Set a gauge
+     * @return The previous value of the gauge (-1 if it is not set before)
+     */
+    int64_t setGauge(int id, int64_t value)
+    {
+        if (id < 0 || id >= MAX_METRICS) return -1;
+        return m_gauges[id].exchange(value, std::memory_order_relaxed);
+    }
+
+    int64_t getCounter(int id) const { return (id >= 0 && id < MAX_METRICS) ? m_counters[id].load() : 0; }
+
+    int64_t getGauge(int id) const { return (id >= 0 && id < MAX_METRICS) ? m_gauges[id].load() : -1; }
+
+    /**
+     * Enable or disable recording trace events
+     * @param enable The flag to record trace events
+     * @param max_events The maximum number of trace events per thread (the oldest ones are overwritten)
+     * @see Trace events are written without locking, so writeChromeTrace() is recommended to be called after processing.
+     */
+    void enableTrace(bool enable, size_t max_events = 100000)
+    {
+        if (max_events < 1) max_events = 1;
+        m_trace_capacity = max_events;
+        m_trace_enabled = enable;
+    }
+
+    /** Summarize all metrics merging their per-thread histograms */
+    std::vector<Summary> summarize()
+    {
+        std::vector<std::string> names;
+        std::vector<std::shared_ptr<ThreadData>> threads;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            names = m_names;
+            threads = m_threads;
+        }
+
+        std::vector<Summary> summaries;
+        for (size_t id = 0; id < names.size(); id++)
+        {
+            Summary s;
+            s.name = names[id];
+            std::vector<uint64_t> bins(LatencyHistogram::NUM_BINS, 0);
+            double sum = 0;
+            for (auto& data : threads)
+            {
+                LatencyHistogram* hist = data->hists[id].load(std::memory_order_acquire);
+                if (hist) hist->accumulate(bins, s.count, sum, s.max);
+            }
+            if (s.count > 0)
+            {
+                s.mean = sum / s.count;
+                s.p50 = LatencyHistogram::getPercentile(bins, s.count, 0.50);
+                s.p95 = LatencyHistogram::getPercentile(bins, s.count, 0.95);
+                s.p99 = LatencyHistogram::getPercentile(bins, s.count, 0.99);
+            }
+            s.counter = m_counters[id].load();
+            s.gauge = m_gauges[id].load();
+            summaries.push_back(s);
+        }
+        return summaries;
+    }
+
+    /** Print the summary of all metrics */
+    void print()
+    {
+        std::vector<Summary> summaries = summarize();
+        printf("[Metrics]\n");
+        for (auto& s : summaries)
+        {
+            if (s.count > 0) printf("\t%s: n=%zu, mean=%.3lfms, p50=%.3lfms, p95=%.3lfms, p99=%.3lfms, max=%.3lfms\n", s.name.c_str(), (size_t)s.count, s.mean / 1000, s.p50 / 1000, s.p95 / 1000, s.p99 / 1000, s.max / 1000);
+            else printf("\t%s: counter=%lld, gauge=%lld\n", s.name.c_str(), (long long)s.counter, (long long)s.gauge);
+        }
+    }
+
+    /**
+     * Write the summary of all metrics as a CSV file
+     * @param filename The name of the CSV file
+     * @param append The flag to append rows to the file (the header is written only to a new file)
+     * @return True if successful (false if failed)
+     */
+    bool writeCSV(const std::string& filename, bool append = false)
+    {
+        FILE* file = nullptr;
+        bool new_file = true;
+        if (append)
+        {
+            file = fopen(filename.c_str(), "r");
+            if (file) { new_file = false; fclose(file); }
+        }
+        file = fopen(filename.c_str(), append ? "a" : "w");
+        if (file == nullptr) return false;
+
+        if (new_file) fprintf(file, "time,name,count,mean_ms,p50_ms,p95_ms,p99_ms,max_ms,counter,gauge\n");
+        double time = now() / 1e6;
+        std::vector<Summary> summaries = summarize();
+        for (auto& s : summaries)
+        {
+            fprintf(file, "%.3lf,%s,%zu,%.4lf,%.4lf,%.4lf,%.4lf,%.4lf,%lld,%lld\n", time, s.name.c_str(), (size_t)s.count, s.mean / 1000, s.p50 / 1000, s.p95 / 1000, s.p99 / 1000, s.max / 1000, (long long)s.counter, (long long)s.gauge);
+        }
+        fclose(file);
+        return true;
+    }
+
+    /**
+     * Write the recorded trace events as a Chrome trace file (JSON)
+     * @param filename The name of the trace file
+     * @return True if successful (false if failed)
+     */
+    bool writeChromeTrace(const std::string& filename)
+    {
+        std::vector<std::string> names;
+        std::vector<std::shared_ptr<ThreadData>> threads;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            names = m_names;
+            threads = m_threads;
+        }
+
+        FILE* file = fopen(filename.c_str(), "w");
+        if (file == nullptr) return false;
+        fprintf(file, "{\"traceEvents\":[\n");
+        bool first = true;
+        for (size_t t = 0; t < threads.size(); t++)
+        {
+            const ThreadData* data = threads[t].get();
+            size_t n_events = data->n_events.load(std::memory_order_acquire);
+            size_t capacity = data->events.size();
+            if (capacity == 0) continue;
+            size_t begin = (n_events > capacity) ? (n_events - capacity) : 0;
+            for (size_t i = begin; i < n_events; i++)
+            {
+                const TraceEvent& evt = data->events[i % capacity];
+                if (evt.id < 0 || evt.id >= (int)names.size()) continue;
+                fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%zu,\"ts\":%.1lf,\"dur\":%.1lf}", first ? "" : ",\n", names[evt.id].c_str(), t, evt.start, evt.duration);
+                first = false;
+            }
+        }
+        fprintf(file, "\n]}\n");
+        fclose(file);
+        return true;
+    }
+
+    /**
+     * Start writing the summary as a CSV file periodically on a background thread
+     * @param filename The name of the CSV file
+     * @param period The period of writing [sec]
+     * @return True if successful (false if failed)
+     */
+    bool startDump(const std::string& filename, double period = 1)
+    {
+        if (m_dump_thread.joinable() || period <= 0) return false;
+        m_dump_running = true;
+        m_dump_thread = std::thread([this, filename, period]()
+        {
+            std::unique_lock<std::mutex> lock(m_dump_mutex);
+            while (m_dump_running)
+            {
+                m_dump_cond.wait_for(lock, std::chrono::microseconds((int64_t)(period * 1e6)));
+                writeCSV(filename, true);
+            }
+        });
+        return true;
+    }
+
+    void stopDump()
+    {
+        if (!m_dump_thread.joinable()) return;
+        {
+            std::lock_guard<std::mutex> lock(m_dump_mutex);
+            m_dump_running = false;
+        }
+        m_dump_cond.notify_all();
+        m_dump_thread.join();
+    }
+
+    /** Clear all recorded values (registered names are kept) */
+    void reset()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto& data : m_threads)
+        {
+            for (int i = 0; i < MAX_METRICS; i++)
+            {
+                LatencyHistogram* hist = data->hists[i].load();
+                if (hist) hist->reset();
+            }
+            data->n_events = 0;
+        }
+        for (int i = 0; i < MAX_METRICS; i++)
+        {
+            m_counters[i] = 0;
+            m_gauges[i] = -1;
+        }
+    }
+
+protected:
+    Metrics() : m_trace_enabled(false), m_trace_capacity(100000), m_dump_running(false)
+    {
+        for (int i = 0; i < MAX_METRICS; i++)
+        {
+            m_counters[i] = 0;
+            m_gauges[i] = -1;
+        }
+    }
+
+    struct TraceEvent
+    {
+        int id = -1;
+        double start = 0;
+        double duration = 0;
+    };
+
+    struct ThreadData
+    {
+        ThreadData()
+        {
+            for (int i = 0; i < MAX_METRICS; i++) hists[i] = nullptr;
+            n_events = 0;
+        }
+
+        ~ThreadData()
+        {
+            for (int i = 0; i < MAX_METRICS; i++) delete hists[i].load();
+        }
+
+        std::atomic<LatencyHistogram*> hists[MAX_METRICS];
+        std::vector<TraceEvent> events;
+        std::atomic<size_t> n_events;
+    };
+
+    ThreadData* getThreadData()
+    {
+        thread_local std::shared_ptr<ThreadData> data;
+        if (!data)
+        {
+            data = std::make_shared<ThreadData>();
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_threads.push_back(data);
+        }
+        return data.get();
+    }
+
+    std::mutex m_mutex;
+    std::vector<std::string> m_names;
+    std::vector<std::shared_ptr<ThreadData>> m_threads;
+    std::atomic<int64_t> m_counters[MAX_METRICS];
+    std::atomic<int64_t> m_gauges[MAX_METRICS];
+    std::atomic<bool> m_trace_enabled;
+    std::atomic<size_t> m_trace_capacity;
+
+    std::thread m_dump_thread;
+    std::mutex m_dump_mutex;
+    std::condition_variable m_dump_cond;
+    bool m_dump_running;
+};
+
+/**
+ * @brief Scoped timer which records its lifetime to Metrics
+ */
+class ScopedTimer
+{
+public:
+    ScopedTimer(int id) : m_id(id), m_start(Metrics::now()) {}
+
+    ScopedTimer(const std::string& name) : m_id(Metrics::instance().registerName(name)), m_start(Metrics::now()) {}
+
+    ~ScopedTimer() { Metrics::instance().addLatency(m_id, m_start, Metrics::now() - m_start); }
+
+    /** Get the elapsed time [sec] */
+    double elapsed() const { return (Metrics::now() - m_start) / 1e6; }
+
+protected:
+    int m_id;
+    double m_start;
+};
+
+} // End of 'dg'
+
+#define DG_METRICS_CONCAT_(a, b) a##b
+#define DG_METRICS_CONCAT(a, b) DG_METRICS_CONCAT_(a, b)
+
+#ifndef DG_NO_METRICS
+/** A macro to measure latency of the current scope (the name should be a string literal) */
+#   define DG_TRACE_SCOPE(name) \
+        static const int DG_METRICS_CONCAT(_dg_metric_id_, __LINE__) = dg::Metrics::instance().registerName(name); \
+        dg::ScopedTimer DG_METRICS_CONCAT(_dg_scoped_timer_, __LINE__)(DG_METRICS_CONCAT(_dg_metric_id_, __LINE__))
+/** A macro to increase a counter (the name should be a string literal) */
+#   define DG_COUNT(name, n) \
+        do { static const int _dg_metric_id = dg::Metrics::instance().registerName(name); dg::Metrics::instance().count(_dg_metric_id, n); } while (0)
+/** A macro to set a gauge (the name should be a string literal) */
+#   define DG_GAUGE(name, value) \
+        do { static const int _dg_metric_id = dg::Metrics::instance().registerName(name); dg::Metrics::instance().setGauge(_dg_metric_id, value); } while (0)
+#else
+#   define DG_TRACE_SCOPE(name)
+#   define DG_COUNT(name, n)
+#   define DG_GAUGE(name, value)
+#endif
+
+#endif // End of '__DG_UTILS_METRICS__'
@@ -21,6 +21,26 @@
 #include <vector>
 #include <fstream>
 #include <sstream>
+#include <limits>
+#include <thread>
+#include <cstring>
+#include <cstdlib>
+#include <cctype>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#if defined(__has_include)
+#if __has_include(<charconv>) && __cplusplus >= 201703L
+#include <charconv>
+#endif
+#endif
+// 'CX_HAS_FROM_CHARS' is defined if 'std::from_chars' supports both integers and floating-point numbers (e.g. not before GCC 11)
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+#define CX_HAS_FROM_CHARS
+#endif
 
 namespace cx
 {
@@ -66,6 +86,362 @@ namespace cx
         return text;
     }
 
+    /**
+     * @brief A Streaming CSV File Reader
+     *
+     * This reader maps a CSV file on memory (or reads it at once if memory mapping is not available) and parses its rows in place.
+     * Each row is given to a callback as its fields which point the mapped file, so cells are not stored as strings.
+     * Numbers are converted by 'std::from_chars' if available (otherwise 'strtod' and 'strtol').
+     * Large files are split into chunks at line breaks, and the chunks are parsed in parallel to extract columns.
+     * Similarly to 'CSVReader', quotation marks are not supported, and leading and trailing spaces of each field are trimmed.
+     */
+    class CSVStreamReader
+    {
+    public:
+        /** A type for 2D vector of doubles */
+        typedef std::vector<std::vector<double>> Double2D;
+
+        /** A type for 2D vector of integers */
+        typedef std::vector<std::vector<int>> Int2D;
+
+        /**
+         * @brief A field of a row
+         *
+         * A field points its text in the file (not null-terminated), so it is valid until the file is closed.
+         */
+        struct Field
+        {
+            /** The beginning of the text */
+            const char* ptr;
+
+            /** The length of the text */
+            size_t len;
+
+            /**
+             * Get the text as a string
+             * @return The text
+             */
+            std::string toString() const { return std::string(ptr, len); }
+
+            /**
+             * Convert the text to a double (a.k.a. float64)
+             * @param invalid_val The value to return if the text is not numeric
+             * @return The converted value
+             */
+            double toDouble(double invalid_val = std::numeric_limits<double>::quiet_NaN()) const
+            {
+                const char* first = ptr;
+                const char* last = ptr + len;
+                if (first < last && *first == '+') first++;
+                if (first >= last) return invalid_val;
+                double val = invalid_val;
+#ifdef CX_HAS_FROM_CHARS
+                if (std::from_chars(first, last, val).ec != std::errc()) return invalid_val;
+#else
+                char buffer[64];
+                size_t n = std::min(static_cast<size_t>(last - first), sizeof(buffer) - 1);
+                memcpy(buffer, first, n);
+                buffer[n] = '\0';
+                char* end = nullptr;
+                val = strtod(buffer, &end);
+                if (end == buffer) return invalid_val;
+#endif
+                return val;
+            }
+
+            /**
+             * Convert the text to an integer (a.k.a. int32)
+             * @param invalid_val The value to return if the text is not numeric
+             * @return The converted value
+             */
+            int toInt(int invalid_val = -1) const
+            {
+                const char* first = ptr;
+                const char* last = ptr + len;
+                if (first < last && *first == '+') first++;
+                if (first >= last) return invalid_val;
+                int val = invalid_val;
+#ifdef CX_HAS_FROM_CHARS
+                if (std::from_chars(first, last, val).ec != std::errc()) return invalid_val;
+#else
+                char buffer[32];
+                size_t n = std::min(static_cast<size_t>(last - first), sizeof(buffer) - 1);
+                memcpy(buffer, first, n);
+                buffer[n] = '\0';
+                char* end = nullptr;
+                long lval = strtol(buffer, &end, 10);
+                if (end == buffer || lval < std::numeric_limits<int>::min() || lval > std::numeric_limits<int>::max()) return invalid_val;
+                val = static_cast<int>(lval);
+#endif
+                return val;
+            }
+        };
+
+        /**
+         * A callback for each row
+         * @param row The row index in the file (starting from 0)
+         * @param fields The fields of the row
+         * @return True to continue (false to stop)
+         */
+        typedef std::function<bool(size_t row, const std::vector<Field>& fields)> RowCallback;
+
+        /**
+         * The default constructor
+         */
+        CSVStreamReader() : m_data(nullptr), m_size(0), m_mapped(false), m_separator(','), m_threads(0) { }
+
+        /**
+         * The destructor
+         */
+        ~CSVStreamReader() { close(); }
+
+        /**
+         * Open a CSV file
+         * @param csv_file The filename to read
+         * @param separator A character which separate each column
+         * @return True if successful (false if failed)
+         */
+        bool open(const std::string& csv_file, char separator = ',')
+        {
+            close();
+            m_separator = separator;
+#ifndef _WIN32
+            int fd = ::open(csv_file.c_str(), O_RDONLY);
+            if (fd < 0) return false;
+            struct stat info;
+            if (fstat(fd, &info) != 0)
+            {
+                ::close(fd);
+                return false;
+            }
+            m_size = static_cast<size_t>(info.st_size);
+            if (m_size > 0)
+            {
+                void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (data != MAP_FAILED)
+                {
+                    madvise(data, m_size, MADV_SEQUENTIAL);
+                    m_data = static_cast<const char*>(data);
+                    m_mapped = true;
+                }
+            }
+            ::close(fd);
+            if (m_mapped || m_size == 0) return true;
+#endif
+            // Read the whole file if it is not mapped
+            std::ifstream file(csv_file, std::ios::binary);
+            if (!file.is_open()) return false;
+            m_buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+            m_data = m_buffer.data();
+            m_size = m_buffer.size();
+            return true;
+        }
+
+        /**
+         * Close the file
+         */
+        void close()
+        {
+#ifndef _WIN32
+            if (m_mapped) munmap(const_cast<char*>(m_data), m_size);
+#endif
+            m_buffer.clear();
+            m_data = nullptr;
+            m_size = 0;
+            m_mapped = false;
+        }
+
+        /**
+         * Get the size of the opened file
+         * @return The file size [byte]
+         */
+        size_t getFileSize() const { return m_size; }
+
+        /**
+         * Set the number of threads to extract columns
+         * @param n_threads The number of threads (0: the number of hardware threads)
+         */
+        void setThreads(int n_threads) { m_threads = n_threads; }
+
+        /**
+         * Read rows in order
+         * @param callback A callback for each row (empty rows are skipped)
+         * @param row_start A starting row to skip headers
+         * @return The number of rows given to the callback
+         */
+        size_t forEachRow(const RowCallback& callback, int row_start = 0) const
+        {
+            const char* p = skipRows(row_start);
+            const char* end = m_data + m_size;
+            std::vector<Field> fields;
+            size_t n_rows = 0;
+            for (size_t row = std::max(row_start, 0); p < end; row++)
+            {
+                p = parseRow(p, end, m_separator, fields);
+                if (fields.empty()) continue;
+                n_rows++;
+                if (!callback(row, fields)) break;
+            }
+            return n_rows;
+        }
+
+        /**
+         * Extract the desired columns as a 2D vector of doubles (a.k.a. float64)
+         * @param row_start A starting row to skip headers
+         * @param columns The desired columns to extract
+         * @param invalid_val The value to represent invalid (e.g. non-numeric) elements
+         * @return The selected columns as a 2D vector of doubles
+         */
+        Double2D extDouble2D(int row_start = 0, const std::vector<size_t> columns = std::vector<size_t>(), double invalid_val = std::numeric_limits<double>::quiet_NaN()) const
+        {
+            return extract<double>(row_start, columns, [invalid_val](const Field& field) { return field.toDouble(invalid_val); }, invalid_val);
+        }
+
+        /**
+         * Extract the desired columns as a 2D vector of integers (a.k.a. int32)
+         * @param row_start A starting row to skip headers
+         * @param columns The desired columns to extract
+         * @param invalid_val The value to represent invalid (e.g. non-numeric) elements
+         * @return The selected columns as a 2D vector of integers
+         */
+        Int2D extInt2D(int row_start = 0, const std::vector<size_t> columns = std::vector<size_t>(), int invalid_val = -1) const
+        {
+            return extract<int>(row_start, columns, [invalid_val](const Field& field) { return field.toInt(invalid_val); }, invalid_val);
+        }
+
+        /**
+         * Parse a row
+         * @param p The beginning of the row
+         * @param end The end of the text
+         * @param separator A character which separate each column
+         * @param fields The trimmed fields of the row (empty if the row is empty)
+         * @return The beginning of the next row
+         */
+        static const char* parseRow(const char* p, const char* end, char separator, std::vector<Field>& fields)
+        {
+            fields.clear();
+            const char* eol = static_cast<const char*>(memchr(p, '\n', end - p));
+            if (eol == nullptr) eol = end;
+            const char* line_end = eol;
+            if (line_end > p && line_end[-1] == '\r') line_end--;
+            if (line_end > p)
+            {
+                const char* first = p;
+                while (true)
+                {
+                    const char* last = static_cast<const char*>(memchr(first, separator, line_end - first));
+                    if (last == nullptr) last = line_end;
+                    Field field = { first, static_cast<size_t>(last - first) };
+                    while (field.len > 0 && isspace(static_cast<unsigned char>(*field.ptr))) { field.ptr++; field.len--; }
+                    while (field.len > 0 && isspace(static_cast<unsigned char>(field.ptr[field.len - 1]))) field.len--;
+                    fields.push_back(field);
+                    if (last >= line_end) break;
+                    first = last + 1;
+                }
+            }
+            return (eol < end) ? eol + 1 : end;
+        }
+
+    protected:
+        /**
+         * Find the beginning of the given row
+         * @param row_start The row index
+         * @return The beginning of the row (the end of the file if there are less rows)
+         */
+        const char* skipRows(int row_start) const
+        {
+            const char* p = m_data;
+            const char* end = m_data + m_size;
+            for (int row = 0; row < row_start && p < end; row++)
+            {
+                const char* eol = static_cast<const char*>(memchr(p, '\n', end - p));
+                p = (eol == nullptr) ? end : eol + 1;
+            }
+            return p;
+        }
+
+        /**
+         * Extract the desired columns of all rows (chunks of the file are parsed in parallel)
+         */
+        template <typename T, typename Convert>
+        std::vector<std::vector<T>> extract(int row_start, const std::vector<size_t>& columns, Convert convert, T invalid_val) const
+        {
+            std::vector<std::vector<T>> data;
+            if (m_size == 0) return data;
+
+            // Select all columns of the first row if the given is empty
+            std::vector<size_t> col_select = columns;
+            if (col_select.empty())
+            {
+                std::vector<Field> first_row;
+                parseRow(m_data, m_data + m_size, m_separator, first_row);
+                for (size_t i = 0; i < first_row.size(); i++) col_select.push_back(i);
+            }
+
+            // Split the rest of the file into chunks at line breaks
+            const char* begin = skipRows(row_start);
+            const char* end = m_data + m_size;
+            const size_t min_chunk = 4 * 1024 * 1024;
+            size_t n_chunks = (m_threads > 0) ? m_threads : std::max(std::thread::hardware_concurrency(), 1u);
+            n_chunks = std::max(std::min(n_chunks, static_cast<size_t>(end - begin) / min_chunk), static_cast<size_t>(1));
+            std::vector<const char*> bounds(1, begin);
+            for (size_t i = 1; i < n_chunks; i++)
+            {
+                const char* p = std::max(begin + (end - begin) * i / n_chunks, bounds.back());
+                const char* eol = static_cast<const char*>(memchr(p, '\n', end - p));
+                bounds.push_back((eol == nullptr) ? end : eol + 1);
+            }
+            bounds.push_back(end);
+
+            // Parse the chunks
+            std::vector<std::vector<std::vector<T>>> chunks(n_chunks);
+            auto parse = [&](size_t chunk)
+            {
+                std::vector<Field> fields;
+                std::vector<std::vector<T>>& rows = chunks[chunk];
+                for (const char* p = bounds[chunk]; p < bounds[chunk + 1];)
+                {
+                    p = parseRow(p, bounds[chunk + 1], m_separator, fields);
+                    if (fields.empty()) continue;
+                    std::vector<T> vals(col_select.size(), invalid_val);
+                    for (size_t i = 0; i < col_select.size(); i++)
+                    {
+                        if (col_select[i] < fields.size()) vals[i] = convert(fields[col_select[i]]);
+                    }
+                    rows.push_back(std::move(vals));
+                }
+            };
+            std::vector<std::thread> workers;
+            for (size_t i = 1; i < n_chunks; i++) workers.push_back(std::thread(parse, i));
+            parse(0);
+            for (auto worker = workers.begin(); worker != workers.end(); worker++) worker->join();
+
+            // Concatenate the chunks
+            data = std::move(chunks[0]);
+            for (size_t i = 1; i < n_chunks; i++)
+                data.insert(data.end(), std::make_move_iterator(chunks[i].begin()), std::make_move_iterator(chunks[i].end()));
+            return data;
+        }
+
+        /** The beginning of the file */
+        const char* m_data;
+
+        /** The size of the file */
+        size_t m_size;
+
+        /** A flag whether the file is mapped on memory or not */
+        bool m_mapped;
+
+        /** The whole file if it is not mapped on memory */
+        std::vector<char> m_buffer;
+
+        /** A character which separate each column */
+        char m_separator;
+
+        /** The number of threads to extract columns */
+        int m_threads;
+    }; // End of 'CSVStreamReader'
+
     /**
      * @brief A CSV File Reader
      *
@@ -93,20 +469,18 @@ namespace cx
          */
         bool open(const std::string& csv_file, char separator = ',')
         {
-            std::ifstream file(csv_file);
-            if (!file.is_open()) return false;
+            CSVStreamReader reader;
+            if (!reader.open(csv_file, separator)) return false;
 
             this->clear();
-            std::string line;
-            while (getline(file, line))
+            reader.forEachRow([this](size_t row, const std::vector<CSVStreamReader::Field>& fields)
             {
-                std::vector<std::string> datum;
-                std::string element;
-                std::stringstream temp(line);
-                while (getline(temp, element, separator))
-                    datum.push_back(trimBoth(element));
-                this->push_back(datum);
-            }
+                this->resize(row + 1); // Keep row indices of empty rows
+                std::vector<std::string>& datum = this->back();
+                for (auto field = fields.begin(); field != fields.end(); field++)
+                    datum.push_back(field->toString());
+                return true;
+            });
             return true;
         }
 
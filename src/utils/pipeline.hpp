@@ -0,0 +1,339 @@
+#ifndef __DG_UTILS_PIPELINE__
+#define __DG_UTILS_PIPELINE__
+
+#include "utils/metrics.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace dg
+{
+
+/** Policies of a bounded queue when a new item arrives on the full queue */
+enum class DropPolicy
+{
+    /** Discard the oldest item to make room for the new one (suitable for sensor streams) */
+    DROP_OLDEST = 0,
+    /** Discard the new item and keep the queued ones */
+    DROP_NEWEST = 1
+};
+
+/**
+ * @brief Wake-up signal of a pipeline stage
+ *
+ * Producers call notify() after they put data for a stage, and the stage thread sleeps in wait() until it is notified.
+ * The mutex is only used to sleep, so data transfer itself is not serialized by this signal.
+ */
+class StageSignal
+{
+public:
+    StageSignal() : m_seq(0) {}
+
+    void notify()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_seq++;
+        }
+        m_cond.notify_all();
+    }
+
+    /**
+     * Wait until a new notification after the given sequence number
+     * @param last_seq The last seen sequence number (updated to the current one)
+     * @param timeout The maximum waiting time [sec]
+     * @return True if notified (false if timeout)
+     */
+    bool wait(uint64_t& last_seq, double timeout)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        bool notified = m_cond.wait_for(lock, std::chrono::microseconds((int64_t)(timeout * 1e6)), [&] { return m_seq != last_seq; });
+        last_seq = m_seq;
+        return notified;
+    }
+
+    uint64_t sequence()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_seq;
+    }
+
+protected:
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    uint64_t m_seq;
+};
+
+/**
+ * @brief Bounded lock-free queue with a drop policy
+ *
+ * It is a multi-producer multi-consumer ring buffer based on per-slot sequence numbers (D. Vyukov).
+ * Its capacity is rounded up to a power of two.
+ * When the queue is full, push() discards the oldest or the newest item according to its DropPolicy so that producers never block.
+ */
+template <typename T>
+class BoundedQueue
+{
+public:
+    BoundedQueue(size_t capacity = 4, DropPolicy policy = DropPolicy::DROP_OLDEST, std::shared_ptr<StageSignal> signal = nullptr)
+        : m_policy(policy), m_signal(signal), m_head(0), m_tail(0), m_n_dropped(0)
+    {
+        size_t size = 2;
+        while (size < capacity) size <<= 1;
+        m_mask = size - 1;
+        m_capacity = capacity;
+        m_slots.reset(new Slot[size]);
+        for (size_t i = 0; i < size; i++) m_slots[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    /**
+     * Put an item to the queue
+     * @param item The item to put
+     * @return True if the item is queued (false if it is dropped)
+     */
+    bool push(T item)
+    {
+        while (!tryPush(item))
+        {
+            if (m_policy == DropPolicy::DROP_NEWEST)
+            {
+                m_n_dropped++;
+                return false;
+            }
+            T oldest;
+            if (tryPop(oldest)) m_n_dropped++;
+        }
+        if (m_signal) m_signal->notify();
+        return true;
+    }
+
+    /**
+     * Take the oldest item from the queue
+     * @param item The taken item
+     * @return True if an item is taken (false if the queue is empty)
+     */
+    bool pop(T& item) { return tryPop(item); }
+
+    /**
+     * Take the newest item from the queue and discard all older ones
+     * @param item The taken item
+     * @return True if an item is taken (false if the queue is empty)
+     */
+    bool popLatest(T& item)
+    {
+        if (!tryPop(item)) return false;
+        T next;
+        while (tryPop(next))
+        {
+            item = std::move(next);
+            m_n_dropped++;
+        }
+        return true;
+    }
+
+    size_t size() const
+    {
+        size_t tail = m_tail.load(std::memory_order_acquire);
+        size_t head = m_head.load(std::memory_order_acquire);
+        return (tail > head) ? (tail - head) : 0;
+    }
+
+    bool empty() const { return size() == 0; }
+
+    size_t capacity() const { return m_capacity; }
+
+    /** Get the number of dropped items so far */
+    uint64_t dropped() const { return m_n_dropped.load(); }
+
+    std::shared_ptr<StageSignal> signal() const { return m_signal; }
+
+protected:
+    bool tryPush(T& item)
+    {
+        if (size() >= m_capacity) return false;
+        size_t pos = m_tail.load(std::memory_order_relaxed);
+        while (true)
+        {
+            Slot& slot = m_slots[pos & m_mask];
+            size_t seq = slot.seq.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0)
+            {
+                if (m_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    slot.data = std::move(item);
+                    slot.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0) return false;
+            else pos = m_tail.load(std::memory_order_relaxed);
+        }
+    }
+
+    bool tryPop(T& item)
+    {
+        size_t pos = m_head.load(std::memory_order_relaxed);
+        while (true)
+        {
+            Slot& slot = m_slots[pos & m_mask];
+            size_t seq = slot.seq.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+            if (diff == 0)
+            {
+                if (m_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    item = std::move(slot.data);
+                    slot.data = T();
+                    slot.seq.store(pos + m_mask + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0) return false;
+            else pos = m_head.load(std::memory_order_relaxed);
+        }
+    }
+
+    struct Slot
+    {
+        std::atomic<size_t> seq;
+        T data;
+    };
+
+    DropPolicy m_policy;
+    std::shared_ptr<StageSignal> m_signal;
+    std::unique_ptr<Slot[]> m_slots;
+    size_t m_mask;
+    size_t m_capacity;
+    std::atomic<size_t> m_head;
+    std::atomic<size_t> m_tail;
+    std::atomic<uint64_t> m_n_dropped;
+};
+
+/**
+ * @brief Dataflow scheduler of processing stages
+ *
+ * Each stage runs on its own thread and is woken up by its StageSignal (event-driven) or by its period (time-driven).
+ * A stage function returns true if it did some work. If it returns true, the stage is called again immediately to drain its inputs.
+ * Stages exchange data through BoundedQueue so that a slow stage drops its stale inputs instead of stalling its producers.
+ */
+class Pipeline
+{
+public:
+    typedef std::function<bool()> StageFunc;
+
+    Pipeline() : m_running(false) {}
+
+    virtual ~Pipeline() { stop(); }
+
+    /**
+     * Add a stage to the pipeline
+     * @param name The name of the stage
+     * @param func The stage function which returns true if it did some work
+     * @param trigger The signal to wake up the stage (nullptr if time-driven only)
+     * @param period The maximum sleeping time between two calls [sec]
+     * @return True if successful (false if failed)
+     */
+    bool addStage(const std::string& name, StageFunc func, std::shared_ptr<StageSignal> trigger = nullptr, double period = 0.1)
+    {
+        if (m_running || !func) return false;
+        std::unique_ptr<Stage> stage(new Stage());
+        stage->name = name;
+        stage->func = func;
+        stage->trigger = trigger ? trigger : std::make_shared<StageSignal>();
+        stage->period = period;
+        m_stages.push_back(std::move(stage));
+        return true;
+    }
+
+    bool start()
+    {
+        if (m_running || m_stages.empty()) return false;
+        m_running = true;
+        for (auto& stage : m_stages)
+        {
+            stage->n_runs = 0;
+            stage->thread = std::thread(&Pipeline::runStage, this, stage.get());
+        }
+        return true;
+    }
+
+    void stop()
+    {
+        if (!m_running) return;
+        m_running = false;
+        for (auto& stage : m_stages)
+        {
+            stage->trigger->notify();
+            if (stage->thread.joinable()) stage->thread.join();
+        }
+    }
+
+    bool isRunning() const { return m_running; }
+
+    /** Change the period of the given stage (it is applied from the next call) */
+    bool setStagePeriod(const std::string& name, double period)
+    {
+        for (auto& stage : m_stages)
+        {
+            if (stage->name == name)
+            {
+                stage->period = period;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /** Get the number of calls of the given stage which did some work */
+    uint64_t countStageRuns(const std::string& name) const
+    {
+        for (auto& stage : m_stages)
+        {
+            if (stage->name == name) return stage->n_runs.load();
+        }
+        return 0;
+    }
+
+protected:
+    struct Stage
+    {
+        std::string name;
+        StageFunc func;
+        std::shared_ptr<StageSignal> trigger;
+        std::atomic<double> period;
+        std::atomic<uint64_t> n_runs;
+        std::thread thread;
+    };
+
+    void runStage(Stage* stage)
+    {
+        uint64_t seq = stage->trigger->sequence();
+        int metric_id = Metrics::instance().registerName("Pipeline::" + stage->name);
+        while (m_running)
+        {
+            double start = Metrics::now();
+            bool worked = stage->func();
+            Metrics::instance().addLatency(metric_id, start, Metrics::now() - start);
+            if (worked)
+            {
+                stage->n_runs++;
+                continue;
+            }
+            stage->trigger->wait(seq, stage->period.load());
+        }
+    }
+
+    std::vector<std::unique_ptr<Stage>> m_stages;
+    std::atomic<bool> m_running;
+};
+
+} // End of 'dg'
+
+#endif // End of '__DG_UTILS_PIPELINE__'
@@ -5,6 +5,7 @@
 #define PY_SSIZE_T_CLEAN
 #include <Python.h>
 #include "numpy/arrayobject.h"
+#include "utils/metrics.hpp"
 
 namespace dg
 {
@@ -0,0 +1,235 @@
+#ifndef __DG_UTILS_RATE_POLICY__
+#define __DG_UTILS_RATE_POLICY__
+
+#include "core/basic_type.hpp"
+#include "utils/metrics.hpp"
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace dg
+{
+
+/**
+ * @brief Context-dependent rate limiter of recognizer modules
+ *
+ * Each module has two rates, one for its idle context and the other for its active context (e.g. approaching a junction for intersection classification).
+ * The owner switches the context of each module with setActive(), and a module asks accept() whether a frame should be processed.
+ * Frames are accepted by their capture times, so the rates are kept on replayed logs which run faster than real time.
+ * When a module becomes active, its next frame is accepted immediately.
+ * Processing times of accepted frames are accumulated to report the compute budget of each module and the compute saved by the policy.
+ * All member functions are thread-safe.
+ */
+class RatePolicy
+{
+public:
+    /** Remove all modules and statistics */
+    void clear()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_modules.clear();
+    }
+
+    /**
+     * Set the rates of a module
+     * @param module The name of the module
+     * @param idle_rate The rate in the idle context [Hz] (0: not run, negative: unlimited)
+     * @param active_rate The rate in the active context [Hz] (0: not run, negative: unlimited)
+     */
+    void setRates(const std::string& module, double idle_rate, double active_rate)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Module& mod = getModule(module);
+        mod.rates[0] = idle_rate;
+        mod.rates[1] = active_rate;
+        Metrics::instance().setGauge(mod.metric_rate, (int64_t)(mod.rate() * 1000));
+    }
+
+    /**
+     * Set the context of a module
+     * @param module The name of the module
+     * @param active True for the active context (false for the idle context)
+     */
+    void setActive(const std::string& module, bool active)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Module& mod = getModule(module);
+        if (active && !mod.active) mod.next_time = -std::numeric_limits<double>::infinity();
+        mod.active = active;
+        Metrics::instance().setGauge(mod.metric_rate, (int64_t)(mod.rate() * 1000));
+    }
+
+    /** Check whether a module is in its active context */
+    bool isActive(const std::string& module) const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto found = m_modules.find(module);
+        return found != m_modules.end() && found->second.active;
+    }
+
+    /**
+     * Get the current rate of a module
+     * @return The rate in the current context [Hz] (negative if unlimited or the module is not registered)
+     */
+    double getRate(const std::string& module) const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto found = m_modules.find(module);
+        return (found != m_modules.end()) ? found->second.rate() : -1;
+    }
+
+    /**
+     * Check whether a frame should be processed by a module (the schedule of the module advances if accepted)
+     * Frames of modules which are not registered are always accepted.
+     * @param module The name of the module
+     * @param capture_time The capture time of the frame [sec]
+     * @return True if the frame should be processed (false if it should be skipped)
+     */
+    bool accept(const std::string& module, Timestamp capture_time)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto found = m_modules.find(module);
+        if (found == m_modules.end()) return true;
+        Module& mod = found->second;
+        if (mod.first_time < 0) mod.first_time = capture_time;
+        mod.last_time = std::max(mod.last_time, capture_time);
+
+        double rate = mod.rate();
+        bool accepted = (rate < 0) || (rate > 0 && capture_time >= mod.next_time);
+        if (accepted)
+        {
+            if (rate > 0) mod.next_time = (mod.next_time + 1 / rate > capture_time) ? mod.next_time + 1 / rate : capture_time + 1 / rate;
+            mod.n_accepted++;
+            if (mod.active) mod.n_active++;
+        }
+        else
+        {
+            mod.n_rejected++;
+            Metrics::instance().count(mod.metric_rejected);
+        }
+        return accepted;
+    }
+
+    /**
+     * Add the processing time of an accepted frame
+     * @param module The name of the module
+     * @param seconds The processing time [sec]
+     */
+    void addBusyTime(const std::string& module, double seconds)
+    {
+        if (seconds < 0) return;
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto found = m_modules.find(module);
+        if (found == m_modules.end()) return;
+        found->second.busy_time += seconds;
+        found->second.n_busy++;
+    }
+
+    /** Get the number of frames accepted by a module */
+    uint64_t countAccepted(const std::string& module) const { Module mod; return getStats(module, mod) ? mod.n_accepted : 0; }
+
+    /** Get the number of frames skipped by the policy of a module */
+    uint64_t countRejected(const std::string& module) const { Module mod; return getStats(module, mod) ? mod.n_rejected : 0; }
+
+    /** Get the mean processing time of a module [sec] */
+    double getMeanProcTime(const std::string& module) const { Module mod; return getStats(module, mod) ? mod.meanProcTime() : 0; }
+
+    /** Get the total processing time of a module [sec] */
+    double getBusyTime(const std::string& module) const { Module mod; return getStats(module, mod) ? mod.busy_time : 0; }
+
+    /**
+     * Get the compute budget of a module in a context
+     * @return The fraction of a CPU core which the module takes at its rate in the context (1 if unlimited)
+     */
+    double getBudget(const std::string& module, bool active) const
+    {
+        Module mod;
+        if (!getStats(module, mod)) return 1;
+        double rate = mod.rates[active ? 1 : 0];
+        return (rate < 0) ? 1 : std::min(rate * mod.meanProcTime(), 1.0);
+    }
+
+    /**
+     * Get the compute saved by the policy of a module
+     * The baseline is processing all frames without the policy, which is limited by the elapsed time of the frames if the module cannot keep up with them.
+     * @return The saved processing time [sec]
+     */
+    double getSavedTime(const std::string& module) const
+    {
+        Module mod;
+        if (!getStats(module, mod)) return 0;
+        double baseline = (mod.n_accepted + mod.n_rejected) * mod.meanProcTime();
+        if (mod.last_time > mod.first_time) baseline = std::min(baseline, mod.last_time - mod.first_time);
+        return std::max(baseline - mod.busy_time, 0.0);
+    }
+
+    /** Print the rates, budgets, and saved compute of each module */
+    void print() const
+    {
+        std::map<std::string, Module> modules;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            modules = m_modules;
+        }
+        for (auto mod = modules.begin(); mod != modules.end(); mod++)
+        {
+            const std::string& name = mod->first;
+            double busy = mod->second.busy_time, saved = getSavedTime(name);
+            printf("[policy] %s: rate %.1f/%.1f Hz, budget %.1f/%.1f%% of a core, %d frames (%d active), %d skipped, %.2f sec busy, %.2f sec saved (%.0f%%)\n",
+                name.c_str(), mod->second.rates[0], mod->second.rates[1], getBudget(name, false) * 100, getBudget(name, true) * 100,
+                (int)mod->second.n_accepted, (int)mod->second.n_active, (int)mod->second.n_rejected, busy, saved, (busy + saved > 0) ? saved / (busy + saved) * 100 : 0);
+        }
+    }
+
+protected:
+    struct Module
+    {
+        double rates[2] = { -1, -1 };
+        bool active = false;
+        double next_time = -std::numeric_limits<double>::infinity();
+        double first_time = -1;
+        double last_time = -1;
+        uint64_t n_accepted = 0;
+        uint64_t n_active = 0;
+        uint64_t n_rejected = 0;
+        uint64_t n_busy = 0;
+        double busy_time = 0;
+        int metric_rate = -1;
+        int metric_rejected = -1;
+
+        double rate() const { return rates[active ? 1 : 0]; }
+        double meanProcTime() const { return (n_busy > 0) ? busy_time / n_busy : 0; }
+    };
+
+    /** Get the state of a module, which is registered if not exist (m_mutex should be locked) */
+    Module& getModule(const std::string& name)
+    {
+        auto found = m_modules.find(name);
+        if (found == m_modules.end())
+        {
+            found = m_modules.insert(std::make_pair(name, Module())).first;
+            Metrics& metrics = Metrics::instance();
+            found->second.metric_rate = metrics.registerName(name + ".rate_mhz");
+            found->second.metric_rejected = metrics.registerName(name + ".policy_skipped");
+        }
+        return found->second;
+    }
+
+    bool getStats(const std::string& module, Module& stats) const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto found = m_modules.find(module);
+        if (found == m_modules.end()) return false;
+        stats = found->second;
+        return true;
+    }
+
+    std::map<std::string, Module> m_modules;
+    mutable std::mutex m_mutex;
+};
+
+} // End of 'dg'
+
+#endif // End of '__DG_UTILS_RATE_POLICY__'
@@ -0,0 +1,132 @@
+#ifndef __DG_UTILS_REPLAY_LOG__
+#define __DG_UTILS_REPLAY_LOG__
+
+#include "utils/binary_log.hpp"
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace dg
+{
+
+/**
+ * @brief Recognizer outputs recorded in a data log of DeepGuider
+ *
+ * A data log is a text file whose lines are written by the recognizers as 'timestamp,cam_fnumber,module_name,...'.
+ * The lines are grouped by their camera frame number and module name so that the recorded outputs of each frame
+ * can be fed to the recognizers again through their read() functions instead of running them.
+ * Binary logs (BinaryLogWriter) are also supported; their records are read on demand from the memory-mapped file.
+ */
+class ReplayLog
+{
+public:
+    /**
+     * Load a data log
+     * @param filename The name of the data log file
+     * @return True if successful (false if failed)
+     */
+    bool open(const std::string& filename)
+    {
+        close();
+        if (BinaryLogReader::isBinaryLog(filename))
+        {
+            m_opened = m_binary.open(filename);
+            return m_opened;
+        }
+
+        std::ifstream stream(filename, std::ios::in);
+        if (!stream.is_open())
+        {
+            printf("[ReplayLog] Error: can't open %s\n", filename.c_str());
+            return false;
+        }
+
+        std::string line;
+        while (std::getline(stream, line))
+        {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line.empty()) continue;
+
+            // parse 'timestamp,cam_fnumber,module_name,...'
+            size_t p1 = line.find(',');
+            if (p1 == std::string::npos) continue;
+            size_t p2 = line.find(',', p1 + 1);
+            if (p2 == std::string::npos) continue;
+            size_t p3 = line.find(',', p2 + 1);
+            int fnumber = atoi(line.substr(p1 + 1, p2 - p1 - 1).c_str());
+            if (fnumber < 0) continue;
+            std::string name = line.substr(p2 + 1, (p3 == std::string::npos) ? std::string::npos : p3 - p2 - 1);
+
+            if (fnumber >= (int)m_frames.size()) m_frames.resize(fnumber + 1);
+            m_frames[fnumber][name].push_back(line);
+            m_n_lines++;
+        }
+        m_opened = true;
+        return true;
+    }
+
+    void close()
+    {
+        m_frames.clear();
+        m_binary.close();
+        m_n_lines = 0;
+        m_opened = false;
+    }
+
+    bool isOpened() const { return m_opened; }
+
+    /** Get the number of frames (the last recorded frame number + 1) */
+    int size() const { return m_binary.isOpened() ? m_binary.size() : (int)m_frames.size(); }
+
+    /** Get the number of recorded lines (records for binary logs) */
+    int countLines() const { return m_binary.isOpened() ? (int)m_binary.countRecords() : m_n_lines; }
+
+    /**
+     * Get the recorded lines of a module at the given frame
+     * @param fnumber The camera frame number
+     * @param name The module name
+     * @param lines The recorded lines (empty if nothing is recorded)
+     * @return True if the recorded lines exist (false if not)
+     */
+    bool get(int fnumber, const std::string& name, std::vector<std::string>& lines) const
+    {
+        lines.clear();
+        if (m_binary.isOpened())
+        {
+            m_binary.getLines(fnumber, name, lines);
+            return !lines.empty();
+        }
+        if (fnumber < 0 || fnumber >= (int)m_frames.size()) return false;
+        auto found = m_frames[fnumber].find(name);
+        if (found == m_frames[fnumber].end()) return false;
+        lines = found->second;
+        return !lines.empty();
+    }
+
+    /**
+     * Feed the recorded outputs of the given frame to a recognizer
+     * @param module The recognizer which has read() and name()
+     * @param fnumber The camera frame number
+     * @return True if the recorded outputs exist (false if not)
+     */
+    template <typename T>
+    bool read(T& module, int fnumber) const
+    {
+        std::vector<std::string> lines;
+        if (!get(fnumber, module.name(), lines)) return false;
+        module.read(lines);
+        return true;
+    }
+
+protected:
+    std::vector<std::map<std::string, std::vector<std::string>>> m_frames;
+    BinaryLogReader m_binary;
+    int m_n_lines = 0;
+    bool m_opened = false;
+};
+
+} // End of 'dg'
+
+#endif // End of '__DG_UTILS_REPLAY_LOG__'
@@ -0,0 +1,229 @@
+#ifndef __DG_UTILS_RESULT_CACHE__
+#define __DG_UTILS_RESULT_CACHE__
+
+#include "core/basic_type.hpp"
+#include "opencv2/opencv.hpp"
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <tuple>
+
+namespace dg
+{
+
+/**
+ * @brief Spatio-temporal cache of recognition results
+ *
+ * Results are keyed by the camera index and its quantized position and heading, and each key keeps the latest result with the difference hash of its image.
+ * A result is reused for a new frame at the same key if it is recent enough and the image hash of the frame is close to that of the result,
+ * so a recognizer doesn't run again on near-identical views while the user stands still.
+ * The key resolution, the maximum age, and the maximum hash distance are configurable, and all results can be invalidated by clear().
+ * An empty image (e.g. replaying a data log without decoding video) is not compared, so only its key and age are checked.
+ * All member functions are thread-safe.
+ *
+ * @tparam T The type of results (e.g. std::vector<LogoResult>)
+ */
+template <typename T>
+class ResultCache
+{
+public:
+    /**
+     * The constructor
+     * @param cell_size The size of position cells [m] (non-positive: the position is not used)
+     * @param heading_bin The size of heading bins [rad] (non-positive: the heading is not used)
+     * @param max_age The maximum age of reusable results [sec]
+     * @param max_hash_distance The maximum Hamming distance of image hashes of the same scene (0 ~ 64, negative: images are not compared)
+     * @param max_entries The maximum number of cached results
+     */
+    ResultCache(double cell_size = 2, double heading_bin = CV_PI / 8, double max_age = 3, int max_hash_distance = 6, size_t max_entries = 256)
+    {
+        setParams(cell_size, heading_bin, max_age, max_hash_distance, max_entries);
+    }
+
+    /** Set the parameters (see the constructor), which remove all cached results */
+    void setParams(double cell_size, double heading_bin, double max_age, int max_hash_distance, size_t max_entries = 256)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_cell_size = cell_size;
+        m_heading_bin = heading_bin;
+        m_max_age = max_age;
+        m_max_hash_distance = max_hash_distance;
+        m_max_entries = std::max(max_entries, (size_t)1);
+        m_entries.clear();
+    }
+
+    /** Remove all cached results (e.g. when the map is changed) */
+    void clear()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_entries.clear();
+    }
+
+    /**
+     * Find a reusable result
+     * @param pose The pose of the camera
+     * @param camera The index of the camera (cameras looking at different directions don't share results)
+     * @param hash The image hash of the frame (see calcImageHash())
+     * @param time The capture time of the frame
+     * @param result The cached result
+     * @return True if a reusable result exists (false if not)
+     */
+    bool find(const Pose2& pose, int camera, uint64_t hash, Timestamp time, T& result)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto found = m_entries.find(toKey(pose, camera));
+        if (found != m_entries.end() && isReusable(found->second, hash, time))
+        {
+            result = found->second.result;
+            m_n_hits++;
+            m_saved_time += found->second.proc_time;
+            return true;
+        }
+        m_n_misses++;
+        return false;
+    }
+
+    /**
+     * Add a new result
+     * @param pose The pose of the camera
+     * @param camera The index of the camera
+     * @param hash The image hash of the frame
+     * @param time The capture time of the frame
+     * @param result The recognition result of the frame
+     * @param proc_time The processing time of the result [sec]
+     */
+    void insert(const Pose2& pose, int camera, uint64_t hash, Timestamp time, const T& result, double proc_time)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Entry& entry = m_entries[toKey(pose, camera)];
+        entry.result = result;
+        entry.hash = hash;
+        entry.time = time;
+        entry.proc_time = std::max(proc_time, 0.0);
+        if (m_entries.size() > m_max_entries) evict(time);
+    }
+
+    /** Get the number of reused results */
+    uint64_t countHits() const { std::lock_guard<std::mutex> lock(m_mutex); return m_n_hits; }
+
+    /** Get the number of frames without reusable results */
+    uint64_t countMisses() const { std::lock_guard<std::mutex> lock(m_mutex); return m_n_misses; }
+
+    /** Get the ratio of reused results */
+    double getHitRate() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return (m_n_hits + m_n_misses > 0) ? (double)m_n_hits / (m_n_hits + m_n_misses) : 0;
+    }
+
+    /** Get the processing time saved by reused results [sec] */
+    double getSavedTime() const { std::lock_guard<std::mutex> lock(m_mutex); return m_saved_time; }
+
+    /** Get the number of cached results */
+    size_t size() const { std::lock_guard<std::mutex> lock(m_mutex); return m_entries.size(); }
+
+    /** Print the hit rate and saved processing time */
+    void print(const char* name) const
+    {
+        printf("[cache] %s: %d hits, %d misses (hit rate %.1f%%), %.2f sec saved\n", name, (int)countHits(), (int)countMisses(), getHitRate() * 100, getSavedTime());
+    }
+
+    /**
+     * Calculate the difference hash of an image
+     * The image is shrunk to 9 x 8 in grayscale, and each bit tells whether a pixel is brighter than its right neighbor.
+     * A small image (e.g. decoded at 1/8 size) is enough and faster.
+     * @param image The image
+     * @return The 64-bit hash (0 if the image is empty)
+     */
+    static uint64_t calcImageHash(const cv::Mat& image)
+    {
+        if (image.empty()) return 0;
+        cv::Mat gray = image, tiny;
+        if (image.channels() == 3) cv::cvtColor(image, gray, cv::COLOR_BGR2GRAY);
+        cv::resize(gray, tiny, cv::Size(9, 8), 0, 0, cv::INTER_AREA);
+        uint64_t hash = 0;
+        for (int y = 0; y < 8; y++)
+        {
+            const uchar* row = tiny.ptr<uchar>(y);
+            for (int x = 0; x < 8; x++)
+            {
+                hash = (hash << 1) | (row[x] > row[x + 1] ? 1 : 0);
+            }
+        }
+        return hash;
+    }
+
+    /** Get the Hamming distance of two image hashes */
+    static int calcHashDistance(uint64_t a, uint64_t b)
+    {
+        uint64_t diff = a ^ b;
+        int n = 0;
+        for (; diff; n++) diff &= diff - 1;
+        return n;
+    }
+
+protected:
+    typedef std::tuple<int, int64_t, int64_t, int> Key;
+
+    struct Entry
+    {
+        T result;
+        uint64_t hash = 0;
+        Timestamp time = -1;
+        double proc_time = 0;
+    };
+
+    Key toKey(const Pose2& pose, int camera) const
+    {
+        int64_t ix = (m_cell_size > 0) ? (int64_t)std::floor(pose.x / m_cell_size) : 0;
+        int64_t iy = (m_cell_size > 0) ? (int64_t)std::floor(pose.y / m_cell_size) : 0;
+        int ih = 0;
+        if (m_heading_bin > 0)
+        {
+            int n_bins = std::max((int)std::lround(2 * CV_PI / m_heading_bin), 1);
+            double theta = pose.theta - 2 * CV_PI * std::floor(pose.theta / (2 * CV_PI));
+            ih = (int)std::lround(theta / (2 * CV_PI) * n_bins) % n_bins;
+        }
+        return std::make_tuple(camera, ix, iy, ih);
+    }
+
+    bool isReusable(const Entry& entry, uint64_t hash, Timestamp time) const
+    {
+        if (time < entry.time || time - entry.time > m_max_age) return false;
+        if (m_max_hash_distance < 0 || hash == 0 || entry.hash == 0) return true;
+        return calcHashDistance(hash, entry.hash) <= m_max_hash_distance;
+    }
+
+    /** Remove expired results, or the oldest one if none is expired (m_mutex should be locked) */
+    void evict(Timestamp time)
+    {
+        for (auto entry = m_entries.begin(); entry != m_entries.end();)
+        {
+            if (time - entry->second.time > m_max_age) entry = m_entries.erase(entry);
+            else entry++;
+        }
+        if (m_entries.size() <= m_max_entries) return;
+        auto oldest = m_entries.begin();
+        for (auto entry = m_entries.begin(); entry != m_entries.end(); entry++)
+        {
+            if (entry->second.time < oldest->second.time) oldest = entry;
+        }
+        m_entries.erase(oldest);
+    }
+
+    std::map<Key, Entry> m_entries;
+    double m_cell_size;
+    double m_heading_bin;
+    double m_max_age;
+    int m_max_hash_distance;
+    size_t m_max_entries;
+    uint64_t m_n_hits = 0;
+    uint64_t m_n_misses = 0;
+    double m_saved_time = 0;
+    mutable std::mutex m_mutex;
+};
+
+} // End of 'dg'
+
+#endif // End of '__DG_UTILS_RESULT_CACHE__'
@@ -35,10 +35,26 @@ namespace fs = std::experimental::filesystem;  // When g++ version is < 8.0.
 
 #endif	// _WIN32
 
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <cstdio>
+#include <cstdint>
+#include <cerrno>
+#ifndef _WIN32
+#include <csignal>
+#include <pthread.h>
+#endif
+
 namespace dg
 {
 
-#ifndef _WIN32
 /*** Note that each messages(ex, "Go_forward") should include no space.
  *	 And the length of each message should not be too long,
  *	 because itself is used as a file name : [message].mp3"
@@ -59,6 +75,8 @@ std::string tts_msg_list_example[] = {
 	"Turn back"
 };
 
+#ifndef _WIN32
+
 bool check_dir_exist(void)
 {
 	bool ret = true;
@@ -204,6 +222,402 @@ int tts(std::string sentence, bool print_msg = true)
 	return ret;
 }
 
+
+/**
+ * @brief Text-to-speech service with a prioritized message queue and a decoded audio cache
+ *
+ * A <b>TTS service</b> speaks messages on its own thread through a persistent audio sink process, which receives raw PCM through a pipe.
+ * Phrases are synthesized (by gtts-cli, only if their mp3 files do not exist) and decoded (by ffmpeg) into PCM once,
+ * so standard guidance phrases can be pre-decoded at startup and spoken without any process launch or network access.
+ * Queued messages are deduplicated by their text, and the most urgent and oldest one is spoken first.
+ * An urgent message drops queued messages of lower priority and interrupts a less urgent message being spoken.
+ * On Windows, messages are only printed.
+ */
+class TTSService
+{
+public:
+	/** Priorities of messages */
+	enum
+	{
+		PRIORITY_LOW = 0,
+		PRIORITY_NORMAL = 1,
+		PRIORITY_URGENT = 2
+	};
+
+	/**
+	 * The default constructor
+	 * @param sample_rate The sampling rate of decoded audio [Hz]
+	 */
+	TTSService(int sample_rate = 24000)
+	{
+		m_sample_rate = sample_rate;
+		m_sink_cmd = "aplay -q -t raw -f S16_LE -c 1 -r " + std::to_string(sample_rate);
+		m_sink = nullptr;
+		m_running = false;
+		m_interrupt = false;
+		m_playing_priority = -1;
+		m_n_played = 0;
+		m_n_dropped = 0;
+		m_n_preempted = 0;
+	}
+
+	/** The destructor */
+	virtual ~TTSService() { stop(); }
+
+	/**
+	 * Get standard guidance and system phrases
+	 * @return The list of phrases
+	 */
+	static std::vector<std::string> getStandardPhrases()
+	{
+		std::vector<std::string> phrases(std::begin(tts_msg_list_example), std::end(tts_msg_list_example));
+		phrases.push_back("System is initialized!");
+		phrases.push_back("Arrived to destination!");
+		phrases.push_back("Regenerate path!");
+		return phrases;
+	}
+
+	/**
+	 * Pre-decode phrases into the audio cache
+	 * @param phrases The list of phrases
+	 * @return True if all phrases are decoded (false if not)
+	 */
+	bool initialize(const std::vector<std::string>& phrases)
+	{
+		bool ok = true;
+		for (auto phrase = phrases.begin(); phrase != phrases.end(); phrase++)
+		{
+			if (getPCM(*phrase) == nullptr) ok = false;
+		}
+		return ok;
+	}
+
+	/**
+	 * Set the command of the audio sink process (it should play signed 16-bit mono PCM from its standard input)
+	 * @param cmd The command of the audio sink
+	 */
+	void setSinkCommand(const std::string& cmd) { m_sink_cmd = cmd; }
+
+	/**
+	 * Start the audio sink and the speaking thread
+	 * @return True if the audio sink is opened (false if messages are only printed)
+	 */
+	bool start()
+	{
+		if (m_running) return m_sink != nullptr;
+#ifndef _WIN32
+		m_sink = popen(m_sink_cmd.c_str(), "w");
+		if (m_sink == nullptr) printf("[TTS] Cannot open the audio sink: %s\n", m_sink_cmd.c_str());
+#endif
+		m_running = true;
+		m_thread = std::thread(&TTSService::run, this);
+		return m_sink != nullptr;
+	}
+
+	/**
+	 * Stop the speaking thread and close the audio sink (queued messages are discarded)
+	 */
+	void stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (!m_running) return;
+			m_running = false;
+			m_interrupt = true;
+			m_queue.clear();
+		}
+		m_cv.notify_all();
+		if (m_thread.joinable()) m_thread.join();
+#ifndef _WIN32
+		if (m_sink != nullptr) pclose(m_sink);
+#endif
+		m_sink = nullptr;
+	}
+
+	/**
+	 * Check whether the service is running or not
+	 * @return True if running (false if not)
+	 */
+	bool isRunning() const { return m_running; }
+
+	/**
+	 * Put a message to speak
+	 * @param msg The message
+	 * @param priority The priority of the message (PRIORITY_URGENT pre-empts less urgent messages)
+	 * @param ttl The time to live of the message in the queue [sec]
+	 * @return True if the message is queued or merged to the same message (false if the service is not running)
+	 */
+	bool put(const std::string& msg, int priority = PRIORITY_NORMAL, double ttl = 5)
+	{
+		if (msg.empty()) return false;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (!m_running) return false;
+			if (msg == m_playing_text && priority <= m_playing_priority) return true;
+
+			// Merge the same message
+			for (auto queued = m_queue.begin(); queued != m_queue.end(); queued++)
+			{
+				if (queued->text == msg)
+				{
+					queued->priority = std::max(queued->priority, priority);
+					queued->time = now();
+					queued->ttl = ttl;
+					return true;
+				}
+			}
+
+			// Pre-empt less urgent messages
+			if (priority >= PRIORITY_URGENT)
+			{
+				size_t n_queued = m_queue.size();
+				m_queue.erase(std::remove_if(m_queue.begin(), m_queue.end(), [priority](const Message& m) { return m.priority < priority; }), m_queue.end());
+				m_n_dropped += n_queued - m_queue.size();
+				if (m_playing_priority >= 0 && m_playing_priority < priority) m_interrupt = true;
+			}
+
+			Message message;
+			message.text = msg;
+			message.priority = priority;
+			message.time = now();
+			message.ttl = ttl;
+			m_queue.push_back(message);
+		}
+		m_cv.notify_one();
+		return true;
+	}
+
+	/**
+	 * Get the number of queued messages
+	 * @return The number of queued messages
+	 */
+	size_t countQueued()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_queue.size();
+	}
+
+	/**
+	 * Get the number of decoded phrases
+	 * @return The number of decoded phrases
+	 */
+	size_t countCached()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_pcm.size();
+	}
+
+	/** Get the number of completely spoken messages */
+	size_t countPlayed() const { return m_n_played; }
+
+	/** Get the number of messages dropped by expiration or pre-emption */
+	size_t countDropped() const { return m_n_dropped; }
+
+	/** Get the number of messages interrupted while being spoken */
+	size_t countPreempted() const { return m_n_preempted; }
+
+protected:
+	/** A queued message */
+	struct Message
+	{
+		std::string text;
+		int priority;
+		double time;
+		double ttl;
+	};
+
+	/** Get the current time [sec] */
+	static double now()
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	/**
+	 * Get the decoded audio of a phrase (synthesized and decoded if not cached)
+	 * @param phrase The phrase
+	 * @return The pointer to signed 16-bit mono PCM (nullptr if failed)
+	 */
+	const std::vector<int16_t>* getPCM(const std::string& phrase)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			auto found = m_pcm.find(phrase);
+			if (found != m_pcm.end()) return &found->second;
+		}
+		std::vector<int16_t> pcm;
+		if (!decode(phrase, pcm)) return nullptr;
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return &(m_pcm[phrase] = std::move(pcm));
+	}
+
+	/**
+	 * Synthesize and decode a phrase
+	 * @param phrase The phrase
+	 * @param pcm The decoded signed 16-bit mono PCM
+	 * @return True if successful (false if failed)
+	 */
+	virtual bool decode(const std::string& phrase, std::vector<int16_t>& pcm)
+	{
+#ifndef _WIN32
+		std::string fname_noext = RemoveSpecials(phrase);
+		if (!check_dir_exist()) return false;
+		if (!check_file_exist(fname_noext) && _tts_mp3gen(phrase, fname_noext) != 0) return false;
+
+		std::string fname = SOUND_FILE(fname_noext);
+		std::string cmd = "ffmpeg -loglevel quiet -i " + fname + " -f s16le -ac 1 -ar " + std::to_string(m_sample_rate) + " - 2>/dev/null";
+		FILE* fp = popen(cmd.c_str(), "r");
+		if (fp == nullptr) return false;
+		pcm.clear();
+		int16_t buffer[4096];
+		size_t n;
+		while ((n = fread(buffer, sizeof(int16_t), 4096, fp)) > 0)
+			pcm.insert(pcm.end(), buffer, buffer + n);
+		return pclose(fp) == 0 && !pcm.empty();
+#else
+		return false;
+#endif
+	}
+
+	/**
+	 * Speak a message
+	 * @param msg The message
+	 * @return True if completely spoken (false if interrupted or failed)
+	 */
+	bool play(const Message& msg)
+	{
+		printf("[TTS] %s\n", msg.text.c_str());
+		const std::vector<int16_t>* pcm = getPCM(msg.text);
+		if (pcm == nullptr || m_sink == nullptr) return false;
+
+		// Write in short chunks, keeping the sink slightly ahead of playback so that it can be interrupted quickly
+		const size_t chunk = m_sample_rate / 20;
+		const double lead = 0.2;
+		double start = now();
+		for (size_t i = 0; i < pcm->size(); i += chunk)
+		{
+			if (m_interrupt) return false;
+			double ahead = (double)i / m_sample_rate - (now() - start);
+			if (ahead > lead) std::this_thread::sleep_for(std::chrono::duration<double>(ahead - lead));
+			size_t n = std::min(chunk, pcm->size() - i);
+			if (fwrite(pcm->data() + i, sizeof(int16_t), n, m_sink) != n || fflush(m_sink) != 0)
+			{
+				if (errno == EPIPE) closeBrokenSink();
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/**
+	 * Close the audio sink whose process has exited
+	 * SIGPIPE of the failed write is blocked on the speaking thread (see run()), so it is consumed here instead of killing the process.
+	 */
+	void closeBrokenSink()
+	{
+#ifndef _WIN32
+		sigset_t sigpipe;
+		sigemptyset(&sigpipe);
+		sigaddset(&sigpipe, SIGPIPE);
+		struct timespec no_wait = { 0, 0 };
+		sigtimedwait(&sigpipe, nullptr, &no_wait);
+		printf("[TTS] The audio sink is closed: %s\n", m_sink_cmd.c_str());
+		pclose(m_sink);
+		m_sink = nullptr;
+#endif
+	}
+
+	/** Speak queued messages until stopped */
+	void run()
+	{
+#ifndef _WIN32
+		// Writing to the exited sink fails with EPIPE on this thread (other threads keep the default SIGPIPE action)
+		sigset_t sigpipe;
+		sigemptyset(&sigpipe);
+		sigaddset(&sigpipe, SIGPIPE);
+		pthread_sigmask(SIG_BLOCK, &sigpipe, nullptr);
+#endif
+		while (true)
+		{
+			Message msg;
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_cv.wait(lock, [this] { return !m_running || !m_queue.empty(); });
+				if (!m_running) break;
+
+				// Drop expired messages and select the most urgent and oldest one
+				double t = now();
+				size_t n_queued = m_queue.size();
+				m_queue.erase(std::remove_if(m_queue.begin(), m_queue.end(), [t](const Message& m) { return t - m.time > m.ttl; }), m_queue.end());
+				m_n_dropped += n_queued - m_queue.size();
+				if (m_queue.empty()) continue;
+				auto best = m_queue.begin();
+				for (auto queued = m_queue.begin(); queued != m_queue.end(); queued++)
+				{
+					if (queued->priority > best->priority) best = queued;
+				}
+				msg = *best;
+				m_queue.erase(best);
+				m_playing_text = msg.text;
+				m_playing_priority = msg.priority;
+				m_interrupt = false;
+			}
+
+			bool ok = play(msg);
+
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (ok) m_n_played++;
+			else if (m_interrupt && m_running) m_n_preempted++;
+			m_playing_text.clear();
+			m_playing_priority = -1;
+		}
+	}
+
+	/** The sampling rate of decoded audio */
+	int m_sample_rate;
+
+	/** The command of the audio sink process */
+	std::string m_sink_cmd;
+
+	/** The pipe to the audio sink process */
+	FILE* m_sink;
+
+	/** The decoded audio of phrases */
+	std::unordered_map<std::string, std::vector<int16_t>> m_pcm;
+
+	/** The queued messages */
+	std::vector<Message> m_queue;
+
+	/** The message being spoken */
+	std::string m_playing_text;
+
+	/** The priority of the message being spoken (-1 if nothing is spoken) */
+	int m_playing_priority;
+
+	/** The flag to interrupt the message being spoken */
+	std::atomic<bool> m_interrupt;
+
+	/** The flag of the speaking thread */
+	std::atomic<bool> m_running;
+
+	/** The speaking thread */
+	std::thread m_thread;
+
+	/** The lock of the queue and the audio cache */
+	std::mutex m_mutex;
+
+	/** The condition to wake up the speaking thread */
+	std::condition_variable m_cv;
+
+	/** The number of completely spoken messages */
+	std::atomic<size_t> m_n_played;
+
+	/** The number of dropped messages */
+	std::atomic<size_t> m_n_dropped;
+
+	/** The number of interrupted messages */
+	std::atomic<size_t> m_n_preempted;
+}; // End of 'TTSService'
+
 } // End of 'dg'
 
 #endif // End of '__DG_TTS__'
@@ -30,6 +30,8 @@ namespace dg
         */
         bool initialize(const char* module_name = "vps", const char* module_path = "./../src/vps", const char* class_name = "vps", const char* func_name_init = "initialize", const char* func_name_apply = "apply")
         {
+            DG_TRACE_SCOPE("VPS::initialize");
+
             dg::Timestamp t1 = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count() / 1000.0;
 
             PyGILState_STATE state;
@@ -69,6 +71,8 @@ namespace dg
         */
         bool apply(cv::Mat image, int N, double gps_lat, double gps_lon, double gps_accuracy, dg::Timestamp ts, const char* ipaddr)
         {
+            DG_TRACE_SCOPE("VPS::apply");
+
             dg::Timestamp t1 = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count() / 1000.0;
 
             PyGILState_STATE state;
@@ -241,7 +245,7 @@ namespace dg
             }
         }
 
-        void write(std::ofstream& stream, int cam_fnumber = -1) const
+        void write(std::ostream& stream, int cam_fnumber = -1) const
         {
             for (int k = 0; k < m_streetviews.size(); k++)
             {